@@ -0,0 +1,737 @@
+// GATT replay benchmark: runs the firmware's BLE service (Bluedroid backend,
+// ble_server.c and the modules behind it) on the host shim and feeds it a
+// scripted sequence of GATT events. Reports per event type the handler
+// time, CPU time, NVS calls and lock waits, plus the firmware's own
+// profiler (prof.h, as served by GET /prof). The script's expect lines
+// check what the stack was asked to send; any failure makes the exit
+// status 1.
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ble_server.h"
+#include "config.h"
+#include "esp_gap_ble_api.h"
+#include "esp_gatts_api.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "host_shim.h"
+#include "led_controller.h"
+#include "led_strip.h"
+#include "nvs_flash.h"
+#include "prof.h"
+#include "web_server.h"
+
+#define TAG "REPLAY"
+
+#define SCRIPT_STEPS_MAX    256
+#define SCRIPT_DEPTH_MAX    8
+#define STEP_DATA_MAX       512
+#define NVS_LATENCY_DEFAULT 5000    // µs per NVS write; flash page writes take a few ms
+
+// --- Script ---
+
+typedef enum {
+    OP_REG,             // reg
+    OP_CONNECT,         // connect <conn> [interval, 1.25 ms units]
+    OP_MTU,             // mtu <conn> <mtu>
+    OP_SUBSCRIBE,       // subscribe <conn> <uuid> <cccd>
+    OP_READ,            // read <conn> <uuid> [offset]
+    OP_WRITE,           // write <conn> <uuid> <text | 0xHEX>
+    OP_WRITE_CMD,       // writecmd <conn> <uuid> <text | 0xHEX>   (no response)
+    OP_PREPARE,         // prepare <conn> <uuid> <offset> <text | 0xHEX>   queued write fragment
+    OP_EXECUTE,         // execute <conn> <0|1>   cancel / execute the queued write
+    OP_DISCONNECT,      // disconnect <conn>
+    OP_SLEEP,           // sleep <ms>      let timers, notifications and animations run
+    OP_RESET,           // reset           drop the statistics gathered so far
+    OP_BOND,            // bond <conn>     the stack reports conn's peer as bonded
+    OP_ENABLE,          // enable <0|1>    ble_set_enabled(), as from the web UI
+    OP_EXPECT,          // expect <check> ...   see check_t
+    OP_REPEAT,          // repeat <n> ... end
+    OP_END,
+} op_t;
+
+static const char *const s_op_names[] = {
+    [OP_REG] = "reg", [OP_CONNECT] = "connect", [OP_MTU] = "mtu",
+    [OP_SUBSCRIBE] = "subscribe", [OP_READ] = "read", [OP_WRITE] = "write",
+    [OP_WRITE_CMD] = "writecmd", [OP_PREPARE] = "prepare", [OP_EXECUTE] = "execute",
+    [OP_DISCONNECT] = "disconnect", [OP_SLEEP] = "sleep",
+    [OP_RESET] = "reset", [OP_BOND] = "bond", [OP_ENABLE] = "enable",
+    [OP_EXPECT] = "expect", [OP_REPEAT] = "repeat", [OP_END] = "end",
+};
+
+typedef enum {
+    CHECK_STATUS,       // status <conn> <hex>           of the link's last response
+    CHECK_VALUE,        // value <conn> <text | 0xHEX>   of the link's last response
+    CHECK_RESPONSES,    // responses <conn> <n>          since the link connected
+    CHECK_NOTIFY,       // notify <conn> <uuid> <n>      notifications + indications, same
+    CHECK_SVC_CHANGED,  // svc_changed <conn> <n>        Service Changed indications, same
+                        // (counts: n exactly, or n+ for at least n)
+    CHECK_LINK,         // link <conn> <0|1>             link still open
+    CHECK_LINKS,        // links <n>                     open links
+    CHECK_ADVERTISING,  // advertising <0|1>
+    CHECK_COUNT,
+} check_t;
+
+static const char *const s_check_names[CHECK_COUNT] = {
+    [CHECK_STATUS] = "status", [CHECK_VALUE] = "value", [CHECK_RESPONSES] = "responses",
+    [CHECK_NOTIFY] = "notify", [CHECK_SVC_CHANGED] = "svc_changed", [CHECK_LINK] = "link",
+    [CHECK_LINKS] = "links", [CHECK_ADVERTISING] = "advertising",
+};
+
+typedef struct {
+    op_t     op;
+    int      line;
+    uint16_t conn;
+    uint16_t uuid;
+    uint32_t arg;       // interval, MTU, CCCD, offset, flag, ms, repeat count, check_t;
+                        // END: REPEAT index
+    uint32_t want;      // EXPECT: expected count / status / state
+    bool     at_least;  // EXPECT: count is a minimum
+    uint16_t len;
+    uint8_t  data[STEP_DATA_MAX];
+} step_t;
+
+static step_t s_steps[SCRIPT_STEPS_MAX];
+static int    s_step_count;
+
+static void script_fail(int line, const char *msg)
+{
+    fprintf(stderr, "script line %d: %s\n", line, msg);
+    exit(2);
+}
+
+// Value of a write: 0x-prefixed hex bytes, otherwise the text as written
+static void parse_value(step_t *st, char *s)
+{
+    size_t n = strlen(s);
+    while (n && isspace((unsigned char)s[n - 1])) s[--n] = '\0';
+    if (strncmp(s, "0x", 2) == 0) {
+        s += 2;
+        n = strlen(s);
+        if (n % 2 || n / 2 > STEP_DATA_MAX) script_fail(st->line, "bad hex value");
+        for (size_t i = 0; i < n / 2; i++) {
+            unsigned v;
+            if (sscanf(s + 2 * i, "%2x", &v) != 1) script_fail(st->line, "bad hex value");
+            st->data[i] = v;
+        }
+        st->len = n / 2;
+    } else {
+        if (n > STEP_DATA_MAX) script_fail(st->line, "value too long");
+        memcpy(st->data, s, n);
+        st->len = n;
+    }
+}
+
+static void script_load(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        exit(2);
+    }
+    int  open_repeat[SCRIPT_DEPTH_MAX];
+    int  depth = 0;
+    char buf[STEP_DATA_MAX + 64];
+    for (int line = 1; fgets(buf, sizeof(buf), f); line++) {
+        char *hash = strchr(buf, '#');
+        if (hash && (hash == buf || isspace((unsigned char)hash[-1]))) *hash = '\0';
+        char *p = buf;
+        while (isspace((unsigned char)*p)) p++;
+        if (!*p) continue;
+        if (s_step_count == SCRIPT_STEPS_MAX) script_fail(line, "too many steps");
+
+        char word[16];
+        int  used = 0;
+        sscanf(p, "%15s%n", word, &used);
+        p += used;
+        step_t *st = &s_steps[s_step_count];
+        memset(st, 0, sizeof(*st));
+        st->line = line;
+        st->op   = OP_END + 1;
+        for (op_t op = 0; op <= OP_END; op++)
+            if (strcmp(word, s_op_names[op]) == 0) st->op = op;
+
+        unsigned a = 0, b = 0;
+        int n = 0;
+        switch (st->op) {
+        case OP_REG:
+        case OP_RESET:
+            break;
+        case OP_CONNECT:
+            n = sscanf(p, "%u %u", &a, &b);
+            if (n < 1) script_fail(line, "usage: connect <conn> [interval]");
+            st->conn = a;
+            st->arg  = n == 2 ? b : 24;
+            break;
+        case OP_MTU:
+            if (sscanf(p, "%u %u", &a, &b) != 2) script_fail(line, "usage: mtu <conn> <mtu>");
+            st->conn = a;
+            st->arg  = b;
+            break;
+        case OP_SUBSCRIBE:
+            if (sscanf(p, "%u %x %x", &a, &b, &st->arg) != 3)
+                script_fail(line, "usage: subscribe <conn> <uuid> <cccd>");
+            st->conn = a;
+            st->uuid = b;
+            break;
+        case OP_READ:
+            if (sscanf(p, "%u %x %u", &a, &b, &st->arg) < 2)
+                script_fail(line, "usage: read <conn> <uuid> [offset]");
+            st->conn = a;
+            st->uuid = b;
+            break;
+        case OP_WRITE:
+        case OP_WRITE_CMD:
+            if (sscanf(p, "%u %x %n", &a, &b, &n) != 2 || !n)
+                script_fail(line, "usage: write <conn> <uuid> <value>");
+            st->conn = a;
+            st->uuid = b;
+            parse_value(st, p + n);
+            break;
+        case OP_PREPARE:
+            if (sscanf(p, "%u %x %u %n", &a, &b, &st->arg, &n) != 3 || !n)
+                script_fail(line, "usage: prepare <conn> <uuid> <offset> <value>");
+            st->conn = a;
+            st->uuid = b;
+            parse_value(st, p + n);
+            break;
+        case OP_EXECUTE:
+            if (sscanf(p, "%u %u", &a, &st->arg) != 2 || st->arg > 1)
+                script_fail(line, "usage: execute <conn> <0|1>");
+            st->conn = a;
+            break;
+        case OP_DISCONNECT:
+            if (sscanf(p, "%u", &a) != 1) script_fail(line, "usage: disconnect <conn>");
+            st->conn = a;
+            break;
+        case OP_SLEEP:
+            if (sscanf(p, "%u", &st->arg) != 1) script_fail(line, "usage: sleep <ms>");
+            break;
+        case OP_BOND:
+            if (sscanf(p, "%u", &a) != 1) script_fail(line, "usage: bond <conn>");
+            st->conn = a;
+            break;
+        case OP_ENABLE:
+            if (sscanf(p, "%u", &st->arg) != 1 || st->arg > 1) script_fail(line, "usage: enable <0|1>");
+            break;
+        case OP_EXPECT:
+            sscanf(p, "%15s%n", word, &used);
+            p += used;
+            st->arg = CHECK_COUNT;
+            for (check_t c = 0; c < CHECK_COUNT; c++)
+                if (strcmp(word, s_check_names[c]) == 0) st->arg = c;
+            switch (st->arg) {
+            case CHECK_STATUS:
+                n = sscanf(p, "%u %x", &a, &st->want) == 2;
+                break;
+            case CHECK_VALUE:
+                n = sscanf(p, "%u %n", &a, &used) == 1;
+                if (n) parse_value(st, p + used);
+                break;
+            case CHECK_RESPONSES:
+            case CHECK_SVC_CHANGED:
+                n = sscanf(p, "%u %u%n", &a, &st->want, &used) == 2;
+                st->at_least = n && p[used] == '+';
+                break;
+            case CHECK_NOTIFY:
+                n = sscanf(p, "%u %x %u%n", &a, &b, &st->want, &used) == 3;
+                st->at_least = n && p[used] == '+';
+                st->uuid = b;
+                break;
+            case CHECK_LINK:
+                n = sscanf(p, "%u %u", &a, &st->want) == 2;
+                break;
+            case CHECK_LINKS:
+            case CHECK_ADVERTISING:
+                n = sscanf(p, "%u", &st->want) == 1;
+                break;
+            default:
+                script_fail(line, "unknown check");
+            }
+            if (!n) script_fail(line, "bad expect arguments");
+            st->conn = a;
+            break;
+        case OP_REPEAT:
+            if (sscanf(p, "%u", &st->arg) != 1) script_fail(line, "usage: repeat <n>");
+            if (depth == SCRIPT_DEPTH_MAX) script_fail(line, "repeat nested too deep");
+            open_repeat[depth++] = s_step_count;
+            break;
+        case OP_END:
+            if (!depth) script_fail(line, "end without repeat");
+            st->arg = open_repeat[--depth];
+            break;
+        default:
+            script_fail(line, "unknown command");
+        }
+        s_step_count++;
+    }
+    fclose(f);
+    if (depth) script_fail(s_steps[open_repeat[depth - 1]].line, "repeat without end");
+}
+
+// --- Per-event statistics ---
+
+typedef struct {
+    uint32_t count;
+    uint64_t wall_us;
+    uint64_t wall_max_us;
+    uint64_t cpu_us;
+    uint32_t nvs_calls;
+    uint32_t nvs_writes;
+    uint64_t nvs_us;
+    uint32_t sem_waits;
+    uint64_t sem_wait_us;
+    uint32_t mux_waits;
+} evt_stat_t;
+
+#define GATTS_EVT_MAX   (ESP_GATTS_SEND_SERVICE_CHANGE_EVT + 1)
+#define GAP_EVT_MAX     (ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT + 1)
+
+static evt_stat_t s_gatts_stat[GATTS_EVT_MAX];
+static evt_stat_t s_gap_stat[GAP_EVT_MAX];
+
+static const char *const s_gatts_names[GATTS_EVT_MAX] = {
+    [ESP_GATTS_REG_EVT]            = "REG",
+    [ESP_GATTS_READ_EVT]           = "READ",
+    [ESP_GATTS_WRITE_EVT]          = "WRITE",
+    [ESP_GATTS_EXEC_WRITE_EVT]     = "EXEC_WRITE",
+    [ESP_GATTS_MTU_EVT]            = "MTU",
+    [ESP_GATTS_CONF_EVT]           = "CONF",
+    [ESP_GATTS_START_EVT]          = "START",
+    [ESP_GATTS_CONNECT_EVT]        = "CONNECT",
+    [ESP_GATTS_DISCONNECT_EVT]     = "DISCONNECT",
+    [ESP_GATTS_CREAT_ATTR_TAB_EVT] = "CREAT_ATTR_TAB",
+};
+
+static const char *const s_gap_names[GAP_EVT_MAX] = {
+    [ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT] = "GAP ADV_DATA_RAW",
+    [ESP_GAP_BLE_ADV_START_COMPLETE_EVT]        = "GAP ADV_START",
+    [ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT]         = "GAP ADV_STOP",
+    [ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT]        = "GAP CONN_PARAMS",
+    [ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT]   = "GAP PKT_LENGTH",
+    [ESP_GAP_BLE_READ_RSSI_COMPLETE_EVT]        = "GAP READ_RSSI",
+    [ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT]       = "GAP PHY_UPDATE",
+};
+
+static int64_t             s_t0_us;
+static uint64_t            s_cpu0_us;
+static shim_thread_stats_t s_ts0;
+
+static uint64_t thread_cpu_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Events are delivered one at a time on this thread, as on the BTC task
+static void probe(bool gatts, int event, bool done)
+{
+    if (!done) {
+        s_ts0     = shim_thread_stats();
+        s_cpu0_us = thread_cpu_us();
+        s_t0_us   = esp_timer_get_time();
+        return;
+    }
+    uint64_t wall = esp_timer_get_time() - s_t0_us;
+    uint64_t cpu  = thread_cpu_us() - s_cpu0_us;
+    shim_thread_stats_t ts = shim_thread_stats();
+    if (event < 0 || event >= (gatts ? GATTS_EVT_MAX : GAP_EVT_MAX)) return;
+
+    evt_stat_t *st = gatts ? &s_gatts_stat[event] : &s_gap_stat[event];
+    st->count++;
+    st->wall_us += wall;
+    if (wall > st->wall_max_us) st->wall_max_us = wall;
+    st->cpu_us      += cpu;
+    st->nvs_calls   += ts.nvs_calls   - s_ts0.nvs_calls;
+    st->nvs_writes  += ts.nvs_writes  - s_ts0.nvs_writes;
+    st->nvs_us      += ts.nvs_us      - s_ts0.nvs_us;
+    st->sem_waits   += ts.sem_waits   - s_ts0.sem_waits;
+    st->sem_wait_us += ts.sem_wait_us - s_ts0.sem_wait_us;
+    st->mux_waits   += ts.mux_waits   - s_ts0.mux_waits;
+}
+
+// Connect to first ATT response, per link: the wait of a client that
+// reuses cached handles instead of rediscovering
+#define FIRST_LINKS_MAX 16
+
+static int64_t  s_connect_us[FIRST_LINKS_MAX];   // 0: no response pending
+static uint32_t s_first_count;
+static uint64_t s_first_us;
+static uint64_t s_first_max_us;
+
+static void first_response_check(uint16_t conn)
+{
+    shim_bt_link_t link;
+    if (conn >= FIRST_LINKS_MAX || !s_connect_us[conn] ||
+        !shim_bt_link(conn, &link) || !link.responses)
+        return;
+    uint64_t us = esp_timer_get_time() - s_connect_us[conn];
+    s_connect_us[conn] = 0;
+    s_first_count++;
+    s_first_us += us;
+    if (us > s_first_max_us) s_first_max_us = us;
+}
+
+// --- Event injection ---
+
+static uint32_t s_trans_id;
+
+static void peer_bda(uint16_t conn, esp_bd_addr_t bda)
+{
+    const esp_bd_addr_t base = { 0xC0, 0xFF, 0xEE, 0x00, 0x00, 0x00 };
+    memcpy(bda, base, sizeof(base));
+    bda[5] = conn;
+}
+
+static uint16_t step_handle(const step_t *st, bool cccd)
+{
+    uint16_t h = shim_bt_handle(st->uuid, cccd);
+    if (!h) script_fail(st->line, cccd ? "characteristic has no CCCD (or no reg yet)"
+                                       : "unknown characteristic (or no reg yet)");
+    return h;
+}
+
+// is_prep: a Prepare Write fragment at st->arg
+static void inject_write(const step_t *st, uint16_t handle, const uint8_t *data,
+                         uint16_t len, bool need_rsp, bool is_prep)
+{
+    // The stack hands the app its own copy of the PDU
+    uint8_t value[STEP_DATA_MAX];
+    memcpy(value, data, len);
+    esp_ble_gatts_cb_param_t p = {0};
+    p.write.conn_id  = st->conn;
+    p.write.trans_id = ++s_trans_id;
+    p.write.handle   = handle;
+    p.write.need_rsp = need_rsp;
+    p.write.is_prep  = is_prep;
+    p.write.offset   = is_prep ? st->arg : 0;
+    p.write.len      = len;
+    p.write.value    = value;
+    peer_bda(st->conn, p.write.bda);
+    shim_bt_gatts_event(ESP_GATTS_WRITE_EVT, &p);
+}
+
+// --- Checks ---
+
+static uint32_t s_checks, s_failures;
+
+static void check_fail(const step_t *st, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static void check_fail(const step_t *st, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(stderr, "FAIL line %d: expect %s: ", st->line, s_check_names[st->arg]);
+    vfprintf(stderr, fmt, ap);
+    fputc('\n', stderr);
+    va_end(ap);
+    s_failures++;
+}
+
+static void check_count(const step_t *st, uint32_t got)
+{
+    if (st->at_least ? got < st->want : got != st->want)
+        check_fail(st, "conn %u: expected %lu%s, got %lu", st->conn,
+                   (unsigned long)st->want, st->at_least ? " or more" : "", (unsigned long)got);
+}
+
+static void check_run(const step_t *st)
+{
+    shim_bt_link_t  link;
+    shim_bt_stats_t bt = shim_bt_stats();
+    bool            seen = shim_bt_link(st->conn, &link);
+
+    s_checks++;
+    switch (st->arg) {
+    case CHECK_STATUS:
+        if (!seen || !link.responses)
+            check_fail(st, "conn %u: no response", st->conn);
+        else if (link.last_status != st->want)
+            check_fail(st, "conn %u: expected 0x%02lx, got 0x%02x", st->conn,
+                       (unsigned long)st->want, link.last_status);
+        break;
+
+    case CHECK_VALUE:
+        if (!seen || !link.responses)
+            check_fail(st, "conn %u: no response", st->conn);
+        else if (link.last_len != st->len || memcmp(link.last_value, st->data, st->len))
+            check_fail(st, "conn %u: expected \"%.*s\" (%u bytes), got \"%.*s\" (%u bytes)",
+                       st->conn, st->len, (const char *)st->data, st->len,
+                       link.last_len, (const char *)link.last_value, link.last_len);
+        break;
+
+    case CHECK_RESPONSES:
+        check_count(st, seen ? link.responses : 0);
+        break;
+
+    case CHECK_NOTIFY: {
+        uint16_t i = step_handle(st, false) - SHIM_BT_FIRST_HANDLE;
+        check_count(st, seen && i < SHIM_BT_HANDLES ? link.sent[i] : 0);
+        break;
+    }
+
+    case CHECK_SVC_CHANGED:
+        check_count(st, seen ? link.svc_changed : 0);
+        break;
+
+    case CHECK_LINK:
+        check_count(st, seen && link.open);
+        break;
+
+    case CHECK_LINKS:
+        check_count(st, bt.links_open);
+        break;
+
+    case CHECK_ADVERTISING:
+        check_count(st, bt.advertising);
+        break;
+    }
+}
+
+static void step_run(const step_t *st)
+{
+    esp_ble_gatts_cb_param_t p = {0};
+
+    switch (st->op) {
+    case OP_REG:
+        p.reg.status = ESP_GATT_OK;
+        p.reg.app_id = 0;
+        shim_bt_gatts_event(ESP_GATTS_REG_EVT, &p);
+        break;
+
+    case OP_CONNECT:
+        p.connect.conn_id              = st->conn;
+        p.connect.conn_params.interval = st->arg;
+        p.connect.conn_params.latency  = 0;
+        p.connect.conn_params.timeout  = 400;
+        peer_bda(st->conn, p.connect.remote_bda);
+        if (st->conn < FIRST_LINKS_MAX) s_connect_us[st->conn] = esp_timer_get_time();
+        shim_bt_gatts_event(ESP_GATTS_CONNECT_EVT, &p);
+        break;
+
+    case OP_MTU:
+        p.mtu.conn_id = st->conn;
+        p.mtu.mtu     = st->arg;
+        shim_bt_gatts_event(ESP_GATTS_MTU_EVT, &p);
+        break;
+
+    case OP_SUBSCRIBE: {
+        const uint8_t cccd[2] = { st->arg & 0xFF, st->arg >> 8 };
+        inject_write(st, step_handle(st, true), cccd, sizeof(cccd), true, false);
+        break;
+    }
+
+    case OP_READ:
+        p.read.conn_id  = st->conn;
+        p.read.trans_id = ++s_trans_id;
+        p.read.handle   = step_handle(st, false);
+        p.read.offset   = st->arg;
+        p.read.is_long  = st->arg > 0;
+        p.read.need_rsp = true;
+        peer_bda(st->conn, p.read.bda);
+        shim_bt_gatts_event(ESP_GATTS_READ_EVT, &p);
+        break;
+
+    case OP_WRITE:
+    case OP_WRITE_CMD:
+        inject_write(st, step_handle(st, false), st->data, st->len, st->op == OP_WRITE, false);
+        break;
+
+    case OP_PREPARE:
+        inject_write(st, step_handle(st, false), st->data, st->len, true, true);
+        break;
+
+    case OP_EXECUTE:
+        p.exec_write.conn_id         = st->conn;
+        p.exec_write.trans_id        = ++s_trans_id;
+        p.exec_write.exec_write_flag = st->arg ? ESP_GATT_PREP_WRITE_EXEC : ESP_GATT_PREP_WRITE_CANCEL;
+        peer_bda(st->conn, p.exec_write.bda);
+        shim_bt_gatts_event(ESP_GATTS_EXEC_WRITE_EVT, &p);
+        break;
+
+    case OP_DISCONNECT:
+        p.disconnect.conn_id = st->conn;
+        p.disconnect.reason  = ESP_GATT_CONN_TERMINATE_PEER_USER;
+        peer_bda(st->conn, p.disconnect.remote_bda);
+        shim_bt_gatts_event(ESP_GATTS_DISCONNECT_EVT, &p);
+        break;
+
+    case OP_SLEEP: {
+        // Keep answering the stack requests that timers make meanwhile
+        int64_t end = esp_timer_get_time() + (int64_t)st->arg * 1000;
+        while (esp_timer_get_time() < end) {
+            shim_bt_run();
+            usleep(1000);
+        }
+        break;
+    }
+
+    case OP_BOND: {
+        esp_bd_addr_t bda;
+        peer_bda(st->conn, bda);
+        shim_bt_add_bond(bda);
+        break;
+    }
+
+    case OP_ENABLE:
+        ble_set_enabled(st->arg);
+        break;
+
+    case OP_EXPECT:
+        check_run(st);
+        return;
+
+    case OP_RESET:
+        memset(s_gatts_stat, 0, sizeof(s_gatts_stat));
+        memset(s_gap_stat, 0, sizeof(s_gap_stat));
+        s_first_count = 0;
+        s_first_us = s_first_max_us = 0;
+        prof_reset();
+        break;
+
+    default:
+        break;
+    }
+    shim_bt_run();
+    first_response_check(st->conn);
+}
+
+static void script_run(void)
+{
+    uint32_t left[SCRIPT_STEPS_MAX];    // iterations left, per REPEAT step
+    for (int pc = 0; pc < s_step_count; pc++) {
+        const step_t *st = &s_steps[pc];
+        if (st->op == OP_REPEAT) {
+            left[pc] = st->arg;
+            if (!left[pc]) {
+                // Skip to the matching END
+                int depth = 0;
+                while (++pc < s_step_count &&
+                       !(s_steps[pc].op == OP_END && depth-- == 0))
+                    if (s_steps[pc].op == OP_REPEAT) depth++;
+            }
+        } else if (st->op == OP_END) {
+            if (--left[st->arg]) pc = st->arg;
+        } else {
+            step_run(st);
+        }
+    }
+}
+
+// --- Report ---
+
+static void stat_print(const char *name, const evt_stat_t *st)
+{
+    if (!st->count) return;
+    printf("%-18s %7lu %9.1f %9lu %9.1f %6lu %7lu %9.1f %6lu %9.1f %6lu\n", name,
+           (unsigned long)st->count,
+           (double)st->wall_us / st->count, (unsigned long)st->wall_max_us,
+           (double)st->cpu_us / st->count,
+           (unsigned long)st->nvs_calls, (unsigned long)st->nvs_writes,
+           st->nvs_writes ? (double)st->nvs_us / st->nvs_writes : 0.0,
+           (unsigned long)st->sem_waits,
+           st->sem_waits ? (double)st->sem_wait_us / st->sem_waits : 0.0,
+           (unsigned long)st->mux_waits);
+}
+
+static void report(uint32_t nvs_latency_us)
+{
+    printf("\nHandler cost per delivered event (NVS write latency %lu us)\n\n",
+           (unsigned long)nvs_latency_us);
+    printf("%-18s %7s %9s %9s %9s %6s %7s %9s %6s %9s %6s\n", "event", "count",
+           "avg_us", "max_us", "cpu_us", "nvs", "nvs_wr", "us/write", "waits", "us/wait", "mux");
+    for (int i = 0; i < GATTS_EVT_MAX; i++)
+        stat_print(s_gatts_names[i] ? s_gatts_names[i] : "GATTS (other)", &s_gatts_stat[i]);
+    for (int i = 0; i < GAP_EVT_MAX; i++)
+        stat_print(s_gap_names[i] ? s_gap_names[i] : "GAP (other)", &s_gap_stat[i]);
+    if (s_first_count)
+        printf("\nConnect to first ATT response: %lu links, avg %.1f us, max %lu us\n",
+               (unsigned long)s_first_count, (double)s_first_us / s_first_count,
+               (unsigned long)s_first_max_us);
+
+    static const char *const prof_names[PROF_EVT_COUNT] = {
+        [PROF_EVT_CONNECT] = "connect", [PROF_EVT_DISCONNECT] = "disconnect",
+        [PROF_EVT_READ] = "read", [PROF_EVT_WRITE] = "write",
+        [PROF_EVT_OTHER_GATT] = "other_gatt", [PROF_EVT_GAP] = "gap",
+    };
+    prof_stats_t ps;
+    prof_get(&ps);
+    printf("\nFirmware profiler (GET /prof)\n\n");
+    printf("%-18s %7s %9s %9s %7s %9s %6s %9s\n", "event", "count", "avg_us", "max_us",
+           "nvs_wr", "nvs_us", "waits", "wait_us");
+    for (int i = 0; i <= PROF_EVT_COUNT; i++) {
+        const prof_stat_t *p = i < PROF_EVT_COUNT ? &ps.evt[i] : &ps.total;
+        if (!p->count && i < PROF_EVT_COUNT) continue;
+        printf("%-18s %7lu %9.1f %9lu %7lu %9lu %6lu %9lu\n",
+               i < PROF_EVT_COUNT ? prof_names[i] : "total (all tasks)",
+               (unsigned long)p->count, p->count ? (double)p->total_us / p->count : 0.0,
+               (unsigned long)p->max_us, (unsigned long)p->nvs_writes,
+               (unsigned long)p->nvs_us, (unsigned long)p->lock_waits,
+               (unsigned long)p->lock_wait_us);
+    }
+
+    shim_bt_stats_t bt = shim_bt_stats();
+    printf("\nStack: %lu responses (%lu errors, last status 0x%02x), %lu notifications, "
+           "%lu indications, %lu closes, %lu advertising starts\n",
+           (unsigned long)bt.responses, (unsigned long)bt.rsp_errors, bt.last_status,
+           (unsigned long)bt.notifications, (unsigned long)bt.indications,
+           (unsigned long)bt.closes, (unsigned long)bt.adv_starts);
+}
+
+// --- Main ---
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-l nvs_write_latency_us] [-v] [script]\n"
+            "  -l  latency charged per NVS write (default %d us)\n"
+            "  -v  firmware log output at INFO (default WARN)\n"
+            "  script defaults to %s\n"
+            "exit status 1 if an expect line fails\n",
+            prog, NVS_LATENCY_DEFAULT, REPLAY_DEFAULT_SCRIPT);
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t latency = NVS_LATENCY_DEFAULT;
+    bool     verbose = false;
+    int      opt;
+    while ((opt = getopt(argc, argv, "l:vh")) != -1) {
+        switch (opt) {
+        case 'l': latency = strtoul(optarg, NULL, 0); break;
+        case 'v': verbose = true; break;
+        default:  usage(argv[0]);
+        }
+    }
+    if (optind + 1 < argc) usage(argv[0]);
+    script_load(optind < argc ? argv[optind] : REPLAY_DEFAULT_SCRIPT);
+
+    esp_log_level_set("*", verbose ? ESP_LOG_INFO : ESP_LOG_WARN);
+    shim_nvs_set_latency_us(latency);
+
+    // The parts of app_main the BLE service depends on
+    ESP_ERROR_CHECK(nvs_flash_init());
+    led_strip_config_t strip_config = { .strip_gpio_num = LED_GPIO, .max_leds = 1 };
+    led_strip_rmt_config_t rmt_config = { .resolution_hz = 10 * 1000 * 1000 };
+    led_strip_handle_t strip;
+    ESP_ERROR_CHECK(led_strip_new_rmt_device(&strip_config, &rmt_config, &strip));
+    led_ctrl_init(strip);
+    web_log_init();
+    led_ctrl_set_change_cb(ble_notify_led_changed);
+
+    ble_server_start();
+    shim_bt_set_probe(probe);
+    ESP_LOGI(TAG, "Replaying %d steps", s_step_count);
+    script_run();
+    report(latency);
+    printf("\nChecks: %lu, failed: %lu\n", (unsigned long)s_checks, (unsigned long)s_failures);
+    return s_failures ? 1 : 0;
+}
@@ -0,0 +1,112 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "morse_store.h"
+#include "ntp_sync.h"
+#include "oled_display.h"
+#include "web_server.h"
+#include "wifi_manager.h"
+#include "wifi_scan.h"
+
+// Firmware modules outside the BLE path. The event log keeps its mutex and
+// a sequence counter, so the BLE handlers pay for the lock as on the target;
+// WiFi is never provisioning, the clock is never synced.
+
+// --- web_server.c ---
+
+static SemaphoreHandle_t s_log_mutex;
+static uint32_t          s_log_next;
+
+static void log_event(void)
+{
+    if (!s_log_mutex) return;
+    if (xSemaphoreTake(s_log_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+    s_log_next++;
+    xSemaphoreGive(s_log_mutex);
+}
+
+void web_log_init(void)
+{
+    s_log_mutex = xSemaphoreCreateMutex();
+}
+
+void web_log_connect(const uint8_t *bd_addr) { log_event(); }
+void web_log_disconnect(const uint8_t *bd_addr) { log_event(); }
+void web_log_read(const uint8_t *bd_addr, uint16_t char_uuid, const char *value) { log_event(); }
+void web_log_write(const uint8_t *bd_addr, uint16_t char_uuid, const char *value) { log_event(); }
+
+// Entries are counted, not stored: the range is empty to the log download
+void web_log_seq_range(uint32_t *first, uint32_t *next)
+{
+    *first = *next = s_log_next;
+}
+
+size_t web_log_export(uint32_t *seq, uint32_t end, uint8_t *buf, size_t max)
+{
+    return 0;
+}
+
+// --- wifi_manager.c / wifi_scan.c ---
+
+bool wifi_manager_is_provisioning(void)
+{
+    return false;
+}
+
+esp_err_t wifi_manager_prov_scan(void)
+{
+    return ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t wifi_manager_prov_connect(const char *ssid, const char *pass)
+{
+    return ESP_ERR_INVALID_STATE;
+}
+
+void wifi_manager_prov_status(wifi_prov_state_t *state, uint8_t *reason, uint32_t *ip)
+{
+    *state  = WIFI_PROV_IDLE;
+    *reason = 0;
+    *ip     = 0;
+}
+
+size_t wifi_scan_get(wifi_scan_ap_t *out, size_t max, int64_t *age_ms, bool *scanning)
+{
+    if (age_ms)   *age_ms   = -1;
+    if (scanning) *scanning = false;
+    return 0;
+}
+
+// --- ntp_sync.c ---
+
+void ntp_sync_set_time(const struct timeval *tv, const char *source)
+{
+}
+
+bool ntp_sync_is_synced(void)
+{
+    return false;
+}
+
+// --- oled_display.c ---
+
+void oled_set_line(uint8_t line, const char *text)
+{
+}
+
+// --- morse_store.c ---
+
+size_t morse_store_length(void)
+{
+    return 0;
+}
+
+void morse_store_reader_init(morse_store_reader_t *r)
+{
+    memset(r, 0, sizeof(*r));
+}
+
+int morse_store_read(void *ctx)
+{
+    return -1;
+}
@@ -0,0 +1,523 @@
+#include <pthread.h>
+#include <string.h>
+#include "esp_bt.h"
+#include "esp_bt_main.h"
+#include "esp_gap_ble_api.h"
+#include "esp_gatt_common_api.h"
+#include "esp_gatts_api.h"
+#include "host_shim.h"
+
+// Bluedroid stand-in: API calls are recorded as requests and completed by
+// shim_bt_run() with the events the stack would send back.
+
+#define SHIM_GATTS_IF       3           // interface the stack assigns at REG
+#define SHIM_TABS_MAX       4
+#define SHIM_TAB_ATTRS      32
+#define SHIM_REQ_MAX        256
+#define SHIM_CONN_MAX       16
+#define SHIM_BONDS_MAX      8
+
+typedef enum {
+    REQ_ATTR_TAB,
+    REQ_START_SERVICE,
+    REQ_ADV_DATA_RAW,
+    REQ_ADV_START,
+    REQ_ADV_STOP,
+    REQ_CONF,
+    REQ_CLOSE,
+    REQ_CONN_PARAMS,
+    REQ_DATA_LEN,
+    REQ_PHY,
+    REQ_RSSI,
+} req_kind_t;
+
+typedef struct {
+    req_kind_t    kind;
+    uint16_t      conn_id;
+    uint16_t      handle;          // ATTR_TAB: table index
+    uint16_t      arg;             // CONF: length; DATA_LEN: tx octets; CONN_PARAMS: interval
+    esp_bd_addr_t bda;
+    uint16_t      latency;
+    uint16_t      timeout;
+} req_t;
+
+typedef struct {
+    const esp_gatts_attr_db_t *db;
+    uint16_t                   count;
+    uint16_t                   handles[SHIM_TAB_ATTRS];
+} attr_tab_t;
+
+typedef struct {
+    bool           seen;
+    esp_bd_addr_t  bda;
+    shim_bt_link_t rec;         // rec.open: between CONNECT_EVT and DISCONNECT_EVT
+} link_t;
+
+static pthread_mutex_t  s_lock = PTHREAD_MUTEX_INITIALIZER;
+static esp_gatts_cb_t   s_gatts_cb;
+static esp_gap_ble_cb_t s_gap_cb;
+static req_t            s_req[SHIM_REQ_MAX];
+static uint16_t         s_req_head, s_req_count;
+static attr_tab_t       s_tabs[SHIM_TABS_MAX];
+static uint8_t          s_tab_count;
+static uint16_t         s_next_handle = SHIM_BT_FIRST_HANDLE;
+static link_t           s_links[SHIM_CONN_MAX];
+static shim_bt_stats_t  s_stats;
+static shim_bt_probe_t  s_probe;
+static esp_bd_addr_t    s_bonds[SHIM_BONDS_MAX];
+static int              s_bond_count;
+
+// --- Request queue ---
+
+static esp_err_t req_push(const req_t *r)
+{
+    esp_err_t err = ESP_OK;
+    pthread_mutex_lock(&s_lock);
+    if (s_req_count == SHIM_REQ_MAX)
+        err = ESP_FAIL;                 // the stack's command queue is full
+    else
+        s_req[(s_req_head + s_req_count++) % SHIM_REQ_MAX] = *r;
+    pthread_mutex_unlock(&s_lock);
+    return err;
+}
+
+static bool req_pop(req_t *r)
+{
+    pthread_mutex_lock(&s_lock);
+    bool any = s_req_count > 0;
+    if (any) {
+        *r = s_req[s_req_head];
+        s_req_head = (s_req_head + 1) % SHIM_REQ_MAX;
+        s_req_count--;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return any;
+}
+
+static uint16_t link_by_bda(const esp_bd_addr_t bda)
+{
+    for (uint16_t i = 0; i < SHIM_CONN_MAX; i++)
+        if (s_links[i].rec.open && memcmp(s_links[i].bda, bda, ESP_BD_ADDR_LEN) == 0)
+            return i;
+    return SHIM_CONN_MAX;
+}
+
+// --- Event delivery ---
+
+// s_links is written here and by API calls on timer threads, so all
+// accesses take s_lock
+void shim_bt_gatts_event(esp_gatts_cb_event_t event, esp_ble_gatts_cb_param_t *param)
+{
+    pthread_mutex_lock(&s_lock);
+    if (event == ESP_GATTS_CONNECT_EVT && param->connect.conn_id < SHIM_CONN_MAX) {
+        link_t *l = &s_links[param->connect.conn_id];
+        memset(l, 0, sizeof(*l));
+        l->seen     = true;
+        l->rec.open = true;
+        memcpy(l->bda, param->connect.remote_bda, ESP_BD_ADDR_LEN);
+        s_stats.advertising = false;        // the controller stops advertising on connect
+    }
+    if (event == ESP_GATTS_DISCONNECT_EVT && param->disconnect.conn_id < SHIM_CONN_MAX)
+        s_links[param->disconnect.conn_id].rec.open = false;
+    pthread_mutex_unlock(&s_lock);
+    if (!s_gatts_cb) return;
+    if (s_probe) s_probe(true, event, false);
+    s_gatts_cb(event, SHIM_GATTS_IF, param);
+    if (s_probe) s_probe(true, event, true);
+}
+
+void shim_bt_gap_event(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
+{
+    if (!s_gap_cb) return;
+    if (s_probe) s_probe(false, event, false);
+    s_gap_cb(event, param);
+    if (s_probe) s_probe(false, event, true);
+}
+
+void shim_bt_set_probe(shim_bt_probe_t probe)
+{
+    s_probe = probe;
+}
+
+static void attr_tab_created(uint16_t tab)
+{
+    attr_tab_t *t = &s_tabs[tab];
+    for (uint16_t i = 0; i < t->count; i++)
+        t->handles[i] = s_next_handle++;
+
+    esp_ble_gatts_cb_param_t p = {0};
+    p.add_attr_tab.status              = ESP_GATT_OK;
+    p.add_attr_tab.svc_uuid.len        = ESP_UUID_LEN_16;
+    p.add_attr_tab.svc_uuid.uuid.uuid16 = *(const uint16_t *)t->db[0].att_desc.value;
+    p.add_attr_tab.num_handle          = t->count;
+    p.add_attr_tab.handles             = t->handles;
+    shim_bt_gatts_event(ESP_GATTS_CREAT_ATTR_TAB_EVT, &p);
+}
+
+static void req_complete(const req_t *r)
+{
+    esp_ble_gatts_cb_param_t gatts = {0};
+    esp_ble_gap_cb_param_t   gap   = {0};
+
+    switch (r->kind) {
+    case REQ_ATTR_TAB:
+        attr_tab_created(r->handle);
+        break;
+
+    case REQ_START_SERVICE:
+        gatts.start.status         = ESP_GATT_OK;
+        gatts.start.service_handle = r->handle;
+        shim_bt_gatts_event(ESP_GATTS_START_EVT, &gatts);
+        break;
+
+    case REQ_ADV_DATA_RAW:
+        gap.adv_data_raw_cmpl.status = ESP_BT_STATUS_SUCCESS;
+        shim_bt_gap_event(ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT, &gap);
+        break;
+
+    case REQ_ADV_START:
+        pthread_mutex_lock(&s_lock);
+        s_stats.advertising = true;
+        pthread_mutex_unlock(&s_lock);
+        gap.adv_start_cmpl.status = ESP_BT_STATUS_SUCCESS;
+        shim_bt_gap_event(ESP_GAP_BLE_ADV_START_COMPLETE_EVT, &gap);
+        break;
+
+    case REQ_ADV_STOP:
+        pthread_mutex_lock(&s_lock);
+        s_stats.advertising = false;
+        pthread_mutex_unlock(&s_lock);
+        gap.adv_stop_cmpl.status = ESP_BT_STATUS_SUCCESS;
+        shim_bt_gap_event(ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT, &gap);
+        break;
+
+    case REQ_CONF:
+        if (r->conn_id >= SHIM_CONN_MAX || !s_links[r->conn_id].rec.open) break;
+        gatts.conf.status  = ESP_GATT_OK;
+        gatts.conf.conn_id = r->conn_id;
+        gatts.conf.handle  = r->handle;
+        gatts.conf.len     = r->arg;
+        shim_bt_gatts_event(ESP_GATTS_CONF_EVT, &gatts);
+        break;
+
+    case REQ_CLOSE:
+        if (r->conn_id >= SHIM_CONN_MAX || !s_links[r->conn_id].rec.open) break;
+        gatts.disconnect.conn_id = r->conn_id;
+        gatts.disconnect.reason  = ESP_GATT_CONN_TERMINATE_LOCAL_HOST;
+        memcpy(gatts.disconnect.remote_bda, s_links[r->conn_id].bda, ESP_BD_ADDR_LEN);
+        shim_bt_gatts_event(ESP_GATTS_DISCONNECT_EVT, &gatts);
+        break;
+
+    case REQ_CONN_PARAMS:
+        if (link_by_bda(r->bda) == SHIM_CONN_MAX) break;
+        gap.update_conn_params.status   = ESP_BT_STATUS_SUCCESS;
+        gap.update_conn_params.conn_int = r->arg;
+        gap.update_conn_params.latency  = r->latency;
+        gap.update_conn_params.timeout  = r->timeout;
+        memcpy(gap.update_conn_params.bda, r->bda, ESP_BD_ADDR_LEN);
+        shim_bt_gap_event(ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT, &gap);
+        break;
+
+    case REQ_DATA_LEN:
+        gap.pkt_data_length_cmpl.status        = ESP_BT_STATUS_SUCCESS;
+        gap.pkt_data_length_cmpl.params.tx_len = r->arg;
+        gap.pkt_data_length_cmpl.params.rx_len = r->arg;
+        shim_bt_gap_event(ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT, &gap);
+        break;
+
+    case REQ_PHY:
+        if (link_by_bda(r->bda) == SHIM_CONN_MAX) break;
+        gap.phy_update.status = ESP_BT_STATUS_SUCCESS;
+        gap.phy_update.tx_phy = 2;
+        gap.phy_update.rx_phy = 2;
+        memcpy(gap.phy_update.bda, r->bda, ESP_BD_ADDR_LEN);
+        shim_bt_gap_event(ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT, &gap);
+        break;
+
+    case REQ_RSSI:
+        if (link_by_bda(r->bda) == SHIM_CONN_MAX) break;
+        gap.read_rssi_cmpl.status = ESP_BT_STATUS_SUCCESS;
+        gap.read_rssi_cmpl.rssi   = -60;
+        memcpy(gap.read_rssi_cmpl.remote_addr, r->bda, ESP_BD_ADDR_LEN);
+        shim_bt_gap_event(ESP_GAP_BLE_READ_RSSI_COMPLETE_EVT, &gap);
+        break;
+    }
+}
+
+int shim_bt_run(void)
+{
+    int n = 0;
+    req_t r;
+    while (req_pop(&r)) {
+        req_complete(&r);
+        n++;
+    }
+    return n;
+}
+
+uint16_t shim_bt_handle(uint16_t uuid16, bool cccd)
+{
+    for (uint8_t t = 0; t < s_tab_count; t++) {
+        const attr_tab_t *tab = &s_tabs[t];
+        for (uint16_t i = 0; i < tab->count; i++) {
+            const esp_attr_desc_t *d = &tab->db[i].att_desc;
+            if (!tab->handles[i] || d->uuid_length != ESP_UUID_LEN_16 ||
+                *(const uint16_t *)d->uuid_p != uuid16)
+                continue;
+            if (!cccd) return tab->handles[i];
+            // The CCCD, if any, directly follows the value
+            const esp_attr_desc_t *n = i + 1 < tab->count ? &tab->db[i + 1].att_desc : NULL;
+            bool is_cccd = n && n->uuid_length == ESP_UUID_LEN_16 &&
+                           *(const uint16_t *)n->uuid_p == ESP_GATT_UUID_CHAR_CLIENT_CONFIG;
+            return is_cccd ? tab->handles[i + 1] : 0;
+        }
+    }
+    return 0;
+}
+
+shim_bt_stats_t shim_bt_stats(void)
+{
+    pthread_mutex_lock(&s_lock);
+    shim_bt_stats_t st = s_stats;
+    for (int i = 0; i < SHIM_CONN_MAX; i++)
+        st.links_open += s_links[i].rec.open;
+    pthread_mutex_unlock(&s_lock);
+    return st;
+}
+
+bool shim_bt_link(uint16_t conn_id, shim_bt_link_t *out)
+{
+    if (conn_id >= SHIM_CONN_MAX) return false;
+    pthread_mutex_lock(&s_lock);
+    bool seen = s_links[conn_id].seen;
+    *out = s_links[conn_id].rec;
+    pthread_mutex_unlock(&s_lock);
+    return seen;
+}
+
+void shim_bt_add_bond(const esp_bd_addr_t bda)
+{
+    pthread_mutex_lock(&s_lock);
+    if (s_bond_count < SHIM_BONDS_MAX)
+        memcpy(s_bonds[s_bond_count++], bda, ESP_BD_ADDR_LEN);
+    pthread_mutex_unlock(&s_lock);
+}
+
+// --- Controller / host bring-up ---
+
+esp_err_t esp_bt_controller_mem_release(esp_bt_mode_t mode) { return ESP_OK; }
+esp_err_t esp_bt_controller_init(esp_bt_controller_config_t *cfg) { return ESP_OK; }
+esp_err_t esp_bt_controller_enable(esp_bt_mode_t mode) { return ESP_OK; }
+esp_err_t esp_bluedroid_init(void) { return ESP_OK; }
+esp_err_t esp_bluedroid_enable(void) { return ESP_OK; }
+esp_err_t esp_ble_gatt_set_local_mtu(uint16_t mtu) { return ESP_OK; }
+
+// --- GATT server ---
+
+esp_err_t esp_ble_gatts_register_callback(esp_gatts_cb_t callback)
+{
+    s_gatts_cb = callback;
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_app_register(uint16_t app_id)
+{
+    // ESP_GATTS_REG_EVT comes from the replay script
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_create_attr_tab(const esp_gatts_attr_db_t *gatts_attr_db,
+                                        esp_gatt_if_t gatts_if, uint16_t max_nb_attr,
+                                        uint8_t srvc_inst_id)
+{
+    if (max_nb_attr > SHIM_TAB_ATTRS) return ESP_ERR_INVALID_ARG;
+    pthread_mutex_lock(&s_lock);
+    uint8_t tab = s_tab_count;
+    if (tab < SHIM_TABS_MAX) {
+        s_tabs[tab].db    = gatts_attr_db;
+        s_tabs[tab].count = max_nb_attr;
+        s_tab_count++;
+    }
+    pthread_mutex_unlock(&s_lock);
+    if (tab == SHIM_TABS_MAX) return ESP_ERR_NO_MEM;
+    return req_push(&(req_t){ .kind = REQ_ATTR_TAB, .handle = tab });
+}
+
+esp_err_t esp_ble_gatts_start_service(uint16_t service_handle)
+{
+    return req_push(&(req_t){ .kind = REQ_START_SERVICE, .handle = service_handle });
+}
+
+esp_err_t esp_ble_gatts_send_response(esp_gatt_if_t gatts_if, uint16_t conn_id, uint32_t trans_id,
+                                      esp_gatt_status_t status, esp_gatt_rsp_t *rsp)
+{
+    pthread_mutex_lock(&s_lock);
+    s_stats.responses++;
+    if (status != ESP_GATT_OK) s_stats.rsp_errors++;
+    s_stats.last_status = status;
+    if (conn_id < SHIM_CONN_MAX && s_links[conn_id].rec.open) {
+        shim_bt_link_t *l = &s_links[conn_id].rec;
+        l->responses++;
+        l->last_status = status;
+        l->last_len    = rsp ? rsp->attr_value.len : 0;
+        if (rsp) memcpy(l->last_value, rsp->attr_value.value, l->last_len);
+    }
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_send_indicate(esp_gatt_if_t gatts_if, uint16_t conn_id, uint16_t attr_handle,
+                                      uint16_t value_len, uint8_t *value, bool need_confirm)
+{
+    pthread_mutex_lock(&s_lock);
+    bool open = conn_id < SHIM_CONN_MAX && s_links[conn_id].rec.open;
+    if (!open) {
+        pthread_mutex_unlock(&s_lock);
+        return ESP_FAIL;
+    }
+    if (need_confirm) s_stats.indications++;
+    else              s_stats.notifications++;
+    if (attr_handle >= SHIM_BT_FIRST_HANDLE && attr_handle - SHIM_BT_FIRST_HANDLE < SHIM_BT_HANDLES)
+        s_links[conn_id].rec.sent[attr_handle - SHIM_BT_FIRST_HANDLE]++;
+    pthread_mutex_unlock(&s_lock);
+    // Bluedroid reports ESP_GATTS_CONF_EVT for notifications as well
+    return req_push(&(req_t){ .kind = REQ_CONF, .conn_id = conn_id,
+                              .handle = attr_handle, .arg = value_len });
+}
+
+esp_err_t esp_ble_gatts_close(esp_gatt_if_t gatts_if, uint16_t conn_id)
+{
+    pthread_mutex_lock(&s_lock);
+    s_stats.closes++;
+    pthread_mutex_unlock(&s_lock);
+    return req_push(&(req_t){ .kind = REQ_CLOSE, .conn_id = conn_id });
+}
+
+esp_err_t esp_ble_gatts_send_service_change_indication(esp_gatt_if_t gatts_if,
+                                                       esp_bd_addr_t remote_bda)
+{
+    pthread_mutex_lock(&s_lock);
+    uint16_t conn = link_by_bda(remote_bda);
+    if (conn < SHIM_CONN_MAX) s_links[conn].rec.svc_changed++;
+    pthread_mutex_unlock(&s_lock);
+    return conn < SHIM_CONN_MAX ? ESP_OK : ESP_FAIL;
+}
+
+// --- GAP ---
+
+esp_err_t esp_ble_gap_register_callback(esp_gap_ble_cb_t callback)
+{
+    s_gap_cb = callback;
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_set_device_name(const char *name)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_config_adv_data(esp_ble_adv_data_t *adv_data)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_config_adv_data_raw(uint8_t *raw_data, uint32_t raw_data_len)
+{
+    if (raw_data_len > 31) return ESP_ERR_INVALID_ARG;
+    pthread_mutex_lock(&s_lock);
+    s_stats.adv_data_sets++;
+    pthread_mutex_unlock(&s_lock);
+    return req_push(&(req_t){ .kind = REQ_ADV_DATA_RAW });
+}
+
+esp_err_t esp_ble_gap_start_advertising(esp_ble_adv_params_t *adv_params)
+{
+    pthread_mutex_lock(&s_lock);
+    s_stats.adv_starts++;
+    pthread_mutex_unlock(&s_lock);
+    return req_push(&(req_t){ .kind = REQ_ADV_START });
+}
+
+esp_err_t esp_ble_gap_stop_advertising(void)
+{
+    return req_push(&(req_t){ .kind = REQ_ADV_STOP });
+}
+
+esp_err_t esp_ble_gap_set_security_param(esp_ble_sm_param_t param_type, void *value, uint8_t len)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_security_rsp(esp_bd_addr_t bd_addr, bool accept)
+{
+    return ESP_OK;
+}
+
+// Bonds come from the replay script (shim_bt_add_bond)
+int esp_ble_get_bond_device_num(void)
+{
+    pthread_mutex_lock(&s_lock);
+    int n = s_bond_count;
+    pthread_mutex_unlock(&s_lock);
+    return n;
+}
+
+esp_err_t esp_ble_get_bond_device_list(int *dev_num, esp_ble_bond_dev_t *dev_list)
+{
+    pthread_mutex_lock(&s_lock);
+    int n = *dev_num < s_bond_count ? *dev_num : s_bond_count;
+    for (int i = 0; i < n; i++) {
+        memcpy(dev_list[i].bd_addr, s_bonds[i], ESP_BD_ADDR_LEN);
+        dev_list[i].bd_addr_type = BLE_ADDR_TYPE_PUBLIC;
+    }
+    pthread_mutex_unlock(&s_lock);
+    *dev_num = n;
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_update_whitelist(bool add_remove, esp_bd_addr_t remote_bda,
+                                       esp_ble_wl_addr_type_t wl_addr_type)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_clear_whitelist(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_update_conn_params(esp_ble_conn_update_params_t *params)
+{
+    req_t r = {
+        .kind    = REQ_CONN_PARAMS,
+        .arg     = params->max_int,
+        .latency = params->latency,
+        .timeout = params->timeout,
+    };
+    memcpy(r.bda, params->bda, ESP_BD_ADDR_LEN);
+    return req_push(&r);
+}
+
+esp_err_t esp_ble_gap_set_pkt_data_len(esp_bd_addr_t remote_device, uint16_t tx_data_length)
+{
+    req_t r = { .kind = REQ_DATA_LEN, .arg = tx_data_length };
+    memcpy(r.bda, remote_device, ESP_BD_ADDR_LEN);
+    return req_push(&r);
+}
+
+esp_err_t esp_ble_gap_set_preferred_phy(esp_bd_addr_t bd_addr, esp_ble_gap_all_phys_t all_phys_mask,
+                                        esp_ble_gap_phy_mask_t tx_phy_mask,
+                                        esp_ble_gap_phy_mask_t rx_phy_mask,
+                                        esp_ble_gap_prefer_phy_options_t phy_options)
+{
+    req_t r = { .kind = REQ_PHY };
+    memcpy(r.bda, bd_addr, ESP_BD_ADDR_LEN);
+    return req_push(&r);
+}
+
+esp_err_t esp_ble_gap_read_rssi(esp_bd_addr_t remote_addr)
+{
+    req_t r = { .kind = REQ_RSSI };
+    memcpy(r.bda, remote_addr, ESP_BD_ADDR_LEN);
+    return req_push(&r);
+}
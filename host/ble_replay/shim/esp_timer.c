@@ -0,0 +1,157 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include "esp_timer.h"
+
+struct esp_timer {
+    esp_timer_cb_t    callback;
+    void             *arg;
+    const char       *name;
+    uint64_t          period_us;    // 0 for one-shot
+    int64_t           alarm_us;
+    bool              armed;
+    struct esp_timer *next;
+};
+
+static pthread_mutex_t    s_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t     s_cond;
+static pthread_once_t     s_once = PTHREAD_ONCE_INIT;
+static struct esp_timer  *s_timers;
+static struct timespec    s_t0;
+
+static void clock_init(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &s_t0);
+}
+
+int64_t esp_timer_get_time(void)
+{
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, clock_init);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)(now.tv_sec - s_t0.tv_sec) * 1000000 + (now.tv_nsec - s_t0.tv_nsec) / 1000;
+}
+
+// --- Dispatch thread ---
+
+static struct esp_timer *next_due(void)
+{
+    struct esp_timer *first = NULL;
+    for (struct esp_timer *t = s_timers; t; t = t->next)
+        if (t->armed && (!first || t->alarm_us < first->alarm_us))
+            first = t;
+    return first;
+}
+
+static void *timer_task(void *arg)
+{
+    pthread_mutex_lock(&s_lock);
+    for (;;) {
+        struct esp_timer *t = next_due();
+        if (!t) {
+            pthread_cond_wait(&s_cond, &s_lock);
+            continue;
+        }
+        int64_t now = esp_timer_get_time();
+        if (t->alarm_us > now) {
+            // Absolute deadline on the same clock as esp_timer_get_time()
+            int64_t ns = (t->alarm_us * 1000) + s_t0.tv_nsec;
+            struct timespec deadline = {
+                .tv_sec  = s_t0.tv_sec + ns / 1000000000,
+                .tv_nsec = ns % 1000000000,
+            };
+            pthread_cond_timedwait(&s_cond, &s_lock, &deadline);
+            continue;
+        }
+        if (t->period_us) {
+            t->alarm_us += t->period_us;
+            if (t->alarm_us < now) t->alarm_us = now + t->period_us;   // skip missed periods
+        } else {
+            t->armed = false;
+        }
+        // Callbacks run unlocked, so they can start and stop timers
+        pthread_mutex_unlock(&s_lock);
+        t->callback(t->arg);
+        pthread_mutex_lock(&s_lock);
+    }
+    return NULL;
+}
+
+static void dispatch_init(void)
+{
+    esp_timer_get_time();
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&s_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, timer_task, NULL) != 0) abort();
+    pthread_detach(thread);
+}
+
+// --- API ---
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle)
+{
+    if (!args || !args->callback || !out_handle) return ESP_ERR_INVALID_ARG;
+    pthread_once(&s_once, dispatch_init);
+    struct esp_timer *t = calloc(1, sizeof(*t));
+    if (!t) return ESP_ERR_NO_MEM;
+    t->callback = args->callback;
+    t->arg      = args->arg;
+    t->name     = args->name;
+
+    pthread_mutex_lock(&s_lock);
+    t->next  = s_timers;
+    s_timers = t;
+    pthread_mutex_unlock(&s_lock);
+    *out_handle = t;
+    return ESP_OK;
+}
+
+static esp_err_t timer_arm(esp_timer_handle_t t, uint64_t delay_us, uint64_t period_us)
+{
+    esp_err_t err = ESP_OK;
+    pthread_mutex_lock(&s_lock);
+    if (t->armed) {
+        err = ESP_ERR_INVALID_STATE;        // as on the target: stop first
+    } else {
+        t->armed     = true;
+        t->alarm_us  = esp_timer_get_time() + delay_us;
+        t->period_us = period_us;
+        pthread_cond_signal(&s_cond);
+    }
+    pthread_mutex_unlock(&s_lock);
+    return err;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return timer_arm(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    return timer_arm(timer, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    esp_err_t err = ESP_OK;
+    pthread_mutex_lock(&s_lock);
+    if (!timer->armed) err = ESP_ERR_INVALID_STATE;
+    timer->armed = false;
+    pthread_mutex_unlock(&s_lock);
+    return err;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&s_lock);
+    bool armed = timer->armed;
+    pthread_mutex_unlock(&s_lock);
+    return armed;
+}
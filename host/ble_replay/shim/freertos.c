@@ -0,0 +1,308 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+#include "esp_timer.h"
+#include "shim_internal.h"
+
+__thread shim_thread_stats_t shim_tls;
+
+shim_thread_stats_t shim_thread_stats(void)
+{
+    return shim_tls;
+}
+
+// --- Critical sections ---
+
+void vPortEnterCritical(portMUX_TYPE *mux)
+{
+    if (pthread_mutex_trylock(&mux->mutex) == 0) return;
+    shim_tls.mux_waits++;
+    pthread_mutex_lock(&mux->mutex);
+}
+
+void vPortExitCritical(portMUX_TYPE *mux)
+{
+    pthread_mutex_unlock(&mux->mutex);
+}
+
+// --- Tasks ---
+
+struct tskTaskControlBlock {
+    TaskFunction_t fn;
+    void          *arg;
+    char           name[16];
+};
+
+static __thread struct tskTaskControlBlock *t_self;
+
+static void *task_main(void *p)
+{
+    t_self = p;
+    t_self->fn(t_self->arg);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                       void *arg, UBaseType_t priority, TaskHandle_t *created_task)
+{
+    struct tskTaskControlBlock *t = calloc(1, sizeof(*t));
+    if (!t) return pdFAIL;
+    t->fn  = fn;
+    t->arg = arg;
+    strncpy(t->name, name ? name : "", sizeof(t->name) - 1);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, task_main, t) != 0) {
+        free(t);
+        return pdFAIL;
+    }
+    pthread_detach(thread);
+    if (created_task) *created_task = t;
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task && task != t_self) abort();
+    pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    usleep((useconds_t)pdTICKS_TO_MS(ticks ? ticks : 1) * 1000);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return pdMS_TO_TICKS(esp_timer_get_time() / 1000);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    // Threads not started by xTaskCreate (the replay driver) get one on demand
+    if (!t_self) t_self = calloc(1, sizeof(*t_self));
+    return t_self;
+}
+
+// --- Semaphores ---
+
+typedef enum {
+    SEM_COUNTING,
+    SEM_MUTEX,
+    SEM_RECURSIVE,
+} sem_kind_t;
+
+struct shim_semaphore {
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    sem_kind_t      kind;
+    UBaseType_t     count;
+    UBaseType_t     max;
+    TaskHandle_t    holder;     // mutexes
+    UBaseType_t     depth;      // recursive mutexes
+};
+
+static SemaphoreHandle_t sem_new(sem_kind_t kind, UBaseType_t max, UBaseType_t initial)
+{
+    SemaphoreHandle_t s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&s->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&s->lock, NULL);
+    s->kind  = kind;
+    s->max   = max;
+    s->count = initial;
+    return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return sem_new(SEM_COUNTING, 1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count)
+{
+    return sem_new(SEM_COUNTING, max_count, initial_count);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return sem_new(SEM_MUTEX, 1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void)
+{
+    return sem_new(SEM_RECURSIVE, 1, 1);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    if (!sem) return;
+    pthread_cond_destroy(&sem->cond);
+    pthread_mutex_destroy(&sem->lock);
+    free(sem);
+}
+
+// Wait (with s->lock held) until a unit is available or the timeout expires
+static bool sem_wait_count(SemaphoreHandle_t s, TickType_t ticks)
+{
+    if (s->count > 0) return true;
+    if (ticks == 0) return false;
+
+    int64_t t0 = esp_timer_get_time();
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    uint64_t ns = (uint64_t)pdTICKS_TO_MS(ticks) * 1000000ULL + deadline.tv_nsec;
+    deadline.tv_sec  += ns / 1000000000ULL;
+    deadline.tv_nsec  = ns % 1000000000ULL;
+
+    int rc = 0;
+    while (s->count == 0 && rc != ETIMEDOUT) {
+        if (ticks == portMAX_DELAY)
+            pthread_cond_wait(&s->cond, &s->lock);
+        else
+            rc = pthread_cond_timedwait(&s->cond, &s->lock, &deadline);
+    }
+    shim_tls.sem_waits++;
+    shim_tls.sem_wait_us += esp_timer_get_time() - t0;
+    return s->count > 0;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks_to_wait)
+{
+    pthread_mutex_lock(&sem->lock);
+    bool ok = sem_wait_count(sem, ticks_to_wait);
+    if (ok) {
+        sem->count--;
+        if (sem->kind != SEM_COUNTING) sem->holder = xTaskGetCurrentTaskHandle();
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return ok ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    BaseType_t ret = pdTRUE;
+    pthread_mutex_lock(&sem->lock);
+    if (sem->count >= sem->max ||
+        (sem->kind != SEM_COUNTING && sem->holder != xTaskGetCurrentTaskHandle())) {
+        ret = pdFALSE;
+    } else {
+        sem->count++;
+        sem->holder = NULL;
+        pthread_cond_signal(&sem->cond);
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return ret;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t ticks_to_wait)
+{
+    pthread_mutex_lock(&sem->lock);
+    bool ok = sem->holder == xTaskGetCurrentTaskHandle();
+    if (!ok && (ok = sem_wait_count(sem, ticks_to_wait))) {
+        sem->count--;
+        sem->holder = xTaskGetCurrentTaskHandle();
+    }
+    if (ok) sem->depth++;
+    pthread_mutex_unlock(&sem->lock);
+    return ok ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem)
+{
+    BaseType_t ret = pdTRUE;
+    pthread_mutex_lock(&sem->lock);
+    if (sem->holder != xTaskGetCurrentTaskHandle()) {
+        ret = pdFALSE;
+    } else if (--sem->depth == 0) {
+        sem->count++;
+        sem->holder = NULL;
+        pthread_cond_signal(&sem->cond);
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return ret;
+}
+
+// --- Software timers ---
+
+struct tmrTimerControl {
+    esp_timer_handle_t      timer;
+    TickType_t              period;
+    bool                    auto_reload;
+    void                   *id;
+    TimerCallbackFunction_t callback;
+};
+
+static void timer_dispatch(void *arg)
+{
+    TimerHandle_t t = arg;
+    t->callback(t);
+}
+
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t auto_reload,
+                           void *timer_id, TimerCallbackFunction_t callback)
+{
+    TimerHandle_t t = calloc(1, sizeof(*t));
+    if (!t) return NULL;
+    t->period      = period;
+    t->auto_reload = auto_reload;
+    t->id          = timer_id;
+    t->callback    = callback;
+    const esp_timer_create_args_t args = {
+        .callback = timer_dispatch,
+        .arg      = t,
+        .name     = name,
+    };
+    if (esp_timer_create(&args, &t->timer) != ESP_OK) {
+        free(t);
+        return NULL;
+    }
+    return t;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticks_to_wait)
+{
+    // Starting a running timer restarts it, as in FreeRTOS
+    esp_timer_stop(timer->timer);
+    uint64_t us = (uint64_t)pdTICKS_TO_MS(timer->period) * 1000;
+    esp_err_t err = timer->auto_reload ? esp_timer_start_periodic(timer->timer, us)
+                                       : esp_timer_start_once(timer->timer, us);
+    return err == ESP_OK ? pdPASS : pdFAIL;
+}
+
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticks_to_wait)
+{
+    return xTimerStart(timer, ticks_to_wait);
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticks_to_wait)
+{
+    esp_timer_stop(timer->timer);
+    return pdPASS;
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t ticks_to_wait)
+{
+    timer->period = period;
+    return xTimerStart(timer, ticks_to_wait);
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer)
+{
+    return esp_timer_is_active(timer->timer) ? pdTRUE : pdFALSE;
+}
+
+void *pvTimerGetTimerID(TimerHandle_t timer)
+{
+    return timer->id;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "esp_bt_defs.h"
+#include "esp_err.h"
+
+// No controller on the host: bring-up calls succeed and do nothing
+
+typedef enum {
+    ESP_BT_MODE_IDLE,
+    ESP_BT_MODE_BLE,
+    ESP_BT_MODE_CLASSIC_BT,
+    ESP_BT_MODE_BTDM,
+} esp_bt_mode_t;
+
+typedef struct {
+    uint8_t unused;
+} esp_bt_controller_config_t;
+
+#define BT_CONTROLLER_INIT_CONFIG_DEFAULT() { 0 }
+
+esp_err_t esp_bt_controller_mem_release(esp_bt_mode_t mode);
+esp_err_t esp_bt_controller_init(esp_bt_controller_config_t *cfg);
+esp_err_t esp_bt_controller_enable(esp_bt_mode_t mode);
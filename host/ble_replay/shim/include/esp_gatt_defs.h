@@ -0,0 +1,103 @@
+#pragma once
+
+#include "esp_bt_defs.h"
+
+#define ESP_GATT_UUID_PRI_SERVICE           0x2800
+#define ESP_GATT_UUID_CHAR_DECLARE          0x2803
+#define ESP_GATT_UUID_CHAR_CLIENT_CONFIG    0x2902
+
+typedef enum {
+    ESP_GATT_OK                 = 0x0,
+    ESP_GATT_INVALID_HANDLE     = 0x01,
+    ESP_GATT_READ_NOT_PERMIT    = 0x02,
+    ESP_GATT_WRITE_NOT_PERMIT   = 0x03,
+    ESP_GATT_INVALID_PDU        = 0x04,
+    ESP_GATT_INSUF_AUTHENTICATION = 0x05,
+    ESP_GATT_REQ_NOT_SUPPORTED  = 0x06,
+    ESP_GATT_INVALID_OFFSET     = 0x07,
+    ESP_GATT_INSUF_AUTHORIZATION = 0x08,
+    ESP_GATT_PREPARE_Q_FULL     = 0x09,
+    ESP_GATT_NOT_FOUND          = 0x0a,
+    ESP_GATT_NOT_LONG           = 0x0b,
+    ESP_GATT_INSUF_KEY_SIZE     = 0x0c,
+    ESP_GATT_INVALID_ATTR_LEN   = 0x0d,
+    ESP_GATT_ERR_UNLIKELY       = 0x0e,
+    ESP_GATT_INSUF_ENCRYPTION   = 0x0f,
+    ESP_GATT_UNSUPPORT_GRP_TYPE = 0x10,
+    ESP_GATT_INSUF_RESOURCE     = 0x11,
+    ESP_GATT_ERROR              = 0x85,
+    ESP_GATT_CCC_CFG_ERR        = 0xfd,
+    ESP_GATT_PRC_IN_PROGRESS    = 0xfe,
+    ESP_GATT_OUT_OF_RANGE       = 0xff,
+} esp_gatt_status_t;
+
+typedef enum {
+    ESP_GATT_CONN_UNKNOWN                = 0,
+    ESP_GATT_CONN_TIMEOUT                = 0x08,
+    ESP_GATT_CONN_TERMINATE_PEER_USER    = 0x13,
+    ESP_GATT_CONN_TERMINATE_LOCAL_HOST   = 0x16,
+} esp_gatt_conn_reason_t;
+
+typedef uint8_t esp_gatt_if_t;
+#define ESP_GATT_IF_NONE    0xff
+
+#define ESP_GATT_PERM_READ              (1 << 0)
+#define ESP_GATT_PERM_READ_ENCRYPTED    (1 << 1)
+#define ESP_GATT_PERM_READ_ENC_MITM     (1 << 2)
+#define ESP_GATT_PERM_WRITE             (1 << 4)
+#define ESP_GATT_PERM_WRITE_ENCRYPTED   (1 << 5)
+#define ESP_GATT_PERM_WRITE_ENC_MITM    (1 << 6)
+typedef uint16_t esp_gatt_perm_t;
+
+#define ESP_GATT_CHAR_PROP_BIT_BROADCAST    (1 << 0)
+#define ESP_GATT_CHAR_PROP_BIT_READ         (1 << 1)
+#define ESP_GATT_CHAR_PROP_BIT_WRITE_NR     (1 << 2)
+#define ESP_GATT_CHAR_PROP_BIT_WRITE        (1 << 3)
+#define ESP_GATT_CHAR_PROP_BIT_NOTIFY       (1 << 4)
+#define ESP_GATT_CHAR_PROP_BIT_INDICATE     (1 << 5)
+typedef uint8_t esp_gatt_char_prop_t;
+
+#define ESP_GATT_MAX_ATTR_LEN   517
+
+#define ESP_GATT_PREP_WRITE_CANCEL  0x00
+#define ESP_GATT_PREP_WRITE_EXEC    0x01
+
+#define ESP_GATT_RSP_BY_APP     0
+#define ESP_GATT_AUTO_RSP       1
+
+typedef struct {
+    uint8_t auto_rsp;
+} esp_attr_control_t;
+
+typedef struct {
+    uint16_t uuid_length;
+    uint8_t *uuid_p;
+    uint16_t perm;
+    uint16_t max_length;
+    uint16_t length;
+    uint8_t *value;
+} esp_attr_desc_t;
+
+typedef struct {
+    esp_attr_control_t attr_control;
+    esp_attr_desc_t    att_desc;
+} esp_gatts_attr_db_t;
+
+typedef struct {
+    uint8_t  value[ESP_GATT_MAX_ATTR_LEN];
+    uint16_t handle;
+    uint16_t offset;
+    uint16_t len;
+    uint8_t  auth_req;
+} esp_gatt_value_t;
+
+typedef union {
+    esp_gatt_value_t attr_value;
+    uint16_t         handle;
+} esp_gatt_rsp_t;
+
+typedef struct {
+    uint16_t interval;
+    uint16_t latency;
+    uint16_t timeout;
+} esp_gatt_conn_params_t;
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+
+// CRC-32 (IEEE 802.3), same convention as the ROM function
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len);
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// Exits the process
+void esp_restart(void) __attribute__((noreturn));
+
+// The host has no fixed heap; both report 0
+uint32_t esp_get_free_heap_size(void);
+uint32_t esp_get_minimum_free_heap_size(void);
@@ -0,0 +1,88 @@
+#pragma once
+
+// Control side of the host shim, used by the replay driver only; the
+// firmware sources see nothing but the IDF headers next to this one.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_gap_ble_api.h"
+#include "esp_gatts_api.h"
+
+// --- Per-thread costs ---
+
+// Counted on the calling thread, so a handler's share can be read by
+// sampling before and after it runs
+typedef struct {
+    uint32_t sem_waits;         // semaphore / mutex takes that had to block
+    uint64_t sem_wait_us;
+    uint32_t mux_waits;         // critical sections entered while another thread held them
+    uint32_t nvs_calls;         // any nvs_* call
+    uint32_t nvs_writes;        // nvs_set_* / nvs_erase_*, each paying the stubbed latency
+    uint64_t nvs_us;            // time spent inside nvs_* calls
+} shim_thread_stats_t;
+
+shim_thread_stats_t shim_thread_stats(void);
+
+// --- NVS ---
+
+// Flash write latency charged to every nvs_set_* / nvs_erase_* (default 0)
+void shim_nvs_set_latency_us(uint32_t us);
+
+// --- Bluedroid ---
+
+// Deliver an event through the callbacks the app registered, on the
+// calling thread (the replay driver plays the Bluedroid BTC task)
+void shim_bt_gatts_event(esp_gatts_cb_event_t event, esp_ble_gatts_cb_param_t *param);
+void shim_bt_gap_event(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
+
+// Complete the stack requests the app has made since the last call, as the
+// stack would: attribute tables get handles (CREAT_ATTR_TAB_EVT), services
+// start, advertising starts / stops, notifications are confirmed
+// (CONF_EVT), closed links disconnect, link updates are accepted.
+// Requests made by timer callbacks are picked up here too, so the events
+// stay on the calling thread. Returns the number of requests completed.
+int shim_bt_run(void);
+
+// Called before (done = false) and after (done = true) every event delivered
+// to the app, on the delivering thread; gatts selects the event enum
+typedef void (*shim_bt_probe_t)(bool gatts, int event, bool done);
+void shim_bt_set_probe(shim_bt_probe_t probe);
+
+// Attribute handle of characteristic uuid16 (its value, or its CCCD);
+// 0 if the app has not created it
+uint16_t shim_bt_handle(uint16_t uuid16, bool cccd);
+
+typedef struct {
+    uint32_t responses;         // esp_ble_gatts_send_response calls
+    uint32_t rsp_errors;        // ... with a status other than ESP_GATT_OK
+    uint8_t  last_status;
+    uint32_t notifications;     // esp_ble_gatts_send_indicate calls
+    uint32_t indications;
+    uint32_t closes;            // esp_ble_gatts_close calls
+    uint32_t adv_starts;
+    uint32_t adv_data_sets;
+    bool     advertising;       // started, and neither stopped nor ended by a connect
+    uint8_t  links_open;
+} shim_bt_stats_t;
+
+shim_bt_stats_t shim_bt_stats(void);
+
+// What one link has seen since its CONNECT_EVT
+#define SHIM_BT_FIRST_HANDLE    0x28    // first app handle, after the GAP / GATT services
+#define SHIM_BT_HANDLES         64      // handles tracked per link, from the first
+
+typedef struct {
+    bool     open;
+    uint32_t responses;
+    uint8_t  last_status;       // of the last response
+    uint16_t last_len;
+    uint8_t  last_value[ESP_GATT_MAX_ATTR_LEN];
+    uint32_t svc_changed;       // Service Changed indications to this peer
+    uint16_t sent[SHIM_BT_HANDLES];   // notifications + indications, by handle - first
+} shim_bt_link_t;
+
+// false if conn_id was never connected
+bool shim_bt_link(uint16_t conn_id, shim_bt_link_t *out);
+
+// Add a peer to the bond list the stack reports (esp_ble_get_bond_device_list)
+void shim_bt_add_bond(const esp_bd_addr_t bda);
@@ -0,0 +1,10 @@
+#pragma once
+
+// Host build: the Bluedroid backend with the options of sdkconfig.defaults
+#define CONFIG_BT_ENABLED                   1
+#define CONFIG_BT_BLUEDROID_ENABLED         1
+#define CONFIG_BT_BLE_50_FEATURES_SUPPORTED 1
+#define CONFIG_BT_BLE_42_FEATURES_SUPPORTED 1
+#define CONFIG_BT_ACL_CONNECTIONS           4
+#define CONFIG_BLE_MAX_CONNECTIONS          4
+#define CONFIG_FREERTOS_HZ                  1000
@@ -0,0 +1,277 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "esp_timer.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "shim_internal.h"
+
+#define NVS_NS_MAX      16
+#define NVS_KEY_LEN     16          // 15 characters, as on the target
+
+typedef enum {
+    NVS_TYPE_U8,
+    NVS_TYPE_U16,
+    NVS_TYPE_U32,
+    NVS_TYPE_STR,
+    NVS_TYPE_BLOB,
+} nvs_type_t;
+
+typedef struct nvs_entry {
+    uint8_t           ns;
+    char              key[NVS_KEY_LEN];
+    nvs_type_t        type;
+    size_t            len;
+    uint8_t          *data;
+    struct nvs_entry *next;
+} nvs_entry_t;
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static char            s_ns[NVS_NS_MAX][NVS_KEY_LEN];
+static uint8_t         s_ns_count;
+static nvs_entry_t    *s_entries;
+static uint32_t        s_latency_us;
+
+// Handle: namespace index + 1, bit 8 set when writable
+#define HANDLE_RW       0x100
+
+void shim_nvs_set_latency_us(uint32_t us)
+{
+    s_latency_us = us;
+}
+
+// --- Call accounting ---
+
+static int64_t call_begin(void)
+{
+    shim_tls.nvs_calls++;
+    return esp_timer_get_time();
+}
+
+static esp_err_t call_end(int64_t t0, esp_err_t err)
+{
+    shim_tls.nvs_us += esp_timer_get_time() - t0;
+    return err;
+}
+
+// A flash write: charged the stubbed latency outside the store lock, so
+// readers on other threads are not held up
+static esp_err_t write_end(int64_t t0, esp_err_t err)
+{
+    shim_tls.nvs_writes++;
+    if (err == ESP_OK && s_latency_us) usleep(s_latency_us);
+    return call_end(t0, err);
+}
+
+// --- Store ---
+
+static nvs_entry_t *entry_find(uint8_t ns, const char *key)
+{
+    for (nvs_entry_t *e = s_entries; e; e = e->next)
+        if (e->ns == ns && strcmp(e->key, key) == 0)
+            return e;
+    return NULL;
+}
+
+static esp_err_t handle_ns(nvs_handle_t handle, bool write, uint8_t *ns)
+{
+    uint32_t idx = (handle & 0xFF) - 1;
+    if (idx >= s_ns_count) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (write && !(handle & HANDLE_RW)) return ESP_ERR_NVS_READ_ONLY;
+    *ns = idx;
+    return ESP_OK;
+}
+
+static esp_err_t entry_set(nvs_handle_t handle, const char *key, nvs_type_t type,
+                           const void *data, size_t len)
+{
+    if (!key || strlen(key) >= NVS_KEY_LEN) return ESP_ERR_INVALID_ARG;
+    pthread_mutex_lock(&s_lock);
+    uint8_t ns;
+    esp_err_t err = handle_ns(handle, true, &ns);
+    nvs_entry_t *e = err == ESP_OK ? entry_find(ns, key) : NULL;
+    uint8_t *copy = err == ESP_OK ? malloc(len ? len : 1) : NULL;
+    if (err == ESP_OK && !copy) err = ESP_ERR_NO_MEM;
+    if (err == ESP_OK && !e) {
+        e = calloc(1, sizeof(*e));
+        if (!e) {
+            err = ESP_ERR_NO_MEM;
+        } else {
+            e->ns = ns;
+            strcpy(e->key, key);
+            e->next   = s_entries;
+            s_entries = e;
+        }
+    }
+    if (err == ESP_OK) {
+        memcpy(copy, data, len);
+        free(e->data);
+        e->data = copy;
+        e->len  = len;
+        e->type = type;
+    } else {
+        free(copy);
+    }
+    pthread_mutex_unlock(&s_lock);
+    return err;
+}
+
+// Copy out a fixed-size value; strings / blobs follow the length protocol
+// of nvs_get_str (NULL out_value asks for the size)
+static esp_err_t entry_get(nvs_handle_t handle, const char *key, nvs_type_t type,
+                           void *out, size_t *len)
+{
+    pthread_mutex_lock(&s_lock);
+    uint8_t ns;
+    esp_err_t err = handle_ns(handle, false, &ns);
+    nvs_entry_t *e = err == ESP_OK ? entry_find(ns, key) : NULL;
+    if (err == ESP_OK && (!e || e->type != type)) err = ESP_ERR_NVS_NOT_FOUND;
+    if (err == ESP_OK) {
+        if (out && *len < e->len) err = ESP_ERR_NVS_INVALID_LENGTH;
+        else if (out) memcpy(out, e->data, e->len);
+        *len = e->len;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return err;
+}
+
+// --- API ---
+
+esp_err_t nvs_flash_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    pthread_mutex_lock(&s_lock);
+    while (s_entries) {
+        nvs_entry_t *e = s_entries;
+        s_entries = e->next;
+        free(e->data);
+        free(e);
+    }
+    s_ns_count = 0;
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    int64_t t0 = call_begin();
+    if (!name || strlen(name) >= NVS_KEY_LEN) return call_end(t0, ESP_ERR_INVALID_ARG);
+    esp_err_t err = ESP_OK;
+    pthread_mutex_lock(&s_lock);
+    uint8_t i = 0;
+    while (i < s_ns_count && strcmp(s_ns[i], name) != 0) i++;
+    if (i == s_ns_count) {
+        // Read-only opens do not create the namespace
+        if (open_mode == NVS_READONLY)  err = ESP_ERR_NVS_NOT_FOUND;
+        else if (i == NVS_NS_MAX)       err = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        else                            strcpy(s_ns[s_ns_count++], name);
+    }
+    pthread_mutex_unlock(&s_lock);
+    if (err == ESP_OK)
+        *out_handle = (i + 1) | (open_mode == NVS_READWRITE ? HANDLE_RW : 0);
+    return call_end(t0, err);
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    call_end(call_begin(), ESP_OK);
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    // Entries reach flash when set; commit only flushes the cache
+    return call_end(call_begin(), ESP_OK);
+}
+
+#define NVS_SET_INT(name, type_t, tag)                                          \
+    esp_err_t name(nvs_handle_t handle, const char *key, type_t value)          \
+    {                                                                           \
+        int64_t t0 = call_begin();                                              \
+        return write_end(t0, entry_set(handle, key, tag, &value, sizeof(value))); \
+    }
+
+#define NVS_GET_INT(name, type_t, tag)                                          \
+    esp_err_t name(nvs_handle_t handle, const char *key, type_t *out_value)     \
+    {                                                                           \
+        int64_t t0 = call_begin();                                              \
+        size_t len = sizeof(*out_value);                                        \
+        return call_end(t0, entry_get(handle, key, tag, out_value, &len));      \
+    }
+
+NVS_SET_INT(nvs_set_u8,  uint8_t,  NVS_TYPE_U8)
+NVS_SET_INT(nvs_set_u16, uint16_t, NVS_TYPE_U16)
+NVS_SET_INT(nvs_set_u32, uint32_t, NVS_TYPE_U32)
+NVS_GET_INT(nvs_get_u8,  uint8_t,  NVS_TYPE_U8)
+NVS_GET_INT(nvs_get_u16, uint16_t, NVS_TYPE_U16)
+NVS_GET_INT(nvs_get_u32, uint32_t, NVS_TYPE_U32)
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value)
+{
+    int64_t t0 = call_begin();
+    return write_end(t0, entry_set(handle, key, NVS_TYPE_STR, value, strlen(value) + 1));
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    int64_t t0 = call_begin();
+    return write_end(t0, entry_set(handle, key, NVS_TYPE_BLOB, value, length));
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length)
+{
+    int64_t t0 = call_begin();
+    return call_end(t0, entry_get(handle, key, NVS_TYPE_STR, out_value, length));
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    int64_t t0 = call_begin();
+    return call_end(t0, entry_get(handle, key, NVS_TYPE_BLOB, out_value, length));
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    int64_t t0 = call_begin();
+    pthread_mutex_lock(&s_lock);
+    uint8_t ns;
+    esp_err_t err = handle_ns(handle, true, &ns);
+    if (err == ESP_OK) {
+        err = ESP_ERR_NVS_NOT_FOUND;
+        for (nvs_entry_t **p = &s_entries; *p; p = &(*p)->next) {
+            nvs_entry_t *e = *p;
+            if (e->ns != ns || strcmp(e->key, key) != 0) continue;
+            *p = e->next;
+            free(e->data);
+            free(e);
+            err = ESP_OK;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    return write_end(t0, err);
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle)
+{
+    int64_t t0 = call_begin();
+    pthread_mutex_lock(&s_lock);
+    uint8_t ns;
+    esp_err_t err = handle_ns(handle, true, &ns);
+    for (nvs_entry_t **p = &s_entries; err == ESP_OK && *p; ) {
+        nvs_entry_t *e = *p;
+        if (e->ns != ns) {
+            p = &e->next;
+            continue;
+        }
+        *p = e->next;
+        free(e->data);
+        free(e);
+    }
+    pthread_mutex_unlock(&s_lock);
+    return write_end(t0, err);
+}
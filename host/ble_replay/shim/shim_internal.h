@@ -0,0 +1,6 @@
+#pragma once
+
+#include "host_shim.h"
+
+// Costs of the calling thread (host_shim.h)
+extern __thread shim_thread_stats_t shim_tls;
@@ -0,0 +1,112 @@
+// HSV micro-benchmark: compares led_color_hsv (main/led_color.c, hue table
+// plus scale8) with the integer sextant conversion it replaced. Checks every
+// h/s/v input for agreement within ±1 per channel, then times both on the
+// same pseudo-random inputs. Exit status 1 if any channel differs by more.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "led_color.h"
+
+#define BENCH_INPUTS   4096
+#define BENCH_PASSES   2000
+#define MAX_DEVIATION  1
+
+// --- Reference: the per-frame conversion used before led_color.c ---
+
+__attribute__((noinline))
+static void hsv_to_rgb(uint16_t h, uint8_t s, uint8_t v,
+                       uint8_t *r, uint8_t *g, uint8_t *b)
+{
+    if (s == 0) { *r = *g = *b = v; return; }
+    uint16_t region    = h / 60;
+    uint16_t remainder = (h - region * 60) * 255 / 60;
+    uint8_t  p = (uint16_t)v * (255 - s) / 255;
+    uint8_t  q = (uint16_t)v * (255 - ((uint16_t)s * remainder / 255)) / 255;
+    uint8_t  t = (uint16_t)v * (255 - ((uint16_t)s * (255 - remainder) / 255)) / 255;
+    switch (region) {
+    case 0: *r = v; *g = t; *b = p; break;
+    case 1: *r = q; *g = v; *b = p; break;
+    case 2: *r = p; *g = v; *b = t; break;
+    case 3: *r = p; *g = q; *b = v; break;
+    case 4: *r = t; *g = p; *b = v; break;
+    default:*r = v; *g = p; *b = q; break;
+    }
+}
+
+// --- Output check ---
+
+static int check_all(void)
+{
+    long off = 0, worst = 0;
+    uint16_t wh = 0;
+    uint8_t  ws = 0, wv = 0;
+    for (uint16_t h = 0; h < 360; h++)
+        for (int s = 0; s < 256; s++)
+            for (int v = 0; v < 256; v++) {
+                uint8_t a[3], b[3];
+                hsv_to_rgb(h, s, v, &a[0], &a[1], &a[2]);
+                led_color_hsv(h, s, v, &b[0], &b[1], &b[2]);
+                for (int c = 0; c < 3; c++) {
+                    int d = abs(a[c] - b[c]);
+                    if (d) off++;
+                    if (d > worst) { worst = d; wh = h; ws = s; wv = v; }
+                }
+            }
+    printf("Checked %d inputs: %ld channels differ, max deviation %ld",
+           360 * 256 * 256, off, worst);
+    if (worst) printf(" (h=%u s=%u v=%u)", wh, ws, wv);
+    printf("\n");
+    return worst <= MAX_DEVIATION ? 0 : 1;
+}
+
+// --- Timing ---
+
+typedef void (*hsv_fn_t)(uint16_t, uint8_t, uint8_t, uint8_t *, uint8_t *, uint8_t *);
+
+static uint16_t s_h[BENCH_INPUTS];
+static uint8_t  s_s[BENCH_INPUTS], s_v[BENCH_INPUTS];
+static volatile uint32_t s_sink;    // keeps the calls from being optimized out
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double time_fn(hsv_fn_t fn)
+{
+    uint32_t sum = 0;
+    double t0 = now_ns();
+    for (int p = 0; p < BENCH_PASSES; p++)
+        for (int i = 0; i < BENCH_INPUTS; i++) {
+            uint8_t r, g, b;
+            fn(s_h[i], s_s[i], s_v[i], &r, &g, &b);
+            sum += r + g + b;
+        }
+    double dt = now_ns() - t0;
+    s_sink = sum;
+    return dt / ((double)BENCH_PASSES * BENCH_INPUTS);
+}
+
+int main(void)
+{
+    int rc = check_all();
+
+    srand(1);
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        s_h[i] = rand() % 360;
+        s_s[i] = rand() & 0xFF;
+        s_v[i] = rand() & 0xFF;
+    }
+    time_fn(hsv_to_rgb);    // warm up caches
+    double old_ns = time_fn(hsv_to_rgb);
+    double lut_ns = time_fn(led_color_hsv);
+    printf("hsv_to_rgb    %6.2f ns/call\n", old_ns);
+    printf("led_color_hsv %6.2f ns/call (%.2fx)\n", lut_ns, old_ns / lut_ns);
+
+    if (rc) printf("FAIL: deviation above %d\n", MAX_DEVIATION);
+    return rc;
+}
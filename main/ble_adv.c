@@ -0,0 +1,134 @@
+#include "ble_adv.h"
+#include <string.h>
+#include "ble_backend.h"
+#include "config.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#define TAG "BLE_ADV"
+
+static volatile ble_adv_phase_t s_phase = BLE_ADV_OFF;
+static esp_timer_handle_t       s_fast_tmr;
+
+// Advertising packet: flags AD + manufacturer data AD (legacy limit 31 bytes)
+#define ADV_DATA_MAX    31
+#define ADV_MFR_OFFSET  3
+#define ADV_MFR_MAX     (ADV_DATA_MAX - ADV_MFR_OFFSET - 4)
+
+static uint8_t            s_data[ADV_DATA_MAX] = { 0x02, 0x01, 0x06 };  // LE General Disc., no BR/EDR
+static size_t             s_data_len = ADV_MFR_OFFSET;
+static bool               s_data_dirty;
+static bool               s_host_ready;       // backend accepts advertising data
+static int64_t            s_data_pushed_us;
+static esp_timer_handle_t s_data_tmr;
+static portMUX_TYPE       s_data_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void adv_apply(ble_adv_phase_t phase)
+{
+    s_phase = phase;
+    if (phase == BLE_ADV_FAST) {
+        // Open to everyone, so new centrals can find the device and pair
+        ble_backend_adv_start(BLE_ADV_FAST_ITVL_MIN, BLE_ADV_FAST_ITVL_MAX, false);
+    } else {
+        bool accept_list = BLE_SEC_MODE != BLE_SEC_NONE && BLE_SEC_ACCEPT_LIST &&
+                           ble_backend_bond_count() > 0;
+        ble_backend_adv_start(BLE_ADV_SLOW_ITVL_MIN, BLE_ADV_SLOW_ITVL_MAX, accept_list);
+    }
+}
+
+// Fast phase over without a connection: keep advertising, but rarely
+static void fast_timer_cb(void *arg)
+{
+    if (s_phase != BLE_ADV_FAST) return;
+    ESP_LOGI(TAG, "No connection after %d s, slow advertising", BLE_ADV_FAST_MS / 1000);
+    adv_apply(BLE_ADV_SLOW);
+}
+
+// Hand the latest packet to the controller; it replaces the advertised
+// data in place, without restarting advertising
+static void data_push(void)
+{
+    uint8_t buf[ADV_DATA_MAX];
+    size_t  len;
+    portENTER_CRITICAL(&s_data_lock);
+    memcpy(buf, s_data, s_data_len);
+    len          = s_data_len;
+    s_data_dirty = false;
+    portEXIT_CRITICAL(&s_data_lock);
+    s_data_pushed_us = esp_timer_get_time();
+    ble_backend_adv_set_data(buf, len);
+}
+
+static void data_timer_cb(void *arg)
+{
+    if (s_data_dirty)
+        data_push();
+}
+
+void ble_adv_init(void)
+{
+    const esp_timer_create_args_t args = {
+        .callback = fast_timer_cb,
+        .name     = "ble_adv",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&args, &s_fast_tmr));
+    const esp_timer_create_args_t data_args = {
+        .callback = data_timer_cb,
+        .name     = "ble_adv_data",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&data_args, &s_data_tmr));
+}
+
+void ble_adv_set_mfr_data(const uint8_t *data, size_t len)
+{
+    if (len > ADV_MFR_MAX) len = ADV_MFR_MAX;
+    portENTER_CRITICAL(&s_data_lock);
+    uint8_t *p = &s_data[ADV_MFR_OFFSET];
+    *p++ = len + 3;                     // AD length: type + company ID + payload
+    *p++ = 0xFF;                        // Manufacturer Specific Data
+    *p++ = BLE_ADV_COMPANY_ID & 0xFF;
+    *p++ = BLE_ADV_COMPANY_ID >> 8;
+    memcpy(p, data, len);
+    s_data_len   = ADV_MFR_OFFSET + 4 + len;
+    s_data_dirty = true;
+    portEXIT_CRITICAL(&s_data_lock);
+
+    // Before the host is up the packet is only stored; ble_adv_start sends it
+    if (!s_host_ready || esp_timer_is_active(s_data_tmr)) return;
+    int64_t wait_us = s_data_pushed_us + BLE_ADV_STATE_MIN_MS * 1000LL - esp_timer_get_time();
+    if (wait_us <= 0)
+        data_push();
+    else
+        esp_timer_start_once(s_data_tmr, wait_us);
+}
+
+void ble_adv_start(void)
+{
+    if (!s_host_ready) {
+        s_host_ready = true;
+        data_push();
+    }
+    esp_timer_stop(s_fast_tmr);
+    adv_apply(BLE_ADV_FAST);
+    esp_timer_start_once(s_fast_tmr, (uint64_t)BLE_ADV_FAST_MS * 1000);
+}
+
+void ble_adv_resume(void)
+{
+    // The fast timer keeps running across the connection, so a second
+    // central arriving early still finds the device quickly
+    adv_apply(esp_timer_is_active(s_fast_tmr) ? BLE_ADV_FAST : BLE_ADV_SLOW);
+}
+
+void ble_adv_stop(void)
+{
+    esp_timer_stop(s_fast_tmr);
+    s_phase = BLE_ADV_OFF;
+    ble_backend_adv_stop();
+}
+
+ble_adv_phase_t ble_adv_phase(void)
+{
+    return s_phase;
+}
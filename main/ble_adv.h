@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    BLE_ADV_OFF,
+    BLE_ADV_FAST,       // BLE_ADV_FAST_ITVL_* for BLE_ADV_FAST_MS
+    BLE_ADV_SLOW,       // BLE_ADV_SLOW_ITVL_* until connected or stopped; bonded
+                        // peers only with BLE_SEC_ACCEPT_LIST
+} ble_adv_phase_t;
+
+// Create the phase and data timers; call once before the host starts
+void ble_adv_init(void);
+
+// Advertise fast for BLE_ADV_FAST_MS, then back off to the slow interval.
+// Restarts the fast phase if already advertising (boot, disconnect, enable).
+void ble_adv_start(void);
+
+// Advertising stopped on connect: continue in the current phase while slots remain
+void ble_adv_resume(void);
+
+void ble_adv_stop(void);
+
+ble_adv_phase_t ble_adv_phase(void);
+
+// Set the manufacturer data payload (after the company ID) of the advertising
+// packet. Pushed to the controller at most every BLE_ADV_STATE_MIN_MS; later
+// calls inside that window replace the pending payload.
+void ble_adv_set_mfr_data(const uint8_t *data, size_t len);
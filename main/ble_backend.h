@@ -0,0 +1,121 @@
+#pragma once
+
+// Interface between the backend-neutral GATT service (ble_server.c) and the
+// host stack backend: ble_backend_bluedroid.c or ble_backend_nimble.c,
+// selected by CONFIG_BT_BLUEDROID_ENABLED / CONFIG_BT_NIMBLE_ENABLED.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#define BLE_CONN_NONE   0xFFFF
+
+// CCCD bits (Client Characteristic Configuration)
+#define BLE_CCCD_NOTIFY     0x0001
+#define BLE_CCCD_INDICATE   0x0002
+
+// Characteristic values served by the service layer
+typedef enum {
+    BLE_ATTR_VALUE,     // 0xFF01 persistent string
+    BLE_ATTR_LED,       // 0xFF03 LED command
+    BLE_ATTR_BATCH,     // 0xFF04 TLV command batch / per-op status
+    BLE_ATTR_STREAM,    // 0xFF05 colour stream (write without response)
+    BLE_ATTR_LOG,       // 0xFF06 event log download
+    BLE_ATTR_WIFI_SCAN, // 0xFF07 WiFi provisioning: scan results
+    BLE_ATTR_WIFI_CONN, // 0xFF08 WiFi provisioning: credentials / status
+    BLE_ATTR_TIME,      // 0x2A2B Current Time (service 0x1805)
+    BLE_ATTR_COUNT,
+} ble_attr_t;
+
+// --- Implemented by the backend ---
+
+// Human-readable backend name for logs ("Bluedroid" / "NimBLE")
+extern const char *const ble_backend_name;
+
+// Bring up controller + host and register the service; calls
+// ble_svc_on_ready() once the service is live
+void ble_backend_start(void);
+
+// Advertise connectable with the service UUID and name in the scan response
+// (the advertising packet itself comes from ble_backend_adv_set_data);
+// if already advertising, switch to the new interval (0.625 ms units).
+// accept_list limits scans and connections to bonded peers.
+void ble_backend_adv_start(uint16_t itvl_min, uint16_t itvl_max, bool accept_list);
+void ble_backend_adv_stop(void);
+
+// Replace the advertising packet (raw AD structures, at most 31 bytes);
+// takes effect immediately, also while advertising
+void ble_backend_adv_set_data(const uint8_t *data, size_t len);
+void ble_backend_disconnect(uint16_t conn_id);
+
+// CRC-32 of the service layout (UUIDs, permissions, properties); changes
+// whenever a firmware update alters the GATT table
+uint32_t ble_backend_db_fingerprint(void);
+
+// Indicate Service Changed over the whole handle range so clients drop their
+// cached handles. Called with BLE_CONN_NONE once at startup (NimBLE queues
+// it for bonded peers) and then once per bonded peer on its next
+// connection (used by Bluedroid).
+void ble_backend_service_changed(uint16_t conn_id);
+
+// Number of bonded peers in persistent storage (0 unless BLE_SEC_MODE bonds)
+int ble_backend_bond_count(void);
+
+// Addresses of up to max bonded peers; returns the number written
+int ble_backend_bond_list(uint8_t (*bda)[6], int max);
+
+// Send a notification (or indication) of data on attr; ble_svc_on_tx_done()
+// follows when the indication is confirmed
+esp_err_t ble_backend_notify(uint16_t conn_id, ble_attr_t attr,
+                             const void *data, size_t len, bool indicate);
+
+// Link-layer requests; results arrive via ble_svc_on_conn_params() and
+// ble_link_on_data_len() / ble_link_on_phy()
+esp_err_t ble_backend_update_params(uint16_t conn_id, uint16_t itvl_min, uint16_t itvl_max,
+                                    uint16_t latency, uint16_t timeout);
+void ble_backend_set_data_len(uint16_t conn_id, uint16_t tx_octets);
+void ble_backend_set_phy_2m(uint16_t conn_id);
+
+// Sample the RSSI of a connection; the result arrives via ble_svc_on_rssi()
+void ble_backend_read_rssi(uint16_t conn_id);
+
+// --- Implemented by the service layer, called from the backend's host task ---
+
+void ble_svc_on_ready(void);
+void ble_svc_on_adv_started(void);
+
+// Returns false if no connection slot is free (the backend then disconnects)
+bool ble_svc_on_connect(uint16_t conn_id, const uint8_t bda[6],
+                        uint16_t itvl, uint16_t latency, uint16_t timeout);
+void ble_svc_on_disconnect(uint16_t conn_id);
+void ble_svc_on_mtu(uint16_t conn_id, uint16_t mtu);
+uint16_t ble_svc_get_mtu(uint16_t conn_id);
+void ble_svc_on_conn_params(uint16_t conn_id, uint16_t itvl, uint16_t latency, uint16_t timeout);
+void ble_svc_on_tx_done(uint16_t conn_id);
+void ble_svc_on_rssi(uint16_t conn_id, int8_t rssi);
+
+// Pairing (BLE_SEC_MODE != BLE_SEC_NONE): passkey for the user to type on
+// the central, then the outcome once the link is encrypted or pairing failed
+void ble_svc_on_passkey(uint16_t conn_id, uint32_t passkey);
+void ble_svc_on_auth(uint16_t conn_id, bool success, bool bonded);
+
+// CCCD state of a connection (the backend owns the descriptor attribute)
+void     ble_svc_on_subscribe(uint16_t conn_id, ble_attr_t attr, uint16_t cccd);
+uint16_t ble_svc_get_cccd(uint16_t conn_id, ble_attr_t attr);
+
+// Current value of attr; first is false for read blob continuations.
+// The pointer stays valid until the next call from the same task.
+const void *ble_svc_read(uint16_t conn_id, ble_attr_t attr, bool first, size_t *len);
+
+// Apply a complete write (after prepare-write reassembly); call
+// ble_svc_write_commit() after the ATT response to persist slow state.
+// BLE_SVC_ERR_CCCD: the write needs notifications enabled first; backends
+// answer ATT 0xFD (Client Characteristic Configuration improperly configured)
+#define BLE_SVC_ERR_CCCD    ESP_ERR_NOT_SUPPORTED
+esp_err_t ble_svc_write(uint16_t conn_id, ble_attr_t attr, const uint8_t *data, size_t len);
+void      ble_svc_write_commit(uint16_t conn_id, ble_attr_t attr);
+
+// Peer address of a connection / connection of a peer address
+bool     ble_svc_conn_bda(uint16_t conn_id, uint8_t bda[6]);
+uint16_t ble_svc_conn_by_bda(const uint8_t bda[6]);
@@ -0,0 +1,820 @@
+#include "sdkconfig.h"
+#if CONFIG_BT_BLUEDROID_ENABLED
+
+#include <stdlib.h>
+#include <string.h>
+#include "ble_backend.h"
+#include "ble_cts.h"
+#include "ble_link.h"
+#include "ble_prov.h"
+#include "config.h"
+#include "prof.h"
+#include "esp_bt.h"
+#include "esp_bt_main.h"
+#include "esp_gap_ble_api.h"
+#include "esp_gatts_api.h"
+#include "esp_gatt_common_api.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+
+#define TAG "BLE_BLUEDROID"
+
+// GATTS application profile ID
+#define PROFILE_APP_ID      0
+
+const char *const ble_backend_name = "Bluedroid";
+
+static esp_gatt_if_t s_gatts_if = ESP_GATT_IF_NONE;
+
+// --- Attribute table ---
+
+// Attribute indices; Bluedroid assigns consecutive handles in this order
+enum {
+    IDX_SVC,
+    IDX_VALUE_CHAR,
+    IDX_VALUE_VAL,
+    IDX_VALUE_CCCD,
+    IDX_LED_CHAR,
+    IDX_LED_VAL,
+    IDX_LED_CCCD,
+    IDX_BATCH_CHAR,
+    IDX_BATCH_VAL,
+    IDX_BATCH_CCCD,
+    IDX_STREAM_CHAR,
+    IDX_STREAM_VAL,
+    IDX_LOG_CHAR,
+    IDX_LOG_VAL,
+    IDX_LOG_CCCD,
+    IDX_WIFI_SCAN_CHAR,
+    IDX_WIFI_SCAN_VAL,
+    IDX_WIFI_SCAN_CCCD,
+    IDX_WIFI_CONN_CHAR,
+    IDX_WIFI_CONN_VAL,
+    IDX_WIFI_CONN_CCCD,
+    // Current Time Service: a second table, so its handles follow its own declaration
+    IDX_CTS_SVC,
+    IDX_CTS_CHAR,
+    IDX_CTS_VAL,
+    IDX_CTS_CCCD,
+    IDX_NB,
+};
+
+static const uint16_t s_uuid_primary_svc = ESP_GATT_UUID_PRI_SERVICE;
+static const uint16_t s_uuid_char_decl   = ESP_GATT_UUID_CHAR_DECLARE;
+static const uint16_t s_uuid_cccd        = ESP_GATT_UUID_CHAR_CLIENT_CONFIG;
+static const uint16_t s_uuid_service     = BLE_SERVICE_UUID;
+static const uint16_t s_uuid_value       = BLE_CHAR_UUID;
+static const uint16_t s_uuid_led         = BLE_LED_CHAR_UUID;
+static const uint16_t s_uuid_batch       = BLE_BATCH_CHAR_UUID;
+static const uint16_t s_uuid_stream      = BLE_STREAM_CHAR_UUID;
+static const uint16_t s_uuid_log         = BLE_LOG_CHAR_UUID;
+static const uint16_t s_uuid_wifi_scan   = BLE_WIFI_SCAN_CHAR_UUID;
+static const uint16_t s_uuid_wifi_conn   = BLE_WIFI_CONN_CHAR_UUID;
+static const uint16_t s_uuid_cts_svc     = BLE_CTS_SVC_UUID;
+static const uint16_t s_uuid_cts         = BLE_CTS_CHAR_UUID;
+static const uint8_t  s_prop_rw_notify   = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE |
+                                           ESP_GATT_CHAR_PROP_BIT_NOTIFY | ESP_GATT_CHAR_PROP_BIT_INDICATE;
+static const uint8_t  s_prop_write_nr    = ESP_GATT_CHAR_PROP_BIT_WRITE_NR;
+static const uint8_t  s_prop_log         = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE |
+                                           ESP_GATT_CHAR_PROP_BIT_NOTIFY;
+static const uint8_t  s_cccd_default[2]  = {0x00, 0x00};
+
+#define ATTR_PERM_RW    (ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE)
+
+// With bonding enabled, value writes need an encrypted (and for passkey
+// pairing, authenticated) link; the stack answers Insufficient Encryption,
+// which makes the central pair. CCCDs stay writable on any link.
+#if BLE_SEC_MODE == BLE_SEC_PASSKEY
+#define ATTR_PERM_VAL   (ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE_ENC_MITM)
+#elif BLE_SEC_MODE == BLE_SEC_JUST_WORKS
+#define ATTR_PERM_VAL   (ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE_ENCRYPTED)
+#else
+#define ATTR_PERM_VAL   ATTR_PERM_RW
+#endif
+#define ATTR_PERM_WO    (ATTR_PERM_VAL & ~ESP_GATT_PERM_READ)
+#define ATTR16(uuid)    ESP_UUID_LEN_16, (uint8_t *)&(uuid)
+
+// Values are served by the app (read/write handlers below), so the stack
+// stores nothing but the declarations.
+static const esp_gatts_attr_db_t s_gatt_db[IDX_NB] = {
+    [IDX_SVC]        = {{ESP_GATT_AUTO_RSP}, {ATTR16(s_uuid_primary_svc), ESP_GATT_PERM_READ,
+                        sizeof(uint16_t), sizeof(uint16_t), (uint8_t *)&s_uuid_service}},
+
+    [IDX_VALUE_CHAR] = {{ESP_GATT_AUTO_RSP}, {ATTR16(s_uuid_char_decl), ESP_GATT_PERM_READ,
+                        1, 1, (uint8_t *)&s_prop_rw_notify}},
+    [IDX_VALUE_VAL]  = {{ESP_GATT_RSP_BY_APP}, {ATTR16(s_uuid_value), ATTR_PERM_VAL,
+                        BLE_MAX_VALUE_LEN, 0, NULL}},
+    [IDX_VALUE_CCCD] = {{ESP_GATT_RSP_BY_APP}, {ATTR16(s_uuid_cccd), ATTR_PERM_RW,
+                        2, 2, (uint8_t *)s_cccd_default}},
+
+    [IDX_LED_CHAR]   = {{ESP_GATT_AUTO_RSP}, {ATTR16(s_uuid_char_decl), ESP_GATT_PERM_READ,
+                        1, 1, (uint8_t *)&s_prop_rw_notify}},
+    [IDX_LED_VAL]    = {{ESP_GATT_RSP_BY_APP}, {ATTR16(s_uuid_led), ATTR_PERM_VAL,
+                        BLE_LED_CMD_MAX_LEN, 0, NULL}},
+    [IDX_LED_CCCD]   = {{ESP_GATT_RSP_BY_APP}, {ATTR16(s_uuid_cccd), ATTR_PERM_RW,
+                        2, 2, (uint8_t *)s_cccd_default}},
+
+    [IDX_BATCH_CHAR] = {{ESP_GATT_AUTO_RSP}, {ATTR16(s_uuid_char_decl), ESP_GATT_PERM_READ,
+                        1, 1, (uint8_t *)&s_prop_rw_notify}},
+    [IDX_BATCH_VAL]  = {{ESP_GATT_RSP_BY_APP}, {ATTR16(s_uuid_batch), ATTR_PERM_VAL,
+                        BLE_MAX_VALUE_LEN, 0, NULL}},
+    [IDX_BATCH_CCCD] = {{ESP_GATT_RSP_BY_APP}, {ATTR16(s_uuid_cccd), ATTR_PERM_RW,
+                        2, 2, (uint8_t *)s_cccd_default}},
+
+    [IDX_STREAM_CHAR] = {{ESP_GATT_AUTO_RSP}, {ATTR16(s_uuid_char_decl), ESP_GATT_PERM_READ,
+                        1, 1, (uint8_t *)&s_prop_write_nr}},
+    [IDX_STREAM_VAL]  = {{ESP_GATT_RSP_BY_APP}, {ATTR16(s_uuid_stream), ATTR_PERM_WO,
+                        BLE_LOCAL_MTU - 3, 0, NULL}},
+
+    [IDX_LOG_CHAR]   = {{ESP_GATT_AUTO_RSP}, {ATTR16(s_uuid_char_decl), ESP_GATT_PERM_READ,
+                        1, 1, (uint8_t *)&s_prop_log}},
+    [IDX_LOG_VAL]    = {{ESP_GATT_RSP_BY_APP}, {ATTR16(s_uuid_log), ATTR_PERM_VAL,
+                        BLE_LOCAL_MTU - 3, 0, NULL}},
+    [IDX_LOG_CCCD]   = {{ESP_GATT_RSP_BY_APP}, {ATTR16(s_uuid_cccd), ATTR_PERM_RW,
+                        2, 2, (uint8_t *)s_cccd_default}},
+
+    [IDX_WIFI_SCAN_CHAR] = {{ESP_GATT_AUTO_RSP}, {ATTR16(s_uuid_char_decl), ESP_GATT_PERM_READ,
+                        1, 1, (uint8_t *)&s_prop_log}},
+    [IDX_WIFI_SCAN_VAL]  = {{ESP_GATT_RSP_BY_APP}, {ATTR16(s_uuid_wifi_scan), ATTR_PERM_VAL,
+                        BLE_PROV_AP_MAX, 0, NULL}},
+    [IDX_WIFI_SCAN_CCCD] = {{ESP_GATT_RSP_BY_APP}, {ATTR16(s_uuid_cccd), ATTR_PERM_RW,
+                        2, 2, (uint8_t *)s_cccd_default}},
+
+    [IDX_WIFI_CONN_CHAR] = {{ESP_GATT_AUTO_RSP}, {ATTR16(s_uuid_char_decl), ESP_GATT_PERM_READ,
+                        1, 1, (uint8_t *)&s_prop_log}},
+    [IDX_WIFI_CONN_VAL]  = {{ESP_GATT_RSP_BY_APP}, {ATTR16(s_uuid_wifi_conn), ATTR_PERM_VAL,
+                        BLE_PROV_CREDS_MAX, 0, NULL}},
+    [IDX_WIFI_CONN_CCCD] = {{ESP_GATT_RSP_BY_APP}, {ATTR16(s_uuid_cccd), ATTR_PERM_RW,
+                        2, 2, (uint8_t *)s_cccd_default}},
+
+    [IDX_CTS_SVC]    = {{ESP_GATT_AUTO_RSP}, {ATTR16(s_uuid_primary_svc), ESP_GATT_PERM_READ,
+                        sizeof(uint16_t), sizeof(uint16_t), (uint8_t *)&s_uuid_cts_svc}},
+    [IDX_CTS_CHAR]   = {{ESP_GATT_AUTO_RSP}, {ATTR16(s_uuid_char_decl), ESP_GATT_PERM_READ,
+                        1, 1, (uint8_t *)&s_prop_log}},
+    [IDX_CTS_VAL]    = {{ESP_GATT_RSP_BY_APP}, {ATTR16(s_uuid_cts), ATTR_PERM_VAL,
+                        BLE_CTS_LEN, 0, NULL}},
+    [IDX_CTS_CCCD]   = {{ESP_GATT_RSP_BY_APP}, {ATTR16(s_uuid_cccd), ATTR_PERM_RW,
+                        2, 2, (uint8_t *)s_cccd_default}},
+};
+
+static uint16_t s_handles[IDX_NB];
+
+// Attribute index for a handle of our services, or IDX_NB if it is not ours
+static int attr_index(uint16_t handle)
+{
+    uint16_t idx = handle - s_handles[IDX_SVC];
+    if (s_handles[IDX_SVC] && idx < IDX_CTS_SVC) return idx;
+    idx = handle - s_handles[IDX_CTS_SVC];
+    if (s_handles[IDX_CTS_SVC] && idx < IDX_NB - IDX_CTS_SVC) return IDX_CTS_SVC + idx;
+    return IDX_NB;
+}
+
+// Value attribute of each service-level attribute
+static const uint8_t s_val_idx[BLE_ATTR_COUNT] = {
+    [BLE_ATTR_VALUE]  = IDX_VALUE_VAL,
+    [BLE_ATTR_LED]    = IDX_LED_VAL,
+    [BLE_ATTR_BATCH]  = IDX_BATCH_VAL,
+    [BLE_ATTR_STREAM] = IDX_STREAM_VAL,
+    [BLE_ATTR_LOG]    = IDX_LOG_VAL,
+    [BLE_ATTR_WIFI_SCAN] = IDX_WIFI_SCAN_VAL,
+    [BLE_ATTR_WIFI_CONN] = IDX_WIFI_CONN_VAL,
+    [BLE_ATTR_TIME]   = IDX_CTS_VAL,
+};
+
+// Queued prepare-write reassembly for the long characteristics, 0xFF01,
+// 0xFF04 and 0xFF08 (one queue at a time)
+static uint8_t  s_prep_buf[BLE_MAX_VALUE_LEN];
+static uint16_t s_prep_len    = 0;
+static uint16_t s_prep_conn   = BLE_CONN_NONE;
+static int      s_prep_idx    = IDX_NB;
+
+// Data length requests awaiting completion; the completion event carries no
+// address, so they are matched in request order.
+static uint16_t s_dle_fifo[BLE_MAX_CONNECTIONS];
+static uint8_t  s_dle_count = 0;
+
+// --- Advertising ---
+
+// Service UUID in 128-bit little-endian form; Bluedroid shortens it to the
+// 16-bit AD type because it sits on the Bluetooth base UUID
+static uint8_t s_svc_uuid128[16] = {
+    0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80,
+    0x00, 0x10, 0x00, 0x00,
+    BLE_SERVICE_UUID & 0xFF, BLE_SERVICE_UUID >> 8, 0x00, 0x00,
+};
+
+// Scan response: service UUID and complete name, sent to active scanners
+static esp_ble_adv_data_t scan_rsp_data = {
+    .set_scan_rsp        = true,
+    .include_name        = true,
+    .service_uuid_len    = sizeof(s_svc_uuid128),
+    .p_service_uuid      = s_svc_uuid128,
+};
+
+static esp_ble_adv_params_t adv_params = {
+    .adv_int_min        = BLE_ADV_FAST_ITVL_MIN,
+    .adv_int_max        = BLE_ADV_FAST_ITVL_MAX,
+    .adv_type           = ADV_TYPE_IND,
+    .own_addr_type      = BLE_ADDR_TYPE_PUBLIC,
+    .channel_map        = ADV_CHNL_ALL,
+    .adv_filter_policy  = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY,
+};
+
+// Legacy advertising parameters cannot change while enabled, so an interval
+// switch stops advertising and restarts it from ADV_STOP_COMPLETE.
+// s_adv_active is set when the start is requested, not when it completes.
+static volatile bool s_adv_active  = false;
+static volatile bool s_adv_restart = false;
+
+// Filter accept list = bonded peers; reloaded before the next advertising
+// start after a new bond (the controller refuses changes while in use)
+static volatile bool s_wl_dirty = true;
+
+static void accept_list_load(void)
+{
+    s_wl_dirty = false;
+    esp_ble_gap_clear_whitelist();
+    int n = esp_ble_get_bond_device_num();
+    if (n <= 0) return;
+    esp_ble_bond_dev_t *list = calloc(n, sizeof(*list));
+    if (!list) return;
+    if (esp_ble_get_bond_device_list(&n, list) == ESP_OK) {
+        for (int i = 0; i < n; i++)
+            esp_ble_gap_update_whitelist(true, list[i].bd_addr,
+                                         list[i].bd_addr_type == BLE_ADDR_TYPE_PUBLIC
+                                             ? BLE_WL_ADDR_TYPE_PUBLIC : BLE_WL_ADDR_TYPE_RANDOM);
+        ESP_LOGI(TAG, "Accept list: %d bonded peer(s)", n);
+    }
+    free(list);
+}
+
+static void adv_start_now(void)
+{
+    if (BLE_SEC_MODE != BLE_SEC_NONE && s_wl_dirty)
+        accept_list_load();
+    s_adv_active = true;
+    esp_ble_gap_start_advertising(&adv_params);
+}
+
+// --- GAP event handler ---
+
+static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
+{
+    switch (event) {
+    case ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT:
+        if (param->adv_data_raw_cmpl.status != ESP_BT_STATUS_SUCCESS)
+            ESP_LOGW(TAG, "Advertising data rejected, status %d", param->adv_data_raw_cmpl.status);
+        break;
+
+    case ESP_GAP_BLE_ADV_START_COMPLETE_EVT:
+        if (param->adv_start_cmpl.status != ESP_BT_STATUS_SUCCESS) {
+            ESP_LOGE(TAG, "Advertising start failed");
+            s_adv_active = false;
+            break;
+        }
+        ESP_LOGI(TAG, "Advertising started, interval %d-%d",
+                 adv_params.adv_int_min, adv_params.adv_int_max);
+        ble_svc_on_adv_started();
+        break;
+
+    case ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT:
+        s_adv_active = false;
+        if (s_adv_restart) {
+            s_adv_restart = false;
+            adv_start_now();
+            break;
+        }
+        ESP_LOGI(TAG, "Advertising stopped");
+        break;
+
+    case ESP_GAP_BLE_SEC_REQ_EVT:
+        // Only sent by centrals that pair on their own; others are asked
+        // through Insufficient Encryption on a protected write
+        ESP_LOGI(TAG, "Security request received, %s pairing",
+                 BLE_SEC_MODE != BLE_SEC_NONE ? "accepting" : "rejecting");
+        esp_ble_gap_security_rsp(param->ble_security.ble_req.bd_addr,
+                                 BLE_SEC_MODE != BLE_SEC_NONE);
+        break;
+
+    case ESP_GAP_BLE_PASSKEY_NOTIF_EVT:
+        ble_svc_on_passkey(ble_svc_conn_by_bda(param->ble_security.key_notif.bd_addr),
+                           param->ble_security.key_notif.passkey);
+        break;
+
+    case ESP_GAP_BLE_AUTH_CMPL_EVT: {
+        esp_ble_auth_cmpl_t *a = &param->ble_security.auth_cmpl;
+        if (!a->success)
+            ESP_LOGW(TAG, "Pairing failed, reason 0x%x", a->fail_reason);
+        else
+            s_wl_dirty = true;
+        ble_svc_on_auth(ble_svc_conn_by_bda(a->bd_addr), a->success,
+                        a->success && BLE_SEC_MODE != BLE_SEC_NONE);
+        break;
+    }
+
+    case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT: {
+        uint16_t conn_id = ble_svc_conn_by_bda(param->update_conn_params.bda);
+        if (conn_id == BLE_CONN_NONE) break;
+        if (param->update_conn_params.status != ESP_BT_STATUS_SUCCESS) {
+            ESP_LOGW(TAG, "Conn param update rejected, status %d",
+                     param->update_conn_params.status);
+            break;
+        }
+        ble_svc_on_conn_params(conn_id, param->update_conn_params.conn_int,
+                               param->update_conn_params.latency,
+                               param->update_conn_params.timeout);
+        break;
+    }
+
+    case ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT: {
+        if (s_dle_count == 0) break;
+        uint16_t conn_id = s_dle_fifo[0];
+        memmove(s_dle_fifo, s_dle_fifo + 1, --s_dle_count * sizeof(s_dle_fifo[0]));
+        if (param->pkt_data_length_cmpl.status != ESP_BT_STATUS_SUCCESS) {
+            ESP_LOGW(TAG, "Data length update failed, status %d",
+                     param->pkt_data_length_cmpl.status);
+            break;
+        }
+        ble_link_on_data_len(conn_id, param->pkt_data_length_cmpl.params.tx_len,
+                             param->pkt_data_length_cmpl.params.rx_len);
+        break;
+    }
+
+    case ESP_GAP_BLE_READ_RSSI_COMPLETE_EVT: {
+        uint16_t conn_id = ble_svc_conn_by_bda(param->read_rssi_cmpl.remote_addr);
+        if (conn_id != BLE_CONN_NONE && param->read_rssi_cmpl.status == ESP_BT_STATUS_SUCCESS)
+            ble_svc_on_rssi(conn_id, param->read_rssi_cmpl.rssi);
+        break;
+    }
+
+#if CONFIG_BT_BLE_50_FEATURES_SUPPORTED
+    case ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT: {
+        uint16_t conn_id = ble_svc_conn_by_bda(param->phy_update.bda);
+        if (conn_id != BLE_CONN_NONE && param->phy_update.status == ESP_BT_STATUS_SUCCESS)
+            ble_link_on_phy(conn_id, param->phy_update.tx_phy, param->phy_update.rx_phy);
+        break;
+    }
+#endif
+
+    default:
+        break;
+    }
+}
+
+// --- Read/write helpers ---
+
+// Answer a read (or read blob) from data[offset..]; at most MTU-1 bytes per PDU,
+// the client continues with read blob requests for the remainder.
+static void send_read_rsp(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param,
+                          const void *data, size_t len)
+{
+    uint16_t offset = param->read.offset;
+    if (offset > len) {
+        esp_ble_gatts_send_response(gatts_if, param->read.conn_id,
+                                    param->read.trans_id, ESP_GATT_INVALID_OFFSET, NULL);
+        return;
+    }
+    uint16_t mtu = ble_svc_get_mtu(param->read.conn_id);
+    size_t chunk = len - offset;
+    if (chunk > (size_t)(mtu - 1)) chunk = mtu - 1;
+
+    esp_gatt_rsp_t rsp = {0};
+    rsp.attr_value.handle = param->read.handle;
+    rsp.attr_value.offset = offset;
+    rsp.attr_value.len    = chunk;
+    memcpy(rsp.attr_value.value, (const uint8_t *)data + offset, chunk);
+    esp_ble_gatts_send_response(gatts_if, param->read.conn_id,
+                                param->read.trans_id, ESP_GATT_OK, &rsp);
+}
+
+static void write_rsp(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param, esp_gatt_status_t status)
+{
+    if (param->write.need_rsp)
+        esp_ble_gatts_send_response(gatts_if, param->write.conn_id,
+                                    param->write.trans_id, status, NULL);
+}
+
+// Queue one Prepare Write fragment; the response echoes the fragment back
+static void prep_write(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param)
+{
+    esp_gatt_status_t status = ESP_GATT_OK;
+    int idx = attr_index(param->write.handle);
+    if (idx != IDX_VALUE_VAL && idx != IDX_BATCH_VAL && idx != IDX_WIFI_CONN_VAL) {
+        status = ESP_GATT_REQ_NOT_SUPPORTED;   // only 0xFF01 / 0xFF04 / 0xFF08 are long values
+    } else if (s_prep_conn != BLE_CONN_NONE &&
+               (s_prep_conn != param->write.conn_id || s_prep_idx != idx)) {
+        status = ESP_GATT_PREPARE_Q_FULL;
+    } else if ((size_t)param->write.offset + param->write.len > sizeof(s_prep_buf)) {
+        status = ESP_GATT_INVALID_OFFSET;
+    }
+
+    if (status == ESP_GATT_OK) {
+        s_prep_conn = param->write.conn_id;
+        s_prep_idx  = idx;
+        memcpy(s_prep_buf + param->write.offset, param->write.value, param->write.len);
+        uint16_t end = param->write.offset + param->write.len;
+        if (end > s_prep_len) s_prep_len = end;
+    }
+
+    if (!param->write.need_rsp) return;
+    esp_gatt_rsp_t rsp = {0};
+    rsp.attr_value.handle = param->write.handle;
+    rsp.attr_value.offset = param->write.offset;
+    if (status == ESP_GATT_OK) {
+        rsp.attr_value.len = param->write.len;
+        memcpy(rsp.attr_value.value, param->write.value, param->write.len);
+    }
+    esp_ble_gatts_send_response(gatts_if, param->write.conn_id,
+                                param->write.trans_id, status, &rsp);
+}
+
+static void prep_reset(void)
+{
+    s_prep_len  = 0;
+    s_prep_conn = BLE_CONN_NONE;
+    s_prep_idx  = IDX_NB;
+}
+
+// --- Attribute read/write handlers ---
+
+typedef void (*attr_read_fn)(ble_attr_t attr, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param);
+typedef void (*attr_write_fn)(ble_attr_t attr, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param);
+
+static void value_read(ble_attr_t attr, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param)
+{
+    size_t len;
+    const void *data = ble_svc_read(param->read.conn_id, attr, !param->read.is_long, &len);
+    send_read_rsp(gatts_if, param, data, len);
+}
+
+// ble_svc_write() result as an ATT status, for single and queued writes
+static esp_gatt_status_t write_status(esp_err_t err)
+{
+    return err == ESP_OK               ? ESP_GATT_OK :
+           err == ESP_ERR_INVALID_SIZE ? ESP_GATT_INVALID_ATTR_LEN :
+           err == BLE_SVC_ERR_CCCD     ? ESP_GATT_CCC_CFG_ERR : ESP_GATT_ERROR;
+}
+
+static void value_write(ble_attr_t attr, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param)
+{
+    esp_err_t err = ble_svc_write(param->write.conn_id, attr, param->write.value, param->write.len);
+    // Send response immediately — NVS write below can take 20-50 ms and
+    // must not block the BLE callback task before the client gets an ACK.
+    write_rsp(gatts_if, param, write_status(err));
+    if (err == ESP_OK)
+        ble_svc_write_commit(param->write.conn_id, attr);
+}
+
+static void cccd_read(ble_attr_t attr, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param)
+{
+    uint16_t cccd = ble_svc_get_cccd(param->read.conn_id, attr);
+    uint8_t v[2] = { cccd & 0xFF, cccd >> 8 };
+    send_read_rsp(gatts_if, param, v, sizeof(v));
+}
+
+static void cccd_write(ble_attr_t attr, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param)
+{
+    if (param->write.len != 2) {
+        write_rsp(gatts_if, param, ESP_GATT_INVALID_ATTR_LEN);
+        return;
+    }
+    ble_svc_on_subscribe(param->write.conn_id, attr,
+                         param->write.value[0] | (param->write.value[1] << 8));
+    write_rsp(gatts_if, param, ESP_GATT_OK);
+}
+
+// Handle-indexed dispatch: attr_index(handle) selects the handler directly
+static const struct {
+    attr_read_fn  read;
+    attr_write_fn write;
+    ble_attr_t    attr;
+} s_attr_ops[IDX_NB] = {
+    [IDX_VALUE_VAL]  = { value_read, value_write, BLE_ATTR_VALUE },
+    [IDX_VALUE_CCCD] = { cccd_read,  cccd_write,  BLE_ATTR_VALUE },
+    [IDX_LED_VAL]    = { value_read, value_write, BLE_ATTR_LED   },
+    [IDX_LED_CCCD]   = { cccd_read,  cccd_write,  BLE_ATTR_LED   },
+    [IDX_BATCH_VAL]  = { value_read, value_write, BLE_ATTR_BATCH },
+    [IDX_BATCH_CCCD] = { cccd_read,  cccd_write,  BLE_ATTR_BATCH },
+    [IDX_STREAM_VAL] = { NULL,       value_write, BLE_ATTR_STREAM },
+    [IDX_LOG_VAL]    = { value_read, value_write, BLE_ATTR_LOG   },
+    [IDX_LOG_CCCD]   = { cccd_read,  cccd_write,  BLE_ATTR_LOG   },
+    [IDX_WIFI_SCAN_VAL]  = { value_read, value_write, BLE_ATTR_WIFI_SCAN },
+    [IDX_WIFI_SCAN_CCCD] = { cccd_read,  cccd_write,  BLE_ATTR_WIFI_SCAN },
+    [IDX_WIFI_CONN_VAL]  = { value_read, value_write, BLE_ATTR_WIFI_CONN },
+    [IDX_WIFI_CONN_CCCD] = { cccd_read,  cccd_write,  BLE_ATTR_WIFI_CONN },
+    [IDX_CTS_VAL]    = { value_read, value_write, BLE_ATTR_TIME  },
+    [IDX_CTS_CCCD]   = { cccd_read,  cccd_write,  BLE_ATTR_TIME  },
+};
+
+// --- GATTS event handler ---
+
+static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
+                                 esp_ble_gatts_cb_param_t *param)
+{
+    switch (event) {
+    case ESP_GATTS_REG_EVT:
+        ESP_LOGI(TAG, "GATTS registered, app_id: %d", param->reg.app_id);
+        s_gatts_if = gatts_if;
+        esp_ble_gap_set_device_name(BLE_DEVICE_NAME);
+        // Whole service in one request instead of a create/add_char chain
+        esp_ble_gatts_create_attr_tab(s_gatt_db, gatts_if, IDX_CTS_SVC, 0);
+        break;
+
+    case ESP_GATTS_CREAT_ATTR_TAB_EVT: {
+        // Our service first, then the Current Time Service once it exists
+        bool cts = param->add_attr_tab.svc_uuid.uuid.uuid16 == BLE_CTS_SVC_UUID;
+        int first = cts ? IDX_CTS_SVC : IDX_SVC;
+        int count = cts ? IDX_NB - IDX_CTS_SVC : IDX_CTS_SVC;
+        if (param->add_attr_tab.status != ESP_GATT_OK ||
+            param->add_attr_tab.num_handle != count) {
+            ESP_LOGE(TAG, "Attribute table 0x%04X creation failed, status %d, handles %d",
+                     param->add_attr_tab.svc_uuid.uuid.uuid16,
+                     param->add_attr_tab.status, param->add_attr_tab.num_handle);
+            break;
+        }
+        memcpy(&s_handles[first], param->add_attr_tab.handles, count * sizeof(s_handles[0]));
+        ESP_LOGI(TAG, "Attribute table 0x%04X created, handles %d-%d",
+                 param->add_attr_tab.svc_uuid.uuid.uuid16,
+                 s_handles[first], s_handles[first + count - 1]);
+        esp_ble_gatts_start_service(s_handles[first]);
+        if (!cts)
+            esp_ble_gatts_create_attr_tab(&s_gatt_db[IDX_CTS_SVC], gatts_if,
+                                          IDX_NB - IDX_CTS_SVC, 0);
+        break;
+    }
+
+    case ESP_GATTS_START_EVT:
+        ESP_LOGI(TAG, "Service started, handle %d", param->start.service_handle);
+        // The Current Time Service is started last
+        if (param->start.service_handle != s_handles[IDX_CTS_SVC]) break;
+        esp_ble_gap_config_adv_data(&scan_rsp_data);
+        ble_svc_on_ready();
+        break;
+
+    case ESP_GATTS_CONNECT_EVT:
+        s_adv_active = false;       // the controller stops advertising on connect
+        if (!ble_svc_on_connect(param->connect.conn_id, param->connect.remote_bda,
+                                param->connect.conn_params.interval,
+                                param->connect.conn_params.latency,
+                                param->connect.conn_params.timeout))
+            esp_ble_gatts_close(gatts_if, param->connect.conn_id);
+        break;
+
+    case ESP_GATTS_DISCONNECT_EVT:
+        if (s_prep_conn == param->disconnect.conn_id)
+            prep_reset();
+        ble_svc_on_disconnect(param->disconnect.conn_id);
+        break;
+
+    case ESP_GATTS_MTU_EVT:
+        ble_svc_on_mtu(param->mtu.conn_id, param->mtu.mtu);
+        break;
+
+    case ESP_GATTS_CONF_EVT:
+        // Indication confirmed (or notification handed to the controller)
+        ble_svc_on_tx_done(param->conf.conn_id);
+        break;
+
+    case ESP_GATTS_READ_EVT: {
+        ESP_LOGI(TAG, "Read request, conn_id: %d, handle: %d, offset: %d",
+                 param->read.conn_id, param->read.handle, param->read.offset);
+        int idx = attr_index(param->read.handle);
+        if (idx < IDX_NB && s_attr_ops[idx].read)
+            s_attr_ops[idx].read(s_attr_ops[idx].attr, gatts_if, param);
+        else
+            esp_ble_gatts_send_response(gatts_if, param->read.conn_id,
+                                        param->read.trans_id, ESP_GATT_READ_NOT_PERMIT, NULL);
+        break;
+    }
+
+    case ESP_GATTS_WRITE_EVT: {
+        // Write commands (0xFF05 stream frames) can arrive every connection event
+        ESP_LOG_LEVEL_LOCAL(param->write.need_rsp ? ESP_LOG_INFO : ESP_LOG_DEBUG, TAG,
+                            "Write request, conn_id: %d, handle: %d, len: %d%s",
+                            param->write.conn_id, param->write.handle, param->write.len,
+                            param->write.is_prep ? " (prepare)" : "");
+        if (param->write.is_prep) {
+            prep_write(gatts_if, param);
+            break;
+        }
+        int idx = attr_index(param->write.handle);
+        if (idx < IDX_NB && s_attr_ops[idx].write)
+            s_attr_ops[idx].write(s_attr_ops[idx].attr, gatts_if, param);
+        else
+            write_rsp(gatts_if, param, ESP_GATT_WRITE_NOT_PERMIT);
+        break;
+    }
+
+    case ESP_GATTS_EXEC_WRITE_EVT: {
+        uint16_t conn_id = param->exec_write.conn_id;
+        bool exec = param->exec_write.exec_write_flag == ESP_GATT_PREP_WRITE_EXEC &&
+                    conn_id == s_prep_conn && s_prep_len > 0;
+        ESP_LOGI(TAG, "Execute write, conn_id: %d, %s, len: %d",
+                 conn_id, exec ? "commit" : "cancel", s_prep_len);
+        ble_attr_t attr = exec ? s_attr_ops[s_prep_idx].attr : BLE_ATTR_VALUE;
+        esp_err_t err = exec ? ble_svc_write(conn_id, attr, s_prep_buf, s_prep_len) : ESP_OK;
+        exec = exec && err == ESP_OK;
+        // Another central's execute / cancel leaves the queued write alone
+        if (conn_id == s_prep_conn)
+            prep_reset();
+        // A cancel is acknowledged; a rejected value fails the execute
+        esp_ble_gatts_send_response(gatts_if, conn_id,
+                                    param->exec_write.trans_id, write_status(err), NULL);
+        if (exec)
+            ble_svc_write_commit(conn_id, attr);
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+// Handler time per event type (prof.h); no-ops unless PROF_ENABLED
+static void gap_event_profiled(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
+{
+    int64_t t0 = prof_evt_begin(PROF_EVT_GAP);
+    gap_event_handler(event, param);
+    prof_evt_end(PROF_EVT_GAP, t0);
+}
+
+static void gatts_event_profiled(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
+                                 esp_ble_gatts_cb_param_t *param)
+{
+    prof_evt_t evt = event == ESP_GATTS_READ_EVT       ? PROF_EVT_READ :
+                     event == ESP_GATTS_WRITE_EVT      ? PROF_EVT_WRITE :
+                     event == ESP_GATTS_EXEC_WRITE_EVT ? PROF_EVT_WRITE :
+                     event == ESP_GATTS_CONNECT_EVT    ? PROF_EVT_CONNECT :
+                     event == ESP_GATTS_DISCONNECT_EVT ? PROF_EVT_DISCONNECT : PROF_EVT_OTHER_GATT;
+    int64_t t0 = prof_evt_begin(evt);
+    gatts_event_handler(event, gatts_if, param);
+    prof_evt_end(evt, t0);
+}
+
+// --- Backend interface ---
+
+void ble_backend_adv_start(uint16_t itvl_min, uint16_t itvl_max, bool accept_list)
+{
+    adv_params.adv_int_min       = itvl_min;
+    adv_params.adv_int_max       = itvl_max;
+    adv_params.adv_filter_policy = accept_list ? ADV_FILTER_ALLOW_SCAN_WLST_CON_WLST
+                                               : ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY;
+    if (s_adv_active) {
+        s_adv_restart = true;
+        esp_ble_gap_stop_advertising();
+    } else {
+        adv_start_now();
+    }
+}
+
+void ble_backend_adv_set_data(const uint8_t *data, size_t len)
+{
+    // Bluedroid copies the buffer before this returns
+    esp_ble_gap_config_adv_data_raw((uint8_t *)data, len);
+}
+
+void ble_backend_adv_stop(void)
+{
+    s_adv_restart = false;
+    if (s_adv_active)
+        esp_ble_gap_stop_advertising();
+}
+
+uint32_t ble_backend_db_fingerprint(void)
+{
+    uint32_t crc = 0;
+    for (int i = 0; i < IDX_NB; i++) {
+        const esp_attr_desc_t *d = &s_gatt_db[i].att_desc;
+        uint16_t meta[2] = { d->perm, d->max_length };
+        crc = esp_rom_crc32_le(crc, d->uuid_p, d->uuid_length);
+        crc = esp_rom_crc32_le(crc, (const uint8_t *)meta, sizeof(meta));
+        // Declarations carry their value (service UUID, properties)
+        if (s_gatt_db[i].attr_control.auto_rsp == ESP_GATT_AUTO_RSP && d->value)
+            crc = esp_rom_crc32_le(crc, d->value, d->length);
+    }
+    return crc;
+}
+
+void ble_backend_service_changed(uint16_t conn_id)
+{
+    uint8_t bda[6];
+    if (conn_id != BLE_CONN_NONE && ble_svc_conn_bda(conn_id, bda))
+        esp_ble_gatts_send_service_change_indication(s_gatts_if, bda);
+}
+
+int ble_backend_bond_count(void)
+{
+    int n = esp_ble_get_bond_device_num();
+    return n > 0 ? n : 0;
+}
+
+int ble_backend_bond_list(uint8_t (*bda)[6], int max)
+{
+    int n = ble_backend_bond_count();
+    if (n == 0 || max <= 0) return 0;
+    esp_ble_bond_dev_t *list = calloc(n, sizeof(*list));
+    if (!list) return 0;
+    if (esp_ble_get_bond_device_list(&n, list) != ESP_OK) n = 0;
+    if (n > max) n = max;
+    for (int i = 0; i < n; i++)
+        memcpy(bda[i], list[i].bd_addr, 6);
+    free(list);
+    return n;
+}
+
+void ble_backend_disconnect(uint16_t conn_id)
+{
+    esp_ble_gatts_close(s_gatts_if, conn_id);
+}
+
+esp_err_t ble_backend_notify(uint16_t conn_id, ble_attr_t attr,
+                             const void *data, size_t len, bool indicate)
+{
+    return esp_ble_gatts_send_indicate(s_gatts_if, conn_id, s_handles[s_val_idx[attr]],
+                                       len, (uint8_t *)data, indicate);
+}
+
+esp_err_t ble_backend_update_params(uint16_t conn_id, uint16_t itvl_min, uint16_t itvl_max,
+                                    uint16_t latency, uint16_t timeout)
+{
+    esp_ble_conn_update_params_t p = {
+        .min_int = itvl_min,
+        .max_int = itvl_max,
+        .latency = latency,
+        .timeout = timeout,
+    };
+    if (!ble_svc_conn_bda(conn_id, p.bda)) return ESP_ERR_NOT_FOUND;
+    return esp_ble_gap_update_conn_params(&p);
+}
+
+void ble_backend_set_data_len(uint16_t conn_id, uint16_t tx_octets)
+{
+    esp_bd_addr_t bda;
+    if (!ble_svc_conn_bda(conn_id, bda) || s_dle_count == BLE_MAX_CONNECTIONS) return;
+    if (esp_ble_gap_set_pkt_data_len(bda, tx_octets) == ESP_OK)
+        s_dle_fifo[s_dle_count++] = conn_id;
+}
+
+void ble_backend_set_phy_2m(uint16_t conn_id)
+{
+#if CONFIG_BT_BLE_50_FEATURES_SUPPORTED
+    esp_bd_addr_t bda;
+    if (!ble_svc_conn_bda(conn_id, bda)) return;
+    esp_ble_gap_set_preferred_phy(bda, 0, ESP_BLE_GAP_PHY_2M_PREF_MASK,
+                                  ESP_BLE_GAP_PHY_2M_PREF_MASK, ESP_BLE_GAP_PHY_OPTIONS_NO_PREF);
+#endif
+}
+
+void ble_backend_read_rssi(uint16_t conn_id)
+{
+    esp_bd_addr_t bda;
+    if (ble_svc_conn_bda(conn_id, bda))
+        esp_ble_gap_read_rssi(bda);
+}
+
+void ble_backend_start(void)
+{
+    // Release Classic BT memory - ESP32-C3 supports BLE only
+    ESP_ERROR_CHECK(esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT));
+
+    esp_bt_controller_config_t bt_cfg = BT_CONTROLLER_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_bt_controller_init(&bt_cfg));
+    ESP_ERROR_CHECK(esp_bt_controller_enable(ESP_BT_MODE_BLE));
+
+    ESP_ERROR_CHECK(esp_bluedroid_init());
+    ESP_ERROR_CHECK(esp_bluedroid_enable());
+
+    ESP_LOGI(TAG, "Bluetooth initialized");
+
+    // Larger MTU lets values up to BLE_LOCAL_MTU-3 move in a single PDU;
+    // the client still has to request it (ESP_GATTS_MTU_EVT reports the result).
+    esp_ble_gatt_set_local_mtu(BLE_LOCAL_MTU);
+
+    // Bonds (LTK + IRK) are kept in NVS by Bluedroid itself
+#if BLE_SEC_MODE == BLE_SEC_PASSKEY
+    esp_ble_auth_req_t auth_req = ESP_LE_AUTH_REQ_SC_MITM_BOND;
+    uint8_t iocap = ESP_IO_CAP_OUT;             // we display, the central types
+#elif BLE_SEC_MODE == BLE_SEC_JUST_WORKS
+    esp_ble_auth_req_t auth_req = ESP_LE_AUTH_REQ_SC_BOND;
+    uint8_t iocap = ESP_IO_CAP_NONE;
+#else
+    esp_ble_auth_req_t auth_req = ESP_LE_AUTH_NO_BOND;
+    uint8_t iocap = ESP_IO_CAP_NONE;
+#endif
+    esp_ble_gap_set_security_param(ESP_BLE_SM_AUTHEN_REQ_MODE, &auth_req, sizeof(auth_req));
+    esp_ble_gap_set_security_param(ESP_BLE_SM_IOCAP_MODE, &iocap, sizeof(iocap));
+#if BLE_SEC_MODE != BLE_SEC_NONE
+    uint8_t key_size = 16;
+    uint8_t keys     = ESP_BLE_ENC_KEY_MASK | ESP_BLE_ID_KEY_MASK;
+    esp_ble_gap_set_security_param(ESP_BLE_SM_MAX_KEY_SIZE, &key_size, sizeof(key_size));
+    esp_ble_gap_set_security_param(ESP_BLE_SM_SET_INIT_KEY, &keys, sizeof(keys));
+    esp_ble_gap_set_security_param(ESP_BLE_SM_SET_RSP_KEY, &keys, sizeof(keys));
+    ESP_LOGI(TAG, "Bonding enabled, %d bonded peer(s)", ble_backend_bond_count());
+#endif
+
+    ESP_ERROR_CHECK(esp_ble_gap_register_callback(gap_event_profiled));
+    ESP_ERROR_CHECK(esp_ble_gatts_register_callback(gatts_event_profiled));
+    ESP_ERROR_CHECK(esp_ble_gatts_app_register(PROFILE_APP_ID));
+}
+
+#endif // CONFIG_BT_BLUEDROID_ENABLED
@@ -0,0 +1,559 @@
+#include "sdkconfig.h"
+#if CONFIG_BT_NIMBLE_ENABLED
+
+#include <string.h>
+#include "ble_backend.h"
+#include "ble_adv.h"
+#include "ble_link.h"
+#include "config.h"
+#include "prof.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_random.h"
+#include "nimble/nimble_port.h"
+#include "nimble/nimble_port_freertos.h"
+#include "host/ble_hs.h"
+#include "host/util/util.h"
+#include "services/gap/ble_svc_gap.h"
+#include "services/gatt/ble_svc_gatt.h"
+#if BLE_SEC_MODE != BLE_SEC_NONE
+#if !CONFIG_BT_NIMBLE_SECURITY_ENABLE || !CONFIG_BT_NIMBLE_NVS_PERSIST
+#error "BLE_SEC_MODE needs CONFIG_BT_NIMBLE_SECURITY_ENABLE and CONFIG_BT_NIMBLE_NVS_PERSIST (see sdkconfig.nimble)"
+#endif
+#include "host/ble_store.h"
+
+// Persists bonds in NVS (CONFIG_BT_NIMBLE_NVS_PERSIST); no public header
+void ble_store_config_init(void);
+#endif
+
+#define TAG "BLE_NIMBLE"
+
+const char *const ble_backend_name = "NimBLE";
+
+static uint8_t  s_own_addr_type;
+static uint16_t s_val_handles[BLE_ATTR_COUNT];
+
+// Filter accept list = bonded peers; reloaded before the next advertising
+// start after a new bond (the controller refuses changes while in use)
+static volatile bool s_wl_dirty = true;
+
+static int gap_event(struct ble_gap_event *event, void *arg);
+
+// --- GATT service ---
+
+#define ATT_ERR_CCCD_CFG    0xFD    // CCCD improperly configured (no NimBLE name)
+
+// The ATT response goes out after the access callback returns, so commit
+// hooks that must follow it (the 0xFF06 log transfer) are run from a
+// callout on the host's own event queue, behind the response
+static struct ble_npl_callout s_commit_co;
+static uint16_t               s_commit_conns[BLE_MAX_CONNECTIONS];
+static size_t                 s_commit_n;       // host task only
+
+static void commit_deferred(struct ble_npl_event *ev)
+{
+    for (size_t i = 0; i < s_commit_n; i++)
+        ble_svc_write_commit(s_commit_conns[i], BLE_ATTR_LOG);
+    s_commit_n = 0;
+}
+
+static void commit_after_rsp(uint16_t conn_handle)
+{
+    for (size_t i = 0; i < s_commit_n; i++)
+        if (s_commit_conns[i] == conn_handle) return;
+    if (s_commit_n < BLE_MAX_CONNECTIONS)
+        s_commit_conns[s_commit_n++] = conn_handle;
+    ble_npl_callout_reset(&s_commit_co, 0);
+}
+
+// NimBLE owns the CCCDs (reported via BLE_GAP_EVENT_SUBSCRIBE) and reassembles
+// prepare writes itself, so the access callback only sees whole values.
+static int chr_access_handle(uint16_t conn_handle, uint16_t attr_handle,
+                             struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    ble_attr_t attr = (ble_attr_t)(uintptr_t)arg;
+
+    switch (ctxt->op) {
+    case BLE_GATT_ACCESS_OP_READ_CHR: {
+        // The host slices long reads by offset and does not expose it, so
+        // every read blob counts as a fresh read here
+        size_t len;
+        const void *data = ble_svc_read(conn_handle, attr, true, &len);
+        return os_mbuf_append(ctxt->om, data, len) == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+
+    case BLE_GATT_ACCESS_OP_WRITE_CHR: {
+        static uint8_t buf[BLE_MAX_VALUE_LEN];
+        uint16_t len = 0;
+        if (OS_MBUF_PKTLEN(ctxt->om) > sizeof(buf))
+            return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+        if (ble_hs_mbuf_to_flat(ctxt->om, buf, sizeof(buf), &len) != 0)
+            return BLE_ATT_ERR_UNLIKELY;
+        esp_err_t err = ble_svc_write(conn_handle, attr, buf, len);
+        if (err != ESP_OK)
+            return err == ESP_ERR_INVALID_SIZE ? BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN :
+                   err == BLE_SVC_ERR_CCCD     ? ATT_ERR_CCCD_CFG : BLE_ATT_ERR_UNLIKELY;
+        if (attr == BLE_ATTR_LOG) {
+            commit_after_rsp(conn_handle);
+            return 0;
+        }
+        // The response is sent when this callback returns, so the NVS
+        // write delays it here (unlike the Bluedroid backend)
+        ble_svc_write_commit(conn_handle, attr);
+        return 0;
+    }
+
+    default:
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+}
+
+// Handler time per event type (prof.h); no-ops unless PROF_ENABLED
+static int chr_access(uint16_t conn_handle, uint16_t attr_handle,
+                      struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    prof_evt_t evt = ctxt->op == BLE_GATT_ACCESS_OP_READ_CHR  ? PROF_EVT_READ :
+                     ctxt->op == BLE_GATT_ACCESS_OP_WRITE_CHR ? PROF_EVT_WRITE : PROF_EVT_OTHER_GATT;
+    int64_t t0 = prof_evt_begin(evt);
+    int rc = chr_access_handle(conn_handle, attr_handle, ctxt, arg);
+    prof_evt_end(evt, t0);
+    return rc;
+}
+
+// With bonding enabled, value writes need an encrypted (and for passkey
+// pairing, authenticated) link, which makes the central pair
+#if BLE_SEC_MODE == BLE_SEC_PASSKEY
+#define CHR_F_SEC   (BLE_GATT_CHR_F_WRITE_ENC | BLE_GATT_CHR_F_WRITE_AUTHEN)
+#elif BLE_SEC_MODE == BLE_SEC_JUST_WORKS
+#define CHR_F_SEC   BLE_GATT_CHR_F_WRITE_ENC
+#else
+#define CHR_F_SEC   0
+#endif
+
+#define CHR_FLAGS   (BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_WRITE | \
+                     BLE_GATT_CHR_F_NOTIFY | BLE_GATT_CHR_F_INDICATE | CHR_F_SEC)
+
+static const struct ble_gatt_svc_def s_svcs[] = {
+    {
+        .type = BLE_GATT_SVC_TYPE_PRIMARY,
+        .uuid = BLE_UUID16_DECLARE(BLE_SERVICE_UUID),
+        .characteristics = (struct ble_gatt_chr_def[]) {
+            {
+                .uuid       = BLE_UUID16_DECLARE(BLE_CHAR_UUID),
+                .access_cb  = chr_access,
+                .arg        = (void *)(uintptr_t)BLE_ATTR_VALUE,
+                .flags      = CHR_FLAGS,
+                .val_handle = &s_val_handles[BLE_ATTR_VALUE],
+            },
+            {
+                .uuid       = BLE_UUID16_DECLARE(BLE_LED_CHAR_UUID),
+                .access_cb  = chr_access,
+                .arg        = (void *)(uintptr_t)BLE_ATTR_LED,
+                .flags      = CHR_FLAGS,
+                .val_handle = &s_val_handles[BLE_ATTR_LED],
+            },
+            {
+                .uuid       = BLE_UUID16_DECLARE(BLE_BATCH_CHAR_UUID),
+                .access_cb  = chr_access,
+                .arg        = (void *)(uintptr_t)BLE_ATTR_BATCH,
+                .flags      = CHR_FLAGS,
+                .val_handle = &s_val_handles[BLE_ATTR_BATCH],
+            },
+            {
+                .uuid       = BLE_UUID16_DECLARE(BLE_STREAM_CHAR_UUID),
+                .access_cb  = chr_access,
+                .arg        = (void *)(uintptr_t)BLE_ATTR_STREAM,
+                .flags      = BLE_GATT_CHR_F_WRITE_NO_RSP | CHR_F_SEC,
+                .val_handle = &s_val_handles[BLE_ATTR_STREAM],
+            },
+            {
+                .uuid       = BLE_UUID16_DECLARE(BLE_LOG_CHAR_UUID),
+                .access_cb  = chr_access,
+                .arg        = (void *)(uintptr_t)BLE_ATTR_LOG,
+                .flags      = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_WRITE |
+                              BLE_GATT_CHR_F_NOTIFY | CHR_F_SEC,
+                .val_handle = &s_val_handles[BLE_ATTR_LOG],
+            },
+            {
+                .uuid       = BLE_UUID16_DECLARE(BLE_WIFI_SCAN_CHAR_UUID),
+                .access_cb  = chr_access,
+                .arg        = (void *)(uintptr_t)BLE_ATTR_WIFI_SCAN,
+                .flags      = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_WRITE |
+                              BLE_GATT_CHR_F_NOTIFY | CHR_F_SEC,
+                .val_handle = &s_val_handles[BLE_ATTR_WIFI_SCAN],
+            },
+            {
+                .uuid       = BLE_UUID16_DECLARE(BLE_WIFI_CONN_CHAR_UUID),
+                .access_cb  = chr_access,
+                .arg        = (void *)(uintptr_t)BLE_ATTR_WIFI_CONN,
+                .flags      = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_WRITE |
+                              BLE_GATT_CHR_F_NOTIFY | CHR_F_SEC,
+                .val_handle = &s_val_handles[BLE_ATTR_WIFI_CONN],
+            },
+            { 0 },
+        },
+    },
+    {
+        .type = BLE_GATT_SVC_TYPE_PRIMARY,
+        .uuid = BLE_UUID16_DECLARE(BLE_CTS_SVC_UUID),
+        .characteristics = (struct ble_gatt_chr_def[]) {
+            {
+                .uuid       = BLE_UUID16_DECLARE(BLE_CTS_CHAR_UUID),
+                .access_cb  = chr_access,
+                .arg        = (void *)(uintptr_t)BLE_ATTR_TIME,
+                .flags      = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_WRITE |
+                              BLE_GATT_CHR_F_NOTIFY | CHR_F_SEC,
+                .val_handle = &s_val_handles[BLE_ATTR_TIME],
+            },
+            { 0 },
+        },
+    },
+    { 0 },
+};
+
+// --- GAP ---
+
+// NimBLE stores addresses LSB first; the rest of the app uses Bluedroid order
+static void addr_to_bda(const ble_addr_t *addr, uint8_t bda[6])
+{
+    for (int i = 0; i < 6; i++)
+        bda[i] = addr->val[5 - i];
+}
+
+static int gap_event_handle(struct ble_gap_event *event, void *arg)
+{
+    struct ble_gap_conn_desc desc;
+
+    switch (event->type) {
+    case BLE_GAP_EVENT_CONNECT: {
+        if (event->connect.status != 0) {
+            ESP_LOGW(TAG, "Connection failed, status %d", event->connect.status);
+            ble_adv_resume();
+            break;
+        }
+        uint16_t conn = event->connect.conn_handle;
+        if (ble_gap_conn_find(conn, &desc) != 0) break;
+        uint8_t bda[6];
+        addr_to_bda(&desc.peer_id_addr, bda);
+        if (!ble_svc_on_connect(conn, bda, desc.conn_itvl, desc.conn_latency,
+                                desc.supervision_timeout))
+            ble_backend_disconnect(conn);
+        break;
+    }
+
+    case BLE_GAP_EVENT_DISCONNECT:
+        ble_svc_on_disconnect(event->disconnect.conn.conn_handle);
+        break;
+
+    case BLE_GAP_EVENT_MTU:
+        ble_svc_on_mtu(event->mtu.conn_handle, event->mtu.value);
+        break;
+
+    case BLE_GAP_EVENT_SUBSCRIBE:
+        for (int a = 0; a < BLE_ATTR_COUNT; a++)
+            if (event->subscribe.attr_handle == s_val_handles[a])
+                ble_svc_on_subscribe(event->subscribe.conn_handle, a,
+                                     (event->subscribe.cur_notify   ? BLE_CCCD_NOTIFY   : 0) |
+                                     (event->subscribe.cur_indicate ? BLE_CCCD_INDICATE : 0));
+        break;
+
+    case BLE_GAP_EVENT_NOTIFY_TX:
+        // Indications report twice: status 0 when sent, then EDONE/ETIMEOUT
+        if (!event->notify_tx.indication || event->notify_tx.status != 0)
+            ble_svc_on_tx_done(event->notify_tx.conn_handle);
+        break;
+
+    case BLE_GAP_EVENT_CONN_UPDATE:
+        if (event->conn_update.status != 0) {
+            ESP_LOGW(TAG, "Conn param update rejected, status %d", event->conn_update.status);
+            break;
+        }
+        if (ble_gap_conn_find(event->conn_update.conn_handle, &desc) == 0)
+            ble_svc_on_conn_params(event->conn_update.conn_handle, desc.conn_itvl,
+                                   desc.conn_latency, desc.supervision_timeout);
+        break;
+
+#if BLE_SEC_MODE != BLE_SEC_NONE
+    case BLE_GAP_EVENT_PASSKEY_ACTION:
+        if (event->passkey.params.action == BLE_SM_IOACT_DISP) {
+            struct ble_sm_io pk = {
+                .action  = BLE_SM_IOACT_DISP,
+                .passkey = esp_random() % 1000000,
+            };
+            ble_svc_on_passkey(event->passkey.conn_handle, pk.passkey);
+            ble_sm_inject_io(event->passkey.conn_handle, &pk);
+        }
+        break;
+
+    case BLE_GAP_EVENT_ENC_CHANGE: {
+        bool ok = event->enc_change.status == 0;
+        bool bonded = ok && ble_gap_conn_find(event->enc_change.conn_handle, &desc) == 0 &&
+                      desc.sec_state.bonded;
+        if (!ok)
+            ESP_LOGW(TAG, "Pairing failed, status %d", event->enc_change.status);
+        if (bonded)
+            s_wl_dirty = true;
+        ble_svc_on_auth(event->enc_change.conn_handle, ok, bonded);
+        break;
+    }
+
+    case BLE_GAP_EVENT_REPEAT_PAIRING:
+        // The peer lost its keys: forget the old bond and pair again
+        if (ble_gap_conn_find(event->repeat_pairing.conn_handle, &desc) == 0)
+            ble_store_util_delete_peer(&desc.peer_id_addr);
+        return BLE_GAP_REPEAT_PAIRING_RETRY;
+#endif
+
+#ifdef BLE_GAP_EVENT_PHY_UPDATE_COMPLETE
+    case BLE_GAP_EVENT_PHY_UPDATE_COMPLETE:
+        if (event->phy_updated.status == 0)
+            ble_link_on_phy(event->phy_updated.conn_handle,
+                            event->phy_updated.tx_phy, event->phy_updated.rx_phy);
+        break;
+#endif
+
+#ifdef BLE_GAP_EVENT_DATA_LEN_CHG
+    case BLE_GAP_EVENT_DATA_LEN_CHG:
+        ble_link_on_data_len(event->data_len_chg.conn_handle,
+                             event->data_len_chg.max_tx_octets,
+                             event->data_len_chg.max_rx_octets);
+        break;
+#endif
+
+    default:
+        break;
+    }
+    return 0;
+}
+
+static int gap_event(struct ble_gap_event *event, void *arg)
+{
+    prof_evt_t evt = event->type == BLE_GAP_EVENT_CONNECT    ? PROF_EVT_CONNECT :
+                     event->type == BLE_GAP_EVENT_DISCONNECT ? PROF_EVT_DISCONNECT : PROF_EVT_GAP;
+    int64_t t0 = prof_evt_begin(evt);
+    int rc = gap_event_handle(event, arg);
+    prof_evt_end(evt, t0);
+    return rc;
+}
+
+static void on_sync(void)
+{
+    ble_hs_util_ensure_addr(0);
+    ble_hs_id_infer_auto(0, &s_own_addr_type);
+
+    // Scan response: service UUID and name (the advertising packet is set
+    // through ble_backend_adv_set_data)
+    static const ble_uuid16_t svc_uuid = BLE_UUID16_INIT(BLE_SERVICE_UUID);
+    struct ble_hs_adv_fields rsp = {0};
+    rsp.uuids16             = &svc_uuid;
+    rsp.num_uuids16         = 1;
+    rsp.uuids16_is_complete = 1;
+    rsp.name                = (uint8_t *)BLE_DEVICE_NAME;
+    rsp.name_len            = strlen(BLE_DEVICE_NAME);
+    rsp.name_is_complete    = 1;
+    ble_gap_adv_rsp_set_fields(&rsp);
+
+    ESP_LOGI(TAG, "Host synced, handles 0xFF01=%d 0xFF03=%d 0xFF04=%d 0xFF05=%d 0xFF06=%d "
+             "0xFF07=%d 0xFF08=%d 0x2A2B=%d",
+             s_val_handles[BLE_ATTR_VALUE], s_val_handles[BLE_ATTR_LED],
+             s_val_handles[BLE_ATTR_BATCH], s_val_handles[BLE_ATTR_STREAM],
+             s_val_handles[BLE_ATTR_LOG], s_val_handles[BLE_ATTR_WIFI_SCAN],
+             s_val_handles[BLE_ATTR_WIFI_CONN], s_val_handles[BLE_ATTR_TIME]);
+    ble_svc_on_ready();
+}
+
+static void on_reset(int reason)
+{
+    ESP_LOGW(TAG, "Host reset, reason %d", reason);
+}
+
+static void host_task(void *param)
+{
+    nimble_port_run();              // returns only after nimble_port_stop()
+    nimble_port_freertos_deinit();
+}
+
+// --- Backend interface ---
+
+#if BLE_SEC_MODE != BLE_SEC_NONE
+static void accept_list_load(void)
+{
+    ble_addr_t peers[BLE_MAX_CONNECTIONS * 2];
+    int n = 0;
+    s_wl_dirty = false;
+    if (ble_store_util_bonded_peers(peers, &n, sizeof(peers) / sizeof(peers[0])) != 0)
+        return;
+    ble_gap_wl_set(peers, n);
+    ESP_LOGI(TAG, "Accept list: %d bonded peer(s)", n);
+}
+#endif
+
+void ble_backend_adv_start(uint16_t itvl_min, uint16_t itvl_max, bool accept_list)
+{
+    struct ble_gap_adv_params p = {
+        .conn_mode     = BLE_GAP_CONN_MODE_UND,
+        .disc_mode     = BLE_GAP_DISC_MODE_GEN,
+        .itvl_min      = itvl_min,
+        .itvl_max      = itvl_max,
+        .filter_policy = accept_list ? BLE_HCI_ADV_FILT_BOTH : BLE_HCI_ADV_FILT_NONE,
+    };
+    // Parameters are fixed while enabled; stop and restart back to back
+    // (both are synchronous here, so the gap is a couple of HCI commands)
+    if (ble_gap_adv_active())
+        ble_gap_adv_stop();
+#if BLE_SEC_MODE != BLE_SEC_NONE
+    if (s_wl_dirty)
+        accept_list_load();
+#endif
+    int rc = ble_gap_adv_start(s_own_addr_type, NULL, BLE_HS_FOREVER, &p, gap_event, NULL);
+    if (rc == 0) {
+        ESP_LOGI(TAG, "Advertising started, interval %d-%d", itvl_min, itvl_max);
+        ble_svc_on_adv_started();
+    } else if (rc != BLE_HS_EALREADY) {
+        ESP_LOGE(TAG, "Advertising start failed, rc %d", rc);
+    }
+}
+
+void ble_backend_adv_set_data(const uint8_t *data, size_t len)
+{
+    int rc = ble_gap_adv_set_data(data, len);
+    if (rc != 0)
+        ESP_LOGW(TAG, "Advertising data rejected, rc %d", rc);
+}
+
+void ble_backend_adv_stop(void)
+{
+    if (ble_gap_adv_active())
+        ble_gap_adv_stop();
+}
+
+uint32_t ble_backend_db_fingerprint(void)
+{
+    uint32_t crc = 0;
+    for (const struct ble_gatt_svc_def *svc = s_svcs; svc->type; svc++) {
+        uint16_t uuid = ble_uuid_u16(svc->uuid);
+        crc = esp_rom_crc32_le(crc, (const uint8_t *)&uuid, sizeof(uuid));
+        for (const struct ble_gatt_chr_def *chr = svc->characteristics; chr->uuid; chr++) {
+            uint16_t meta[2] = { ble_uuid_u16(chr->uuid), chr->flags };
+            crc = esp_rom_crc32_le(crc, (const uint8_t *)meta, sizeof(meta));
+        }
+    }
+    return crc;
+}
+
+void ble_backend_service_changed(uint16_t conn_id)
+{
+    // The host queues the indication for bonded peers and sends it when they
+    // reconnect, so the call at startup covers everyone
+    if (conn_id == BLE_CONN_NONE)
+        ble_svc_gatt_changed(0x0001, 0xFFFF);
+}
+
+int ble_backend_bond_count(void)
+{
+#if BLE_SEC_MODE != BLE_SEC_NONE
+    int n = 0;
+    return ble_store_util_count(BLE_STORE_OBJ_TYPE_PEER_SEC, &n) == 0 ? n : 0;
+#else
+    return 0;
+#endif
+}
+
+int ble_backend_bond_list(uint8_t (*bda)[6], int max)
+{
+#if BLE_SEC_MODE != BLE_SEC_NONE
+    ble_addr_t peers[BLE_SC_PEERS_MAX];
+    int n = 0;
+    if (max > BLE_SC_PEERS_MAX) max = BLE_SC_PEERS_MAX;
+    if (ble_store_util_bonded_peers(peers, &n, max) != 0) return 0;
+    for (int i = 0; i < n; i++)
+        memcpy(bda[i], peers[i].val, 6);
+    return n;
+#else
+    return 0;
+#endif
+}
+
+void ble_backend_disconnect(uint16_t conn_id)
+{
+    ble_gap_terminate(conn_id, BLE_ERR_REM_USER_CONN_TERM);
+}
+
+esp_err_t ble_backend_notify(uint16_t conn_id, ble_attr_t attr,
+                             const void *data, size_t len, bool indicate)
+{
+    struct os_mbuf *om = ble_hs_mbuf_from_flat(data, len);
+    if (!om) return ESP_ERR_NO_MEM;
+    int rc = indicate ? ble_gatts_indicate_custom(conn_id, s_val_handles[attr], om)
+                      : ble_gatts_notify_custom(conn_id, s_val_handles[attr], om);
+    return rc == 0 ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t ble_backend_update_params(uint16_t conn_id, uint16_t itvl_min, uint16_t itvl_max,
+                                    uint16_t latency, uint16_t timeout)
+{
+    struct ble_gap_upd_params p = {
+        .itvl_min            = itvl_min,
+        .itvl_max            = itvl_max,
+        .latency             = latency,
+        .supervision_timeout = timeout,
+    };
+    return ble_gap_update_params(conn_id, &p) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+void ble_backend_set_data_len(uint16_t conn_id, uint16_t tx_octets)
+{
+    // 2120 us = time to send 251 octets on the 1M PHY
+    ble_gap_set_data_len(conn_id, tx_octets, 2120);
+}
+
+void ble_backend_set_phy_2m(uint16_t conn_id)
+{
+#if CONFIG_BT_NIMBLE_50_FEATURE_SUPPORT
+    ble_gap_set_prefered_le_phy(conn_id, BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_2M_MASK,
+                                BLE_GAP_LE_PHY_CODED_ANY);
+#endif
+}
+
+void ble_backend_read_rssi(uint16_t conn_id)
+{
+    // Answered by the controller synchronously, unlike Bluedroid
+    int8_t rssi;
+    if (ble_gap_conn_rssi(conn_id, &rssi) == 0)
+        ble_svc_on_rssi(conn_id, rssi);
+}
+
+void ble_backend_start(void)
+{
+    // Controller + host init in one call (Classic BT memory is never claimed)
+    ESP_ERROR_CHECK(nimble_port_init());
+    ble_npl_callout_init(&s_commit_co, nimble_port_get_dflt_eventq(), commit_deferred, NULL);
+
+    ble_hs_cfg.sync_cb  = on_sync;
+    ble_hs_cfg.reset_cb = on_reset;
+#if BLE_SEC_MODE != BLE_SEC_NONE
+    ble_hs_cfg.sm_io_cap         = BLE_SEC_MODE == BLE_SEC_PASSKEY ? BLE_HS_IO_DISPLAY_ONLY
+                                                                   : BLE_HS_IO_NO_INPUT_OUTPUT;
+    ble_hs_cfg.sm_bonding        = 1;
+    ble_hs_cfg.sm_mitm           = BLE_SEC_MODE == BLE_SEC_PASSKEY;
+    ble_hs_cfg.sm_sc             = 1;
+    ble_hs_cfg.sm_our_key_dist   = BLE_SM_PAIR_KEY_DIST_ENC | BLE_SM_PAIR_KEY_DIST_ID;
+    ble_hs_cfg.sm_their_key_dist = BLE_SM_PAIR_KEY_DIST_ENC | BLE_SM_PAIR_KEY_DIST_ID;
+    ble_hs_cfg.store_status_cb   = ble_store_util_status_rr;
+    ble_store_config_init();
+#endif
+
+    ble_svc_gap_init();
+    ble_svc_gatt_init();
+    ESP_ERROR_CHECK(ble_gatts_count_cfg(s_svcs) == 0 ? ESP_OK : ESP_FAIL);
+    ESP_ERROR_CHECK(ble_gatts_add_svcs(s_svcs) == 0 ? ESP_OK : ESP_FAIL);
+    ble_svc_gap_device_name_set(BLE_DEVICE_NAME);
+
+    // Larger MTU lets values up to BLE_LOCAL_MTU-3 move in a single PDU
+    ble_att_set_preferred_mtu(BLE_LOCAL_MTU);
+
+    ESP_LOGI(TAG, "Bluetooth initialized");
+    nimble_port_freertos_init(host_task);
+}
+
+#endif // CONFIG_BT_NIMBLE_ENABLED
@@ -0,0 +1,68 @@
+#include "ble_batch.h"
+#include <stdbool.h>
+#include <string.h>
+#include "config.h"
+#include "led_controller.h"
+
+static uint16_t get_le16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint8_t validate(const ble_batch_op_t *op)
+{
+    switch (op->type) {
+    case BATCH_OP_VALUE:
+        return op->len <= BLE_MAX_VALUE_LEN ? BATCH_OK : BATCH_ERR_LEN;
+
+    case BATCH_OP_LED: {
+        if (op->len == 0 || op->len > BLE_LED_CMD_MAX_LEN) return BATCH_ERR_LEN;
+        char cmd[BLE_LED_CMD_MAX_LEN + 1] = {0};
+        memcpy(cmd, op->data, op->len);
+        return led_ctrl_is_valid_command(cmd) ? BATCH_OK : BATCH_ERR_VALUE;
+    }
+
+    case BATCH_OP_MORSE_CFG: {
+        if (op->len != 6) return BATCH_ERR_LEN;
+        // Same limits as POST /morse/cfg
+        uint16_t t1 = get_le16(op->data), t2 = get_le16(op->data + 2), t3 = get_le16(op->data + 4);
+        bool ok = t1 >= 50 && t1 <= 1500 && t2 >= 50 && t2 <= 1500 && t3 >= 200 && t3 <= 3000;
+        return ok ? BATCH_OK : BATCH_ERR_VALUE;
+    }
+
+    case BATCH_OP_BLE_ENABLE:
+        if (op->len != 1) return BATCH_ERR_LEN;
+        return op->data[0] <= 1 ? BATCH_OK : BATCH_ERR_VALUE;
+
+    default:
+        return BATCH_ERR_TYPE;
+    }
+}
+
+int ble_batch_parse(const uint8_t *frame, size_t len,
+                    ble_batch_op_t *ops, uint8_t *status, int max_ops)
+{
+    int  n     = 0;
+    bool valid = true;
+    size_t pos = 0;
+
+    while (pos < len) {
+        if (n == max_ops || len - pos < 3) return -1;
+        ble_batch_op_t *op = &ops[n];
+        op->type = frame[pos];
+        op->len  = get_le16(&frame[pos + 1]);
+        op->data = &frame[pos + 3];
+        pos += 3;
+        if (op->len > len - pos) return -1;
+        pos += op->len;
+
+        status[n] = validate(op);
+        if (status[n] != BATCH_OK) valid = false;
+        n++;
+    }
+
+    if (!valid)
+        for (int i = 0; i < n; i++)
+            if (status[i] == BATCH_OK) status[i] = BATCH_SKIPPED;
+    return n;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// TLV frame written to 0xFF04: any number of
+//   [type:1][len:2 LE][value:len]
+// The whole frame is validated first and only applied if every op is valid.
+typedef enum {
+    BATCH_OP_VALUE      = 0x01,     // 0xFF01 string, up to BLE_MAX_VALUE_LEN bytes
+    BATCH_OP_LED        = 0x02,     // LED command as written to 0xFF03
+    BATCH_OP_MORSE_CFG  = 0x03,     // t1, t2, t3 in ms, 3 x uint16 LE
+    BATCH_OP_BLE_ENABLE = 0x04,     // 1 byte: 0 = disable, 1 = enable (after the response)
+} ble_batch_type_t;
+
+// Per-op status, notified on 0xFF04 as [op count][status...]
+typedef enum {
+    BATCH_OK        = 0x00,
+    BATCH_ERR_TYPE  = 0x01,         // unknown op type
+    BATCH_ERR_LEN   = 0x02,         // wrong length for the type
+    BATCH_ERR_VALUE = 0x03,         // value out of range / unknown LED command
+    BATCH_SKIPPED   = 0x04,         // valid, but not applied because another op failed
+} ble_batch_status_t;
+
+typedef struct {
+    uint8_t        type;
+    uint16_t       len;
+    const uint8_t *data;            // points into the frame
+} ble_batch_op_t;
+
+// Split frame into ops and validate each one, filling status[i].
+// Returns the op count, or -1 if the frame is truncated or holds more than
+// max_ops ops. If any op is invalid, the valid ones are marked BATCH_SKIPPED.
+int ble_batch_parse(const uint8_t *frame, size_t len,
+                    ble_batch_op_t *ops, uint8_t *status, int max_ops);
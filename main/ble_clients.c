@@ -0,0 +1,226 @@
+#include "ble_clients.h"
+#include <string.h>
+#include <time.h>
+#include "config.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#define NIL             0xFF
+#define HASH_BUCKETS    (2 * BLE_CLIENTS_MAX)   // chains stay ~1 entry long
+
+_Static_assert(BLE_CLIENTS_MAX < NIL, "slot indices are uint8_t");
+
+typedef struct {
+    ble_client_info_t info;
+    uint8_t           gen;          // bumped on eviction, see ble_clients_addr()
+    uint8_t           hnext;        // next slot in the same hash bucket
+    uint8_t           prev, next;   // LRU list, head = most recently seen
+    int64_t           connect_us;   // start of the open connection
+} client_t;
+
+static client_t     s_clients[BLE_CLIENTS_MAX];
+static uint8_t      s_count;
+static uint8_t      s_buckets[HASH_BUCKETS];
+static uint8_t      s_lru_head = NIL;
+static uint8_t      s_lru_tail = NIL;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// --- Hash and LRU list (caller holds s_lock) ---
+
+static uint8_t bucket_of(const uint8_t bda[6])
+{
+    uint32_t h = 2166136261u;       // FNV-1a
+    for (int i = 0; i < 6; i++)
+        h = (h ^ bda[i]) * 16777619u;
+    return h % HASH_BUCKETS;
+}
+
+static void hash_remove(uint8_t i)
+{
+    uint8_t *p = &s_buckets[bucket_of(s_clients[i].info.bda)];
+    while (*p != NIL && *p != i)
+        p = &s_clients[*p].hnext;
+    if (*p == i) *p = s_clients[i].hnext;
+}
+
+static void lru_unlink(uint8_t i)
+{
+    client_t *c = &s_clients[i];
+    if (c->prev != NIL) s_clients[c->prev].next = c->next; else s_lru_head = c->next;
+    if (c->next != NIL) s_clients[c->next].prev = c->prev; else s_lru_tail = c->prev;
+}
+
+static void lru_push_front(uint8_t i)
+{
+    client_t *c = &s_clients[i];
+    c->prev = NIL;
+    c->next = s_lru_head;
+    if (s_lru_head != NIL) s_clients[s_lru_head].prev = i; else s_lru_tail = i;
+    s_lru_head = i;
+}
+
+static uint8_t find(const uint8_t bda[6])
+{
+    uint8_t i = s_buckets[bucket_of(bda)];
+    while (i != NIL && memcmp(s_clients[i].info.bda, bda, 6) != 0)
+        i = s_clients[i].hnext;
+    return i;
+}
+
+// Find bda, or take a free slot / the least recently seen idle client's slot
+static uint8_t find_or_add(const uint8_t bda[6])
+{
+    uint8_t i = find(bda);
+    if (i != NIL) {
+        lru_unlink(i);
+        lru_push_front(i);
+        return i;
+    }
+
+    if (s_count < BLE_CLIENTS_MAX) {
+        i = s_count++;
+    } else {
+        // Connected clients are never evicted
+        for (i = s_lru_tail; i != NIL && s_clients[i].info.connected; i = s_clients[i].prev) {}
+        if (i == NIL) return NIL;
+        hash_remove(i);
+        lru_unlink(i);
+    }
+
+    client_t *c = &s_clients[i];
+    uint8_t gen = c->gen + 1;
+    memset(c, 0, sizeof(*c));
+    c->gen = gen;
+    memcpy(c->info.bda, bda, 6);
+    uint8_t b = bucket_of(bda);
+    c->hnext = s_buckets[b];
+    s_buckets[b] = i;
+    lru_push_front(i);
+    return i;
+}
+
+static uint32_t now_s(void)
+{
+    time_t now;
+    time(&now);
+    return (uint32_t)now;
+}
+
+// Look up (or register) bda, mark it seen and return it locked; NULL if
+// the table is full of connected clients. Pair with client_release().
+static client_t *client_acquire(const uint8_t bda[6])
+{
+    uint32_t now = now_s();
+    portENTER_CRITICAL(&s_lock);
+    uint8_t i = find_or_add(bda);
+    if (i == NIL) {
+        portEXIT_CRITICAL(&s_lock);
+        return NULL;
+    }
+    s_clients[i].info.last_seen = now;
+    return &s_clients[i];
+}
+
+static void client_release(void)
+{
+    portEXIT_CRITICAL(&s_lock);
+}
+
+// --- Public API ---
+
+void ble_clients_init(void)
+{
+    memset(s_buckets, NIL, sizeof(s_buckets));
+}
+
+int ble_clients_slot(const uint8_t bda[6], uint8_t *gen)
+{
+    client_t *c = client_acquire(bda);
+    if (!c) return -1;
+    *gen = c->gen;
+    int slot = c - s_clients;
+    client_release();
+    return slot;
+}
+
+bool ble_clients_addr(int slot, uint8_t gen, uint8_t bda[6])
+{
+    if (slot < 0 || slot >= BLE_CLIENTS_MAX) return false;
+    portENTER_CRITICAL(&s_lock);
+    bool ok = slot < s_count && s_clients[slot].gen == gen;
+    if (ok) memcpy(bda, s_clients[slot].info.bda, 6);
+    portEXIT_CRITICAL(&s_lock);
+    return ok;
+}
+
+void ble_clients_on_connect(const uint8_t bda[6])
+{
+    int64_t now = esp_timer_get_time();
+    client_t *c = client_acquire(bda);
+    if (!c) return;
+    c->info.connects++;
+    c->info.connected = true;
+    c->info.rssi      = 0;
+    c->connect_us     = now;
+    client_release();
+}
+
+void ble_clients_on_disconnect(const uint8_t bda[6])
+{
+    int64_t now = esp_timer_get_time();
+    client_t *c = client_acquire(bda);
+    if (!c) return;
+    if (c->info.connected)
+        c->info.conn_time_s += (uint32_t)((now - c->connect_us) / 1000000);
+    c->info.connected = false;
+    client_release();
+}
+
+void ble_clients_on_read(const uint8_t bda[6], size_t bytes)
+{
+    client_t *c = client_acquire(bda);
+    if (!c) return;
+    c->info.reads++;
+    c->info.tx_bytes += bytes;
+    client_release();
+}
+
+void ble_clients_on_write(const uint8_t bda[6], size_t bytes)
+{
+    client_t *c = client_acquire(bda);
+    if (!c) return;
+    c->info.writes++;
+    c->info.rx_bytes += bytes;
+    client_release();
+}
+
+void ble_clients_on_notify(const uint8_t bda[6], size_t bytes)
+{
+    client_t *c = client_acquire(bda);
+    if (!c) return;
+    c->info.tx_bytes += bytes;
+    client_release();
+}
+
+void ble_clients_on_rssi(const uint8_t bda[6], int8_t rssi)
+{
+    client_t *c = client_acquire(bda);
+    if (!c) return;
+    c->info.rssi = rssi;
+    client_release();
+}
+
+size_t ble_clients_snapshot(ble_client_info_t *out, size_t max)
+{
+    int64_t now = esp_timer_get_time();
+    size_t n = 0;
+    portENTER_CRITICAL(&s_lock);
+    for (uint8_t i = s_lru_head; i != NIL && n < max; i = s_clients[i].next) {
+        out[n] = s_clients[i].info;
+        if (out[n].connected)
+            out[n].conn_time_s += (uint32_t)((now - s_clients[i].connect_us) / 1000000);
+        n++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return n;
+}
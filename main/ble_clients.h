@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Counters of one central, kept across connections until it is evicted
+typedef struct {
+    uint8_t  bda[6];
+    bool     connected;
+    int8_t   rssi;              // last sample while connected, dBm (0 = none yet)
+    uint32_t connects;
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t rx_bytes;          // written by the client
+    uint32_t tx_bytes;          // read by / notified to the client
+    uint32_t last_seen;         // Unix time if synced, seconds since boot otherwise
+    uint32_t conn_time_s;       // total connected time, including the open connection
+} ble_client_info_t;
+
+// Registry of the last BLE_CLIENTS_MAX centrals: hashed by address, evicting
+// the least recently seen one that is not connected when full
+void ble_clients_init(void);
+
+// Slot of bda, registering it if new; gen changes whenever the slot is
+// reused for another address. Returns -1 if every slot is connected.
+int  ble_clients_slot(const uint8_t bda[6], uint8_t *gen);
+
+// Address in slot, or false if the slot was reused since gen was handed out
+bool ble_clients_addr(int slot, uint8_t gen, uint8_t bda[6]);
+
+void ble_clients_on_connect(const uint8_t bda[6]);
+void ble_clients_on_disconnect(const uint8_t bda[6]);
+void ble_clients_on_read(const uint8_t bda[6], size_t bytes);
+void ble_clients_on_write(const uint8_t bda[6], size_t bytes);
+void ble_clients_on_notify(const uint8_t bda[6], size_t bytes);
+void ble_clients_on_rssi(const uint8_t bda[6], int8_t rssi);
+
+// Copy all known clients into out, most recently seen first; returns the
+// number copied
+size_t ble_clients_snapshot(ble_client_info_t *out, size_t max);
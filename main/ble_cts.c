@@ -0,0 +1,51 @@
+#include "ble_cts.h"
+#include <string.h>
+#include <time.h>
+#include "ntp_sync.h"
+
+void ble_cts_encode(uint8_t out[BLE_CTS_LEN], uint8_t adjust_reason)
+{
+    memset(out, 0, BLE_CTS_LEN);
+    out[9] = adjust_reason;
+    if (!ntp_sync_is_synced()) return;
+
+    struct timeval tv;
+    struct tm t;
+    gettimeofday(&tv, NULL);
+    localtime_r(&tv.tv_sec, &t);
+    uint16_t year = t.tm_year + 1900;
+    out[0] = year & 0xFF;
+    out[1] = year >> 8;
+    out[2] = t.tm_mon + 1;
+    out[3] = t.tm_mday;
+    out[4] = t.tm_hour;
+    out[5] = t.tm_min;
+    out[6] = t.tm_sec;
+    out[7] = t.tm_wday == 0 ? 7 : t.tm_wday;
+    out[8] = (uint8_t)(tv.tv_usec * 256 / 1000000);
+}
+
+esp_err_t ble_cts_decode(const uint8_t *data, size_t len, struct timeval *tv)
+{
+    if (len < BLE_CTS_LEN) return ESP_ERR_INVALID_SIZE;
+    uint16_t year = data[0] | (data[1] << 8);
+    if (year < 2020 || year > 2099 || data[2] < 1 || data[2] > 12 ||
+        data[3] < 1 || data[3] > 31 || data[4] > 23 || data[5] > 59 || data[6] > 59)
+        return ESP_ERR_INVALID_ARG;
+
+    // Day of week, fractions and adjust reason are informational
+    struct tm t = {
+        .tm_year  = year - 1900,
+        .tm_mon   = data[2] - 1,
+        .tm_mday  = data[3],
+        .tm_hour  = data[4],
+        .tm_min   = data[5],
+        .tm_sec   = data[6],
+        .tm_isdst = -1,         // let TIMEZONE decide
+    };
+    time_t utc = mktime(&t);
+    if (utc == (time_t)-1) return ESP_ERR_INVALID_ARG;
+    tv->tv_sec  = utc;
+    tv->tv_usec = data[8] * 1000000 / 256;
+    return ESP_OK;
+}
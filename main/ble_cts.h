@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include "esp_err.h"
+
+// Current Time Service (0x1805) Current Time characteristic (0x2A2B):
+//   [year:2 LE][month][day][hours][minutes][seconds][day of week 1-7, Mon=1]
+//   [fractions256][adjust reason]
+// in local time (TIMEZONE); year 0 = not known yet
+#define BLE_CTS_LEN             10
+
+// Adjust reason bits
+#define BLE_CTS_ADJ_MANUAL      0x01
+#define BLE_CTS_ADJ_EXTERNAL    0x02    // external reference (NTP, a central)
+
+// Encode the current local time; all date fields zero if the clock was never set
+void ble_cts_encode(uint8_t out[BLE_CTS_LEN], uint8_t adjust_reason);
+
+// Decode a Current Time write into UTC; ESP_ERR_INVALID_ARG if out of range
+esp_err_t ble_cts_decode(const uint8_t *data, size_t len, struct timeval *tv);
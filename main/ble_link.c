@@ -0,0 +1,160 @@
+#include "ble_link.h"
+#include <string.h>
+#include "ble_backend.h"
+#include "config.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#define TAG "BLE_LINK"
+
+typedef struct {
+    bool               in_use;
+    uint16_t           conn_id;
+    ble_link_info_t    info;
+    esp_timer_handle_t idle_tmr;
+} link_t;
+
+static link_t       s_links[BLE_MAX_CONNECTIONS];
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;   // info vs. snapshot
+
+static const char *phy_name(uint8_t phy)
+{
+    return phy == 2 ? "2M" : phy == 3 ? "Coded" : "1M";
+}
+
+static link_t *link_find(uint16_t conn_id)
+{
+    for (int i = 0; i < BLE_MAX_CONNECTIONS; i++)
+        if (s_links[i].in_use && s_links[i].conn_id == conn_id)
+            return &s_links[i];
+    return NULL;
+}
+
+static void request_params(link_t *l, bool fast)
+{
+    esp_err_t err = ble_backend_update_params(l->conn_id,
+        fast ? BLE_LINK_FAST_ITVL_MIN : BLE_LINK_SLOW_ITVL_MIN,
+        fast ? BLE_LINK_FAST_ITVL_MAX : BLE_LINK_SLOW_ITVL_MAX,
+        fast ? 0 : BLE_LINK_SLOW_LATENCY,
+        BLE_LINK_SUPERVISION_TMO);
+    if (err == ESP_OK)
+        l->info.fast = fast;
+}
+
+// No traffic for BLE_LINK_IDLE_MS: relax to the power-saving interval
+static void idle_timer_cb(void *arg)
+{
+    link_t *l = arg;
+    if (!l->in_use || !l->info.fast) return;
+    ESP_LOGI(TAG, "Link idle, requesting slow interval");
+    request_params(l, false);
+}
+
+void ble_link_init(void)
+{
+    for (int i = 0; i < BLE_MAX_CONNECTIONS; i++) {
+        const esp_timer_create_args_t args = {
+            .callback = idle_timer_cb,
+            .arg      = &s_links[i],
+            .name     = "ble_idle",
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&args, &s_links[i].idle_tmr));
+    }
+}
+
+void ble_link_open(uint16_t conn_id, const uint8_t *bda,
+                   uint16_t itvl, uint16_t latency, uint16_t timeout)
+{
+    link_t *l = NULL;
+    for (int i = 0; i < BLE_MAX_CONNECTIONS && !l; i++)
+        if (!s_links[i].in_use) l = &s_links[i];
+    if (!l) return;
+
+    portENTER_CRITICAL(&s_lock);
+    memset(&l->info, 0, sizeof(l->info));
+    memcpy(l->info.bda, bda, 6);
+    l->info.tx_phy    = l->info.rx_phy    = 1;
+    l->info.tx_octets = l->info.rx_octets = 27;
+    l->info.itvl      = itvl;
+    l->info.latency   = latency;
+    l->info.timeout   = timeout;
+    l->conn_id        = conn_id;
+    l->in_use         = true;
+    portEXIT_CRITICAL(&s_lock);
+
+    ble_backend_set_data_len(conn_id, BLE_LINK_DLE_OCTETS);
+    ble_backend_set_phy_2m(conn_id);
+    // Service discovery follows right after connect: start fast, relax when idle
+    request_params(l, true);
+    esp_timer_start_once(l->idle_tmr, (uint64_t)BLE_LINK_IDLE_MS * 1000);
+}
+
+void ble_link_close(uint16_t conn_id)
+{
+    link_t *l = link_find(conn_id);
+    if (!l) return;
+    esp_timer_stop(l->idle_tmr);
+    portENTER_CRITICAL(&s_lock);
+    l->in_use = false;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void ble_link_activity(uint16_t conn_id)
+{
+    link_t *l = link_find(conn_id);
+    if (!l) return;
+    if (!l->info.fast) {
+        ESP_LOGI(TAG, "Link active, requesting fast interval");
+        request_params(l, true);
+    }
+    esp_timer_stop(l->idle_tmr);
+    esp_timer_start_once(l->idle_tmr, (uint64_t)BLE_LINK_IDLE_MS * 1000);
+}
+
+void ble_link_on_params(uint16_t conn_id, uint16_t itvl, uint16_t latency, uint16_t timeout)
+{
+    link_t *l = link_find(conn_id);
+    if (!l) return;
+    portENTER_CRITICAL(&s_lock);
+    l->info.itvl    = itvl;
+    l->info.latency = latency;
+    l->info.timeout = timeout;
+    l->info.updates++;
+    portEXIT_CRITICAL(&s_lock);
+    ESP_LOGI(TAG, "Conn params: interval %u.%02u ms, latency %u, timeout %u ms",
+             itvl * 5 / 4, (itvl * 125) % 100, latency, timeout * 10);
+}
+
+void ble_link_on_data_len(uint16_t conn_id, uint16_t tx_octets, uint16_t rx_octets)
+{
+    link_t *l = link_find(conn_id);
+    if (!l) return;
+    portENTER_CRITICAL(&s_lock);
+    l->info.tx_octets = tx_octets;
+    l->info.rx_octets = rx_octets;
+    portEXIT_CRITICAL(&s_lock);
+    ESP_LOGI(TAG, "Data length: tx %u, rx %u octets", tx_octets, rx_octets);
+}
+
+void ble_link_on_phy(uint16_t conn_id, uint8_t tx_phy, uint8_t rx_phy)
+{
+    link_t *l = link_find(conn_id);
+    if (!l) return;
+    portENTER_CRITICAL(&s_lock);
+    l->info.tx_phy = tx_phy;
+    l->info.rx_phy = rx_phy;
+    portEXIT_CRITICAL(&s_lock);
+    ESP_LOGI(TAG, "PHY: tx %s, rx %s", phy_name(tx_phy), phy_name(rx_phy));
+}
+
+size_t ble_link_snapshot(ble_link_info_t *out, size_t max)
+{
+    size_t n = 0;
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < BLE_MAX_CONNECTIONS && n < max; i++)
+        if (s_links[i].in_use)
+            out[n++] = s_links[i].info;
+    portEXIT_CRITICAL(&s_lock);
+    return n;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Negotiated link-layer parameters of one connection
+typedef struct {
+    uint8_t  bda[6];
+    uint8_t  tx_phy;        // 1 = 1M, 2 = 2M, 3 = Coded
+    uint8_t  rx_phy;
+    uint16_t tx_octets;     // LL payload length; 27 until data length extension
+    uint16_t rx_octets;
+    uint16_t itvl;          // connection interval, 1.25 ms units
+    uint16_t latency;       // peripheral latency, connection events
+    uint16_t timeout;       // supervision timeout, 10 ms units
+    bool     fast;          // short interval requested for an active transfer
+    uint32_t updates;       // completed connection parameter updates
+} ble_link_info_t;
+
+// Create per-link idle timers; call once before the first connection
+void ble_link_init(void);
+
+// Start link policy for a new connection: request 2M PHY, DLE and the fast interval
+void ble_link_open(uint16_t conn_id, const uint8_t *bda,
+                   uint16_t itvl, uint16_t latency, uint16_t timeout);
+
+// Forget a link on disconnect
+void ble_link_close(uint16_t conn_id);
+
+// Mark the link busy: switch to the fast interval and restart the idle timeout
+void ble_link_activity(uint16_t conn_id);
+
+// Completed link-layer procedures, reported by the BLE backend
+void ble_link_on_params(uint16_t conn_id, uint16_t itvl, uint16_t latency, uint16_t timeout);
+void ble_link_on_data_len(uint16_t conn_id, uint16_t tx_octets, uint16_t rx_octets);
+void ble_link_on_phy(uint16_t conn_id, uint8_t tx_phy, uint8_t rx_phy);
+
+// Copy the state of all open links into out; returns the number copied
+size_t ble_link_snapshot(ble_link_info_t *out, size_t max);
@@ -0,0 +1,164 @@
+#include "ble_log_xfer.h"
+#include <stdbool.h>
+#include <string.h>
+#include "ble_backend.h"
+#include "ble_link.h"
+#include "web_server.h"
+#include "config.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#define TAG "BLE_LOG_XFER"
+
+#define PKT_FLAG_LAST   0x01
+#define RETRY_US        10000   // host out of buffers: try again after this
+
+static struct {
+    bool     active;
+    uint16_t conn_id;
+    uint16_t payload;           // record bytes per notification
+    uint32_t seq;               // next record to stage
+    uint32_t end;               // first record not to send
+    uint8_t  inflight;          // notifications not yet reported sent
+    uint32_t bytes;
+    int64_t  start_us;
+} s_x;
+
+// Whole records waiting to be cut into notifications
+static uint8_t  s_buf[BLE_LOCAL_MTU + LOG_EXPORT_MAX_REC];
+static size_t   s_buf_len;
+
+// Totals of the last finished transfer (status read)
+static uint32_t s_last_bytes, s_last_bps, s_last_ms;
+
+// Recursive: NimBLE reports a notification as sent from inside the notify
+// call, which re-enters ble_log_xfer_on_tx_done() from pump()
+static SemaphoreHandle_t  s_mutex;
+static bool               s_in_pump;
+static esp_timer_handle_t s_retry_tmr;
+
+static void finish(void)
+{
+    int64_t us = esp_timer_get_time() - s_x.start_us;
+    s_last_bytes = s_x.bytes;
+    s_last_ms    = (uint32_t)(us / 1000);
+    s_last_bps   = us > 0 ? (uint32_t)((uint64_t)s_x.bytes * 1000000 / us) : 0;
+    s_x.active   = false;
+    ESP_LOGI(TAG, "conn_id %d: log sent, %lu bytes in %lu ms (%lu B/s)", s_x.conn_id,
+             (unsigned long)s_last_bytes, (unsigned long)s_last_ms, (unsigned long)s_last_bps);
+}
+
+// Send notifications while fewer than BLE_LOG_TX_WINDOW are outstanding, so
+// the controller's buffers never overflow; caller holds s_mutex
+static void pump(void)
+{
+    uint8_t pkt[BLE_LOCAL_MTU];
+
+    s_in_pump = true;
+    while (s_x.active && s_x.inflight < BLE_LOG_TX_WINDOW) {
+        if (s_buf_len < s_x.payload)
+            s_buf_len += web_log_export(&s_x.seq, s_x.end, s_buf + s_buf_len,
+                                        sizeof(s_buf) - s_buf_len);
+        bool   more = (int32_t)(s_x.end - s_x.seq) > 0;
+        size_t n    = s_buf_len < s_x.payload ? s_buf_len : s_x.payload;
+        bool   last = !more && n == s_buf_len;
+        if (n == 0 && !last) break;     // log mutex busy: retry below
+
+        pkt[0] = last ? PKT_FLAG_LAST : 0;
+        memcpy(pkt + 1, s_buf, n);
+        s_x.inflight++;                 // before sending: the sent report may come first
+        if (ble_backend_notify(s_x.conn_id, BLE_ATTR_LOG, pkt, n + 1, false) != ESP_OK) {
+            s_x.inflight--;
+            break;
+        }
+        memmove(s_buf, s_buf + n, s_buf_len - n);
+        s_buf_len -= n;
+        s_x.bytes += n + 1;
+        ble_link_activity(s_x.conn_id);
+        if (last) finish();
+    }
+    // Stopped with nothing outstanding: no sent report will wake us up
+    if (s_x.active && s_x.inflight == 0 && !esp_timer_is_active(s_retry_tmr))
+        esp_timer_start_once(s_retry_tmr, RETRY_US);
+    s_in_pump = false;
+}
+
+static void retry_timer_cb(void *arg)
+{
+    xSemaphoreTakeRecursive(s_mutex, portMAX_DELAY);
+    pump();
+    xSemaphoreGiveRecursive(s_mutex);
+}
+
+void ble_log_xfer_init(void)
+{
+    s_mutex = xSemaphoreCreateRecursiveMutex();
+    const esp_timer_create_args_t args = {
+        .callback = retry_timer_cb,
+        .name     = "ble_log_xfer",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&args, &s_retry_tmr));
+}
+
+esp_err_t ble_log_xfer_start(uint16_t conn_id, uint16_t mtu, uint32_t since)
+{
+    uint32_t first, next;
+    web_log_seq_range(&first, &next);
+
+    xSemaphoreTakeRecursive(s_mutex, portMAX_DELAY);
+    if (s_x.active && s_x.conn_id != conn_id) {
+        xSemaphoreGiveRecursive(s_mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
+    // A repeated write from the same client restarts its transfer
+    s_x.active   = true;
+    s_x.conn_id  = conn_id;
+    s_x.payload  = mtu - 3 - 1;
+    s_x.seq      = since;
+    s_x.end      = next;
+    s_x.inflight = 0;
+    s_x.bytes    = 0;
+    s_x.start_us = esp_timer_get_time();
+    s_buf_len    = 0;
+    ESP_LOGI(TAG, "conn_id %d: log from seq %lu (retained %lu..%lu)", conn_id,
+             (unsigned long)since, (unsigned long)first, (unsigned long)next);
+    pump();
+    xSemaphoreGiveRecursive(s_mutex);
+    return ESP_OK;
+}
+
+void ble_log_xfer_on_tx_done(uint16_t conn_id)
+{
+    xSemaphoreTakeRecursive(s_mutex, portMAX_DELAY);
+    if (s_x.active && s_x.conn_id == conn_id) {
+        // Value/LED notifications report here too; never go below zero
+        if (s_x.inflight > 0) s_x.inflight--;
+        if (!s_in_pump) pump();
+    }
+    xSemaphoreGiveRecursive(s_mutex);
+}
+
+void ble_log_xfer_conn_closed(uint16_t conn_id)
+{
+    xSemaphoreTakeRecursive(s_mutex, portMAX_DELAY);
+    if (s_x.active && s_x.conn_id == conn_id) {
+        s_x.active = false;
+        ESP_LOGW(TAG, "conn_id %d: log transfer aborted after %lu bytes",
+                 conn_id, (unsigned long)s_x.bytes);
+    }
+    xSemaphoreGiveRecursive(s_mutex);
+}
+
+void ble_log_xfer_status(uint8_t out[BLE_LOG_STATUS_LEN])
+{
+    uint32_t v[5];
+    web_log_seq_range(&v[0], &v[1]);
+    xSemaphoreTakeRecursive(s_mutex, portMAX_DELAY);
+    v[2] = s_last_bytes;
+    v[3] = s_last_bps;
+    v[4] = s_last_ms;
+    xSemaphoreGiveRecursive(s_mutex);
+    memcpy(out, v, sizeof(v));          // little-endian target
+}
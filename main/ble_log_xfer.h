@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Event log download on 0xFF06, for when the web UI is unreachable.
+// The client enables notifications and writes a uint32 LE "since" sequence
+// number; the server streams the web_log_export() records from there up to
+// the entry logged last when the write arrived. Each notification is
+//   [flags:1][record stream bytes]   flags bit 0 = last packet
+// and records may span packets. Reading 0xFF06 returns the status:
+//   [first seq:4][next seq:4][bytes:4][bytes/s:4][duration ms:4]
+// (log range now, and totals of the last finished transfer).
+#define BLE_LOG_STATUS_LEN  20
+
+void ble_log_xfer_init(void);
+
+// Begin a transfer to conn_id; ESP_ERR_INVALID_STATE if another is running
+esp_err_t ble_log_xfer_start(uint16_t conn_id, uint16_t mtu, uint32_t since);
+
+// A notification left the host (from ble_svc_on_tx_done): send more
+void ble_log_xfer_on_tx_done(uint16_t conn_id);
+
+// Abort a transfer to conn_id
+void ble_log_xfer_conn_closed(uint16_t conn_id);
+
+void ble_log_xfer_status(uint8_t out[BLE_LOG_STATUS_LEN]);
@@ -0,0 +1,90 @@
+#include "ble_prov.h"
+#include <string.h>
+#include "config.h"
+#include "wifi_manager.h"
+#include "wifi_scan.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+// Snapshot of the scan cache: every stream sends one consistent list, even
+// if a background rescan replaces the cache meanwhile
+static wifi_scan_ap_t    s_aps[WIFI_SCAN_MAX_APS];
+static size_t            s_count;
+static SemaphoreHandle_t s_mutex;
+
+void ble_prov_init(void)
+{
+    s_mutex = xSemaphoreCreateMutex();
+}
+
+size_t ble_prov_snapshot(void)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    s_count = wifi_scan_get(s_aps, WIFI_SCAN_MAX_APS, NULL, NULL);
+    size_t n = s_count;
+    xSemaphoreGive(s_mutex);
+    return n;
+}
+
+size_t ble_prov_encode_ap(size_t idx, uint8_t out[BLE_PROV_AP_MAX])
+{
+    size_t len = 0;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (idx == 0 && s_count == 0) {
+        out[0] = 0;
+        out[1] = 0;
+        len    = 2;
+    } else if (idx < s_count) {
+        const wifi_scan_ap_t *ap = &s_aps[idx];
+        size_t ssid_len = strnlen(ap->ssid, 32);
+        out[0] = idx;
+        out[1] = s_count;
+        out[2] = (uint8_t)ap->rssi;
+        out[3] = ap->authmode;
+        out[4] = ap->channel;
+        memcpy(&out[BLE_PROV_AP_HDR], ap->ssid, ssid_len);
+        len = BLE_PROV_AP_HDR + ssid_len;
+    }
+    xSemaphoreGive(s_mutex);
+    return len;
+}
+
+void ble_prov_encode_info(uint8_t out[BLE_PROV_INFO_LEN])
+{
+    bool scanning = false;
+    if (wifi_manager_is_provisioning())     // the scan cache exists by then
+        wifi_scan_get(NULL, 0, NULL, &scanning);
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    out[0] = s_count;
+    xSemaphoreGive(s_mutex);
+    out[1] = scanning ? 0x01 : 0x00;
+}
+
+esp_err_t ble_prov_decode_creds(const uint8_t *data, size_t len, char ssid[33], char pass[65])
+{
+    if (len < 2 || data[0] == 0 || data[0] > 32 || len < 2u + data[0])
+        return ESP_ERR_INVALID_SIZE;
+    size_t ssid_len = data[0];
+    size_t pass_len = data[1 + ssid_len];
+    if (pass_len > 64 || len != 2 + ssid_len + pass_len)
+        return ESP_ERR_INVALID_SIZE;
+    memcpy(ssid, &data[1], ssid_len);
+    ssid[ssid_len] = '\0';
+    memcpy(pass, &data[2 + ssid_len], pass_len);
+    pass[pass_len] = '\0';
+    // The SSID ends up in a C string (NVS, logs): no embedded NULs
+    if (strlen(ssid) != ssid_len || strlen(pass) != pass_len)
+        return ESP_ERR_INVALID_SIZE;
+    return ESP_OK;
+}
+
+void ble_prov_encode_status(uint8_t out[BLE_PROV_STATUS_LEN])
+{
+    wifi_prov_state_t state;
+    uint8_t  reason;
+    uint32_t ip;
+    wifi_manager_prov_status(&state, &reason, &ip);
+    out[0] = state;
+    out[1] = reason;
+    memcpy(&out[2], &ip, 4);       // network order, as in esp_ip4_addr_t
+}
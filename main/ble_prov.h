@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// WiFi provisioning over GATT, an alternative to the SoftAP portal that
+// works without the phone leaving its own network.
+//
+// 0xFF07 WiFi scan: write [0x00] for the cached list or [0x01] to scan
+// first. With notifications enabled, the list follows one network per
+// notification, one per connection interval:
+//   [index][count][rssi:int8][authmode][channel][ssid bytes]
+// A list with no networks is the single record [0][0]. Reading returns
+// [count of the last list][flags], flags bit 0 = scan running. A 32-byte
+// SSID needs an ATT MTU of at least 40.
+//
+// 0xFF08 WiFi connect: write [ssid len][ssid][password len][password] to
+// start an attempt (a long write for more than MTU-3 bytes). Its progress is
+// notified, and readable, as
+//   [state][reason][IPv4 address:4]
+// with state a wifi_prov_state_t and reason the wifi_err_reason_t of a
+// failure (0 = timeout). The device reboots shortly after "connected".
+#define BLE_PROV_AP_HDR         5
+#define BLE_PROV_AP_MAX         (BLE_PROV_AP_HDR + 32)
+#define BLE_PROV_INFO_LEN       2
+#define BLE_PROV_CREDS_MAX      (1 + 32 + 1 + 64)
+#define BLE_PROV_STATUS_LEN     6
+
+#define BLE_PROV_SCAN_CACHED    0x00
+#define BLE_PROV_SCAN_FRESH     0x01
+
+void ble_prov_init(void);
+
+// Copy the scan cache for the notification streams; returns the count
+size_t ble_prov_snapshot(void);
+
+// Encode network idx of the snapshot; 0 past the end
+size_t ble_prov_encode_ap(size_t idx, uint8_t out[BLE_PROV_AP_MAX]);
+
+// 0xFF07 read value
+void ble_prov_encode_info(uint8_t out[BLE_PROV_INFO_LEN]);
+
+// Parse a 0xFF08 write; ESP_ERR_INVALID_SIZE if malformed
+esp_err_t ble_prov_decode_creds(const uint8_t *data, size_t len, char ssid[33], char pass[65]);
+
+// 0xFF08 read / notification value
+void ble_prov_encode_status(uint8_t out[BLE_PROV_STATUS_LEN]);
@@ -1,45 +1,108 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "ble_server.h"
+#include "ble_backend.h"
+#include "ble_adv.h"
+#include "ble_batch.h"
+#include "ble_clients.h"
+#include "ble_cts.h"
+#include "ble_link.h"
+#include "ble_log_xfer.h"
+#include "ble_prov.h"
+#include "ble_stream.h"
 #include "led_controller.h"
+#include "ntp_sync.h"
 #include "oled_display.h"
+#include "prof.h"
 #include "web_server.h"
+#include "wifi_manager.h"
 #include "config.h"
 #include "nvs_flash.h"
 #include "nvs.h"
-#include "esp_bt.h"
-#include "esp_bt_main.h"
-#include "esp_gap_ble_api.h"
-#include "esp_gatts_api.h"
 #include "esp_log.h"
+#include "esp_system.h"
 #include "freertos/FreeRTOS.h"
-#include "freertos/timers.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
 
 #define TAG "BLE_SERVER"
 
-// GATTS application profile ID
-#define PROFILE_APP_ID      0
-
 // NVS namespace and key for persistent storage
 #define NVS_NAMESPACE       "ble_storage"
 #define NVS_KEY             "ble_value"
+#define NVS_KEY_DB_HASH     "db_hash"       // GATT layout of the last boot
+#define NVS_KEY_SC_PEERS    "sc_peers"      // bonded peers not yet told of a layout change
+
+// In-RAM cache for the main characteristic value; written by the host task
+// and httpd, so other tasks read it through value_copy()
+static char         cached_value[BLE_MAX_VALUE_LEN + 1];
+static size_t       cached_len;
+static portMUX_TYPE s_value_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Change notification mask (per connection)
+#define NOTIFY_VALUE    BIT0
+#define NOTIFY_LED      BIT1
+#define NOTIFY_BATCH    BIT2    // per-op status of the connection's last 0xFF04 frame
+#define NOTIFY_TIME     BIT3
+#define NOTIFY_WIFI_SCAN BIT4   // next record of the connection's 0xFF07 list
+#define NOTIFY_WIFI_CONN BIT5
+
+// Per-connection state, one slot per simultaneous central
+typedef struct {
+    bool               in_use;
+    uint16_t           conn_id;
+    uint8_t            bda[6];
+    uint16_t           mtu;            // ATT default 23 until MTU exchange
+    uint16_t           itvl;           // connection interval, 1.25 ms units
+    uint16_t           cccd[BLE_ATTR_COUNT];
+    uint8_t            notify_pending; // NOTIFY_* bits waiting for the holdoff
+    bool               ind_inflight;   // waiting for indication confirm
+    esp_timer_handle_t notify_tmr;     // coalescing: one push per connection interval
+    bool               notify_busy;    // notify_timer_cb running; conn_free waits for it
+    uint32_t           reads;
+    uint32_t           writes;
+    uint32_t           notifies;
+    int64_t            connect_us;     // for the connect -> first ATT op latency
+    bool               first_op;       // latency already logged
+    uint8_t            batch_status[1 + BLE_BATCH_MAX_OPS];  // [op count][status...]
+    uint8_t            batch_len;
+    uint32_t           log_since;      // 0xFF06 cursor, sent after the write response
+    uint8_t            scan_next;      // 0xFF07 list: next record to notify
+    bool               scan_wait;      // 0xFF07 list: waiting for a fresh scan
+    struct {                           // slow batch ops, run after the ATT response
+        bool           value;          // persist 0xFF01
+        bool           led;            // persist the LED colour
+        bool           morse;
+        morse_cfg_t    morse_cfg;
+        int8_t         enable;         // -1 = unchanged
+    } batch_commit;
+} ble_conn_t;
 
-// In-RAM cache for the main characteristic value
-static char   cached_value[BLE_MAX_VALUE_LEN + 1];
-static size_t cached_len;
+static ble_conn_t   s_conns[BLE_MAX_CONNECTIONS];
+static uint8_t      s_conn_count   = 0;
+static bool         s_ble_enabled  = true;
+static portMUX_TYPE s_notify_lock  = portMUX_INITIALIZER_UNLOCKED;
+static uint16_t     s_led_writer   = BLE_CONN_NONE;  // writer already knows the new command
+static uint16_t     s_time_writer  = BLE_CONN_NONE;  // central that just set the clock
 
-static uint16_t service_handle;
-static uint16_t char_handle;
-static uint16_t led_char_handle;
+// Bonded peers still owed a Service Changed indication (host task only)
+static uint8_t      s_sc_peers[BLE_SC_PEERS_MAX][6];
+static int          s_sc_count;
 
-// Current connected client address (for logging)
-static uint8_t connected_bd_addr[6];
+// Startup timing: ble_server_start -> service ready -> first advertisement
+static int64_t s_t_start_us   = 0;
+static int64_t s_t_service_us = 0;
+static bool    s_adv_reported = false;
 
-// Track connection state for enable/disable control
-static bool          is_connected    = false;
-static bool          s_ble_enabled   = true;
-static uint16_t      current_conn_id = 0xFFFF;
-static esp_gatt_if_t current_gatts_if = 0xFF;
+// The host stack must be built with at least as many links as we track
+#if defined(CONFIG_BT_ACL_CONNECTIONS) && CONFIG_BT_ACL_CONNECTIONS < BLE_MAX_CONNECTIONS
+#error "CONFIG_BLE_MAX_CONNECTIONS exceeds CONFIG_BT_ACL_CONNECTIONS (see sdkconfig.defaults)"
+#endif
+#if defined(CONFIG_BT_NIMBLE_MAX_CONNECTIONS) && CONFIG_BT_NIMBLE_MAX_CONNECTIONS < BLE_MAX_CONNECTIONS
+#error "CONFIG_BLE_MAX_CONNECTIONS exceeds CONFIG_BT_NIMBLE_MAX_CONNECTIONS (see sdkconfig.nimble)"
+#endif
 
 // --- NVS helpers ---
 
@@ -55,268 +118,833 @@ static esp_err_t nvs_read_value(char *buf, size_t *len)
 
 static esp_err_t nvs_write_value(const char *buf)
 {
+    int64_t t0 = esp_timer_get_time();
     nvs_handle_t handle;
     esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
     if (ret != ESP_OK) return ret;
     ret = nvs_set_str(handle, NVS_KEY, buf);
     if (ret == ESP_OK) ret = nvs_commit(handle);
     nvs_close(handle);
+    prof_nvs(esp_timer_get_time() - t0);
     return ret;
 }
 
-// --- Advertising parameters ---
+static esp_err_t nvs_save_sc_peers(nvs_handle_t handle)
+{
+    if (s_sc_count > 0)
+        return nvs_set_blob(handle, NVS_KEY_SC_PEERS, s_sc_peers, s_sc_count * 6);
+    esp_err_t ret = nvs_erase_key(handle, NVS_KEY_SC_PEERS);
+    return ret == ESP_ERR_NVS_NOT_FOUND ? ESP_OK : ret;
+}
+
+// Compare the GATT layout with the one stored at the last boot. After a
+// change every bonded peer holds stale cached handles and must be told to
+// rediscover, once, on its next connection, even if that is several boots
+// later; unbonded clients cache nothing. Loads the peers still owed the
+// indication and returns whether the layout changed.
+static bool nvs_db_hash_check(uint32_t hash)
+{
+    nvs_handle_t handle;
+    uint32_t stored = 0;
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) return false;
+    bool changed = nvs_get_u32(handle, NVS_KEY_DB_HASH, &stored) != ESP_OK || stored != hash;
+    if (changed) {
+        // Peer list first: a reset before the hash is stored repeats this
+        s_sc_count = ble_backend_bond_list(s_sc_peers, BLE_SC_PEERS_MAX);
+        if (nvs_save_sc_peers(handle) == ESP_OK &&
+            nvs_set_u32(handle, NVS_KEY_DB_HASH, hash) == ESP_OK)
+            nvs_commit(handle);
+    } else {
+        size_t len = sizeof(s_sc_peers);
+        s_sc_count = nvs_get_blob(handle, NVS_KEY_SC_PEERS, s_sc_peers, &len) == ESP_OK ? len / 6 : 0;
+    }
+    nvs_close(handle);
+    return changed;
+}
+
+// true if peer bda was owed Service Changed; it is not owed one again
+static bool sc_peer_take(const uint8_t bda[6])
+{
+    int i = 0;
+    while (i < s_sc_count && memcmp(s_sc_peers[i], bda, 6) != 0)
+        i++;
+    if (i == s_sc_count) return false;
+    memcpy(s_sc_peers[i], s_sc_peers[--s_sc_count], 6);
+
+    int64_t t0 = esp_timer_get_time();
+    nvs_handle_t handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle) == ESP_OK) {
+        if (nvs_save_sc_peers(handle) == ESP_OK)
+            nvs_commit(handle);
+        nvs_close(handle);
+    }
+    prof_nvs(esp_timer_get_time() - t0);
+    return true;
+}
+
+// --- Value cache ---
+
+// Consistent copy of the cached value into out (BLE_MAX_VALUE_LEN + 1 bytes)
+static size_t value_copy(char *out)
+{
+    portENTER_CRITICAL(&s_value_lock);
+    size_t len = cached_len;
+    memcpy(out, cached_value, len + 1);
+    portEXIT_CRITICAL(&s_value_lock);
+    return len;
+}
+
+static void value_store(const void *data, size_t len)
+{
+    portENTER_CRITICAL(&s_value_lock);
+    cached_len = len < BLE_MAX_VALUE_LEN ? len : BLE_MAX_VALUE_LEN;
+    memcpy(cached_value, data, cached_len);
+    cached_value[cached_len] = '\0';
+    portEXIT_CRITICAL(&s_value_lock);
+}
+
+// --- Connection table ---
+
+static ble_conn_t *conn_find(uint16_t conn_id)
+{
+    for (int i = 0; i < BLE_MAX_CONNECTIONS; i++)
+        if (s_conns[i].in_use && s_conns[i].conn_id == conn_id)
+            return &s_conns[i];
+    return NULL;
+}
+
+static ble_conn_t *conn_alloc(uint16_t conn_id)
+{
+    for (int i = 0; i < BLE_MAX_CONNECTIONS; i++) {
+        ble_conn_t *c = &s_conns[i];
+        if (c->in_use) continue;
+        esp_timer_handle_t tmr = c->notify_tmr;  // timers live for the whole run
+        memset(c, 0, sizeof(*c));
+        c->notify_tmr = tmr;
+        c->in_use     = true;
+        c->conn_id    = conn_id;
+        c->mtu        = 23;
+        c->itvl       = 24;
+        portENTER_CRITICAL(&s_notify_lock);
+        s_conn_count++;
+        portEXIT_CRITICAL(&s_notify_lock);
+        return c;
+    }
+    return NULL;
+}
+
+static void conn_free(ble_conn_t *c)
+{
+    portENTER_CRITICAL(&s_notify_lock);
+    c->in_use         = false;
+    c->notify_pending = 0;
+    portEXIT_CRITICAL(&s_notify_lock);
+    // esp_timer_stop() does not wait for a callback already running; it sees
+    // in_use = false before its next send and does not re-arm the timer
+    while (c->notify_busy)
+        vTaskDelay(1);
+    esp_timer_stop(c->notify_tmr);
+    portENTER_CRITICAL(&s_notify_lock);
+    s_conn_count--;
+    portEXIT_CRITICAL(&s_notify_lock);
+}
 
-static esp_ble_adv_params_t adv_params = {
-    .adv_int_min        = 0x20,
-    .adv_int_max        = 0x40,
-    .adv_type           = ADV_TYPE_IND,
-    .own_addr_type      = BLE_ADDR_TYPE_PUBLIC,
-    .channel_map        = ADV_CHNL_ALL,
-    .adv_filter_policy  = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY,
+// --- Advertised state record ---
+//
+// Manufacturer data payload, little-endian, so observers can follow the
+// device without connecting:
+//   [0]     record format (1)
+//   [1]     sequence, incremented on every state change
+//   [2]     flags: bits 0-2 connected centrals, bit 3 BLE enabled,
+//           bit 4 value longer than the prefix
+//   [3]     LED mode (index into s_led_modes; 1 = static colour)
+//   [4..6]  static colour R, G, B (0 otherwise)
+//   [7..8]  uptime, minutes
+//   [9..12] FNV-1a hash of the 0xFF01 value
+//   [13..]  first BLE_ADV_STATE_PREFIX bytes of the value
+
+#define STATE_FORMAT        1
+#define STATE_HDR_LEN       13
+#define STATE_F_ENABLED     BIT3
+#define STATE_F_TRUNCATED   BIT4
+
+static const char *const s_led_modes[] = {
+    "off", "", "fade", "rainbow", "fire", "heartbeat", "breathe", "morse",
 };
 
-// --- GAP event handler ---
+static uint8_t            s_state_seq = 0;
+static esp_timer_handle_t s_state_tmr;
+static SemaphoreHandle_t  s_state_mutex;    // one record build at a time
 
-static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
+static uint32_t fnv1a(const void *data, size_t len)
 {
-    switch (event) {
-    case ESP_GAP_BLE_ADV_START_COMPLETE_EVT:
-        if (param->adv_start_cmpl.status == ESP_BT_STATUS_SUCCESS)
-            ESP_LOGI(TAG, "Advertising started");
-        else
-            ESP_LOGE(TAG, "Advertising start failed");
-        break;
+    const uint8_t *p = data;
+    uint32_t h = 2166136261u;
+    while (len--) {
+        h ^= *p++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Rebuild the record and hand it to the advertiser (which rate-limits);
+// changed = false only refreshes the uptime field. Called from the host
+// task, httpd and the state timer: the mutex keeps the sequence, the hash
+// and the prefix of each record consistent and the records in order.
+static void state_publish(bool changed)
+{
+    if (!s_state_mutex) return;             // before ble_server_start
+    xSemaphoreTake(s_state_mutex, portMAX_DELAY);
+    uint8_t rec[STATE_HDR_LEN + BLE_ADV_STATE_PREFIX] = {0};
+    char cmd[BLE_LED_CMD_MAX_LEN];
+    led_ctrl_get_command(cmd, sizeof(cmd));
 
-    case ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT:
-        ESP_LOGI(TAG, "Advertising stopped");
-        break;
+    uint8_t mode = 1;                       // anything unlisted is "RRGGBB"
+    for (int i = 0; i < sizeof(s_led_modes) / sizeof(s_led_modes[0]); i++)
+        if (strcmp(cmd, s_led_modes[i]) == 0)
+            mode = i;
+    if (mode == 1) {
+        unsigned long rgb = strtoul(cmd, NULL, 16);
+        rec[4] = rgb >> 16;
+        rec[5] = rgb >> 8;
+        rec[6] = rgb;
+    }
 
-    case ESP_GAP_BLE_SEC_REQ_EVT:
-        ESP_LOGI(TAG, "Security request received, rejecting pairing");
-        esp_ble_gap_security_rsp(param->ble_security.ble_req.bd_addr, false);
-        break;
+    char val[BLE_MAX_VALUE_LEN + 1];
+    size_t len    = value_copy(val);
+    size_t prefix = len < BLE_ADV_STATE_PREFIX ? len : BLE_ADV_STATE_PREFIX;
+    uint32_t hash = fnv1a(val, len);
+    uint16_t mins = esp_timer_get_time() / 60000000LL;
+    portENTER_CRITICAL(&s_notify_lock);
+    uint8_t conns = s_conn_count;
+    portEXIT_CRITICAL(&s_notify_lock);
 
-    default:
-        break;
+    if (changed) s_state_seq++;
+    rec[0]  = STATE_FORMAT;
+    rec[1]  = s_state_seq;
+    rec[2]  = (conns & 0x07) | (s_ble_enabled ? STATE_F_ENABLED : 0) |
+              (len > prefix ? STATE_F_TRUNCATED : 0);
+    rec[3]  = mode;
+    rec[7]  = mins;
+    rec[8]  = mins >> 8;
+    rec[9]  = hash;
+    rec[10] = hash >> 8;
+    rec[11] = hash >> 16;
+    rec[12] = hash >> 24;
+    memcpy(&rec[STATE_HDR_LEN], val, prefix);
+    ble_adv_set_mfr_data(rec, STATE_HDR_LEN + prefix);
+    xSemaphoreGive(s_state_mutex);
+}
+
+static void state_timer_cb(void *arg)
+{
+    state_publish(false);
+}
+
+// --- Client statistics ---
+
+static esp_timer_handle_t s_rssi_tmr;      // runs while any central is connected
+
+static void rssi_timer_cb(void *arg)
+{
+    for (int i = 0; i < BLE_MAX_CONNECTIONS; i++)
+        if (s_conns[i].in_use)
+            ble_backend_read_rssi(s_conns[i].conn_id);
+}
+
+void ble_svc_on_rssi(uint16_t conn_id, int8_t rssi)
+{
+    ble_conn_t *c = conn_find(conn_id);
+    if (c) ble_clients_on_rssi(c->bda, rssi);
+}
+
+// Reflect connection count on the status LED and OLED
+static void conn_status_update(void)
+{
+    led_ctrl_ble_connected(s_conn_count > 0);
+    if (!s_ble_enabled) {
+        oled_set_line(1, "DISABLED");
+    } else if (s_conn_count == 0) {
+        oled_set_line(1, "ADVERTISING");
+    } else {
+        char line[17];
+        snprintf(line, sizeof(line), "CONNECTED %d/%d", s_conn_count, BLE_MAX_CONNECTIONS);
+        oled_set_line(1, s_conn_count == 1 ? "CONNECTED" : line);
     }
+    state_publish(true);
 }
 
-// --- GATTS event handler ---
+bool ble_svc_conn_bda(uint16_t conn_id, uint8_t bda[6])
+{
+    ble_conn_t *c = conn_find(conn_id);
+    if (!c) return false;
+    memcpy(bda, c->bda, 6);
+    return true;
+}
 
-static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
-                                 esp_ble_gatts_cb_param_t *param)
+uint16_t ble_svc_conn_by_bda(const uint8_t bda[6])
 {
-    switch (event) {
-    case ESP_GATTS_REG_EVT: {
-        ESP_LOGI(TAG, "GATTS registered, app_id: %d", param->reg.app_id);
-        esp_ble_gap_set_device_name(BLE_DEVICE_NAME);
+    for (int i = 0; i < BLE_MAX_CONNECTIONS; i++)
+        if (s_conns[i].in_use && memcmp(s_conns[i].bda, bda, 6) == 0)
+            return s_conns[i].conn_id;
+    return BLE_CONN_NONE;
+}
 
-        // 6 handles: 1 service + 2 characteristics x 2 (declaration + value) + 1 spare
-        esp_gatt_srvc_id_t service_id = {
-            .is_primary = true,
-            .id = {
-                .inst_id = 0,
-                .uuid = {
-                    .len = ESP_UUID_LEN_16,
-                    .uuid = { .uuid16 = BLE_SERVICE_UUID }
-                }
-            }
-        };
-        esp_ble_gatts_create_service(gatts_if, &service_id, 10);
-        break;
-    }
-    case ESP_GATTS_CREATE_EVT: {
-        ESP_LOGI(TAG, "Service created, handle: %d", param->create.service_handle);
-        service_handle = param->create.service_handle;
-        esp_ble_gatts_start_service(service_handle);
-
-        // Add main R/W characteristic (persistent string value)
-        esp_bt_uuid_t char_uuid = {
-            .len = ESP_UUID_LEN_16,
-            .uuid = { .uuid16 = BLE_CHAR_UUID }
-        };
+// --- Value helpers ---
 
-        cached_len = sizeof(cached_value);
-        if (nvs_read_value(cached_value, &cached_len) != ESP_OK) {
-            ESP_LOGI(TAG, "No NVS value found, using default: %s", BLE_DEFAULT_VALUE);
-            strncpy(cached_value, BLE_DEFAULT_VALUE, sizeof(cached_value));
-            cached_len = strlen(BLE_DEFAULT_VALUE);
-        } else {
-            ESP_LOGI(TAG, "Loaded value from NVS: %s", cached_value);
-        }
+// Update the cached main value from a complete write (plain or executed)
+static void value_update(const uint8_t *data, size_t len)
+{
+    led_ctrl_ble_flash(false);
+    value_store(data, len);
+    char val[BLE_MAX_VALUE_LEN + 1];
+    value_copy(val);
+    led_ctrl_set_morse_text(val);           // keep Morse in sync if active
+}
 
-        esp_attr_value_t char_val = {
-            .attr_max_len = BLE_MAX_VALUE_LEN,
-            .attr_len     = cached_len,
-            .attr_value   = (uint8_t *)cached_value
-        };
-        esp_ble_gatts_add_char(service_handle, &char_uuid,
-                               ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
-                               ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE,
-                               &char_val, NULL);
-        break;
-    }
-    case ESP_GATTS_ADD_CHAR_EVT: {
-        uint16_t uuid16 = param->add_char.char_uuid.uuid.uuid16;
-        ESP_LOGI(TAG, "Characteristic added, uuid: 0x%04X, handle: %d",
-                 uuid16, param->add_char.attr_handle);
-
-        if (uuid16 == BLE_CHAR_UUID) {
-            char_handle = param->add_char.attr_handle;
-            // Chain: add LED control characteristic (R/W: color or animation command)
-            esp_bt_uuid_t led_uuid = {
-                .len = ESP_UUID_LEN_16,
-                .uuid = { .uuid16 = BLE_LED_CHAR_UUID }
-            };
-            esp_ble_gatts_add_char(service_handle, &led_uuid,
-                                   ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
-                                   ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE,
-                                   NULL, NULL);
-
-        } else if (uuid16 == BLE_LED_CHAR_UUID) {
-            led_char_handle = param->add_char.attr_handle;
+// Log and persist the cached value - call after the ATT response is sent
+static void value_persist(const uint8_t *bda)
+{
+    char val[BLE_MAX_VALUE_LEN + 1];
+    value_copy(val);
+    web_log_write(bda, BLE_CHAR_UUID, val);
+
+    esp_err_t ret = nvs_write_value(val);
+    if (ret == ESP_OK)
+        ESP_LOGI(TAG, "Value saved to NVS: %s", val);
+    else
+        ESP_LOGE(TAG, "NVS write failed: %s", esp_err_to_name(ret));
+}
+
+// --- Change notifications ---
+
+static void notify_send(ble_conn_t *c, ble_attr_t attr, const void *data, size_t len)
+{
+    // The connection may have closed while this callback was running
+    portENTER_CRITICAL(&s_notify_lock);
+    bool open = c->in_use;
+    portEXIT_CRITICAL(&s_notify_lock);
+    if (!open) return;
+
+    bool indicate = !(c->cccd[attr] & BLE_CCCD_NOTIFY);  // prefer notify when both are enabled
+    if (len > (size_t)(c->mtu - 3)) len = c->mtu - 3;
+    if (ble_backend_notify(c->conn_id, attr, data, len, indicate) != ESP_OK)
+        return;
+    c->notifies++;
+    ble_clients_on_notify(c->bda, len);
+    ble_link_activity(c->conn_id);
+    if (indicate) c->ind_inflight = true;
+}
+
+// Leading-edge coalescing: the first change goes out immediately, changes
+// during the following connection interval are merged into one push.
+static void notify_timer_cb(void *arg)
+{
+    ble_conn_t *c = arg;
+    portENTER_CRITICAL(&s_notify_lock);
+    uint8_t pending = c->in_use && !c->ind_inflight ? c->notify_pending : 0;
+    c->notify_pending &= ~pending;
+    c->notify_busy     = pending != 0;
+    portEXIT_CRITICAL(&s_notify_lock);
+    if (!pending) return;
+
+    if ((pending & NOTIFY_VALUE) && c->cccd[BLE_ATTR_VALUE]) {
+        char val[BLE_MAX_VALUE_LEN + 1];
+        size_t len = value_copy(val);
+        notify_send(c, BLE_ATTR_VALUE, val, len);
+    }
+    if ((pending & NOTIFY_LED) && c->cccd[BLE_ATTR_LED]) {
+        char led_cmd[12] = {0};
+        led_ctrl_get_command(led_cmd, sizeof(led_cmd));
+        notify_send(c, BLE_ATTR_LED, led_cmd, strlen(led_cmd));
+    }
+    if ((pending & NOTIFY_BATCH) && c->cccd[BLE_ATTR_BATCH])
+        notify_send(c, BLE_ATTR_BATCH, c->batch_status, c->batch_len);
+    if ((pending & NOTIFY_TIME) && c->cccd[BLE_ATTR_TIME]) {
+        uint8_t cts[BLE_CTS_LEN];
+        ble_cts_encode(cts, BLE_CTS_ADJ_EXTERNAL);
+        notify_send(c, BLE_ATTR_TIME, cts, sizeof(cts));
+    }
+    if ((pending & NOTIFY_WIFI_CONN) && c->cccd[BLE_ATTR_WIFI_CONN]) {
+        uint8_t st[BLE_PROV_STATUS_LEN];
+        ble_prov_encode_status(st);
+        notify_send(c, BLE_ATTR_WIFI_CONN, st, sizeof(st));
+    }
+    if ((pending & NOTIFY_WIFI_SCAN) && c->cccd[BLE_ATTR_WIFI_SCAN]) {
+        // One network per holdoff; the bit is re-armed until the list ends
+        uint8_t rec[BLE_PROV_AP_MAX];
+        portENTER_CRITICAL(&s_notify_lock);
+        uint8_t idx = c->scan_next++;
+        portEXIT_CRITICAL(&s_notify_lock);
+        size_t len = ble_prov_encode_ap(idx, rec);
+        if (len) notify_send(c, BLE_ATTR_WIFI_SCAN, rec, len);
+        if (len > 2 && rec[0] + 1 < rec[1]) {
+            portENTER_CRITICAL(&s_notify_lock);
+            c->notify_pending |= NOTIFY_WIFI_SCAN;
+            portEXIT_CRITICAL(&s_notify_lock);
         }
-        break;
-    }
-
-    case ESP_GATTS_START_EVT: {
-        ESP_LOGI(TAG, "Service started");
-        esp_ble_adv_data_t adv_data = {
-            .set_scan_rsp        = false,
-            .include_name        = true,
-            .include_txpower     = true,
-            .min_interval        = 0x0006,
-            .max_interval        = 0x0010,
-            .appearance          = 0x00,
-            .manufacturer_len    = 0,
-            .p_manufacturer_data = NULL,
-            .service_data_len    = 0,
-            .p_service_data      = NULL,
-            .service_uuid_len    = 0,
-            .p_service_uuid      = NULL,
-            .flag = (ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT),
-        };
-        esp_ble_gap_config_adv_data(&adv_data);
-        esp_ble_gap_start_advertising(&adv_params);
-        oled_set_line(1, "ADVERTISING");
-        break;
-    }
-
-    case ESP_GATTS_CONNECT_EVT:
-        ESP_LOGI(TAG, "Client connected, conn_id: %d", param->connect.conn_id);
-        is_connected     = true;
-        current_conn_id  = param->connect.conn_id;
-        current_gatts_if = gatts_if;
-        memcpy(connected_bd_addr, param->connect.remote_bda, 6);
-        led_ctrl_ble_connected(true);
-        web_log_connect(connected_bd_addr);
-        oled_set_line(1, "CONNECTED");
-        break;
-
-    case ESP_GATTS_DISCONNECT_EVT:
-        ESP_LOGI(TAG, "Client disconnected");
-        is_connected    = false;
-        current_conn_id = 0xFFFF;
-        web_log_disconnect(connected_bd_addr);
-        led_ctrl_ble_connected(false);
-        if (s_ble_enabled)
-            esp_ble_gap_start_advertising(&adv_params);
-        oled_set_line(1, s_ble_enabled ? "ADVERTISING" : "DISABLED");
-        break;
-
-    case ESP_GATTS_READ_EVT: {
-        ESP_LOGI(TAG, "Read request, conn_id: %d, handle: %d",
-                 param->read.conn_id, param->read.handle);
-
-        if (param->read.handle == led_char_handle) {
-            char led_cmd[12] = {0};
-            led_ctrl_get_command(led_cmd, sizeof(led_cmd));
-            esp_gatt_rsp_t rsp = {0};
-            rsp.attr_value.handle = param->read.handle;
-            rsp.attr_value.len    = strlen(led_cmd);
-            memcpy(rsp.attr_value.value, led_cmd, rsp.attr_value.len);
-            esp_ble_gatts_send_response(gatts_if, param->read.conn_id,
-                                        param->read.trans_id, ESP_GATT_OK, &rsp);
-            ESP_LOGI(TAG, "LED read response: %s", led_cmd);
-            break;
+    }
+    // Hold off for one connection interval before the next push
+    portENTER_CRITICAL(&s_notify_lock);
+    bool open      = c->in_use;
+    c->notify_busy = false;
+    portEXIT_CRITICAL(&s_notify_lock);
+    if (open)
+        esp_timer_start_once(c->notify_tmr, (uint64_t)c->itvl * 1250);
+}
+
+static void notify_queue(ble_conn_t *c, uint8_t want)
+{
+    portENTER_CRITICAL(&s_notify_lock);
+    c->notify_pending |= want;
+    portEXIT_CRITICAL(&s_notify_lock);
+    if (!esp_timer_is_active(c->notify_tmr))
+        esp_timer_start_once(c->notify_tmr, 0);
+}
+
+// Queue a change for every subscribed connection except skip_conn (the writer)
+static void notify_kick(uint8_t mask, uint16_t skip_conn)
+{
+    for (int i = 0; i < BLE_MAX_CONNECTIONS; i++) {
+        ble_conn_t *c = &s_conns[i];
+        if (!c->in_use || c->conn_id == skip_conn) continue;
+        uint8_t want = ((mask & NOTIFY_VALUE) && c->cccd[BLE_ATTR_VALUE] ? NOTIFY_VALUE : 0) |
+                       ((mask & NOTIFY_LED)   && c->cccd[BLE_ATTR_LED]   ? NOTIFY_LED   : 0) |
+                       ((mask & NOTIFY_TIME)  && c->cccd[BLE_ATTR_TIME]  ? NOTIFY_TIME  : 0) |
+                       ((mask & NOTIFY_WIFI_CONN) && c->cccd[BLE_ATTR_WIFI_CONN] ? NOTIFY_WIFI_CONN : 0);
+        if (want)
+            notify_queue(c, want);
+    }
+}
+
+// (Re)start the 0xFF07 list of `also`, of connections waiting for a fresh
+// scan and of those still streaming, from a new snapshot of the scan cache
+static void scan_stream_start(ble_conn_t *also)
+{
+    ble_prov_snapshot();
+    for (int i = 0; i < BLE_MAX_CONNECTIONS; i++) {
+        ble_conn_t *c = &s_conns[i];
+        if (!c->in_use) continue;
+        portENTER_CRITICAL(&s_notify_lock);
+        bool go = c == also || c->scan_wait || (c->notify_pending & NOTIFY_WIFI_SCAN);
+        if (go) {
+            c->scan_wait  = false;
+            c->scan_next  = 0;
         }
+        portEXIT_CRITICAL(&s_notify_lock);
+        if (go)
+            notify_queue(c, NOTIFY_WIFI_SCAN);
+    }
+}
 
-        led_ctrl_ble_flash(true);
-        web_log_read(connected_bd_addr, BLE_CHAR_UUID, cached_value);
-
-        esp_gatt_rsp_t rsp = {0};
-        rsp.attr_value.handle = param->read.handle;
-        rsp.attr_value.len    = cached_len;
-        memcpy(rsp.attr_value.value, cached_value, cached_len);
-        esp_ble_gatts_send_response(gatts_if, param->read.conn_id,
-                                    param->read.trans_id, ESP_GATT_OK, &rsp);
-        ESP_LOGI(TAG, "Read response sent: %s", cached_value);
-        break;
-    }
-
-    case ESP_GATTS_WRITE_EVT: {
-        ESP_LOGI(TAG, "Write request, conn_id: %d, handle: %d, len: %d",
-                 param->write.conn_id, param->write.handle, param->write.len);
-
-        if (param->write.handle == led_char_handle) {
-            // LED command: null-terminate and apply
-            size_t cmd_len = param->write.len < BLE_LED_CMD_MAX_LEN
-                             ? param->write.len : BLE_LED_CMD_MAX_LEN;
+// --- Backend events ---
+
+void ble_svc_on_ready(void)
+{
+    s_t_service_us = esp_timer_get_time();
+    uint32_t db_hash = ble_backend_db_fingerprint();
+    bool changed = nvs_db_hash_check(db_hash);
+    ESP_LOGI(TAG, "GATT layout %08lx%s, %d bonded peer(s) owed Service Changed",
+             (unsigned long)db_hash, changed ? " changed since last boot" : "", s_sc_count);
+    if (changed)
+        ble_backend_service_changed(BLE_CONN_NONE);
+    ble_adv_start();
+    oled_set_line(1, "ADVERTISING");
+}
+
+void ble_svc_on_adv_started(void)
+{
+    if (s_adv_reported) return;
+    s_adv_reported = true;
+    int64_t now = esp_timer_get_time();
+    ESP_LOGI(TAG, "Startup (%s): service ready %lld us, first advertisement %lld us after ble_server_start",
+             ble_backend_name, (long long)(s_t_service_us - s_t_start_us),
+             (long long)(now - s_t_start_us));
+}
+
+bool ble_svc_on_connect(uint16_t conn_id, const uint8_t bda[6],
+                        uint16_t itvl, uint16_t latency, uint16_t timeout)
+{
+    ESP_LOGI(TAG, "Client connected, conn_id: %d", conn_id);
+    ble_conn_t *c = conn_alloc(conn_id);
+    if (!c) {
+        // Controller allowed more links than we track; refuse the extra one
+        ESP_LOGW(TAG, "No free connection slot, closing conn_id %d", conn_id);
+        return false;
+    }
+    c->itvl       = itvl;
+    c->connect_us = esp_timer_get_time();
+    memcpy(c->bda, bda, 6);
+    if (sc_peer_take(bda))
+        ble_backend_service_changed(conn_id);
+    ble_link_open(conn_id, bda, itvl, latency, timeout);
+    ble_clients_on_connect(c->bda);
+    if (!esp_timer_is_active(s_rssi_tmr))
+        esp_timer_start_periodic(s_rssi_tmr, BLE_CLIENTS_RSSI_MS * 1000ULL);
+    web_log_connect(c->bda);
+    conn_status_update();
+    // Advertising stops on connect; keep accepting centrals while slots remain
+    if (s_ble_enabled && s_conn_count < BLE_MAX_CONNECTIONS)
+        ble_adv_resume();
+    else
+        ble_adv_stop();
+    return true;
+}
+
+void ble_svc_on_disconnect(uint16_t conn_id)
+{
+    ESP_LOGI(TAG, "Client disconnected, conn_id: %d", conn_id);
+    ble_conn_t *c = conn_find(conn_id);
+    if (!c) return;
+    ESP_LOGI(TAG, "conn_id %d: %lu reads, %lu writes, %lu notifications",
+             c->conn_id, (unsigned long)c->reads, (unsigned long)c->writes,
+             (unsigned long)c->notifies);
+    web_log_disconnect(c->bda);
+    ble_stream_conn_closed(conn_id);
+    ble_log_xfer_conn_closed(conn_id);
+    ble_link_close(conn_id);
+    ble_clients_on_disconnect(c->bda);
+    conn_free(c);
+    if (s_conn_count == 0)
+        esp_timer_stop(s_rssi_tmr);
+    conn_status_update();
+    // The peer may come straight back (range, reset): fast phase again
+    if (s_ble_enabled)
+        ble_adv_start();
+}
+
+void ble_svc_on_passkey(uint16_t conn_id, uint32_t passkey)
+{
+    char line[17];
+    snprintf(line, sizeof(line), "PIN %06lu", (unsigned long)passkey);
+    ESP_LOGI(TAG, "Pairing conn_id %d, passkey %06lu", conn_id, (unsigned long)passkey);
+    oled_set_line(2, line);
+}
+
+void ble_svc_on_auth(uint16_t conn_id, bool success, bool bonded)
+{
+    ESP_LOGI(TAG, "conn_id %d: %s%s", conn_id, success ? "link encrypted" : "pairing failed",
+             bonded ? ", bonded" : "");
+    if (BLE_SEC_MODE != BLE_SEC_NONE)
+        oled_set_line(2, success ? "PAIRED" : "PAIRING FAILED");
+}
+
+void ble_svc_on_mtu(uint16_t conn_id, uint16_t mtu)
+{
+    ESP_LOGI(TAG, "MTU exchanged, conn_id: %d, mtu: %d", conn_id, mtu);
+    ble_conn_t *c = conn_find(conn_id);
+    if (c) c->mtu = mtu;
+}
+
+uint16_t ble_svc_get_mtu(uint16_t conn_id)
+{
+    ble_conn_t *c = conn_find(conn_id);
+    return c ? c->mtu : 23;
+}
+
+void ble_svc_on_conn_params(uint16_t conn_id, uint16_t itvl, uint16_t latency, uint16_t timeout)
+{
+    // Notification holdoff follows the negotiated interval
+    ble_conn_t *c = conn_find(conn_id);
+    if (c) c->itvl = itvl;
+    ble_link_on_params(conn_id, itvl, latency, timeout);
+}
+
+void ble_svc_on_tx_done(uint16_t conn_id)
+{
+    // Indication confirmed: release the next coalesced push
+    ble_conn_t *c = conn_find(conn_id);
+    if (!c) return;
+    c->ind_inflight = false;
+    if (c->notify_pending && !esp_timer_is_active(c->notify_tmr))
+        esp_timer_start_once(c->notify_tmr, 0);
+    ble_log_xfer_on_tx_done(conn_id);
+}
+
+void ble_svc_on_subscribe(uint16_t conn_id, ble_attr_t attr, uint16_t cccd)
+{
+    ble_conn_t *c = conn_find(conn_id);
+    if (!c || attr >= BLE_ATTR_COUNT) return;
+    c->cccd[attr] = cccd;
+    static const uint16_t uuids[BLE_ATTR_COUNT] = {
+        [BLE_ATTR_VALUE] = BLE_CHAR_UUID,       [BLE_ATTR_LED]    = BLE_LED_CHAR_UUID,
+        [BLE_ATTR_BATCH] = BLE_BATCH_CHAR_UUID, [BLE_ATTR_STREAM] = BLE_STREAM_CHAR_UUID,
+        [BLE_ATTR_LOG]   = BLE_LOG_CHAR_UUID,   [BLE_ATTR_TIME]   = BLE_CTS_CHAR_UUID,
+        [BLE_ATTR_WIFI_SCAN] = BLE_WIFI_SCAN_CHAR_UUID,
+        [BLE_ATTR_WIFI_CONN] = BLE_WIFI_CONN_CHAR_UUID,
+    };
+    ESP_LOGI(TAG, "CCCD 0x%04X = 0x%04X (conn_id %d)", uuids[attr], cccd, conn_id);
+}
+
+uint16_t ble_svc_get_cccd(uint16_t conn_id, ble_attr_t attr)
+{
+    ble_conn_t *c = conn_find(conn_id);
+    return (c && attr < BLE_ATTR_COUNT) ? c->cccd[attr] : 0;
+}
+
+// --- Command batch (0xFF04) ---
+
+// Validate the whole frame, then apply every op or none. Ops touching flash
+// or the connection itself are deferred to batch_commit().
+static esp_err_t batch_write(ble_conn_t *c, const uint8_t *data, size_t len)
+{
+    ble_batch_op_t ops[BLE_BATCH_MAX_OPS];
+    int n = ble_batch_parse(data, len, ops, &c->batch_status[1], BLE_BATCH_MAX_OPS);
+    if (n < 0) {
+        ESP_LOGW(TAG, "conn_id %d: malformed batch (%d bytes)", c->conn_id, (int)len);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    c->batch_status[0] = n;
+    c->batch_len       = 1 + n;
+    c->batch_commit.value  = false;
+    c->batch_commit.led    = false;
+    c->batch_commit.morse  = false;
+    c->batch_commit.enable = -1;
+
+    bool valid = true;
+    for (int i = 0; i < n; i++)
+        if (c->batch_status[1 + i] != BATCH_OK) valid = false;
+
+    for (int i = 0; valid && i < n; i++) {
+        const ble_batch_op_t *op = &ops[i];
+        switch (op->type) {
+        case BATCH_OP_VALUE:
+            value_update(op->data, op->len);
+            notify_kick(NOTIFY_VALUE, c->conn_id);   // like a plain 0xFF01 write
+            c->batch_commit.value = true;
+            break;
+        case BATCH_OP_LED: {
             char cmd[BLE_LED_CMD_MAX_LEN + 1] = {0};
-            memcpy(cmd, param->write.value, cmd_len);
-            ESP_LOGI(TAG, "LED command via BLE: %s", cmd);
-            if (strcmp(cmd, "morse") == 0)
-                led_ctrl_set_morse_text(cached_value);  // use current 0xFF01 value
-            led_ctrl_apply_command(cmd);
-            if (param->write.need_rsp)
-                esp_ble_gatts_send_response(gatts_if, param->write.conn_id,
-                                            param->write.trans_id, ESP_GATT_OK, NULL);
+            memcpy(cmd, op->data, op->len);
+            if (strcmp(cmd, "morse") == 0) {
+                char val[BLE_MAX_VALUE_LEN + 1];
+                value_copy(val);
+                led_ctrl_set_morse_text(val);
+            }
+            s_led_writer = c->conn_id;               // like a plain 0xFF03 write
+            c->batch_commit.led = led_ctrl_apply_command_unsaved(cmd);
+            s_led_writer = BLE_CONN_NONE;
+            break;
+        }
+        case BATCH_OP_MORSE_CFG:
+            c->batch_commit.morse = true;
+            c->batch_commit.morse_cfg.t1_ms = op->data[0] | (op->data[1] << 8);
+            c->batch_commit.morse_cfg.t2_ms = op->data[2] | (op->data[3] << 8);
+            c->batch_commit.morse_cfg.t3_ms = op->data[4] | (op->data[5] << 8);
+            break;
+        case BATCH_OP_BLE_ENABLE:
+            c->batch_commit.enable = op->data[0];
             break;
         }
+    }
+    ESP_LOGI(TAG, "conn_id %d: batch of %d op(s) %s", c->conn_id, n,
+             valid ? "applied" : "rejected");
+    if (valid) state_publish(true);
 
-        // Main characteristic: flash red, update cache, persist to NVS
-        led_ctrl_ble_flash(false);
+    if (c->cccd[BLE_ATTR_BATCH])
+        notify_queue(c, NOTIFY_BATCH);
+    return ESP_OK;
+}
 
-        cached_len = param->write.len < BLE_MAX_VALUE_LEN
-                     ? param->write.len : BLE_MAX_VALUE_LEN;
-        memcpy(cached_value, param->write.value, cached_len);
-        cached_value[cached_len] = '\0';
-        led_ctrl_set_morse_text(cached_value);  // keep Morse in sync if active
+static void batch_commit(ble_conn_t *c)
+{
+    if (c->batch_commit.value)
+        value_persist(c->bda);
+    if (c->batch_commit.led)
+        led_ctrl_save_color();
+    if (c->batch_commit.morse)
+        led_ctrl_set_morse_timing(&c->batch_commit.morse_cfg);
+    if (c->batch_commit.enable >= 0 && c->batch_commit.enable != s_ble_enabled)
+        ble_set_enabled(c->batch_commit.enable);   // may disconnect c
+}
+
+// A client with valid cached handles reads or writes right after connecting;
+// one that rediscovers spends several round trips first
+static void conn_first_op(ble_conn_t *c, const char *op)
+{
+    if (!c || c->first_op) return;
+    c->first_op = true;
+    ESP_LOGI(TAG, "conn_id %d: first %s %lld ms after connect", c->conn_id, op,
+             (long long)(esp_timer_get_time() - c->connect_us) / 1000);
+}
 
-        // Send response immediately — NVS write below can take 20-50 ms and
-        // must not block the BLE callback task before the client gets an ACK.
-        if (param->write.need_rsp)
-            esp_ble_gatts_send_response(gatts_if, param->write.conn_id,
-                                        param->write.trans_id, ESP_GATT_OK, NULL);
+static const void *attr_read(ble_conn_t *c, ble_attr_t attr, bool first, size_t *len)
+{
+    static char led_cmd[12];
 
-        web_log_write(connected_bd_addr, BLE_CHAR_UUID, cached_value);
+    if (attr == BLE_ATTR_BATCH) {
+        *len = c ? c->batch_len : 0;
+        return c ? (const void *)c->batch_status : "";
+    }
 
-        esp_err_t ret = nvs_write_value(cached_value);
-        if (ret == ESP_OK)
-            ESP_LOGI(TAG, "Value saved to NVS: %s", cached_value);
-        else
-            ESP_LOGE(TAG, "NVS write failed: %s", esp_err_to_name(ret));
-        break;
+    if (attr == BLE_ATTR_TIME) {
+        static uint8_t cts[BLE_CTS_LEN];
+        ble_cts_encode(cts, 0);
+        *len = sizeof(cts);
+        return cts;
     }
 
-    default:
-        break;
+    if (attr == BLE_ATTR_LOG) {
+        static uint8_t status[BLE_LOG_STATUS_LEN];
+        ble_log_xfer_status(status);
+        *len = sizeof(status);
+        return status;
     }
+
+    if (attr == BLE_ATTR_WIFI_SCAN) {
+        static uint8_t info[BLE_PROV_INFO_LEN];
+        ble_prov_encode_info(info);
+        *len = sizeof(info);
+        return info;
+    }
+
+    if (attr == BLE_ATTR_WIFI_CONN) {
+        static uint8_t st[BLE_PROV_STATUS_LEN];
+        ble_prov_encode_status(st);
+        *len = sizeof(st);
+        return st;
+    }
+
+    if (attr == BLE_ATTR_LED) {
+        led_ctrl_get_command(led_cmd, sizeof(led_cmd));
+        *len = strlen(led_cmd);
+        ESP_LOGI(TAG, "LED read response: %s", led_cmd);
+        return led_cmd;
+    }
+
+    static char val[BLE_MAX_VALUE_LEN + 1];   // host task only
+    *len = value_copy(val);
+    // Log once per logical read, not for every read blob continuation
+    if (first && c) {
+        c->reads++;
+        led_ctrl_ble_flash(true);
+        web_log_read(c->bda, BLE_CHAR_UUID, val);
+        ESP_LOGI(TAG, "Read response sent: %s", val);
+    }
+    return val;
 }
 
+const void *ble_svc_read(uint16_t conn_id, ble_attr_t attr, bool first, size_t *len)
+{
+    ble_conn_t *c = conn_find(conn_id);
+    if (c) ble_link_activity(conn_id);
+    conn_first_op(c, "read");
+    const void *data = attr_read(c, attr, first, len);
+    if (c && first)
+        ble_clients_on_read(c->bda, *len);
+    return data;
+}
+
+esp_err_t ble_svc_write(uint16_t conn_id, ble_attr_t attr, const uint8_t *data, size_t len)
+{
+    ble_conn_t *c = conn_find(conn_id);
+    if (!c) return ESP_ERR_NOT_FOUND;
+    ble_link_activity(conn_id);
+    conn_first_op(c, "write");
+    c->writes++;
+    ble_clients_on_write(c->bda, len);
+
+    // Stream frames: no response, no log entry, nothing persisted per frame
+    if (attr == BLE_ATTR_STREAM) {
+        ble_stream_frame(conn_id, data, len);
+        return ESP_OK;
+    }
+
+    if (attr == BLE_ATTR_BATCH)
+        return batch_write(c, data, len);
+
+    // Current Time from the central: the wall clock for BLE-only setups
+    if (attr == BLE_ATTR_TIME) {
+        struct timeval tv;
+        esp_err_t err = ble_cts_decode(data, len, &tv);
+        if (err != ESP_OK) return err;
+        s_time_writer = conn_id;
+        ntp_sync_set_time(&tv, "BLE CTS");
+        s_time_writer = BLE_CONN_NONE;
+        return ESP_OK;
+    }
+
+    // Log download cursor; the transfer starts after the write response
+    if (attr == BLE_ATTR_LOG) {
+        if (len != 4) return ESP_ERR_INVALID_SIZE;
+        if (!(c->cccd[BLE_ATTR_LOG] & BLE_CCCD_NOTIFY)) return BLE_SVC_ERR_CCCD;
+        c->log_since = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+        return ESP_OK;
+    }
+
+    // WiFi provisioning: list networks, then connect (ble_prov.h)
+    if (attr == BLE_ATTR_WIFI_SCAN) {
+        if (len != 1 || data[0] > BLE_PROV_SCAN_FRESH) return ESP_ERR_INVALID_SIZE;
+        if (!c->cccd[BLE_ATTR_WIFI_SCAN]) return BLE_SVC_ERR_CCCD;
+        if (!wifi_manager_is_provisioning()) return ESP_ERR_INVALID_STATE;
+        if (data[0] == BLE_PROV_SCAN_CACHED) {
+            scan_stream_start(c);
+            return ESP_OK;
+        }
+        esp_err_t err = wifi_manager_prov_scan();
+        if (err == ESP_OK) c->scan_wait = true;    // scan_stream_start on SCAN_DONE
+        return err;
+    }
+
+    if (attr == BLE_ATTR_WIFI_CONN) {
+        char ssid[33], pass[65];
+        esp_err_t err = ble_prov_decode_creds(data, len, ssid, pass);
+        if (err != ESP_OK) return err;
+        ESP_LOGI(TAG, "conn_id %d: WiFi provisioning, SSID=%s", conn_id, ssid);
+        return wifi_manager_prov_connect(ssid, pass);
+    }
+
+    if (attr == BLE_ATTR_LED) {
+        // LED command: null-terminate and apply
+        size_t cmd_len = len < BLE_LED_CMD_MAX_LEN ? len : BLE_LED_CMD_MAX_LEN;
+        char cmd[BLE_LED_CMD_MAX_LEN + 1] = {0};
+        memcpy(cmd, data, cmd_len);
+        ESP_LOGI(TAG, "LED command via BLE: %s", cmd);
+        if (strcmp(cmd, "morse") == 0) {
+            char val[BLE_MAX_VALUE_LEN + 1];
+            value_copy(val);
+            led_ctrl_set_morse_text(val);       // use current 0xFF01 value
+        }
+        s_led_writer = conn_id;
+        led_ctrl_apply_command(cmd);
+        s_led_writer = BLE_CONN_NONE;
+        return ESP_OK;
+    }
+
+    if (len > BLE_MAX_VALUE_LEN) return ESP_ERR_INVALID_SIZE;
+    // Flash red, update cache; the NVS write waits for ble_svc_write_commit
+    value_update(data, len);
+    notify_kick(NOTIFY_VALUE, conn_id);
+    state_publish(true);
+    return ESP_OK;
+}
+
+void ble_svc_write_commit(uint16_t conn_id, ble_attr_t attr)
+{
+    ble_conn_t *c = conn_find(conn_id);
+    if (attr == BLE_ATTR_VALUE && c)
+        value_persist(c->bda);
+    if (attr == BLE_ATTR_BATCH && c)
+        batch_commit(c);
+    if (attr == BLE_ATTR_LOG && c &&
+        ble_log_xfer_start(conn_id, c->mtu, c->log_since) != ESP_OK)
+        ESP_LOGW(TAG, "conn_id %d: log transfer busy", conn_id);
+}
+
+// --- Public API ---
+
 void ble_set_enabled(bool enabled)
 {
     s_ble_enabled = enabled;
     if (!enabled) {
-        esp_ble_gap_stop_advertising();
-        if (current_conn_id != 0xFFFF)
-            esp_ble_gatts_close(current_gatts_if, current_conn_id);
-        oled_set_line(1, "DISABLED");
-    } else {
-        if (!is_connected)
-            esp_ble_gap_start_advertising(&adv_params);
-        oled_set_line(1, is_connected ? "CONNECTED" : "ADVERTISING");
+        ble_adv_stop();
+        for (int i = 0; i < BLE_MAX_CONNECTIONS; i++)
+            if (s_conns[i].in_use)
+                ble_backend_disconnect(s_conns[i].conn_id);
+    } else if (s_conn_count < BLE_MAX_CONNECTIONS) {
+        ble_adv_start();
     }
+    conn_status_update();
 }
 
 bool ble_is_enabled(void)
@@ -327,41 +955,92 @@ bool ble_is_enabled(void)
 void ble_get_value(char *buf, size_t len)
 {
     if (!buf || len == 0) return;
-    strncpy(buf, cached_value, len - 1);
+    char val[BLE_MAX_VALUE_LEN + 1];
+    value_copy(val);
+    strncpy(buf, val, len - 1);
     buf[len - 1] = '\0';
 }
 
 esp_err_t ble_set_value(const char *val)
 {
     if (!val) return ESP_ERR_INVALID_ARG;
-    cached_len = strlen(val);
-    if (cached_len > BLE_MAX_VALUE_LEN) cached_len = BLE_MAX_VALUE_LEN;
-    memcpy(cached_value, val, cached_len);
-    cached_value[cached_len] = '\0';
-    return nvs_write_value(cached_value);
+    value_store(val, strlen(val));
+    notify_kick(NOTIFY_VALUE, BLE_CONN_NONE);
+    state_publish(true);
+    char stored[BLE_MAX_VALUE_LEN + 1];
+    value_copy(stored);
+    return nvs_write_value(stored);
 }
 
-void ble_server_start(void)
+void ble_notify_led_changed(void)
+{
+    notify_kick(NOTIFY_LED, s_led_writer);  // don't echo a client's own write back to it
+    state_publish(true);
+}
+
+void ble_notify_time_changed(void)
 {
-    // Release Classic BT memory - ESP32-C3 supports BLE only
-    ESP_ERROR_CHECK(esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT));
+    notify_kick(NOTIFY_TIME, s_time_writer);
+}
 
-    esp_bt_controller_config_t bt_cfg = BT_CONTROLLER_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_bt_controller_init(&bt_cfg));
-    ESP_ERROR_CHECK(esp_bt_controller_enable(ESP_BT_MODE_BLE));
+void ble_notify_wifi_scan_done(void)
+{
+    bool waiting = false;
+    for (int i = 0; i < BLE_MAX_CONNECTIONS; i++)
+        if (s_conns[i].in_use && s_conns[i].scan_wait) waiting = true;
+    if (waiting)
+        scan_stream_start(NULL);
+}
 
-    ESP_ERROR_CHECK(esp_bluedroid_init());
-    ESP_ERROR_CHECK(esp_bluedroid_enable());
+void ble_notify_wifi_status(void)
+{
+    notify_kick(NOTIFY_WIFI_CONN, BLE_CONN_NONE);   // the writer wants the progress too
+}
 
-    ESP_LOGI(TAG, "Bluetooth initialized");
+void ble_server_start(void)
+{
+    s_t_start_us = esp_timer_get_time();
 
-    esp_ble_auth_req_t auth_req = ESP_LE_AUTH_NO_BOND;
-    esp_ble_gap_set_security_param(ESP_BLE_SM_AUTHEN_REQ_MODE, &auth_req, sizeof(auth_req));
+    cached_len = sizeof(cached_value);
+    if (nvs_read_value(cached_value, &cached_len) != ESP_OK) {
+        ESP_LOGI(TAG, "No NVS value found, using default: %s", BLE_DEFAULT_VALUE);
+        strncpy(cached_value, BLE_DEFAULT_VALUE, sizeof(cached_value));
+        cached_len = strlen(BLE_DEFAULT_VALUE);
+    } else {
+        cached_len = strlen(cached_value);
+        ESP_LOGI(TAG, "Loaded value from NVS: %s", cached_value);
+    }
 
-    uint8_t iocap = ESP_IO_CAP_NONE;
-    esp_ble_gap_set_security_param(ESP_BLE_SM_IOCAP_MODE, &iocap, sizeof(iocap));
+    s_state_mutex = xSemaphoreCreateMutex();
+    ble_link_init();
+    ble_adv_init();
+    ble_stream_init();
+    ble_clients_init();
+    ble_log_xfer_init();
+    ble_prov_init();
+    for (int i = 0; i < BLE_MAX_CONNECTIONS; i++) {
+        const esp_timer_create_args_t notify_args = {
+            .callback = notify_timer_cb,
+            .arg      = &s_conns[i],
+            .name     = "ble_notify",
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&notify_args, &s_conns[i].notify_tmr));
+    }
+    const esp_timer_create_args_t state_args = {
+        .callback = state_timer_cb,
+        .name     = "ble_state",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&state_args, &s_state_tmr));
+    const esp_timer_create_args_t rssi_args = {
+        .callback = rssi_timer_cb,
+        .name     = "ble_rssi",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&rssi_args, &s_rssi_tmr));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(s_state_tmr, BLE_ADV_STATE_REFRESH_MS * 1000ULL));
+    state_publish(true);
 
-    ESP_ERROR_CHECK(esp_ble_gap_register_callback(gap_event_handler));
-    ESP_ERROR_CHECK(esp_ble_gatts_register_callback(gatts_event_handler));
-    ESP_ERROR_CHECK(esp_ble_gatts_app_register(PROFILE_APP_ID));
+    ble_backend_start();
+    ESP_LOGI(TAG, "%s host started, free heap %lu bytes (min %lu)", ble_backend_name,
+             (unsigned long)esp_get_free_heap_size(),
+             (unsigned long)esp_get_minimum_free_heap_size());
 }
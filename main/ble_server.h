@@ -17,4 +17,15 @@ bool ble_is_enabled(void);
 void ble_get_value(char *buf, size_t len);
 
 // Update the cached characteristic value and persist it to NVS
-esp_err_t ble_set_value(const char *val);
\ No newline at end of file
+esp_err_t ble_set_value(const char *val);
+
+// Push the current LED command to subscribed clients (coalesced per connection interval)
+void ble_notify_led_changed(void);
+
+// Push the current time to Current Time Service subscribers after the clock was set
+void ble_notify_time_changed(void);
+
+// WiFi provisioning hooks (wifi_manager_set_prov_cb): stream the new scan to
+// centrals that asked for one, push connect progress to 0xFF08 subscribers
+void ble_notify_wifi_scan_done(void);
+void ble_notify_wifi_status(void);
@@ -0,0 +1,130 @@
+#include "ble_stream.h"
+#include <stdio.h>
+#include <string.h>
+#include "ble_backend.h"
+#include "led_controller.h"
+#include "config.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#define TAG "BLE_STREAM"
+
+#define STREAM_HDR_LEN  2       // seq
+#define STREAM_PIXEL    3       // R G B
+
+static ble_stream_stats_t s_stats = { .conn_id = BLE_CONN_NONE };
+static uint16_t           s_last_seq;
+static char               s_last_hex[7];    // last applied colour, "RRGGBB"
+static uint64_t           s_apply_total_us;
+static uint32_t           s_fps_count;
+static int64_t            s_fps_start_us;
+static esp_timer_handle_t s_idle_tmr;
+static portMUX_TYPE       s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Persist the final colour once, through the normal command path (NVS save
+// and change callback). Skipped if another command replaced it meanwhile.
+static void stream_end(const char *why)
+{
+    portENTER_CRITICAL(&s_lock);
+    bool was_active = s_stats.active;
+    s_stats.active  = false;
+    s_stats.conn_id = BLE_CONN_NONE;
+    s_stats.fps     = 0;
+    portEXIT_CRITICAL(&s_lock);
+    if (!was_active) return;
+
+    char cur[BLE_LED_CMD_MAX_LEN];
+    led_ctrl_get_command(cur, sizeof(cur));
+    ESP_LOGI(TAG, "Stream ended (%s): %lu frames, %lu applied, %lu stale, last %s",
+             why, (unsigned long)s_stats.frames, (unsigned long)s_stats.applied,
+             (unsigned long)s_stats.stale, s_last_hex);
+    if (strcmp(cur, s_last_hex) == 0)
+        led_ctrl_apply_command(s_last_hex);
+}
+
+static void idle_timer_cb(void *arg)
+{
+    stream_end("idle");
+}
+
+void ble_stream_init(void)
+{
+    const esp_timer_create_args_t args = {
+        .callback = idle_timer_cb,
+        .name     = "ble_stream",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&args, &s_idle_tmr));
+}
+
+void ble_stream_frame(uint16_t conn_id, const uint8_t *data, size_t len)
+{
+    int64_t t0 = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_lock);
+    s_stats.frames++;
+    if (len < STREAM_HDR_LEN + STREAM_PIXEL || (len - STREAM_HDR_LEN) % STREAM_PIXEL) {
+        s_stats.malformed++;
+        portEXIT_CRITICAL(&s_lock);
+        return;
+    }
+    uint16_t seq = data[0] | (data[1] << 8);
+    bool fresh = !s_stats.active || s_stats.conn_id != conn_id;
+    if (fresh) {
+        // New stream, or another client took over: its seq starts over
+        s_stats.active  = true;
+        s_stats.conn_id = conn_id;
+        s_fps_start_us  = t0;
+        s_fps_count     = 0;
+    } else if ((int16_t)(seq - s_last_seq) <= 0) {
+        // Write without response can't be reordered on one link, but a
+        // client may resend or run several senders; keep only newer frames
+        s_stats.stale++;
+        portEXIT_CRITICAL(&s_lock);
+        return;
+    }
+    s_last_seq = seq;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (fresh)
+        ESP_LOGI(TAG, "Stream started by conn_id %d", conn_id);
+
+    // One WS2812 on this board: pixel 0 is shown, any further pixels ignored
+    const uint8_t *px = data + STREAM_HDR_LEN;
+    led_ctrl_stream_color(px[0], px[1], px[2]);
+    esp_timer_stop(s_idle_tmr);
+    esp_timer_start_once(s_idle_tmr, BLE_STREAM_IDLE_MS * 1000ULL);
+
+    char hex[7];
+    snprintf(hex, sizeof(hex), "%02X%02X%02X", px[0], px[1], px[2]);
+    int64_t now = esp_timer_get_time();
+    uint32_t dt = (uint32_t)(now - t0);
+    portENTER_CRITICAL(&s_lock);
+    memcpy(s_last_hex, hex, sizeof(hex));
+    s_stats.applied++;
+    s_apply_total_us += dt;
+    s_stats.apply_avg_us = (uint32_t)(s_apply_total_us / s_stats.applied);
+    if (dt > s_stats.apply_max_us) s_stats.apply_max_us = dt;
+    s_fps_count++;
+    if (now - s_fps_start_us >= 1000000) {
+        s_stats.fps    = s_fps_count;
+        s_fps_count    = 0;
+        s_fps_start_us = now;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void ble_stream_conn_closed(uint16_t conn_id)
+{
+    if (s_stats.active && s_stats.conn_id == conn_id) {
+        esp_timer_stop(s_idle_tmr);
+        stream_end("disconnect");
+    }
+}
+
+void ble_stream_get_stats(ble_stream_stats_t *out)
+{
+    portENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
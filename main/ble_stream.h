@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Frame written (without response) to 0xFF05:
+//   [seq:2 LE][R G B] ... one RGB triple per pixel
+// Frames with a seq not newer than the last applied one are dropped. The
+// colour is shown immediately and saved to NVS only once the stream ends
+// (BLE_STREAM_IDLE_MS without a frame, or the streaming client disconnects).
+typedef struct {
+    bool     active;
+    uint16_t conn_id;           // streaming client while active
+    uint32_t frames;            // received, including dropped
+    uint32_t applied;
+    uint32_t stale;             // out of order / duplicate seq
+    uint32_t malformed;         // shorter than one pixel or not whole pixels
+    uint32_t apply_avg_us;      // frame in -> LED updated
+    uint32_t apply_max_us;
+    uint32_t fps;               // applied frames in the last second
+} ble_stream_stats_t;
+
+// Create the idle timer; call once before the host starts
+void ble_stream_init(void);
+
+// Handle one 0xFF05 write
+void ble_stream_frame(uint16_t conn_id, const uint8_t *data, size_t len);
+
+// End the stream if conn_id was streaming
+void ble_stream_conn_closed(uint16_t conn_id);
+
+void ble_stream_get_stats(ble_stream_stats_t *out);
@@ -0,0 +1,348 @@
+#include "captive_net.h"
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <string.h>
+#include "config.h"
+#include "esp_log.h"
+#include "lwip/sockets.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#define TAG "CAPTIVE_NET"
+
+#define MDNS_GROUP      "224.0.0.251"
+#define MDNS_PORT       5353
+#define MDNS_TTL_S      120
+#define MDNS_LEGACY_TTL 10          // one-shot (non-5353 port) resolvers
+#define DNS_TYPE_A      1
+#define DNS_TYPE_ANY    255
+#define DNS_CLASS_IN    1
+#define MDNS_CLASS_FLAG 0x8000      // question: unicast response wanted; answer: cache flush
+
+static uint32_t            s_ip;            // network order
+static int                 s_dns  = -1;
+static int                 s_mdns = -1;
+static int                 s_tls  = -1;
+static int                 s_ctrl = -1;     // loopback UDP: stop signal
+static uint16_t            s_ctrl_port;
+static volatile bool       s_stop;
+static TaskHandle_t        s_task;
+static SemaphoreHandle_t   s_exited;
+static captive_net_stats_t s_stats;
+static portMUX_TYPE        s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// mDNS name as DNS labels: [len]host[5]local[0]
+static uint8_t s_mdns_name[1 + sizeof(WIFI_PROV_MDNS_HOST) + 7];
+static size_t  s_mdns_name_len;
+
+// Receive buffers are shared; only the task touches them
+static uint8_t s_rx[256];
+static uint8_t s_tx[320];
+
+static void stat_inc(uint32_t *counter)
+{
+    portENTER_CRITICAL(&s_lock);
+    (*counter)++;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+static int udp_open(uint32_t addr, uint16_t port)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) return -1;
+    int yes = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    struct sockaddr_in srv = {
+        .sin_family      = AF_INET,
+        .sin_port        = htons(port),
+        .sin_addr.s_addr = addr,
+    };
+    if (bind(sock, (struct sockaddr *)&srv, sizeof(srv)) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = v >> 8;
+    p[1] = v;
+}
+
+// --- DNS: hijacks all queries → portal address ---
+
+static void dns_handle(void)
+{
+    struct sockaddr_in cli;
+    socklen_t cli_len = sizeof(cli);
+    int len = recvfrom(s_dns, s_rx, sizeof(s_rx), 0, (struct sockaddr *)&cli, &cli_len);
+    if (len < 0) return;
+    // Header only, truncated (a full buffer), or a response: drop
+    if (len < 12 || len >= (int)sizeof(s_rx) || (s_rx[2] & 0x80)) {
+        stat_inc(&s_stats.dns_dropped);
+        return;
+    }
+
+    // Echo header, mark as response, set ANCOUNT=1
+    memcpy(s_tx, s_rx, len);
+    s_tx[2]  = 0x81; // QR=1, AA=1
+    s_tx[3]  = 0x80; // RA=1, RCODE=0
+    s_tx[6]  = 0; s_tx[7]  = 1; // ANCOUNT = 1
+    s_tx[8]  = 0; s_tx[9]  = 0; // NSCOUNT = 0
+    s_tx[10] = 0; s_tx[11] = 0; // ARCOUNT = 0
+
+    // Append A-record answer: TTL=0 prevents OS from caching hijacked results
+    int pos = len;
+    s_tx[pos++] = 0xC0; s_tx[pos++] = 0x0C; // name: pointer to question
+    put16(&s_tx[pos], DNS_TYPE_A);   pos += 2;
+    put16(&s_tx[pos], DNS_CLASS_IN); pos += 2;
+    memset(&s_tx[pos], 0, 4);        pos += 4;  // TTL = 0 (no caching)
+    put16(&s_tx[pos], 4);            pos += 2;  // RDLENGTH
+    memcpy(&s_tx[pos], &s_ip, 4);    pos += 4;
+
+    sendto(s_dns, s_tx, pos, 0, (struct sockaddr *)&cli, cli_len);
+    stat_inc(&s_stats.dns_answered);
+}
+
+// --- mDNS: answers A queries for WIFI_PROV_MDNS_HOST.local ---
+
+// First question is for our name with type A or ANY; *qu = unicast wanted
+static bool mdns_match(int len, bool *qu)
+{
+    int end = 12 + (int)s_mdns_name_len;
+    if (len < end + 4 || (s_rx[4] == 0 && s_rx[5] == 0)) return false;
+    for (size_t i = 0; i < s_mdns_name_len; i++)
+        if (tolower(s_rx[12 + i]) != s_mdns_name[i]) return false;
+    uint16_t qtype  = (s_rx[end] << 8) | s_rx[end + 1];
+    uint16_t qclass = (s_rx[end + 2] << 8) | s_rx[end + 3];
+    *qu = qclass & MDNS_CLASS_FLAG;
+    return (qtype == DNS_TYPE_A || qtype == DNS_TYPE_ANY) &&
+           (qclass & ~MDNS_CLASS_FLAG) == DNS_CLASS_IN;
+}
+
+static void mdns_handle(void)
+{
+    struct sockaddr_in cli;
+    socklen_t cli_len = sizeof(cli);
+    int len = recvfrom(s_mdns, s_rx, sizeof(s_rx), 0, (struct sockaddr *)&cli, &cli_len);
+    if (len < 0) return;
+    stat_inc(&s_stats.mdns_queries);
+    bool qu;
+    // Queries only (QR=0, opcode 0); responses from other hosts are ignored
+    if (len < 12 || (s_rx[2] & 0xF8) || !mdns_match(len, &qu)) return;
+
+    // A resolver on another port is a one-shot (legacy) query: it expects
+    // a DNS-style reply with its ID and question, sent back to it
+    bool legacy = ntohs(cli.sin_port) != MDNS_PORT;
+    memset(s_tx, 0, 12);
+    if (legacy) memcpy(s_tx, s_rx, 2);          // ID
+    s_tx[2] = 0x84;                             // QR=1, AA=1
+    s_tx[5] = legacy ? 1 : 0;                   // QDCOUNT
+    s_tx[7] = 1;                                // ANCOUNT
+    int pos = 12;
+    if (legacy) {
+        memcpy(&s_tx[pos], s_mdns_name, s_mdns_name_len);
+        pos += s_mdns_name_len;
+        put16(&s_tx[pos], DNS_TYPE_A);   pos += 2;
+        put16(&s_tx[pos], DNS_CLASS_IN); pos += 2;
+        s_tx[pos++] = 0xC0; s_tx[pos++] = 0x0C; // answer name: pointer to question
+    } else {
+        memcpy(&s_tx[pos], s_mdns_name, s_mdns_name_len);
+        pos += s_mdns_name_len;
+    }
+    put16(&s_tx[pos], DNS_TYPE_A); pos += 2;
+    put16(&s_tx[pos], legacy ? DNS_CLASS_IN : DNS_CLASS_IN | MDNS_CLASS_FLAG); pos += 2;
+    uint32_t ttl = legacy ? MDNS_LEGACY_TTL : MDNS_TTL_S;
+    put16(&s_tx[pos], ttl >> 16); put16(&s_tx[pos + 2], ttl); pos += 4;
+    put16(&s_tx[pos], 4);          pos += 2;
+    memcpy(&s_tx[pos], &s_ip, 4);  pos += 4;
+
+    struct sockaddr_in dst = cli;
+    if (!legacy && !qu) {
+        dst.sin_port        = htons(MDNS_PORT);
+        dst.sin_addr.s_addr = inet_addr(MDNS_GROUP);
+    }
+    sendto(s_mdns, s_tx, pos, 0, (struct sockaddr *)&dst, sizeof(dst));
+    stat_inc(&s_stats.mdns_answered);
+}
+
+// --- TCP 443 fast-reject: makes Android HTTPS probe fail in milliseconds ---
+// Android runs HTTP and HTTPS probes concurrently. Without a listener on 443,
+// ESP32's lwIP may silently drop SYN packets, causing the HTTPS probe to time
+// out at SOCKET_TIMEOUT_MS (10 s). By accepting and immediately RST-ing the
+// connection (SO_LINGER l_linger=0), we force ECONNRESET in < 5 ms, so the
+// full probe cycle completes in ~1-2 s instead of 10+ s.
+static void tls_handle(void)
+{
+    struct sockaddr_in cli;
+    socklen_t cli_len = sizeof(cli);
+    int client = accept(s_tls, (struct sockaddr *)&cli, &cli_len);
+    if (client < 0) return;
+    // l_linger=0 causes RST on close instead of graceful FIN
+    struct linger lg = { .l_onoff = 1, .l_linger = 0 };
+    setsockopt(client, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+    close(client);
+    stat_inc(&s_stats.https_reset);
+}
+
+static int tls_open(void)
+{
+    int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock < 0) return -1;
+    int yes = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    struct sockaddr_in srv = {
+        .sin_family      = AF_INET,
+        .sin_port        = htons(443),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(sock, (struct sockaddr *)&srv, sizeof(srv)) < 0 || listen(sock, 4) < 0) {
+        close(sock);
+        return -1;
+    }
+    // select() reported a connection; never block if the peer gave up meanwhile
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+    return sock;
+}
+
+// --- Event loop ---
+
+static void close_all(void)
+{
+    int *socks[] = { &s_dns, &s_mdns, &s_tls, &s_ctrl };
+    for (size_t i = 0; i < sizeof(socks) / sizeof(socks[0]); i++) {
+        if (*socks[i] >= 0) close(*socks[i]);
+        *socks[i] = -1;
+    }
+}
+
+static void captive_net_task(void *arg)
+{
+    int socks[] = { s_dns, s_mdns, s_tls, s_ctrl };
+    int maxfd = -1;
+    for (size_t i = 0; i < sizeof(socks) / sizeof(socks[0]); i++)
+        if (socks[i] > maxfd) maxfd = socks[i];
+
+    while (!s_stop) {
+        fd_set rd;
+        FD_ZERO(&rd);
+        for (size_t i = 0; i < sizeof(socks) / sizeof(socks[0]); i++)
+            if (socks[i] >= 0) FD_SET(socks[i], &rd);
+        if (select(maxfd + 1, &rd, NULL, NULL, NULL) < 0) {
+            if (errno == EINTR) continue;
+            ESP_LOGE(TAG, "select failed: errno %d", errno);
+            break;
+        }
+        stat_inc(&s_stats.wakeups);
+        if (FD_ISSET(s_ctrl, &rd))
+            recv(s_ctrl, s_rx, sizeof(s_rx), 0);    // s_stop is checked above
+        if (s_dns >= 0 && FD_ISSET(s_dns, &rd))
+            dns_handle();
+        if (s_mdns >= 0 && FD_ISSET(s_mdns, &rd))
+            mdns_handle();
+        if (s_tls >= 0 && FD_ISSET(s_tls, &rd))
+            tls_handle();
+    }
+
+    close_all();
+    xSemaphoreGive(s_exited);
+    vTaskDelete(NULL);
+}
+
+esp_err_t captive_net_start(uint32_t ip)
+{
+    if (s_task) return ESP_ERR_INVALID_STATE;
+    s_ip   = ip;
+    s_stop = false;
+    if (!s_exited) s_exited = xSemaphoreCreateBinary();
+
+    // "host" "local" as DNS labels, lower case for the comparison
+    const char *host = WIFI_PROV_MDNS_HOST;
+    size_t hlen = strlen(host);
+    s_mdns_name[0] = hlen;
+    for (size_t i = 0; i < hlen; i++)
+        s_mdns_name[1 + i] = tolower((unsigned char)host[i]);
+    memcpy(&s_mdns_name[1 + hlen], "\x05local", 7);     // with the root label
+    s_mdns_name_len = 1 + hlen + 7;
+
+    s_ctrl = udp_open(htonl(INADDR_LOOPBACK), 0);
+    s_dns  = udp_open(htonl(INADDR_ANY), 53);
+    if (s_ctrl < 0 || s_dns < 0) {
+        ESP_LOGE(TAG, "%s socket failed", s_ctrl < 0 ? "Control" : "DNS");
+        close_all();
+        return ESP_FAIL;
+    }
+    struct sockaddr_in ctrl;
+    socklen_t ctrl_len = sizeof(ctrl);
+    getsockname(s_ctrl, (struct sockaddr *)&ctrl, &ctrl_len);
+    s_ctrl_port = ntohs(ctrl.sin_port);
+
+    // mDNS and 443 are best effort: the portal works without them
+    s_mdns = udp_open(htonl(INADDR_ANY), MDNS_PORT);
+    if (s_mdns >= 0) {
+        struct ip_mreq mreq = {
+            .imr_multiaddr.s_addr = inet_addr(MDNS_GROUP),
+            .imr_interface.s_addr = htonl(INADDR_ANY),
+        };
+        struct in_addr out_if = { .s_addr = ip };
+        if (setsockopt(s_mdns, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0)
+            ESP_LOGW(TAG, "mDNS group join failed, unicast queries only");
+        setsockopt(s_mdns, IPPROTO_IP, IP_MULTICAST_IF, &out_if, sizeof(out_if));
+    } else {
+        ESP_LOGW(TAG, "mDNS socket failed");
+    }
+    s_tls = tls_open();
+    if (s_tls < 0)
+        ESP_LOGW(TAG, "TCP 443 listener failed");
+
+    if (xTaskCreate(captive_net_task, "captive_net", CAPTIVE_NET_TASK_STACK,
+                    NULL, 5, &s_task) != pdPASS) {
+        s_task = NULL;
+        close_all();
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "DNS, mDNS (%s.local) and TCP 443 reject ready", host);
+    return ESP_OK;
+}
+
+void captive_net_stop(void)
+{
+    if (!s_task) return;
+    s_stop = true;
+
+    // Wake select() through the loopback control socket
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock >= 0) {
+        struct sockaddr_in dst = {
+            .sin_family      = AF_INET,
+            .sin_port        = htons(s_ctrl_port),
+            .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        };
+        sendto(sock, "", 1, 0, (struct sockaddr *)&dst, sizeof(dst));
+        close(sock);
+    }
+    if (xSemaphoreTake(s_exited, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        ESP_LOGW(TAG, "Task did not stop");
+        return;
+    }
+    s_task = NULL;
+
+    captive_net_stats_t st;
+    captive_net_get_stats(&st);
+    ESP_LOGI(TAG, "Stopped: DNS %lu answered, %lu dropped; mDNS %lu/%lu answered; "
+             "HTTPS %lu reset; %lu wakeups",
+             (unsigned long)st.dns_answered, (unsigned long)st.dns_dropped,
+             (unsigned long)st.mdns_answered, (unsigned long)st.mdns_queries,
+             (unsigned long)st.https_reset, (unsigned long)st.wakeups);
+}
+
+void captive_net_get_stats(captive_net_stats_t *out)
+{
+    portENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
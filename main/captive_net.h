@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// Captive portal network services, multiplexed with select() in one task:
+//   UDP 53    DNS: every query is answered with the portal address (TTL 0)
+//   UDP 5353  mDNS: A queries for WIFI_PROV_MDNS_HOST.local
+//   TCP 443   HTTPS probes are accepted and reset at once
+// Sockets bind to INADDR_ANY, so start this before the SoftAP comes up.
+typedef struct {
+    uint32_t dns_answered;
+    uint32_t dns_dropped;       // malformed, oversized or not a query
+    uint32_t mdns_queries;      // packets received on 5353
+    uint32_t mdns_answered;     // queries for our host name
+    uint32_t https_reset;
+    uint32_t wakeups;           // select() returns
+} captive_net_stats_t;
+
+// ip: portal address in network byte order (esp_ip4_addr_t.addr)
+esp_err_t captive_net_start(uint32_t ip);
+
+// Wake the task, close its sockets and wait until it has exited; logs the
+// counters. No-op if not running.
+void captive_net_stop(void);
+
+void captive_net_get_stats(captive_net_stats_t *out);
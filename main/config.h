@@ -1,5 +1,7 @@
 #pragma once
 
+#include "sdkconfig.h"
+
 // --- Location & Time ---
 #define ZIP_CODE                "02451"
 #define TIMEZONE                "EST5EDT,M3.2.0,M11.1.0"
@@ -12,8 +14,77 @@
 #define BLE_SERVICE_UUID        0x00FF
 #define BLE_CHAR_UUID           0xFF01  // R/W characteristic: persistent string value
 #define BLE_LED_CHAR_UUID       0xFF03  // R/W characteristic: "RRGGBB" or "fade"/"fire"/"rainbow"/"off"
-#define BLE_MAX_VALUE_LEN       20
+#define BLE_BATCH_CHAR_UUID     0xFF04  // R/W characteristic: TLV batch of commands (ble_batch.h)
+#define BLE_STREAM_CHAR_UUID    0xFF05  // write-without-response: [seq16][R G B]... colour stream
+#define BLE_LOG_CHAR_UUID       0xFF06  // R/W/N: event log download (ble_log_xfer.h)
+#define BLE_WIFI_SCAN_CHAR_UUID 0xFF07  // R/W/N: WiFi scan for provisioning (ble_prov.h)
+#define BLE_WIFI_CONN_CHAR_UUID 0xFF08  // R/W/N: WiFi credentials / connect status (ble_prov.h)
+#define BLE_CTS_SVC_UUID        0x1805  // Current Time Service: a central can set the clock
+#define BLE_CTS_CHAR_UUID       0x2A2B  // Current Time (R/W/N)
+#define BLE_MAX_VALUE_LEN       512     // ATT maximum; longer than MTU-1 uses read blob / prepare write
+#define BLE_LOCAL_MTU           247     // requested ATT MTU (fits one 251-byte LL packet)
 #define BLE_LED_CMD_MAX_LEN     12      // longest command: "heartbeat" = 9 chars
+#define BLE_MAX_CONNECTIONS     CONFIG_BLE_MAX_CONNECTIONS // simultaneous centrals (menuconfig → BLE Server)
+#define BLE_BATCH_MAX_OPS       16      // operations per 0xFF04 frame
+#define BLE_STREAM_IDLE_MS      500     // no 0xFF05 frame for this long ends the stream
+#define BLE_CLIENTS_MAX         32      // centrals remembered for stats / log; LRU beyond
+#define BLE_CLIENTS_RSSI_MS     5000    // RSSI sampling period of connected centrals
+#define BLE_LOG_TX_WINDOW       4       // 0xFF06 notifications queued in the host at once
+
+// --- BLE link policy (intervals in 1.25 ms units, timeout in 10 ms units) ---
+#define BLE_LINK_FAST_ITVL_MIN  12      // 15 ms while transferring
+#define BLE_LINK_FAST_ITVL_MAX  24      // 30 ms
+#define BLE_LINK_SLOW_ITVL_MIN  400     // 500 ms when idle
+#define BLE_LINK_SLOW_ITVL_MAX  480     // 600 ms
+#define BLE_LINK_SLOW_LATENCY   2       // idle peripheral may skip 2 events
+#define BLE_LINK_SUPERVISION_TMO 600    // 6 s
+#define BLE_LINK_IDLE_MS        5000    // no reads/writes/notifications -> slow interval
+#define BLE_LINK_DLE_OCTETS     251     // LL payload length requested on connect
+
+// --- BLE advertising (intervals in 0.625 ms units) ---
+#define BLE_ADV_FAST_ITVL_MIN   0x20    // 20 ms after boot / disconnect
+#define BLE_ADV_FAST_ITVL_MAX   0x30    // 30 ms
+#define BLE_ADV_SLOW_ITVL_MIN   0x0664  // 1022.5 ms once nobody connected
+#define BLE_ADV_SLOW_ITVL_MAX   0x0800  // 1280 ms
+#define BLE_ADV_FAST_MS         30000   // length of the fast phase
+#define BLE_ADV_COMPANY_ID      0xFFFF  // manufacturer data company ID (0xFFFF = testing)
+#define BLE_ADV_STATE_MIN_MS    1000    // state record updates at most this often
+#define BLE_ADV_STATE_REFRESH_MS 60000  // re-publish for the uptime field
+#define BLE_ADV_STATE_PREFIX    8       // bytes of the 0xFF01 value in the record
+
+// --- BLE security ---
+#define BLE_SEC_NONE            0       // no pairing, writes open to any central
+#define BLE_SEC_JUST_WORKS      1       // LE Secure Connections bond, no confirmation
+#define BLE_SEC_PASSKEY         2       // LE Secure Connections bond, passkey on the OLED
+#define BLE_SEC_MODE            BLE_SEC_NONE
+#define BLE_SEC_ACCEPT_LIST     1       // slow advertising phase accepts bonded peers only
+#define BLE_SC_PEERS_MAX        15      // bonded peers owed Service Changed; >= the stack's bond limit
+
+// --- WiFi provisioning portal ---
+#define WIFI_SCAN_MAX_APS       20      // networks kept in the /scan cache
+#define WIFI_SCAN_REFRESH_MS    30000   // background rescan while the portal runs
+#define WIFI_PROV_CONNECT_TIMEOUT_MS 12000  // POST /connect attempt: association + DHCP
+#define WIFI_PROV_REBOOT_DELAY_MS    1500   // after success, lets /connect/status answer
+#define WIFI_PROV_BLE_FIRST_MS       15000  // provisioning over BLE only, then the SoftAP portal (0 = portal at once)
+#define WIFI_PROV_MDNS_HOST     "esp32-setup"  // portal answers mDNS for <host>.local
+
+// --- WiFi station reconnect (wifi_reconnect.h) ---
+#define WIFI_RECONNECT_BASE_MS      1000    // first backoff step; doubles per attempt
+#define WIFI_RECONNECT_MAX_MS       16000   // backoff cap
+#define WIFI_RECONNECT_NO_AP_MAX_MS 60000   // cap while the AP is not found at all
+#define WIFI_RECONNECT_AUTH_MAX     3       // AUTH_FAIL retries before re-provisioning
+#define WIFI_FAST_STATIC_IP         0       // 1: reuse the cached lease at boot, skip DHCP
+                                            // (risks an address clash if the router reassigned it)
+#define WIFI_STORE_MAX              4       // known networks kept in NVS
+#define WIFI_STORE_RECENT_BONUS_DB  10      // ranking bonus of the last network that connected
+#define WIFI_STORE_PORTAL_AFTER_MS  120000  // no known network since boot: open the portal
+#define WIFI_ROAM_RSSI              -75     // below this the station looks for a better AP
+#define WIFI_ROAM_CHECK_MS          10000   // RSSI sample period while connected
+#define WIFI_ROAM_LOW_COUNT         3       // weak samples in a row before a roam scan
+#define WIFI_ROAM_HYSTERESIS_DB     8       // candidate must be this much stronger
+
+// --- Profiling ---
+#define PROF_ENABLED            1       // BLE handler time, NVS writes, LED mutex waits (GET /prof)
 
 // --- Morse decoder thresholds (match "Flash Morse Code" app slider values) ---
 // App algorithm:  signal ≤ T1 → dot,  signal > T1 → dash
@@ -42,9 +113,15 @@
 #define BLE_TASK_STACK          4096
 #define WIFI_TASK_STACK         6144
 #define LED_ANIM_TASK_STACK     4096
+#define CAPTIVE_NET_TASK_STACK  3072    // portal DNS / mDNS / TCP 443 loop
 
 // --- Web log ring buffer ---
-#define LOG_MAX_DEVICES         8
 #define LOG_MAX_CHARS           16
+#if CONFIG_BT_NIMBLE_ENABLED
+// NimBLE leaves ~50 KB more heap than Bluedroid; /log JSON needs ~200 B/entry
+#define LOG_MAX_ENTRIES         384
+#define LOG_DATA_POOL_SIZE      6144
+#else
 #define LOG_MAX_ENTRIES         256     // 4096 entries * 200 B/entry = ~800 KB malloc, exceeds heap
 #define LOG_DATA_POOL_SIZE      4096
+#endif
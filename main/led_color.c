@@ -0,0 +1,145 @@
+#include "led_color.h"
+#include "config.h"
+
+// Full-saturation, full-value hue wheel for h = 0..359.
+// Generated offline from the integer HSV sextant formula (s = v = 255).
+static const uint8_t s_hue_lut[360][3] = {
+    {255,  0,  0}, {255,  4,  0}, {255,  8,  0}, {255, 12,  0}, {255, 17,  0}, {255, 21,  0},
+    {255, 25,  0}, {255, 29,  0}, {255, 34,  0}, {255, 38,  0}, {255, 42,  0}, {255, 46,  0},
+    {255, 51,  0}, {255, 55,  0}, {255, 59,  0}, {255, 63,  0}, {255, 68,  0}, {255, 72,  0},
+    {255, 76,  0}, {255, 80,  0}, {255, 85,  0}, {255, 89,  0}, {255, 93,  0}, {255, 97,  0},
+    {255,102,  0}, {255,106,  0}, {255,110,  0}, {255,114,  0}, {255,119,  0}, {255,123,  0},
+    {255,127,  0}, {255,131,  0}, {255,136,  0}, {255,140,  0}, {255,144,  0}, {255,148,  0},
+    {255,153,  0}, {255,157,  0}, {255,161,  0}, {255,165,  0}, {255,170,  0}, {255,174,  0},
+    {255,178,  0}, {255,182,  0}, {255,187,  0}, {255,191,  0}, {255,195,  0}, {255,199,  0},
+    {255,204,  0}, {255,208,  0}, {255,212,  0}, {255,216,  0}, {255,221,  0}, {255,225,  0},
+    {255,229,  0}, {255,233,  0}, {255,238,  0}, {255,242,  0}, {255,246,  0}, {255,250,  0},
+    {255,255,  0}, {251,255,  0}, {247,255,  0}, {243,255,  0}, {238,255,  0}, {234,255,  0},
+    {230,255,  0}, {226,255,  0}, {221,255,  0}, {217,255,  0}, {213,255,  0}, {209,255,  0},
+    {204,255,  0}, {200,255,  0}, {196,255,  0}, {192,255,  0}, {187,255,  0}, {183,255,  0},
+    {179,255,  0}, {175,255,  0}, {170,255,  0}, {166,255,  0}, {162,255,  0}, {158,255,  0},
+    {153,255,  0}, {149,255,  0}, {145,255,  0}, {141,255,  0}, {136,255,  0}, {132,255,  0},
+    {128,255,  0}, {124,255,  0}, {119,255,  0}, {115,255,  0}, {111,255,  0}, {107,255,  0},
+    {102,255,  0}, { 98,255,  0}, { 94,255,  0}, { 90,255,  0}, { 85,255,  0}, { 81,255,  0},
+    { 77,255,  0}, { 73,255,  0}, { 68,255,  0}, { 64,255,  0}, { 60,255,  0}, { 56,255,  0},
+    { 51,255,  0}, { 47,255,  0}, { 43,255,  0}, { 39,255,  0}, { 34,255,  0}, { 30,255,  0},
+    { 26,255,  0}, { 22,255,  0}, { 17,255,  0}, { 13,255,  0}, {  9,255,  0}, {  5,255,  0},
+    {  0,255,  0}, {  0,255,  4}, {  0,255,  8}, {  0,255, 12}, {  0,255, 17}, {  0,255, 21},
+    {  0,255, 25}, {  0,255, 29}, {  0,255, 34}, {  0,255, 38}, {  0,255, 42}, {  0,255, 46},
+    {  0,255, 51}, {  0,255, 55}, {  0,255, 59}, {  0,255, 63}, {  0,255, 68}, {  0,255, 72},
+    {  0,255, 76}, {  0,255, 80}, {  0,255, 85}, {  0,255, 89}, {  0,255, 93}, {  0,255, 97},
+    {  0,255,102}, {  0,255,106}, {  0,255,110}, {  0,255,114}, {  0,255,119}, {  0,255,123},
+    {  0,255,127}, {  0,255,131}, {  0,255,136}, {  0,255,140}, {  0,255,144}, {  0,255,148},
+    {  0,255,153}, {  0,255,157}, {  0,255,161}, {  0,255,165}, {  0,255,170}, {  0,255,174},
+    {  0,255,178}, {  0,255,182}, {  0,255,187}, {  0,255,191}, {  0,255,195}, {  0,255,199},
+    {  0,255,204}, {  0,255,208}, {  0,255,212}, {  0,255,216}, {  0,255,221}, {  0,255,225},
+    {  0,255,229}, {  0,255,233}, {  0,255,238}, {  0,255,242}, {  0,255,246}, {  0,255,250},
+    {  0,255,255}, {  0,251,255}, {  0,247,255}, {  0,243,255}, {  0,238,255}, {  0,234,255},
+    {  0,230,255}, {  0,226,255}, {  0,221,255}, {  0,217,255}, {  0,213,255}, {  0,209,255},
+    {  0,204,255}, {  0,200,255}, {  0,196,255}, {  0,192,255}, {  0,187,255}, {  0,183,255},
+    {  0,179,255}, {  0,175,255}, {  0,170,255}, {  0,166,255}, {  0,162,255}, {  0,158,255},
+    {  0,153,255}, {  0,149,255}, {  0,145,255}, {  0,141,255}, {  0,136,255}, {  0,132,255},
+    {  0,128,255}, {  0,124,255}, {  0,119,255}, {  0,115,255}, {  0,111,255}, {  0,107,255},
+    {  0,102,255}, {  0, 98,255}, {  0, 94,255}, {  0, 90,255}, {  0, 85,255}, {  0, 81,255},
+    {  0, 77,255}, {  0, 73,255}, {  0, 68,255}, {  0, 64,255}, {  0, 60,255}, {  0, 56,255},
+    {  0, 51,255}, {  0, 47,255}, {  0, 43,255}, {  0, 39,255}, {  0, 34,255}, {  0, 30,255},
+    {  0, 26,255}, {  0, 22,255}, {  0, 17,255}, {  0, 13,255}, {  0,  9,255}, {  0,  5,255},
+    {  0,  0,255}, {  4,  0,255}, {  8,  0,255}, { 12,  0,255}, { 17,  0,255}, { 21,  0,255},
+    { 25,  0,255}, { 29,  0,255}, { 34,  0,255}, { 38,  0,255}, { 42,  0,255}, { 46,  0,255},
+    { 51,  0,255}, { 55,  0,255}, { 59,  0,255}, { 63,  0,255}, { 68,  0,255}, { 72,  0,255},
+    { 76,  0,255}, { 80,  0,255}, { 85,  0,255}, { 89,  0,255}, { 93,  0,255}, { 97,  0,255},
+    {102,  0,255}, {106,  0,255}, {110,  0,255}, {114,  0,255}, {119,  0,255}, {123,  0,255},
+    {127,  0,255}, {131,  0,255}, {136,  0,255}, {140,  0,255}, {144,  0,255}, {148,  0,255},
+    {153,  0,255}, {157,  0,255}, {161,  0,255}, {165,  0,255}, {170,  0,255}, {174,  0,255},
+    {178,  0,255}, {182,  0,255}, {187,  0,255}, {191,  0,255}, {195,  0,255}, {199,  0,255},
+    {204,  0,255}, {208,  0,255}, {212,  0,255}, {216,  0,255}, {221,  0,255}, {225,  0,255},
+    {229,  0,255}, {233,  0,255}, {238,  0,255}, {242,  0,255}, {246,  0,255}, {250,  0,255},
+    {255,  0,255}, {255,  0,251}, {255,  0,247}, {255,  0,243}, {255,  0,238}, {255,  0,234},
+    {255,  0,230}, {255,  0,226}, {255,  0,221}, {255,  0,217}, {255,  0,213}, {255,  0,209},
+    {255,  0,204}, {255,  0,200}, {255,  0,196}, {255,  0,192}, {255,  0,187}, {255,  0,183},
+    {255,  0,179}, {255,  0,175}, {255,  0,170}, {255,  0,166}, {255,  0,162}, {255,  0,158},
+    {255,  0,153}, {255,  0,149}, {255,  0,145}, {255,  0,141}, {255,  0,136}, {255,  0,132},
+    {255,  0,128}, {255,  0,124}, {255,  0,119}, {255,  0,115}, {255,  0,111}, {255,  0,107},
+    {255,  0,102}, {255,  0, 98}, {255,  0, 94}, {255,  0, 90}, {255,  0, 85}, {255,  0, 81},
+    {255,  0, 77}, {255,  0, 73}, {255,  0, 68}, {255,  0, 64}, {255,  0, 60}, {255,  0, 56},
+    {255,  0, 51}, {255,  0, 47}, {255,  0, 43}, {255,  0, 39}, {255,  0, 34}, {255,  0, 30},
+    {255,  0, 26}, {255,  0, 22}, {255,  0, 17}, {255,  0, 13}, {255,  0,  9}, {255,  0,  5},
+};
+
+// Gamma 2.2 expansion to 16-bit linear: round(65535 * (i / 255) ^ 2.2).
+// The extra 8 bits survive brightness scaling and feed the dither residual,
+// so dim levels keep their resolution instead of collapsing to 0/1/2.
+static const uint16_t s_gamma16[256] = {
+        0,     0,     2,     4,     7,    11,    17,    24,
+       32,    42,    53,    65,    79,    94,   111,   129,
+      148,   169,   192,   216,   242,   270,   299,   330,
+      362,   396,   432,   469,   508,   549,   591,   635,
+      681,   729,   779,   830,   883,   938,   995,  1053,
+     1113,  1175,  1239,  1305,  1373,  1443,  1514,  1587,
+     1663,  1740,  1819,  1900,  1983,  2068,  2155,  2243,
+     2334,  2427,  2521,  2618,  2717,  2817,  2920,  3024,
+     3131,  3240,  3350,  3463,  3578,  3694,  3813,  3934,
+     4057,  4182,  4309,  4438,  4570,  4703,  4838,  4976,
+     5115,  5257,  5401,  5547,  5695,  5845,  5998,  6152,
+     6309,  6468,  6629,  6792,  6957,  7124,  7294,  7466,
+     7640,  7816,  7994,  8175,  8358,  8543,  8730,  8919,
+     9111,  9305,  9501,  9699,  9900, 10102, 10307, 10515,
+    10724, 10936, 11150, 11366, 11585, 11806, 12029, 12254,
+    12482, 12712, 12944, 13179, 13416, 13655, 13896, 14140,
+    14386, 14635, 14885, 15138, 15394, 15652, 15912, 16174,
+    16439, 16706, 16975, 17247, 17521, 17798, 18077, 18358,
+    18642, 18928, 19216, 19507, 19800, 20095, 20393, 20694,
+    20996, 21301, 21609, 21919, 22231, 22546, 22863, 23182,
+    23504, 23829, 24156, 24485, 24817, 25151, 25487, 25826,
+    26168, 26512, 26858, 27207, 27558, 27912, 28268, 28627,
+    28988, 29351, 29717, 30086, 30457, 30830, 31206, 31585,
+    31966, 32349, 32735, 33124, 33514, 33908, 34304, 34702,
+    35103, 35507, 35913, 36321, 36732, 37146, 37562, 37981,
+    38402, 38825, 39252, 39680, 40112, 40546, 40982, 41421,
+    41862, 42306, 42753, 43202, 43654, 44108, 44565, 45025,
+    45487, 45951, 46418, 46888, 47360, 47835, 48313, 48793,
+    49275, 49761, 50249, 50739, 51232, 51728, 52226, 52727,
+    53230, 53736, 54245, 54756, 55270, 55787, 56306, 56828,
+    57352, 57879, 58409, 58941, 59476, 60014, 60554, 61097,
+    61642, 62190, 62741, 63295, 63851, 64410, 64971, 65535,
+};
+
+// x * scale / 256 with scale = 255 mapping x → x (no divide)
+static inline uint8_t scale8(uint8_t x, uint8_t scale)
+{
+    return (uint8_t)(((uint16_t)x * ((uint16_t)scale + 1)) >> 8);
+}
+
+void led_color_hsv(uint16_t h, uint8_t s, uint8_t v,
+                   uint8_t *r, uint8_t *g, uint8_t *b)
+{
+    if (h >= 360) h = 359;
+    const uint8_t *c = s_hue_lut[h];
+    // Desaturate toward white, then scale by value
+    *r = scale8(255 - scale8(255 - c[0], s), v);
+    *g = scale8(255 - scale8(255 - c[1], s), v);
+    *b = scale8(255 - scale8(255 - c[2], s), v);
+}
+
+static uint8_t render_channel(uint8_t c, uint8_t *err)
+{
+    // 16-bit linear level scaled by brightness: high byte is the output code,
+    // low byte is the fraction dithering carries into the next frame.
+    uint32_t lvl = ((uint32_t)s_gamma16[c] * ((uint32_t)LED_DEMO_BRIGHTNESS + 1)) >> 8;
+    if (err) {
+        lvl += *err;
+        *err = (uint8_t)(lvl & 0xFF);
+    } else {
+        lvl += 0x80;  // round to nearest
+    }
+    lvl >>= 8;
+    return lvl > 255 ? 255 : (uint8_t)lvl;
+}
+
+void led_color_render(uint8_t r, uint8_t g, uint8_t b, led_dither_t *dither,
+                      uint8_t *out_r, uint8_t *out_g, uint8_t *out_b)
+{
+    *out_r = render_channel(r, dither ? &dither->err[0] : NULL);
+    *out_g = render_channel(g, dither ? &dither->err[1] : NULL);
+    *out_b = render_channel(b, dither ? &dither->err[2] : NULL);
+}
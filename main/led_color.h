@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Per-pixel temporal dithering state: 8-bit residual carried between frames
+// so brightness levels between two output codes average out over time.
+typedef struct {
+    uint8_t err[3];
+} led_dither_t;
+
+// HSV → RGB via lookup table (h: 0-359, s: 0-255, v: 0-255), no divisions.
+// Output is perceptual (pre-gamma) and matches the classic integer HSV
+// conversion to within ±1 per channel.
+void led_color_hsv(uint16_t h, uint8_t s, uint8_t v,
+                   uint8_t *r, uint8_t *g, uint8_t *b);
+
+// Convert a perceptual color to LED drive levels: gamma correction, the
+// LED_DEMO_BRIGHTNESS ceiling (config.h), then either temporal dithering
+// (dither != NULL, call once per frame) or plain rounding (dither == NULL,
+// for static output).
+void led_color_render(uint8_t r, uint8_t g, uint8_t b, led_dither_t *dither,
+                      uint8_t *out_r, uint8_t *out_g, uint8_t *out_b);
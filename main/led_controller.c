@@ -1,8 +1,14 @@
 #include "led_controller.h"
+#include "led_color.h"
+#include "morse_store.h"
 #include "config.h"
+#include "prof.h"
+#include <ctype.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "nvs.h"
 
 #define LED_NVS_NS    "led_ctrl"
@@ -39,17 +45,31 @@ static led_anim_t  s_anim        = LED_ANIM_NONE;
 static bool        s_connected   = false;
 static char        s_cached_cmd[12] = "off"; // current command string for BLE read
 static char        s_morse_text[BLE_MAX_VALUE_LEN + 1] = {0};
+static bool        s_morse_stored = false;    // play morse_store message instead
 static morse_cfg_t s_morse_cfg;               // initialized in led_ctrl_init()
+static led_change_cb_t s_change_cb = NULL;     // fired after a command is applied
+
+// Take s_mutex; time spent blocked behind the animation task or another
+// caller is reported to the profiler
+static void led_lock(void)
+{
+    if (xSemaphoreTake(s_mutex, 0) == pdTRUE) return;
+    int64_t t0 = esp_timer_get_time();
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    prof_lock_wait(esp_timer_get_time() - t0);
+}
 
 // --- NVS helpers ---
 
 static void nvs_save_color(const char *hex6)
 {
+    int64_t t0 = esp_timer_get_time();
     nvs_handle_t h;
     if (nvs_open(LED_NVS_NS, NVS_READWRITE, &h) != ESP_OK) return;
     nvs_set_str(h, LED_NVS_KEY, hex6);
     nvs_commit(h);
     nvs_close(h);
+    prof_nvs(esp_timer_get_time() - t0);
 }
 
 static void nvs_load_morse_cfg(morse_cfg_t *cfg)
@@ -65,6 +85,7 @@ static void nvs_load_morse_cfg(morse_cfg_t *cfg)
 
 static void nvs_save_morse_cfg(const morse_cfg_t *cfg)
 {
+    int64_t t0 = esp_timer_get_time();
     nvs_handle_t h;
     if (nvs_open(MORSE_NVS_NS, NVS_READWRITE, &h) != ESP_OK) return;
     nvs_set_u16(h, "t1", cfg->t1_ms);
@@ -72,6 +93,7 @@ static void nvs_save_morse_cfg(const morse_cfg_t *cfg)
     nvs_set_u16(h, "t3", cfg->t3_ms);
     nvs_commit(h);
     nvs_close(h);
+    prof_nvs(esp_timer_get_time() - t0);
 }
 
 // --- Low-level LED write (always call with s_mutex held) ---
@@ -88,32 +110,22 @@ static void set_off(void)
     led_strip_refresh(s_led);
 }
 
-// --- HSV → RGB (h: 0-359, s: 0-255, v: 0-255) ---
+// --- Color pipeline output (always call with s_mutex held) ---
 
-static void hsv_to_rgb(uint16_t h, uint8_t s, uint8_t v,
-                       uint8_t *r, uint8_t *g, uint8_t *b)
+// Render a perceptual color through gamma + brightness and write it.
+// Pass the animation's dither state for per-frame output, NULL for static.
+static void set_color(uint8_t r, uint8_t g, uint8_t b, led_dither_t *dither)
 {
-    if (s == 0) { *r = *g = *b = v; return; }
-    uint16_t region    = h / 60;
-    uint16_t remainder = (h - region * 60) * 255 / 60;
-    uint8_t  p = (uint16_t)v * (255 - s) / 255;
-    uint8_t  q = (uint16_t)v * (255 - ((uint16_t)s * remainder / 255)) / 255;
-    uint8_t  t = (uint16_t)v * (255 - ((uint16_t)s * (255 - remainder) / 255)) / 255;
-    switch (region) {
-    case 0: *r = v; *g = t; *b = p; break;
-    case 1: *r = q; *g = v; *b = p; break;
-    case 2: *r = p; *g = v; *b = t; break;
-    case 3: *r = p; *g = q; *b = v; break;
-    case 4: *r = t; *g = p; *b = v; break;
-    default:*r = v; *g = p; *b = q; break;
-    }
+    uint8_t lr, lg, lb;
+    led_color_render(r, g, b, dither, &lr, &lg, &lb);
+    set_raw(lr, lg, lb);
 }
 
 // --- Flash timer callback: restore status LED after a BLE event flash ---
 
 static void flash_timer_cb(TimerHandle_t xTimer)
 {
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    led_lock();
     if (s_mode == LED_MODE_STATUS) {
         if (s_connected)
             set_raw(0, LED_BRIGHTNESS, 0);
@@ -125,88 +137,9 @@ static void flash_timer_cb(TimerHandle_t xTimer)
 
 // --- Morse code support ---
 
-// Russian А-Я transliteration (indices 0-31: А=0 … Я=31)
-// Soft sign (Ь, index 29) and hard sign (Ъ, index 27) produce no Morse output.
-static const char *s_ru_translit[32] = {
-    "A","B","V","G","D","E","ZH","Z","I","Y",
-    "K","L","M","N","O","P","R","S","T","U",
-    "F","H","TS","CH","SH","SCH","","Y","","E",
-    "YU","YA"
-};
-
-// Decode a single UTF-8 Cyrillic codepoint at in[*pos], advance *pos,
-// and return the transliteration string (or NULL for unknown/punctuation).
-static const char *decode_cyrillic(const char *in, size_t len, size_t *pos)
-{
-    uint8_t b0 = (uint8_t)in[*pos];
-    if (*pos + 1 >= len) { (*pos)++; return NULL; }
-    uint8_t b1 = (uint8_t)in[*pos + 1];
-    *pos += 2;
-
-    if (b0 == 0xD0) {
-        if (b1 == 0x81) return s_ru_translit[5];          // Ё → Е
-        if (b1 >= 0x90 && b1 <= 0xAF) return s_ru_translit[b1 - 0x90]; // А-Я
-        if (b1 >= 0xB0 && b1 <= 0xBF) return s_ru_translit[b1 - 0xB0]; // а-п
-    } else if (b0 == 0xD1) {
-        if (b1 == 0x91) return s_ru_translit[5];          // ё → е
-        if (b1 >= 0x80 && b1 <= 0x8F) return s_ru_translit[b1 - 0x80 + 16]; // р-я
-    }
-    return NULL;
-}
-
-// Transliterate UTF-8 text (Cyrillic → Latin, ASCII uppercase, skip other)
-// into out[out_len]. Spaces are preserved.
-static void morse_translit(const char *in, char *out, size_t out_len)
-{
-    size_t in_len  = strlen(in);
-    size_t out_pos = 0;
-    size_t i = 0;
-
-    while (i < in_len && out_pos + 1 < out_len) {
-        uint8_t c = (uint8_t)in[i];
-        if (c == ' ') {
-            out[out_pos++] = ' ';
-            i++;
-        } else if (c < 0x80) {
-            // ASCII: pass through as uppercase
-            if (c >= 'a' && c <= 'z') c -= 32;
-            out[out_pos++] = (char)c;
-            i++;
-        } else if ((c == 0xD0 || c == 0xD1) && i + 1 < in_len) {
-            const char *tr = decode_cyrillic(in, in_len, &i);
-            if (tr) {
-                size_t tlen = strlen(tr);
-                if (out_pos + tlen < out_len) {
-                    memcpy(out + out_pos, tr, tlen);
-                    out_pos += tlen;
-                }
-            }
-        } else {
-            i++;  // skip other multibyte sequences
-        }
-    }
-    out[out_pos] = '\0';
-}
-
-// A-Z then 0-9
-static const char *s_morse_table[36] = {
-    ".-",   "-...", "-.-.", "-..",  ".",    "..-.", "--.",  "....", "..",   ".---",
-    "-.-",  ".-..", "--",   "-.",   "---",  ".--.", "--.-", ".-.",  "...",  "-",
-    "..-",  "...-", ".--",  "-..-", "-.--", "--..",
-    "-----",".----","..---","...--","....-",".....","-....","--...","---..", "----."
-};
-
-static const char *morse_encode(char c)
-{
-    if (c >= 'A' && c <= 'Z') return s_morse_table[c - 'A'];
-    if (c >= 'a' && c <= 'z') return s_morse_table[c - 'a'];
-    if (c >= '0' && c <= '9') return s_morse_table[26 + (c - '0')];
-    return NULL;
-}
-
 static bool morse_is_active(void)
 {
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    led_lock();
     bool active = (s_mode == LED_MODE_DEMO && s_anim == LED_ANIM_MORSE);
     xSemaphoreGive(s_mutex);
     return active;
@@ -214,11 +147,11 @@ static bool morse_is_active(void)
 
 static void morse_on(uint32_t ms)
 {
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    led_lock();
     if (s_mode == LED_MODE_DEMO && s_anim == LED_ANIM_MORSE) {
         uint8_t r, g, b;
-        hsv_to_rgb(28, 255, LED_DEMO_BRIGHTNESS, &r, &g, &b);  // warm amber
-        set_raw(r, g, b);
+        led_color_hsv(28, 255, 255, &r, &g, &b);  // warm amber
+        set_color(r, g, b, NULL);
     }
     xSemaphoreGive(s_mutex);
     vTaskDelay(pdMS_TO_TICKS(ms));
@@ -226,7 +159,7 @@ static void morse_on(uint32_t ms)
 
 static void morse_off(uint32_t ms)
 {
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    led_lock();
     if (s_mode == LED_MODE_DEMO && s_anim == LED_ANIM_MORSE) set_off();
     xSemaphoreGive(s_mutex);
     vTaskDelay(pdMS_TO_TICKS(ms));
@@ -235,7 +168,7 @@ static void morse_off(uint32_t ms)
 // Chunked wait for long pauses - checks for interruption every 200 ms
 static void morse_wait(uint32_t ms)
 {
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    led_lock();
     if (s_mode == LED_MODE_DEMO && s_anim == LED_ANIM_MORSE) set_off();
     xSemaphoreGive(s_mutex);
     while (ms > 0 && morse_is_active()) {
@@ -245,51 +178,17 @@ static void morse_wait(uint32_t ms)
     }
 }
 
-static void play_morse(const char *text, const morse_cfg_t *cfg)
+// Stream the source through the encoder one timeline segment at a time;
+// RAM use is constant no matter how long the text is.
+static void play_morse(const morse_source_t *src, const morse_cfg_t *cfg)
 {
-    // Derive actual on/off durations from decoder thresholds (with margin):
-    //   dot  = 60% T1       → safely below T1 (dot/dash boundary)
-    //   dash = 250% T1      → comfortably above T1
-    //   sym  = 40% T2       → safely below T2 (sym/letter boundary)
-    //   char = mid(T2, T3)  → falls in the letter-gap zone (T2 < char ≤ T3)
-    //   word = char × 7/3   → standard Morse 7:3 ratio; adaptive decoders
-    //                          cluster gaps by ratio, so ~2.3× char is needed
-    uint32_t dot_ms      = (uint32_t)cfg->t1_ms * 6 / 10;
-    uint32_t dash_ms     = (uint32_t)cfg->t1_ms * 5 / 2;
-    uint32_t sym_gap_ms  = (uint32_t)cfg->t2_ms * 4 / 10;
-    uint32_t char_gap_ms = ((uint32_t)cfg->t2_ms + cfg->t3_ms) / 2;
-    uint32_t word_gap_ms = char_gap_ms * 7 / 3;
-
-    // Transliterate Cyrillic → Latin (ASCII passes through unchanged)
-    char xlat[128];
-    morse_translit(text, xlat, sizeof(xlat));
-
-    // Initial silence so the decoder establishes a clear baseline
-    morse_off(char_gap_ms);
-
-    for (int i = 0; xlat[i]; i++) {
+    morse_enc_t enc;
+    morse_seg_t seg;
+    morse_enc_init(&enc, src, cfg);
+
+    while (morse_enc_next(&enc, &seg)) {
         if (!morse_is_active()) return;
-        char c = xlat[i];
-        if (c == ' ') {
-            // char_gap was already added after the previous character;
-            // add only the extra silence to reach word_gap total.
-            if (word_gap_ms > char_gap_ms)
-                morse_off(word_gap_ms - char_gap_ms);
-        } else {
-            const char *code = morse_encode(c);
-            if (!code) continue;
-            for (int j = 0; code[j]; j++) {
-                if (code[j] == '.') {
-                    morse_on(dot_ms);
-                } else {
-                    morse_on(dash_ms);
-                }
-                if (code[j + 1]) {
-                    morse_off(sym_gap_ms);   // gap between elements within char
-                }
-            }
-            morse_off(char_gap_ms);          // gap after each character
-        }
+        if (seg.on) morse_on(seg.ms); else morse_off(seg.ms);
     }
     if (morse_is_active()) {
         morse_wait(3000);  // pause between repeats, interruptible every 200 ms
@@ -300,12 +199,13 @@ static void play_morse(const char *text, const morse_cfg_t *cfg)
 
 static void anim_task(void *arg)
 {
-    uint16_t hue       = 0;
-    uint32_t fire_seed = 0xDEADBEEF;
-    uint8_t  fire_val  = LED_DEMO_BRIGHTNESS;
+    uint16_t     hue       = 0;
+    uint32_t     fire_seed = 0xDEADBEEF;
+    uint8_t      fire_val  = 255;
+    led_dither_t dither    = {0};
 
     for (;;) {
-        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        led_lock();
 
         if (s_mode != LED_MODE_DEMO || s_anim == LED_ANIM_NONE) {
             xSemaphoreGive(s_mutex);
@@ -313,36 +213,38 @@ static void anim_task(void *arg)
             continue;
         }
 
+        // Colors below are perceptual full-scale (0-255); set_color applies
+        // gamma and the LED_DEMO_BRIGHTNESS ceiling with temporal dithering.
         uint8_t r = 0, g = 0, b = 0;
 
         switch (s_anim) {
         case LED_ANIM_FADE:
             // Full hue cycle in ~12 s (360 steps × 33 ms)
-            hsv_to_rgb(hue, 255, LED_DEMO_BRIGHTNESS, &r, &g, &b);
-            hue = (hue + 1) % 360;
+            led_color_hsv(hue, 255, 255, &r, &g, &b);
+            if (++hue >= 360) hue = 0;
             break;
 
         case LED_ANIM_RAINBOW:
             // Full hue cycle in ~3 s (90 steps × 33 ms)
-            hsv_to_rgb(hue, 255, LED_DEMO_BRIGHTNESS, &r, &g, &b);
-            hue = (hue + 4) % 360;
+            led_color_hsv(hue, 255, 255, &r, &g, &b);
+            hue += 4;
+            if (hue >= 360) hue -= 360;
             break;
 
         case LED_ANIM_FIRE: {
             // LCG pseudo-random; organic flicker: decay + random spikes
             fire_seed = fire_seed * 1664525UL + 1013904223UL;
             uint8_t rnd   = (uint8_t)(fire_seed >> 16);
-            uint8_t decay = 6 + (rnd & 7);  // decay 6-13 per frame
+            uint8_t decay = 8 + (rnd & 7);  // decay 8-15 per frame
             fire_val = (fire_val > decay) ? fire_val - decay : 0;
             if (rnd < 60) {  // ~23% chance: spike brightness
                 fire_seed = fire_seed * 1664525UL + 1013904223UL;
                 uint8_t rnd2 = (uint8_t)(fire_seed >> 24);
-                fire_val = LED_DEMO_BRIGHTNESS / 3
-                           + (rnd2 % (LED_DEMO_BRIGHTNESS * 2 / 3 + 1));
+                fire_val = 155 + (rnd2 % 101);  // 155-255 (~1/3..full drive)
             }
-            if (fire_val < LED_DEMO_BRIGHTNESS / 4) fire_val = LED_DEMO_BRIGHTNESS / 4;
+            if (fire_val < 136) fire_val = 136;  // ~1/4 drive after gamma
             uint16_t fire_hue = rnd % 13;  // hue 0-12: deep red to barely orange
-            hsv_to_rgb(fire_hue, 255, fire_val, &r, &g, &b);
+            led_color_hsv(fire_hue, 255, fire_val, &r, &g, &b);
             break;
         }
 
@@ -351,11 +253,11 @@ static void anim_task(void *arg)
             uint8_t phase = (uint8_t)(hue % 34);
             hue++;
             if (phase < 3) {
-                hsv_to_rgb(5, 255, LED_DEMO_BRIGHTNESS, &r, &g, &b);          // beat 1
+                led_color_hsv(5, 255, 255, &r, &g, &b);   // beat 1
             } else if (phase < 5) {
-                r = g = b = 0;                                                  // gap
+                r = g = b = 0;                            // gap
             } else if (phase < 9) {
-                hsv_to_rgb(5, 255, LED_DEMO_BRIGHTNESS * 2 / 3, &r, &g, &b); // beat 2
+                led_color_hsv(5, 255, 212, &r, &g, &b);   // beat 2 (~2/3 drive)
             }
             // phase 9-33: r=g=b=0 (rest, already zero-initialized)
             break;
@@ -365,9 +267,9 @@ static void anim_task(void *arg)
             // 120-frame cycle (~4 s): triangle-wave brightness, cool blue
             uint8_t phase = (uint8_t)(hue % 120);
             uint8_t x     = (phase < 60) ? phase : (119 - phase);  // 0..59
-            uint8_t val   = LED_DEMO_BRIGHTNESS / 6
-                            + (uint8_t)((uint16_t)x * (LED_DEMO_BRIGHTNESS * 5 / 6) / 59);
-            hsv_to_rgb(200, 200, val, &r, &g, &b);
+            // 113 ≈ 1/6 drive after gamma; dithering keeps the dim end smooth
+            uint8_t val   = 113 + (uint8_t)((uint16_t)x * 142 / 59);
+            led_color_hsv(200, 200, val, &r, &g, &b);
             hue = (hue + 1) % 120;
             break;
         }
@@ -376,10 +278,20 @@ static void anim_task(void *arg)
             char text[BLE_MAX_VALUE_LEN + 1];
             strncpy(text, s_morse_text, BLE_MAX_VALUE_LEN);
             text[BLE_MAX_VALUE_LEN] = '\0';
+            bool stored     = s_morse_stored;
             morse_cfg_t cfg = s_morse_cfg;    // snapshot config under mutex
             xSemaphoreGive(s_mutex);          // release before long blocking playback
-            if (text[0] != '\0') {
-                play_morse(text, &cfg);
+
+            morse_str_src_t      str_src = { .text = text };
+            morse_store_reader_t reader;
+            morse_source_t       src     = { morse_str_read, &str_src };
+            if (stored) {
+                morse_store_reader_init(&reader);
+                src.read = morse_store_read;
+                src.ctx  = &reader;
+            }
+            if (stored ? morse_store_length() > 0 : text[0] != '\0') {
+                play_morse(&src, &cfg);
             } else {
                 vTaskDelay(pdMS_TO_TICKS(1000));
             }
@@ -390,7 +302,7 @@ static void anim_task(void *arg)
             break;
         }
 
-        set_raw(r, g, b);
+        set_color(r, g, b, &dither);
         xSemaphoreGive(s_mutex);
         vTaskDelay(pdMS_TO_TICKS(33));
     }
@@ -412,6 +324,8 @@ void led_ctrl_init(led_strip_handle_t led)
     s_morse_cfg.t2_ms = MORSE_DEFAULT_T2_MS;
     s_morse_cfg.t3_ms = MORSE_DEFAULT_T3_MS;
     nvs_load_morse_cfg(&s_morse_cfg);
+    // A message left in the flash store survives a reboot; keep playing it
+    s_morse_stored = morse_store_length() > 0;
 
     // Restore saved color from NVS (before task starts; no concurrency yet)
     char saved[9] = {0};
@@ -431,19 +345,19 @@ void led_ctrl_init(led_strip_handle_t led)
 void led_ctrl_get_command(char *buf, size_t len)
 {
     if (!buf || len == 0) return;
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    led_lock();
     strncpy(buf, s_cached_cmd, len - 1);
     buf[len - 1] = '\0';
     xSemaphoreGive(s_mutex);
 }
 
-bool led_ctrl_apply_command(const char *cmd)
+static bool apply_command(const char *cmd, bool persist)
 {
     if (!cmd) return false;
 
     // Named animation / off commands
     if (strcmp(cmd, "off") == 0) {
-        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        led_lock();
         s_mode = LED_MODE_STATUS;
         s_anim = LED_ANIM_NONE;
         strncpy(s_cached_cmd, "off", sizeof(s_cached_cmd) - 1);
@@ -452,7 +366,7 @@ bool led_ctrl_apply_command(const char *cmd)
         return true;
     }
     if (strcmp(cmd, "fade") == 0) {
-        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        led_lock();
         s_mode = LED_MODE_DEMO;
         s_anim = LED_ANIM_FADE;
         strncpy(s_cached_cmd, "fade", sizeof(s_cached_cmd) - 1);
@@ -460,7 +374,7 @@ bool led_ctrl_apply_command(const char *cmd)
         return true;
     }
     if (strcmp(cmd, "fire") == 0) {
-        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        led_lock();
         s_mode = LED_MODE_DEMO;
         s_anim = LED_ANIM_FIRE;
         strncpy(s_cached_cmd, "fire", sizeof(s_cached_cmd) - 1);
@@ -468,7 +382,7 @@ bool led_ctrl_apply_command(const char *cmd)
         return true;
     }
     if (strcmp(cmd, "rainbow") == 0) {
-        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        led_lock();
         s_mode = LED_MODE_DEMO;
         s_anim = LED_ANIM_RAINBOW;
         strncpy(s_cached_cmd, "rainbow", sizeof(s_cached_cmd) - 1);
@@ -476,7 +390,7 @@ bool led_ctrl_apply_command(const char *cmd)
         return true;
     }
     if (strcmp(cmd, "heartbeat") == 0) {
-        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        led_lock();
         s_mode = LED_MODE_DEMO;
         s_anim = LED_ANIM_HEARTBEAT;
         strncpy(s_cached_cmd, "heartbeat", sizeof(s_cached_cmd) - 1);
@@ -484,7 +398,7 @@ bool led_ctrl_apply_command(const char *cmd)
         return true;
     }
     if (strcmp(cmd, "breathe") == 0) {
-        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        led_lock();
         s_mode = LED_MODE_DEMO;
         s_anim = LED_ANIM_BREATHE;
         strncpy(s_cached_cmd, "breathe", sizeof(s_cached_cmd) - 1);
@@ -492,7 +406,7 @@ bool led_ctrl_apply_command(const char *cmd)
         return true;
     }
     if (strcmp(cmd, "morse") == 0) {
-        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        led_lock();
         s_mode = LED_MODE_DEMO;
         s_anim = LED_ANIM_MORSE;
         strncpy(s_cached_cmd, "morse", sizeof(s_cached_cmd) - 1);
@@ -517,43 +431,102 @@ bool led_ctrl_apply_command(const char *cmd)
         tmp[0] = cmd[4]; tmp[1] = cmd[5];
         uint8_t b = (uint8_t)strtol(tmp, NULL, 16);
 
-        // Scale 0-255 → 0-LED_DEMO_BRIGHTNESS so hue is preserved but safe brightness
-        r = (uint16_t)r * LED_DEMO_BRIGHTNESS / 255;
-        g = (uint16_t)g * LED_DEMO_BRIGHTNESS / 255;
-        b = (uint16_t)b * LED_DEMO_BRIGHTNESS / 255;
-
         // Copy hex string before taking mutex (for NVS save after release)
         char hex_save[7];
         memcpy(hex_save, cmd, 6);
         hex_save[6] = '\0';
 
-        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        led_lock();
         s_mode = LED_MODE_DEMO;
         s_anim = LED_ANIM_NONE;
         memcpy(s_cached_cmd, hex_save, 7);
-        set_raw(r, g, b);
+        set_color(r, g, b, NULL);  // gamma + LED_DEMO_BRIGHTNESS ceiling
         xSemaphoreGive(s_mutex);
 
-        nvs_save_color(hex_save); // persist outside mutex (flash write can be slow)
+        if (persist)
+            nvs_save_color(hex_save); // persist outside mutex (flash write can be slow)
         return true;
     }
 
     return false;
 }
 
+void led_ctrl_stream_color(uint8_t r, uint8_t g, uint8_t b)
+{
+    led_lock();
+    s_mode = LED_MODE_DEMO;
+    s_anim = LED_ANIM_NONE;
+    snprintf(s_cached_cmd, sizeof(s_cached_cmd), "%02X%02X%02X", r, g, b);
+    set_color(r, g, b, NULL);
+    xSemaphoreGive(s_mutex);
+}
+
+bool led_ctrl_is_valid_command(const char *cmd)
+{
+    static const char *const names[] = {
+        "off", "fade", "fire", "rainbow", "heartbeat", "breathe", "morse",
+    };
+    if (!cmd) return false;
+    for (int i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+        if (strcmp(cmd, names[i]) == 0) return true;
+    if (strlen(cmd) != 6) return false;
+    for (int i = 0; i < 6; i++)
+        if (!isxdigit((unsigned char)cmd[i])) return false;
+    return true;
+}
+
+bool led_ctrl_apply_command(const char *cmd)
+{
+    bool ok = apply_command(cmd, true);
+    if (ok && s_change_cb) s_change_cb();
+    return ok;
+}
+
+bool led_ctrl_apply_command_unsaved(const char *cmd)
+{
+    bool ok = apply_command(cmd, false);
+    if (ok && s_change_cb) s_change_cb();
+    return ok;
+}
+
+void led_ctrl_save_color(void)
+{
+    char hex[7];
+    led_lock();
+    bool is_color = s_mode == LED_MODE_DEMO && s_anim == LED_ANIM_NONE;
+    memcpy(hex, s_cached_cmd, sizeof(hex) - 1);
+    hex[6] = '\0';
+    xSemaphoreGive(s_mutex);
+    if (is_color && strlen(hex) == 6)
+        nvs_save_color(hex);
+}
+
+void led_ctrl_set_change_cb(led_change_cb_t cb)
+{
+    s_change_cb = cb;
+}
+
 void led_ctrl_set_morse_text(const char *text)
 {
     if (!text) return;
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    led_lock();
     strncpy(s_morse_text, text, BLE_MAX_VALUE_LEN);
     s_morse_text[BLE_MAX_VALUE_LEN] = '\0';
+    s_morse_stored = false;
+    xSemaphoreGive(s_mutex);
+}
+
+void led_ctrl_set_morse_stored(void)
+{
+    led_lock();
+    s_morse_stored = true;
     xSemaphoreGive(s_mutex);
 }
 
 void led_ctrl_get_morse_timing(morse_cfg_t *cfg)
 {
     if (!cfg) return;
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    led_lock();
     *cfg = s_morse_cfg;
     xSemaphoreGive(s_mutex);
 }
@@ -561,7 +534,7 @@ void led_ctrl_get_morse_timing(morse_cfg_t *cfg)
 void led_ctrl_set_morse_timing(const morse_cfg_t *cfg)
 {
     if (!cfg) return;
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    led_lock();
     s_morse_cfg = *cfg;
     xSemaphoreGive(s_mutex);
     nvs_save_morse_cfg(cfg);  // persist outside mutex (flash write can be slow)
@@ -569,7 +542,7 @@ void led_ctrl_set_morse_timing(const morse_cfg_t *cfg)
 
 void led_ctrl_ble_connected(bool connected)
 {
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    led_lock();
     s_connected = connected;
     if (s_mode == LED_MODE_STATUS) {
         if (connected) set_raw(0, LED_BRIGHTNESS, 0); else set_off();
@@ -579,7 +552,7 @@ void led_ctrl_ble_connected(bool connected)
 
 void led_ctrl_ble_flash(bool is_read)
 {
-    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    led_lock();
     if (s_mode == LED_MODE_STATUS) {
         // blue = read, red = write
         if (is_read) set_raw(0, 0, LED_BRIGHTNESS);
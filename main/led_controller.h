@@ -2,7 +2,9 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include "led_strip.h"
+#include "morse.h"
 
 // Initialize LED controller; must be called before any other led_ctrl_* function
 void led_ctrl_init(led_strip_handle_t led);
@@ -16,6 +18,27 @@ void led_ctrl_init(led_strip_handle_t led);
 // Returns true if the command was recognised and applied.
 bool led_ctrl_apply_command(const char *cmd);
 
+// Like led_ctrl_apply_command, but an "RRGGBB" colour is not written to NVS;
+// call led_ctrl_save_color() later, off the latency-sensitive path
+bool led_ctrl_apply_command_unsaved(const char *cmd);
+
+// Persist the current "RRGGBB" colour (nothing to do for an animation or "off")
+void led_ctrl_save_color(void);
+
+// True if cmd would be accepted by led_ctrl_apply_command (nothing is applied)
+bool led_ctrl_is_valid_command(const char *cmd);
+
+// Show a colour from a real-time stream: like "RRGGBB" but not persisted and
+// without the change callback. Call led_ctrl_apply_command() with the final
+// colour when the stream ends.
+void led_ctrl_stream_color(uint8_t r, uint8_t g, uint8_t b);
+
+// Callback type for LED command changes (any source: BLE, web UI, NVS restore)
+typedef void (*led_change_cb_t)(void);
+
+// Register callback invoked after a command has been applied successfully
+void led_ctrl_set_change_cb(led_change_cb_t cb);
+
 // Notify LED controller of BLE connection state change (status mode only)
 void led_ctrl_ble_connected(bool connected);
 
@@ -29,15 +52,9 @@ void led_ctrl_get_command(char *buf, size_t len);
 // Set the text string to transmit when Morse animation is active
 void led_ctrl_set_morse_text(const char *text);
 
-// Morse decoder thresholds — mirror the three sliders in "Flash Morse Code" app.
-// Firmware derives actual on/off durations automatically with comfortable margins:
-//   dot  = 60% T1,  dash = 250% T1
-//   sym  = 40% T2,  char = midpoint(T2,T3),  word = 150% T3
-typedef struct {
-    uint16_t t1_ms;  // Dot/Dash threshold:    signal ≤ t1 → dot,  > t1 → dash
-    uint16_t t2_ms;  // Sym/Letter threshold:  gap    ≤ t2 → sym,  (t2..t3] → char
-    uint16_t t3_ms;  // Letter/Word threshold: gap    > t3 → word
-} morse_cfg_t;
+// Transmit the message held in the flash Morse store (morse_store.h) instead
+// of the text string; the next led_ctrl_set_morse_text call switches back.
+void led_ctrl_set_morse_stored(void);
 
 // Get / set Morse timing (set also persists to NVS)
 void led_ctrl_get_morse_timing(morse_cfg_t *cfg);
@@ -7,6 +7,7 @@
 #include "config.h"
 #include "ble_server.h"
 #include "wifi_manager.h"
+#include "wifi_fast.h"
 #include "web_server.h"
 #include "ntp_sync.h"
 #include "oled_display.h"
@@ -23,6 +24,7 @@ static void wifi_task(void *arg)
     wifi_manager_start();   // Blocks until WiFi connected
     ntp_sync_start();       // Start NTP sync (runs in background)
     web_server_start();     // Start HTTP server
+    wifi_fast_http_ready(); // Log boot-to-IP / boot-to-HTTP timing
     vTaskDelete(NULL);
 }
 
@@ -65,10 +67,16 @@ void app_main(void)
         oled_set_line(2, "WiFi: ...");
     }
 
+    // Local time works as soon as any time source (NTP or BLE CTS) sets the clock
+    ntp_sync_init();
+
     // Initialize BLE event logging mutex, load persisted config
     web_log_init();
     web_set_ble_ctrl_cb(ble_set_enabled);
     web_set_wifi_reset_cb(wifi_manager_reset);
+    led_ctrl_set_change_cb(ble_notify_led_changed);
+    ntp_sync_set_change_cb(ble_notify_time_changed);
+    wifi_manager_set_prov_cb(ble_notify_wifi_scan_done, ble_notify_wifi_status);
 
     // Start BLE and WiFi as independent FreeRTOS tasks
     xTaskCreate(ble_task,  "ble_task",  BLE_TASK_STACK,  NULL, 5, NULL);
@@ -0,0 +1,309 @@
+#include "morse.h"
+#include <string.h>
+
+// --- Transliteration (non-ASCII code point → Latin) ---
+
+// Upper-case code points only; fold_case() maps lower case first.
+// Sorted by code point for binary search. Empty string = no Morse output.
+typedef struct {
+    uint16_t cp;
+    char     lat[4];
+} translit_t;
+
+static const translit_t s_translit[] = {
+    // Latin-1 punctuation and letters
+    {0x00A0, " "},   {0x00AB, "\""},  {0x00BB, "\""},
+    {0x00C0, "A"},   {0x00C1, "A"},   {0x00C2, "A"},   {0x00C3, "A"},
+    {0x00C4, "AE"},  {0x00C5, "AA"},  {0x00C6, "AE"},  {0x00C7, "C"},
+    {0x00C8, "E"},   {0x00C9, "E"},   {0x00CA, "E"},   {0x00CB, "E"},
+    {0x00CC, "I"},   {0x00CD, "I"},   {0x00CE, "I"},   {0x00CF, "I"},
+    {0x00D0, "D"},   {0x00D1, "N"},   {0x00D2, "O"},   {0x00D3, "O"},
+    {0x00D4, "O"},   {0x00D5, "O"},   {0x00D6, "OE"},  {0x00D7, "X"},
+    {0x00D8, "OE"},  {0x00D9, "U"},   {0x00DA, "U"},   {0x00DB, "U"},
+    {0x00DC, "UE"},  {0x00DD, "Y"},   {0x00DE, "TH"},  {0x00DF, "SS"},
+    {0x0178, "Y"},
+    // Greek (ELOT 743)
+    {0x0386, "A"},   {0x0388, "E"},   {0x0389, "I"},   {0x038A, "I"},
+    {0x038C, "O"},   {0x038E, "Y"},   {0x038F, "O"},   {0x0390, "I"},
+    {0x0391, "A"},   {0x0392, "V"},   {0x0393, "G"},   {0x0394, "D"},
+    {0x0395, "E"},   {0x0396, "Z"},   {0x0397, "I"},   {0x0398, "TH"},
+    {0x0399, "I"},   {0x039A, "K"},   {0x039B, "L"},   {0x039C, "M"},
+    {0x039D, "N"},   {0x039E, "X"},   {0x039F, "O"},   {0x03A0, "P"},
+    {0x03A1, "R"},   {0x03A3, "S"},   {0x03A4, "T"},   {0x03A5, "Y"},
+    {0x03A6, "F"},   {0x03A7, "CH"},  {0x03A8, "PS"},  {0x03A9, "O"},
+    {0x03AA, "I"},   {0x03AB, "Y"},   {0x03B0, "Y"},
+    // Cyrillic (Russian, Ukrainian, Belarusian, Serbian, Macedonian)
+    {0x0400, "E"},   {0x0401, "E"},   {0x0402, "DJ"},  {0x0403, "G"},
+    {0x0404, "YE"},  {0x0405, "DZ"},  {0x0406, "I"},   {0x0407, "YI"},
+    {0x0408, "J"},   {0x0409, "LJ"},  {0x040A, "NJ"},  {0x040B, "C"},
+    {0x040C, "K"},   {0x040D, "I"},   {0x040E, "U"},   {0x040F, "DZ"},
+    {0x0410, "A"},   {0x0411, "B"},   {0x0412, "V"},   {0x0413, "G"},
+    {0x0414, "D"},   {0x0415, "E"},   {0x0416, "ZH"},  {0x0417, "Z"},
+    {0x0418, "I"},   {0x0419, "Y"},   {0x041A, "K"},   {0x041B, "L"},
+    {0x041C, "M"},   {0x041D, "N"},   {0x041E, "O"},   {0x041F, "P"},
+    {0x0420, "R"},   {0x0421, "S"},   {0x0422, "T"},   {0x0423, "U"},
+    {0x0424, "F"},   {0x0425, "H"},   {0x0426, "TS"},  {0x0427, "CH"},
+    {0x0428, "SH"},  {0x0429, "SCH"}, {0x042A, ""},    {0x042B, "Y"},
+    {0x042C, ""},    {0x042D, "E"},   {0x042E, "YU"},  {0x042F, "YA"},
+    {0x0490, "G"},
+    // General punctuation
+    {0x2013, "-"},   {0x2014, "-"},   {0x2018, "'"},   {0x2019, "'"},
+    {0x201C, "\""},  {0x201D, "\""},  {0x2026, "."},
+};
+
+// Map lower-case letters of the covered scripts onto their upper-case form
+static uint32_t fold_case(uint32_t cp)
+{
+    if (cp >= 0x00E0 && cp <= 0x00FE && cp != 0x00F7) return cp - 0x20;
+    if (cp == 0x00FF) return 0x0178;
+    if (cp >= 0x03AC && cp <= 0x03AF) {
+        static const uint16_t tonos[4] = {0x0386, 0x0388, 0x0389, 0x038A};
+        return tonos[cp - 0x03AC];
+    }
+    if (cp == 0x03C2) return 0x03A3;                      // final sigma
+    if (cp >= 0x03B1 && cp <= 0x03CB) return cp - 0x20;
+    if (cp == 0x03CC) return 0x038C;
+    if (cp == 0x03CD) return 0x038E;
+    if (cp == 0x03CE) return 0x038F;
+    if (cp >= 0x0430 && cp <= 0x044F) return cp - 0x20;
+    if (cp >= 0x0450 && cp <= 0x045F) return cp - 0x50;
+    if (cp == 0x0491) return 0x0490;
+    return cp;
+}
+
+static const char *translit(uint32_t cp)
+{
+    cp = fold_case(cp);
+    size_t lo = 0, hi = sizeof(s_translit) / sizeof(s_translit[0]);
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (s_translit[mid].cp == cp) return s_translit[mid].lat;
+        if (s_translit[mid].cp < cp) lo = mid + 1; else hi = mid;
+    }
+    return NULL;
+}
+
+// --- Morse code tables ---
+
+// ASCII 0x20-0x5F (upper case); NULL = not sendable
+static const char *const s_morse_ascii[64] = {
+    ['!' - 0x20] = "-.-.--", ['"' - 0x20] = ".-..-.", ['$' - 0x20] = "...-..-",
+    ['&' - 0x20] = ".-...",  ['\'' - 0x20] = ".----.", ['(' - 0x20] = "-.--.",
+    [')' - 0x20] = "-.--.-", ['+' - 0x20] = ".-.-.",  [',' - 0x20] = "--..--",
+    ['-' - 0x20] = "-....-", ['.' - 0x20] = ".-.-.-", ['/' - 0x20] = "-..-.",
+    ['0' - 0x20] = "-----",  ['1' - 0x20] = ".----",  ['2' - 0x20] = "..---",
+    ['3' - 0x20] = "...--",  ['4' - 0x20] = "....-",  ['5' - 0x20] = ".....",
+    ['6' - 0x20] = "-....",  ['7' - 0x20] = "--...",  ['8' - 0x20] = "---..",
+    ['9' - 0x20] = "----.",  [':' - 0x20] = "---...", [';' - 0x20] = "-.-.-.",
+    ['=' - 0x20] = "-...-",  ['?' - 0x20] = "..--..", ['@' - 0x20] = ".--.-.",
+    ['A' - 0x20] = ".-",     ['B' - 0x20] = "-...",   ['C' - 0x20] = "-.-.",
+    ['D' - 0x20] = "-..",    ['E' - 0x20] = ".",      ['F' - 0x20] = "..-.",
+    ['G' - 0x20] = "--.",    ['H' - 0x20] = "....",   ['I' - 0x20] = "..",
+    ['J' - 0x20] = ".---",   ['K' - 0x20] = "-.-",    ['L' - 0x20] = ".-..",
+    ['M' - 0x20] = "--",     ['N' - 0x20] = "-.",     ['O' - 0x20] = "---",
+    ['P' - 0x20] = ".--.",   ['Q' - 0x20] = "--.-",   ['R' - 0x20] = ".-.",
+    ['S' - 0x20] = "...",    ['T' - 0x20] = "-",      ['U' - 0x20] = "..-",
+    ['V' - 0x20] = "...-",   ['W' - 0x20] = ".--",    ['X' - 0x20] = "-..-",
+    ['Y' - 0x20] = "-.--",   ['Z' - 0x20] = "--..",   ['_' - 0x20] = "..--.-",
+};
+
+// Prosigns: letters run together without the inter-character gap
+static const struct { const char *name; const char *code; } s_prosigns[] = {
+    {"AR", ".-.-."},  {"AS", ".-..."},   {"BT", "-...-"}, {"CT", "-.-.-"},
+    {"HH", "........"}, {"KN", "-.--."}, {"SK", "...-.-"}, {"SOS", "...---..."},
+};
+
+static const char *morse_encode(char c)
+{
+    if (c < 0x20 || c > 0x5F) return NULL;
+    return s_morse_ascii[c - 0x20];
+}
+
+// --- String source ---
+
+int morse_str_read(void *ctx)
+{
+    morse_str_src_t *s = ctx;
+    uint8_t c = (uint8_t)s->text[s->pos];
+    if (c == 0) return -1;
+    s->pos++;
+    return c;
+}
+
+// --- Input pipeline: bytes → code points → upper-case ASCII ---
+
+static int src_byte(morse_enc_t *e)
+{
+    if (e->peek != -2) {
+        int b = e->peek;
+        e->peek = -2;
+        return b;
+    }
+    return e->src.read(e->src.ctx);
+}
+
+// Decode one UTF-8 code point; malformed sequences yield U+FFFD
+static int32_t utf8_next(morse_enc_t *e)
+{
+    int b = src_byte(e);
+    if (b < 0x80) return b;  // ASCII or -1 (end)
+
+    int     extra;
+    int32_t cp;
+    if      ((b & 0xE0) == 0xC0) { extra = 1; cp = b & 0x1F; }
+    else if ((b & 0xF0) == 0xE0) { extra = 2; cp = b & 0x0F; }
+    else if ((b & 0xF8) == 0xF0) { extra = 3; cp = b & 0x07; }
+    else return 0xFFFD;  // stray continuation byte
+
+    while (extra--) {
+        b = src_byte(e);
+        if (b < 0) return -1;
+        if ((b & 0xC0) != 0x80) {
+            e->peek = (int16_t)b;  // not ours: re-read it as a new sequence
+            return 0xFFFD;
+        }
+        cp = (cp << 6) | (b & 0x3F);
+    }
+    return cp;
+}
+
+static void queue_push_front(morse_enc_t *e, const char *s, size_t n)
+{
+    if (n > sizeof(e->queue) - e->q_len) n = sizeof(e->queue) - e->q_len;
+    memmove(e->queue + n, e->queue, e->q_len);
+    memcpy(e->queue, s, n);
+    e->q_len += n;
+}
+
+// Next upper-case ASCII character (whitespace folded to ' '), or -1 at end
+static int next_char(morse_enc_t *e)
+{
+    while (e->q_len == 0) {
+        int32_t cp = utf8_next(e);
+        if (cp < 0) return -1;
+        if (cp < 0x80) {
+            if (cp == '\t' || cp == '\n' || cp == '\r') cp = ' ';
+            if (cp < 0x20 || cp == 0x7F) continue;
+            if (cp >= 'a' && cp <= 'z') cp -= 32;
+            e->queue[e->q_len++] = (char)cp;
+        } else {
+            const char *tr = translit((uint32_t)cp);
+            if (tr) queue_push_front(e, tr, strlen(tr));
+        }
+    }
+    char c = e->queue[0];
+    memmove(e->queue, e->queue + 1, --e->q_len);
+    return (uint8_t)c;
+}
+
+// After '<': collect up to 3 letters and '>'. Returns the prosign code, or
+// NULL after pushing the collected characters back for literal encoding.
+static const char *read_prosign(morse_enc_t *e)
+{
+    char buf[5];
+    size_t n = 0;
+    while (n < sizeof(buf)) {
+        int c = next_char(e);
+        if (c < 0) break;
+        buf[n++] = (char)c;
+        if (c == '>') {
+            for (size_t i = 0; i < sizeof(s_prosigns) / sizeof(s_prosigns[0]); i++) {
+                size_t len = strlen(s_prosigns[i].name);
+                if (len == n - 1 && memcmp(buf, s_prosigns[i].name, len) == 0)
+                    return s_prosigns[i].code;
+            }
+            break;
+        }
+        if (c < 'A' || c > 'Z') break;
+    }
+    queue_push_front(e, buf, n);
+    return NULL;
+}
+
+// --- Encoder ---
+
+enum {
+    PHASE_START = 0,   // leading silence
+    PHASE_CHAR,        // fetch the next character
+    PHASE_ELEM,        // send one dot or dash
+    PHASE_SYM_GAP,     // gap between elements of a character
+    PHASE_CHAR_GAP,    // gap after a character
+};
+
+void morse_enc_init(morse_enc_t *enc, const morse_source_t *src, const morse_cfg_t *cfg)
+{
+    memset(enc, 0, sizeof(*enc));
+    enc->src  = *src;
+    enc->peek = -2;
+
+    // Derive actual on/off durations from decoder thresholds (with margin):
+    //   dot  = 60% T1       → safely below T1 (dot/dash boundary)
+    //   dash = 250% T1      → comfortably above T1
+    //   sym  = 40% T2       → safely below T2 (sym/letter boundary)
+    //   char = mid(T2, T3)  → falls in the letter-gap zone (T2 < char ≤ T3)
+    //   word = char × 7/3   → standard Morse 7:3 ratio; adaptive decoders
+    //                          cluster gaps by ratio, so ~2.3× char is needed
+    enc->dot_ms      = (uint32_t)cfg->t1_ms * 6 / 10;
+    enc->dash_ms     = (uint32_t)cfg->t1_ms * 5 / 2;
+    enc->sym_gap_ms  = (uint32_t)cfg->t2_ms * 4 / 10;
+    enc->char_gap_ms = ((uint32_t)cfg->t2_ms + cfg->t3_ms) / 2;
+    enc->word_gap_ms = enc->char_gap_ms * 7 / 3;
+}
+
+bool morse_enc_next(morse_enc_t *e, morse_seg_t *seg)
+{
+    for (;;) {
+        switch (e->phase) {
+        case PHASE_START:
+            // Initial silence so the decoder establishes a clear baseline
+            e->phase = PHASE_CHAR;
+            seg->on = false;
+            seg->ms = e->char_gap_ms;
+            return true;
+
+        case PHASE_CHAR: {
+            int c = next_char(e);
+            if (c < 0) return false;
+            if (c == ' ') {
+                e->word_gap_due = true;  // runs of whitespace collapse to one gap
+                continue;
+            }
+            const char *code = (c == '<') ? read_prosign(e) : morse_encode((char)c);
+            if (!code) continue;
+            e->code     = code;
+            e->code_pos = 0;
+            e->phase    = PHASE_ELEM;
+            if (e->word_gap_due) {
+                e->word_gap_due = false;
+                // char_gap was already sent after the previous character;
+                // add only the extra silence to reach word_gap total.
+                if (e->word_gap_ms > e->char_gap_ms) {
+                    seg->on = false;
+                    seg->ms = e->word_gap_ms - e->char_gap_ms;
+                    return true;
+                }
+            }
+            continue;
+        }
+
+        case PHASE_ELEM:
+            seg->on = true;
+            seg->ms = (e->code[e->code_pos++] == '.') ? e->dot_ms : e->dash_ms;
+            e->phase = e->code[e->code_pos] ? PHASE_SYM_GAP : PHASE_CHAR_GAP;
+            return true;
+
+        case PHASE_SYM_GAP:
+            e->phase = PHASE_ELEM;
+            seg->on = false;
+            seg->ms = e->sym_gap_ms;
+            return true;
+
+        case PHASE_CHAR_GAP:
+        default:
+            e->phase = PHASE_CHAR;
+            seg->on = false;
+            seg->ms = e->char_gap_ms;
+            return true;
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Morse decoder thresholds — mirror the three sliders in "Flash Morse Code" app.
+// Firmware derives actual on/off durations automatically with comfortable margins:
+//   dot  = 60% T1,  dash = 250% T1
+//   sym  = 40% T2,  char = midpoint(T2,T3),  word = char × 7/3
+typedef struct {
+    uint16_t t1_ms;  // Dot/Dash threshold:    signal ≤ t1 → dot,  > t1 → dash
+    uint16_t t2_ms;  // Sym/Letter threshold:  gap    ≤ t2 → sym,  (t2..t3] → char
+    uint16_t t3_ms;  // Letter/Word threshold: gap    > t3 → word
+} morse_cfg_t;
+
+// Pull-style text source: read() returns the next byte of UTF-8 text (0-255),
+// or -1 at end of text. The encoder never buffers more than a few bytes, so
+// the text can be any length (RAM string, flash store, ...).
+typedef struct {
+    int  (*read)(void *ctx);
+    void  *ctx;
+} morse_source_t;
+
+// Source over a null-terminated string in RAM
+typedef struct {
+    const char *text;
+    size_t      pos;
+} morse_str_src_t;
+
+int morse_str_read(void *ctx);
+
+// One timeline segment: LED on or off for ms milliseconds
+typedef struct {
+    bool     on;
+    uint32_t ms;
+} morse_seg_t;
+
+// Streaming encoder state — fixed size, independent of text length
+typedef struct {
+    morse_source_t src;
+    int16_t     peek;           // pushed-back source byte (-2 = none)
+    uint32_t    dot_ms, dash_ms, sym_gap_ms, char_gap_ms, word_gap_ms;
+    char        queue[12];      // transliterated ASCII waiting to be encoded
+    uint8_t     q_len;
+    const char *code;           // element pattern being sent ('.' / '-')
+    uint8_t     code_pos;
+    uint8_t     phase;
+    bool        word_gap_due;
+} morse_enc_t;
+
+// Prepare an encoder for one pass over src using the given decoder thresholds.
+void morse_enc_init(morse_enc_t *enc, const morse_source_t *src, const morse_cfg_t *cfg);
+
+// Produce the next on/off segment. Returns false when the text is exhausted.
+// Input is UTF-8: Latin-1, Cyrillic and Greek letters are transliterated to
+// Latin, ASCII punctuation is sent as ITU punctuation, and prosigns can be
+// embedded as <AR>, <SK>, <BT>, <KN>, <AS>, <CT>, <HH> or <SOS>.
+bool morse_enc_next(morse_enc_t *enc, morse_seg_t *seg);
@@ -0,0 +1,136 @@
+#include "morse_store.h"
+#include <string.h>
+#include "esp_log.h"
+#include "esp_partition.h"
+
+#define TAG "MORSE_STORE"
+
+#define STORE_PART_LABEL  "morse"
+#define STORE_MAGIC       0x4D4F5253UL  // "MORS"
+#define STORE_DATA_OFFSET 16            // header {magic, len} padded to 16 bytes
+
+typedef struct {
+    uint32_t magic;
+    uint32_t len;
+} store_hdr_t;
+
+static const esp_partition_t *s_part     = NULL;
+static bool                   s_loaded   = false;
+static uint32_t               s_len      = 0;      // committed message length
+static uint32_t               s_wr_len   = 0;      // upload: expected length
+static uint32_t               s_wr_pos   = 0;      // upload: bytes written
+static volatile uint32_t      s_gen      = 0;      // bumped on every rewrite
+
+static const esp_partition_t *store_part(void)
+{
+    if (!s_part) {
+        s_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                          ESP_PARTITION_SUBTYPE_ANY, STORE_PART_LABEL);
+        if (!s_part) ESP_LOGE(TAG, "Partition '%s' not found", STORE_PART_LABEL);
+    }
+    return s_part;
+}
+
+// Read the header once; an incomplete upload has no magic and reads as empty
+static void store_load(void)
+{
+    if (s_loaded) return;
+    s_loaded = true;
+    const esp_partition_t *p = store_part();
+    if (!p) return;
+    store_hdr_t hdr;
+    if (esp_partition_read(p, 0, &hdr, sizeof(hdr)) == ESP_OK &&
+        hdr.magic == STORE_MAGIC && hdr.len <= p->size - STORE_DATA_OFFSET)
+        s_len = hdr.len;
+}
+
+size_t morse_store_capacity(void)
+{
+    const esp_partition_t *p = store_part();
+    return p ? p->size - STORE_DATA_OFFSET : 0;
+}
+
+size_t morse_store_length(void)
+{
+    store_load();
+    return s_len;
+}
+
+esp_err_t morse_store_begin(size_t len)
+{
+    const esp_partition_t *p = store_part();
+    if (!p) return ESP_ERR_NOT_FOUND;
+    if (len > p->size - STORE_DATA_OFFSET) return ESP_ERR_INVALID_SIZE;
+
+    s_loaded = true;
+    s_len    = 0;
+    s_gen++;  // stop any reader still walking the old message
+
+    // Erase only the sectors the new message needs (header included)
+    size_t erase = (STORE_DATA_OFFSET + len + p->erase_size - 1)
+                   / p->erase_size * p->erase_size;
+    esp_err_t ret = esp_partition_erase_range(p, 0, erase);
+    if (ret != ESP_OK) return ret;
+
+    s_wr_len = len;
+    s_wr_pos = 0;
+    return ESP_OK;
+}
+
+esp_err_t morse_store_append(const void *data, size_t len)
+{
+    const esp_partition_t *p = store_part();
+    if (!p) return ESP_ERR_NOT_FOUND;
+    if (s_wr_pos + len > s_wr_len) return ESP_ERR_INVALID_SIZE;
+    esp_err_t ret = esp_partition_write(p, STORE_DATA_OFFSET + s_wr_pos, data, len);
+    if (ret == ESP_OK) s_wr_pos += len;
+    return ret;
+}
+
+esp_err_t morse_store_finish(void)
+{
+    const esp_partition_t *p = store_part();
+    if (!p) return ESP_ERR_NOT_FOUND;
+    if (s_wr_pos != s_wr_len) return ESP_ERR_INVALID_STATE;
+
+    // Header written last: a power loss mid-upload leaves an empty store
+    store_hdr_t hdr = { .magic = STORE_MAGIC, .len = s_wr_len };
+    esp_err_t ret = esp_partition_write(p, 0, &hdr, sizeof(hdr));
+    if (ret != ESP_OK) return ret;
+    s_len = s_wr_len;
+    ESP_LOGI(TAG, "Stored %lu-byte message", (unsigned long)s_len);
+    return ESP_OK;
+}
+
+esp_err_t morse_store_clear(void)
+{
+    const esp_partition_t *p = store_part();
+    if (!p) return ESP_ERR_NOT_FOUND;
+    s_loaded = true;
+    s_len    = 0;
+    s_gen++;
+    return esp_partition_erase_range(p, 0, p->erase_size);
+}
+
+void morse_store_reader_init(morse_store_reader_t *r)
+{
+    memset(r, 0, sizeof(*r));
+    r->len = morse_store_length();
+    r->gen = s_gen;
+}
+
+int morse_store_read(void *ctx)
+{
+    morse_store_reader_t *r = ctx;
+    if (r->buf_pos >= r->buf_len) {
+        if (r->pos >= r->len || r->gen != s_gen || !s_part) return -1;
+        uint32_t n = r->len - r->pos;
+        if (n > sizeof(r->buf)) n = sizeof(r->buf);
+        if (esp_partition_read(s_part, STORE_DATA_OFFSET + r->pos, r->buf, n) != ESP_OK)
+            return -1;
+        r->pos    += n;
+        r->buf_len = (uint8_t)n;
+        r->buf_pos = 0;
+    }
+    return r->buf[r->buf_pos++];
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Long Morse message kept in the dedicated "morse" flash partition, so text
+// far beyond BLE_MAX_VALUE_LEN can be transmitted without holding it in RAM.
+
+// Start a new upload of len bytes; erases the old message.
+esp_err_t morse_store_begin(size_t len);
+
+// Append the next chunk of the upload
+esp_err_t morse_store_append(const void *data, size_t len);
+
+// Commit the upload; the message becomes readable only after this succeeds.
+esp_err_t morse_store_finish(void);
+
+// Remove the stored message
+esp_err_t morse_store_clear(void);
+
+// Length of the committed message in bytes (0 if none)
+size_t morse_store_length(void);
+
+// Maximum message length the partition can hold
+size_t morse_store_capacity(void);
+
+// Sequential reader with a small flash read-ahead buffer
+typedef struct {
+    uint32_t pos;
+    uint32_t len;
+    uint32_t gen;       // store generation at init; a new upload ends the read
+    uint8_t  buf[32];
+    uint8_t  buf_len;
+    uint8_t  buf_pos;
+} morse_store_reader_t;
+
+void morse_store_reader_init(morse_store_reader_t *r);
+
+// morse_source_t read callback: next byte or -1 at end (ctx = reader)
+int morse_store_read(void *ctx);
@@ -1,4 +1,6 @@
 #include "ntp_sync.h"
+#include <stdlib.h>
+#include <time.h>
 #include "web_server.h"
 #include "config.h"
 #include "esp_log.h"
@@ -6,19 +8,34 @@
 
 #define TAG "NTP_SYNC"
 
+static volatile bool    s_synced    = false;
+static time_change_cb_t s_change_cb = NULL;
+
+// Wall-clock time arrived from any source
+static void time_synced(const char *source)
+{
+    if (!s_synced) {
+        s_synced = true;
+        web_log_boot();  // rebase boot-relative log entries, log actual boot time
+    }
+    ESP_LOGI(TAG, "Time synchronized (%s)", source);
+    if (s_change_cb) s_change_cb();
+}
+
 static void ntp_sync_cb(struct timeval *tv)
 {
     (void)tv;
-    web_log_boot();  // log actual boot time now that wall-clock is known
-    ESP_LOGI(TAG, "Time synchronized");
+    time_synced("NTP");
 }
 
-void ntp_sync_start(void)
+void ntp_sync_init(void)
 {
-    // Set local timezone before starting sync
     setenv("TZ", TIMEZONE, 1);
     tzset();
+}
 
+void ntp_sync_start(void)
+{
     esp_sntp_config_t config = ESP_NETIF_SNTP_DEFAULT_CONFIG(NTP_SERVER);
     config.sync_cb = ntp_sync_cb;
     esp_netif_sntp_init(&config);
@@ -26,3 +43,24 @@ void ntp_sync_start(void)
     ESP_LOGI(TAG, "NTP sync started, server: %s, timezone: %s (zip: %s)",
              NTP_SERVER, TIMEZONE, ZIP_CODE);
 }
+
+void ntp_sync_set_time(const struct timeval *tv, const char *source)
+{
+    struct timeval old;
+    gettimeofday(&old, NULL);
+    settimeofday(tv, NULL);
+    if (s_synced)
+        ESP_LOGI(TAG, "Clock corrected by %lld ms",
+                 (long long)(tv->tv_sec - old.tv_sec) * 1000 + (tv->tv_usec - old.tv_usec) / 1000);
+    time_synced(source);
+}
+
+bool ntp_sync_is_synced(void)
+{
+    return s_synced;
+}
+
+void ntp_sync_set_change_cb(time_change_cb_t cb)
+{
+    s_change_cb = cb;
+}
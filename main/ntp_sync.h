@@ -1,4 +1,21 @@
 #pragma once
 
+#include <stdbool.h>
+#include <sys/time.h>
+
+// Called after the wall clock was set or corrected (NTP or a BLE central)
+typedef void (*time_change_cb_t)(void);
+
+// Apply TIMEZONE; call once at boot so local time works without WiFi
+void ntp_sync_init(void);
+
 // Start SNTP time synchronization (non-blocking, runs in background)
 void ntp_sync_start(void);
+
+// Set the clock from another source (e.g. BLE Current Time Service)
+void ntp_sync_set_time(const struct timeval *tv, const char *source);
+
+// True once any source has set the wall clock
+bool ntp_sync_is_synced(void);
+
+void ntp_sync_set_change_cb(time_change_cb_t cb);
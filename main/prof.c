@@ -0,0 +1,83 @@
+#include "prof.h"
+
+#if PROF_ENABLED
+
+#include <string.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static prof_stats_t  s_stats;
+static portMUX_TYPE  s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Event being handled, so NVS and mutex costs are charged to it. Host
+// events are handled one at a time on a single task.
+static TaskHandle_t  s_evt_task;
+static int           s_evt_cur = -1;
+
+static void stat_add(uint32_t *count, uint32_t *total, int64_t us)
+{
+    (*count)++;
+    *total += (uint32_t)us;
+}
+
+int64_t prof_evt_begin(prof_evt_t evt)
+{
+    s_evt_task = xTaskGetCurrentTaskHandle();
+    s_evt_cur  = evt;
+    return esp_timer_get_time();
+}
+
+void prof_evt_end(prof_evt_t evt, int64_t start_us)
+{
+    uint32_t us = (uint32_t)(esp_timer_get_time() - start_us);
+    s_evt_cur = -1;
+    portENTER_CRITICAL(&s_lock);
+    prof_stat_t *st[2] = { &s_stats.evt[evt], &s_stats.total };
+    for (int i = 0; i < 2; i++) {
+        stat_add(&st[i]->count, &st[i]->total_us, us);
+        if (us > st[i]->max_us) st[i]->max_us = us;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+// Charge to the running event if called from its task, and to the total
+static prof_stat_t *evt_stat(void)
+{
+    if (s_evt_cur < 0 || xTaskGetCurrentTaskHandle() != s_evt_task) return NULL;
+    return &s_stats.evt[s_evt_cur];
+}
+
+void prof_nvs(int64_t us)
+{
+    portENTER_CRITICAL(&s_lock);
+    prof_stat_t *st = evt_stat();
+    if (st) stat_add(&st->nvs_writes, &st->nvs_us, us);
+    stat_add(&s_stats.total.nvs_writes, &s_stats.total.nvs_us, us);
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void prof_lock_wait(int64_t us)
+{
+    portENTER_CRITICAL(&s_lock);
+    prof_stat_t *st = evt_stat();
+    if (st) stat_add(&st->lock_waits, &st->lock_wait_us, us);
+    stat_add(&s_stats.total.lock_waits, &s_stats.total.lock_wait_us, us);
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void prof_get(prof_stats_t *out)
+{
+    portENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void prof_reset(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    memset(&s_stats, 0, sizeof(s_stats));
+    portEXIT_CRITICAL(&s_lock);
+}
+
+#endif
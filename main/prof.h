@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "config.h"
+
+// BLE host events, grouped by what the handler does
+typedef enum {
+    PROF_EVT_CONNECT,
+    PROF_EVT_DISCONNECT,
+    PROF_EVT_READ,
+    PROF_EVT_WRITE,             // includes prepare / execute write
+    PROF_EVT_OTHER_GATT,
+    PROF_EVT_GAP,               // advertising, link and security events
+    PROF_EVT_COUNT,
+} prof_evt_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t total_us;          // handler time, including the waits below
+    uint32_t max_us;
+    uint32_t nvs_writes;        // NVS commits made inside the handler
+    uint32_t nvs_us;
+    uint32_t lock_waits;        // LED mutex acquisitions that had to wait
+    uint32_t lock_wait_us;
+} prof_stat_t;
+
+typedef struct {
+    prof_stat_t evt[PROF_EVT_COUNT];
+    prof_stat_t total;          // all tasks, inside and outside BLE handlers
+} prof_stats_t;
+
+#if PROF_ENABLED
+
+// Bracket one host event handler; returns the start time for prof_evt_end()
+int64_t prof_evt_begin(prof_evt_t evt);
+void    prof_evt_end(prof_evt_t evt, int64_t start_us);
+
+// Report an NVS commit / a contended mutex acquisition and its duration
+void prof_nvs(int64_t us);
+void prof_lock_wait(int64_t us);
+
+void prof_get(prof_stats_t *out);
+void prof_reset(void);
+
+#else
+
+static inline int64_t prof_evt_begin(prof_evt_t evt) { return 0; }
+static inline void    prof_evt_end(prof_evt_t evt, int64_t start_us) {}
+static inline void    prof_nvs(int64_t us) {}
+static inline void    prof_lock_wait(int64_t us) {}
+static inline void    prof_get(prof_stats_t *out) { *out = (prof_stats_t){0}; }
+static inline void    prof_reset(void) {}
+
+#endif
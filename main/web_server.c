@@ -1,6 +1,14 @@
 #include "web_server.h"
 #include "ble_server.h"
+#include "ble_clients.h"
+#include "ble_link.h"
+#include "ble_stream.h"
 #include "led_controller.h"
+#include "morse_store.h"
+#include "prof.h"
+#include "wifi_fast.h"
+#include "wifi_reconnect.h"
+#include "wifi_store.h"
 #include "config.h"
 #include <string.h>
 #include <stdio.h>
@@ -33,10 +41,6 @@ static web_wifi_reset_cb_t s_wifi_reset_cb = NULL;
 
 // --- Storage ---
 
-// Known device addresses table
-static uint8_t  device_addrs[LOG_MAX_DEVICES][6];
-static uint8_t  device_count = 0;
-
 // Known characteristic UUIDs table
 static uint16_t char_uuids[LOG_MAX_CHARS];
 static uint8_t  char_count = 0;
@@ -45,6 +49,7 @@ static uint8_t  char_count = 0;
 static log_entry_t log_entries[LOG_MAX_ENTRIES];
 static uint16_t    log_head  = 0;   // Index of oldest entry
 static uint16_t    log_count = 0;   // Number of valid entries
+static uint32_t    log_first_seq = 0; // Sequence number of the oldest entry
 
 // Pool for READ/WRITE string data
 static char     data_pool[LOG_DATA_POOL_SIZE];
@@ -89,20 +94,13 @@ static void cfg_save_u8(const char *key, uint8_t val)
 
 // --- Internal helpers (caller must hold log_mutex) ---
 
-// Find or register a device address, return its index
-static uint8_t get_device_idx(const uint8_t *bd_addr)
+// Client registry slot of a device address (0xFE = registry full, shown as unknown)
+static uint8_t get_device_idx(const uint8_t *bd_addr, uint8_t *gen)
 {
+    *gen = 0;
     if (!bd_addr) return 0xFF;
-
-    for (uint8_t i = 0; i < device_count; i++) {
-        if (memcmp(device_addrs[i], bd_addr, 6) == 0)
-            return i;
-    }
-    if (device_count < LOG_MAX_DEVICES) {
-        memcpy(device_addrs[device_count], bd_addr, 6);
-        return device_count++;
-    }
-    return 0xFF; // Table full
+    int slot = ble_clients_slot(bd_addr, gen);
+    return slot < 0 ? 0xFE : (uint8_t)slot;
 }
 
 // Store a string in data pool, return its offset (0xFFFF if no data)
@@ -137,26 +135,35 @@ static uint8_t find_or_add_char(uint16_t uuid)
     return 0xFF;
 }
 
-// Add a log entry to ring buffer; skipped if logging is disabled
-static void log_add(uint8_t device_idx, ble_event_type_t event,
-                    uint8_t char_idx, uint16_t data_offset)
+// Claim the slot for a new entry, overwriting the oldest one when full
+static uint16_t log_slot(void)
 {
-    if (!s_log_enabled) return;
-
     uint16_t idx = (log_head + log_count) % LOG_MAX_ENTRIES;
 
     if (log_count >= LOG_MAX_ENTRIES) {
         // Buffer full - overwrite oldest entry
         log_head = (log_head + 1) % LOG_MAX_ENTRIES;
+        log_first_seq++;
     } else {
         log_count++;
     }
+    return idx;
+}
+
+// Add a log entry to ring buffer; skipped if logging is disabled
+static void log_add(uint8_t device_idx, uint8_t device_gen, ble_event_type_t event,
+                    uint8_t char_idx, uint16_t data_offset)
+{
+    if (!s_log_enabled) return;
+
+    uint16_t idx = log_slot();
 
     time_t now;
     time(&now);
 
     log_entries[idx].timestamp   = (uint32_t)now;
     log_entries[idx].device_idx  = device_idx;
+    log_entries[idx].device_gen  = device_gen;
     log_entries[idx].event_type  = (uint8_t)event;
     log_entries[idx].char_idx    = char_idx;
     log_entries[idx].data_offset = data_offset;
@@ -180,6 +187,24 @@ void web_set_wifi_reset_cb(web_wifi_reset_cb_t cb)
     s_wifi_reset_cb = cb;
 }
 
+int web_json_escape(const char *src, char *dst, size_t dst_len)
+{
+    size_t pos = 0;
+    while (*src && pos < dst_len - 1) {
+        if (*src == '"' || *src == '\\') {
+            if (pos + 2 > dst_len - 1) break;
+            dst[pos++] = '\\';
+            dst[pos++] = *src++;
+        } else if ((unsigned char)*src < 0x20) {
+            src++; // drop control characters
+        } else {
+            dst[pos++] = *src++;
+        }
+    }
+    dst[pos] = '\0';
+    return (int)pos;
+}
+
 uint8_t web_log_register_char(uint16_t uuid)
 {
     if (xSemaphoreTake(log_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return 0xFF;
@@ -191,36 +216,40 @@ uint8_t web_log_register_char(uint16_t uuid)
 void web_log_connect(const uint8_t *bd_addr)
 {
     if (xSemaphoreTake(log_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
-    uint8_t didx = get_device_idx(bd_addr);
-    log_add(didx, BLE_EVT_CONNECT, 0xFF, 0xFFFF);
+    uint8_t dgen;
+    uint8_t didx = get_device_idx(bd_addr, &dgen);
+    log_add(didx, dgen, BLE_EVT_CONNECT, 0xFF, 0xFFFF);
     xSemaphoreGive(log_mutex);
 }
 
 void web_log_disconnect(const uint8_t *bd_addr)
 {
     if (xSemaphoreTake(log_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
-    uint8_t didx = get_device_idx(bd_addr);
-    log_add(didx, BLE_EVT_DISCONNECT, 0xFF, 0xFFFF);
+    uint8_t dgen;
+    uint8_t didx = get_device_idx(bd_addr, &dgen);
+    log_add(didx, dgen, BLE_EVT_DISCONNECT, 0xFF, 0xFFFF);
     xSemaphoreGive(log_mutex);
 }
 
 void web_log_read(const uint8_t *bd_addr, uint16_t char_uuid, const char *value)
 {
     if (xSemaphoreTake(log_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
-    uint8_t  didx = get_device_idx(bd_addr);
+    uint8_t  dgen;
+    uint8_t  didx = get_device_idx(bd_addr, &dgen);
     uint8_t  cidx = find_or_add_char(char_uuid);
     uint16_t doff = store_data(value);
-    log_add(didx, BLE_EVT_READ, cidx, doff);
+    log_add(didx, dgen, BLE_EVT_READ, cidx, doff);
     xSemaphoreGive(log_mutex);
 }
 
 void web_log_write(const uint8_t *bd_addr, uint16_t char_uuid, const char *value)
 {
     if (xSemaphoreTake(log_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
-    uint8_t  didx = get_device_idx(bd_addr);
+    uint8_t  dgen;
+    uint8_t  didx = get_device_idx(bd_addr, &dgen);
     uint8_t  cidx = find_or_add_char(char_uuid);
     uint16_t doff = store_data(value);
-    log_add(didx, BLE_EVT_WRITE, cidx, doff);
+    log_add(didx, dgen, BLE_EVT_WRITE, cidx, doff);
     xSemaphoreGive(log_mutex);
 }
 
@@ -230,16 +259,12 @@ static void web_log_action(const char *desc)
     if (xSemaphoreTake(log_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
     uint16_t doff = store_data(desc);
     // Always log web actions regardless of s_log_enabled
-    uint16_t idx = (log_head + log_count) % LOG_MAX_ENTRIES;
-    if (log_count >= LOG_MAX_ENTRIES) {
-        log_head = (log_head + 1) % LOG_MAX_ENTRIES;
-    } else {
-        log_count++;
-    }
+    uint16_t idx = log_slot();
     time_t now;
     time(&now);
     log_entries[idx].timestamp   = (uint32_t)now;
     log_entries[idx].device_idx  = 0xFF;
+    log_entries[idx].device_gen  = 0;
     log_entries[idx].event_type  = WEB_EVT_ACTION;
     log_entries[idx].char_idx    = 0xFF;
     log_entries[idx].data_offset = doff;
@@ -252,21 +277,70 @@ void web_log_boot(void)
     time_t boot_ts = time(NULL) - (time_t)(esp_timer_get_time() / 1000000LL);
 
     if (xSemaphoreTake(log_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
-    uint16_t doff = store_data("Boot");
-    uint16_t idx  = (log_head + log_count) % LOG_MAX_ENTRIES;
-    if (log_count >= LOG_MAX_ENTRIES) {
-        log_head = (log_head + 1) % LOG_MAX_ENTRIES;
-    } else {
-        log_count++;
+    // Entries so far hold seconds since boot: move them onto the wall clock
+    for (uint16_t i = 0; i < log_count; i++) {
+        log_entry_t *e = &log_entries[(log_head + i) % LOG_MAX_ENTRIES];
+        if (e->timestamp < NTP_SYNCED_THRESHOLD)
+            e->timestamp += (uint32_t)boot_ts;
     }
+    uint16_t doff = store_data("Boot");
+    uint16_t idx  = log_slot();
     log_entries[idx].timestamp   = (uint32_t)boot_ts;
     log_entries[idx].device_idx  = 0xFF;
+    log_entries[idx].device_gen  = 0;
     log_entries[idx].event_type  = WEB_EVT_ACTION;
     log_entries[idx].char_idx    = 0xFF;
     log_entries[idx].data_offset = doff;
     xSemaphoreGive(log_mutex);
 }
 
+void web_log_seq_range(uint32_t *first, uint32_t *next)
+{
+    *first = *next = 0;
+    if (xSemaphoreTake(log_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+    *first = log_first_seq;
+    *next  = log_first_seq + log_count;
+    xSemaphoreGive(log_mutex);
+}
+
+size_t web_log_export(uint32_t *seq, uint32_t end, uint8_t *buf, size_t max)
+{
+    if (xSemaphoreTake(log_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return 0;
+    size_t pos = 0;
+    if ((int32_t)(*seq - log_first_seq) < 0)
+        *seq = log_first_seq;           // older entries were overwritten
+    uint32_t last = log_first_seq + log_count;
+    if ((int32_t)(end - last) > 0) end = last;
+
+    while ((int32_t)(end - *seq) > 0) {
+        const log_entry_t *e = &log_entries[(log_head + (*seq - log_first_seq)) % LOG_MAX_ENTRIES];
+        const char *data = "";
+        if (e->data_offset != 0xFFFF && e->data_offset < LOG_DATA_POOL_SIZE)
+            data = data_pool + e->data_offset;
+        size_t dlen = strnlen(data, LOG_EXPORT_MAX_REC - LOG_EXPORT_HDR_LEN);
+        if (pos + LOG_EXPORT_HDR_LEN + dlen > max) break;
+
+        uint8_t  addr[6] = {0};
+        uint16_t uuid    = e->char_idx < char_count ? char_uuids[e->char_idx] : 0;
+        if (e->device_idx != 0xFF)
+            ble_clients_addr(e->device_idx, e->device_gen, addr);
+
+        uint8_t *p = buf + pos;
+        memcpy(p, seq, 4);              // little-endian target
+        memcpy(p + 4, &e->timestamp, 4);
+        p[8] = e->event_type;
+        memcpy(p + 9, addr, 6);
+        p[15] = uuid & 0xFF;
+        p[16] = uuid >> 8;
+        p[17] = (uint8_t)dlen;
+        memcpy(p + LOG_EXPORT_HDR_LEN, data, dlen);
+        pos += LOG_EXPORT_HDR_LEN + dlen;
+        (*seq)++;
+    }
+    xSemaphoreGive(log_mutex);
+    return pos;
+}
+
 // --- HTTP handlers ---
 
 static const char *event_name(uint8_t evt)
@@ -386,7 +460,7 @@ static esp_err_t root_handler(httpd_req_t *req)
         "<div class='lbl'>Current NVS value:</div>"
         "<div class='cur' id='curVal'>...</div>"
         "<div class='lbl'>New value:</div>"
-        "<input class='inp' id='newVal' type='text' maxlength='20' placeholder='enter value...'>"
+        "<input class='inp' id='newVal' type='text' maxlength='512' placeholder='enter value...'>"
         "<button onclick='writeVal()'>Write to NVS</button>"
         "<hr style='border:none;border-top:1px solid var(--bd);margin:12px 0'>"
         "<div class='lbl'>LED Color:</div>"
@@ -434,6 +508,10 @@ static esp_err_t root_handler(httpd_req_t *req)
         " style='flex:1;margin-bottom:0'></div>"
         "<div class='row'><span class='lbl2'></span>"
         "<button onclick='saveMorse()'>Apply</button></div>"
+        "<div class='lbl'>Long Morse message (stored in flash, any length):</div>"
+        "<textarea class='inp' id='mMsg' rows='3' placeholder='leave empty to use NVS value'></textarea>"
+        "<div class='row'><span class='lbl2'></span>"
+        "<button onclick='sendMsg()'>Send Message</button></div>"
         "</div>"
         "<script>"
         "var TT=[['t0','p0'],['t1','p1'],['t2','p2']];"
@@ -564,6 +642,10 @@ static esp_err_t root_handler(httpd_req_t *req)
         "body:'t1='+document.getElementById('mT1').value"
         "+'&t2='+document.getElementById('mT2').value"
         "+'&t3='+document.getElementById('mT3').value});}"
+        "function sendMsg(){"
+        "fetch('/morse/text',{method:'POST',body:document.getElementById('mMsg').value})"
+        ".then(r=>r.json()).then(d=>{if(d.ok&&d.len)setLedActive('btnMorse');"
+        "else if(!d.ok)alert(d.msg);});}"
         "function fState(){"
         "fetch('/state').then(r=>r.json()).then(s=>{"
         "on=s.ble;ln=s.log;"
@@ -696,6 +778,66 @@ static esp_err_t morse_cfg_handler(httpd_req_t *req)
     return httpd_resp_send(req, "{\"ok\":true}", HTTPD_RESP_USE_STRLEN);
 }
 
+// Clear the store and go back to sending the 0xFF01 value
+static void morse_text_drop(void)
+{
+    morse_store_clear();
+    char val[BLE_MAX_VALUE_LEN + 1];
+    ble_get_value(val, sizeof(val));
+    led_ctrl_set_morse_text(val);
+}
+
+// POST /morse/text - body: UTF-8 message of any length up to the flash store size.
+// Streamed straight into the "morse" partition, then transmitted as Morse.
+// An empty body clears the store and returns to sending the 0xFF01 value.
+// The store is erased first, so a failed upload also falls back to the value.
+static esp_err_t morse_text_handler(httpd_req_t *req)
+{
+    size_t total = req->content_len;
+    if (total == 0) {
+        morse_text_drop();
+        web_log_action("Morse msg cleared");
+        httpd_resp_set_type(req, "application/json");
+        return httpd_resp_send(req, "{\"ok\":true,\"len\":0}", HTTPD_RESP_USE_STRLEN);
+    }
+    if (total > morse_store_capacity() || morse_store_begin(total) != ESP_OK) {
+        if (total <= morse_store_capacity())
+            morse_text_drop();      // begin may have erased part of the store
+        httpd_resp_set_type(req, "application/json");
+        return httpd_resp_send(req, "{\"ok\":false,\"msg\":\"Message too long\"}",
+                               HTTPD_RESP_USE_STRLEN);
+    }
+
+    char   chunk[256];
+    size_t received = 0;
+    while (received < total) {
+        int n = httpd_req_recv(req, chunk, sizeof(chunk));
+        if (n == HTTPD_SOCK_ERR_TIMEOUT) continue;
+        if (n <= 0 || morse_store_append(chunk, (size_t)n) != ESP_OK) {
+            morse_text_drop();
+            httpd_resp_send_500(req);
+            return ESP_FAIL;
+        }
+        received += (size_t)n;
+    }
+    if (morse_store_finish() != ESP_OK) {
+        morse_text_drop();
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    led_ctrl_set_morse_stored();
+    led_ctrl_apply_command("morse");
+    char desc[32];
+    snprintf(desc, sizeof(desc), "Morse msg: %u B", (unsigned)total);
+    web_log_action(desc);
+
+    char resp[40];
+    snprintf(resp, sizeof(resp), "{\"ok\":true,\"len\":%u}", (unsigned)total);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, resp, HTTPD_RESP_USE_STRLEN);
+}
+
 // Serve log as JSON array
 static esp_err_t log_handler(httpd_req_t *req)
 {
@@ -738,11 +880,11 @@ static esp_err_t log_handler(httpd_req_t *req)
         format_timestamp(e->timestamp, date_str, sizeof(date_str),
                          time_str, sizeof(time_str));
 
-        char dev_str[20];
+        char    dev_str[20];
+        uint8_t a[6];
         if (e->device_idx == 0xFF) {
             strcpy(dev_str, "Web UI");
-        } else if (e->device_idx < device_count) {
-            uint8_t *a = device_addrs[e->device_idx];
+        } else if (ble_clients_addr(e->device_idx, e->device_gen, a)) {
             snprintf(dev_str, sizeof(dev_str), "%02X:%02X:%02X:%02X:%02X:%02X",
                      a[0], a[1], a[2], a[3], a[4], a[5]);
         } else {
@@ -797,6 +939,157 @@ static esp_err_t state_handler(httpd_req_t *req)
     return httpd_resp_send(req, buf, HTTPD_RESP_USE_STRLEN);
 }
 
+// Return negotiated link parameters as JSON [{addr, phy, dle, itvl_us, latency, timeout_ms, fast, updates}]
+static esp_err_t ble_links_handler(httpd_req_t *req)
+{
+    ble_link_info_t links[BLE_MAX_CONNECTIONS];
+    size_t n = ble_link_snapshot(links, BLE_MAX_CONNECTIONS);
+
+    char buf[160 * BLE_MAX_CONNECTIONS + 4];
+    int pos = 0;
+    buf[pos++] = '[';
+    for (size_t i = 0; i < n; i++) {
+        const ble_link_info_t *l = &links[i];
+        pos += snprintf(buf + pos, sizeof(buf) - pos,
+                        "%s{\"addr\":\"%02X:%02X:%02X:%02X:%02X:%02X\","
+                        "\"phy\":[%u,%u],\"dle\":[%u,%u],\"itvl_us\":%lu,"
+                        "\"latency\":%u,\"timeout_ms\":%u,\"fast\":%s,\"updates\":%lu}",
+                        i > 0 ? "," : "",
+                        l->bda[0], l->bda[1], l->bda[2], l->bda[3], l->bda[4], l->bda[5],
+                        l->tx_phy, l->rx_phy, l->tx_octets, l->rx_octets,
+                        (unsigned long)l->itvl * 1250, l->latency, l->timeout * 10,
+                        l->fast ? "true" : "false", (unsigned long)l->updates);
+    }
+    buf[pos++] = ']';
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, buf, pos);
+}
+
+// Known centrals, most recently seen first
+static esp_err_t clients_handler(httpd_req_t *req)
+{
+    static ble_client_info_t clients[BLE_CLIENTS_MAX];   // httpd runs one handler at a time
+    size_t n = ble_clients_snapshot(clients, BLE_CLIENTS_MAX);
+
+    // Streamed one entry per chunk, like /scan: no buffer sized for the worst case
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr_chunk(req, "[");
+    char item[256];                 // worst case (10-digit counters) is 212 bytes
+    for (size_t i = 0; i < n; i++) {
+        const ble_client_info_t *c = &clients[i];
+        snprintf(item, sizeof(item),
+                 "%s{\"addr\":\"%02X:%02X:%02X:%02X:%02X:%02X\",\"connected\":%s,"
+                 "\"rssi\":%d,\"connects\":%lu,\"reads\":%lu,\"writes\":%lu,"
+                 "\"rx_bytes\":%lu,\"tx_bytes\":%lu,\"last_seen\":%lu,\"conn_time_s\":%lu}",
+                 i > 0 ? "," : "",
+                 c->bda[0], c->bda[1], c->bda[2], c->bda[3], c->bda[4], c->bda[5],
+                 c->connected ? "true" : "false", c->rssi,
+                 (unsigned long)c->connects, (unsigned long)c->reads,
+                 (unsigned long)c->writes, (unsigned long)c->rx_bytes,
+                 (unsigned long)c->tx_bytes, (unsigned long)c->last_seen,
+                 (unsigned long)c->conn_time_s);
+        if (httpd_resp_sendstr_chunk(req, item) != ESP_OK)
+            return ESP_FAIL;
+    }
+    httpd_resp_sendstr_chunk(req, "]");
+    return httpd_resp_sendstr_chunk(req, NULL);
+}
+
+// BLE event handler cost per event type (prof.h)
+static esp_err_t prof_get_handler(httpd_req_t *req)
+{
+    static const char *const names[PROF_EVT_COUNT] = {
+        "connect", "disconnect", "read", "write", "other_gatt", "gap",
+    };
+    prof_stats_t st;
+    prof_get(&st);
+
+    char buf[200 * (PROF_EVT_COUNT + 1) + 32];
+    int pos = snprintf(buf, sizeof(buf), "{\"enabled\":%s", PROF_ENABLED ? "true" : "false");
+    for (int i = 0; i <= PROF_EVT_COUNT; i++) {
+        const prof_stat_t *p = i < PROF_EVT_COUNT ? &st.evt[i] : &st.total;
+        pos += snprintf(buf + pos, sizeof(buf) - pos,
+                        ",\"%s\":{\"count\":%lu,\"avg_us\":%lu,\"max_us\":%lu,"
+                        "\"nvs_writes\":%lu,\"nvs_us\":%lu,\"lock_waits\":%lu,\"lock_wait_us\":%lu}",
+                        i < PROF_EVT_COUNT ? names[i] : "total",
+                        (unsigned long)p->count,
+                        (unsigned long)(p->count ? p->total_us / p->count : 0),
+                        (unsigned long)p->max_us,
+                        (unsigned long)p->nvs_writes, (unsigned long)p->nvs_us,
+                        (unsigned long)p->lock_waits, (unsigned long)p->lock_wait_us);
+    }
+    pos += snprintf(buf + pos, sizeof(buf) - pos, "}");
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, buf, pos);
+}
+
+// POST - zero the profiling counters before a measurement run
+static esp_err_t prof_reset_handler(httpd_req_t *req)
+{
+    prof_reset();
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, "{\"ok\":true}", HTTPD_RESP_USE_STRLEN);
+}
+
+static esp_err_t ble_stream_handler(httpd_req_t *req)
+{
+    ble_stream_stats_t st;
+    ble_stream_get_stats(&st);
+
+    char buf[256];
+    int len = snprintf(buf, sizeof(buf),
+                       "{\"active\":%s,\"conn_id\":%d,\"frames\":%lu,\"applied\":%lu,"
+                       "\"stale\":%lu,\"malformed\":%lu,\"apply_avg_us\":%lu,"
+                       "\"apply_max_us\":%lu,\"fps\":%lu}",
+                       st.active ? "true" : "false", st.active ? st.conn_id : -1,
+                       (unsigned long)st.frames, (unsigned long)st.applied,
+                       (unsigned long)st.stale, (unsigned long)st.malformed,
+                       (unsigned long)st.apply_avg_us, (unsigned long)st.apply_max_us,
+                       (unsigned long)st.fps);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, buf, len);
+}
+
+// GET - station reconnect counters, outage durations and boot timing
+static esp_err_t wifi_stats_handler(httpd_req_t *req)
+{
+    wifi_reconnect_stats_t st;
+    wifi_fast_stats_t      fs;
+    wifi_reconnect_get_stats(&st);
+    wifi_fast_get_stats(&fs);
+
+    char buf[1024];
+    int len = snprintf(buf, sizeof(buf),
+                       "{\"connected\":%s,\"last_reason\":%d,\"attempt\":%d,"
+                       "\"disconnects\":%lu,\"attempts\":%lu,\"recoveries\":%lu,\"roams\":%lu,"
+                       "\"next_retry_ms\":%lu,\"last_outage_ms\":%lu,\"max_outage_ms\":%lu,"
+                       "\"total_outage_ms\":%llu,\"boot\":{\"cached_ap\":%s,\"cached_ap_hit\":%s,"
+                       "\"static_ip\":%s,\"channel\":%d,\"start_ms\":%lu,\"assoc_ms\":%lu,"
+                       "\"ip_ms\":%lu,\"http_ms\":%lu},\"networks\":[",
+                       st.connected ? "true" : "false", st.last_reason, st.attempt,
+                       (unsigned long)st.disconnects, (unsigned long)st.attempts,
+                       (unsigned long)st.recoveries, (unsigned long)st.roams,
+                       (unsigned long)st.next_retry_ms,
+                       (unsigned long)st.last_outage_ms, (unsigned long)st.max_outage_ms,
+                       (unsigned long long)st.total_outage_ms,
+                       fs.hint ? "true" : "false", fs.hint_hit ? "true" : "false",
+                       fs.static_ip ? "true" : "false", fs.channel,
+                       (unsigned long)fs.start_ms, (unsigned long)fs.assoc_ms,
+                       (unsigned long)fs.ip_ms, (unsigned long)fs.http_ms);
+
+    // Known networks; passwords never leave the device
+    wifi_store_net_t net;
+    for (size_t i = 0; wifi_store_get(i, &net); i++) {
+        char ssid[66];
+        web_json_escape(net.ssid, ssid, sizeof(ssid));
+        len += snprintf(buf + len, sizeof(buf) - len, "%s{\"ssid\":\"%s\",\"last_ok_time\":%lu}",
+                        i ? "," : "", ssid, (unsigned long)net.last_ok_time);
+    }
+    len += snprintf(buf + len, sizeof(buf) - len, "]}");
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, buf, len);
+}
+
 // POST body: "1" or "0" - toggle BLE advertising on/off
 static esp_err_t ble_ctrl_handler(httpd_req_t *req)
 {
@@ -863,10 +1156,10 @@ static esp_err_t theme_handler(httpd_req_t *req)
 static esp_err_t clear_handler(httpd_req_t *req)
 {
     if (xSemaphoreTake(log_mutex, pdMS_TO_TICKS(200)) == pdTRUE) {
+        log_first_seq += log_count;     // sequence numbers never repeat
         log_head      = 0;
         log_count     = 0;
         data_pool_pos = 0;
-        device_count  = 0;
         char_count    = 0;
         xSemaphoreGive(log_mutex);
     }
@@ -916,7 +1209,7 @@ void web_server_start(void)
 
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.lru_purge_enable  = true;
-    config.max_uri_handlers  = 15;
+    config.max_uri_handlers  = 24;
     config.stack_size        = 8192;
 
     httpd_handle_t server = NULL;
@@ -930,6 +1223,12 @@ void web_server_start(void)
         { "/log",          HTTP_GET,  log_handler,        NULL },
         { "/state",        HTTP_GET,  state_handler,      NULL },
         { "/value",        HTTP_GET,  value_get_handler,  NULL },
+        { "/ble/links",    HTTP_GET,  ble_links_handler,  NULL },
+        { "/ble/stream",   HTTP_GET,  ble_stream_handler, NULL },
+        { "/clients",      HTTP_GET,  clients_handler,    NULL },
+        { "/prof",         HTTP_GET,  prof_get_handler,   NULL },
+        { "/wifi",         HTTP_GET,  wifi_stats_handler, NULL },
+        { "/prof",         HTTP_POST, prof_reset_handler, NULL },
         { "/manifest.json",HTTP_GET,  manifest_handler,   NULL },
         { "/favicon.svg",  HTTP_GET,  favicon_handler,    NULL },
         { "/ble",          HTTP_POST, ble_ctrl_handler,   NULL },
@@ -941,6 +1240,7 @@ void web_server_start(void)
         { "/led/color",   HTTP_POST, led_color_handler,  NULL },
         { "/led/anim",    HTTP_POST, led_anim_handler,   NULL },
         { "/morse/cfg",   HTTP_POST, morse_cfg_handler,  NULL },
+        { "/morse/text",  HTTP_POST, morse_text_handler, NULL },
     };
     for (int i = 0; i < (int)(sizeof(uris) / sizeof(uris[0])); i++)
         httpd_register_uri_handler(server, &uris[i]);
@@ -2,6 +2,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "config.h"
 
 // BLE event types
@@ -13,12 +14,13 @@ typedef enum {
     WEB_EVT_ACTION     = 4, // Web UI action (LED, value, settings)
 } ble_event_type_t;
 
-// Compact log entry - 9 bytes per record
+// Compact log entry - 10 bytes per record
 // timestamp holds Unix time (seconds) when NTP is synced,
 // or seconds since boot otherwise (distinguishable: boot values < Jan 1 2020)
 typedef struct __attribute__((packed)) {
     uint32_t timestamp;     // Unix time if synced, seconds since boot otherwise
-    uint8_t  device_idx;    // Index into device address table (0xFF = unknown)
+    uint8_t  device_idx;    // Client registry slot (0xFF = web UI / none)
+    uint8_t  device_gen;    // Slot generation; a mismatch means the client was evicted
     uint8_t  event_type;    // ble_event_type_t
     uint8_t  char_idx;      // Index into characteristic UUID table (0xFF = unknown)
     uint16_t data_offset;   // Offset into data pool (0xFFFF = no data)
@@ -33,7 +35,8 @@ typedef void (*web_wifi_reset_cb_t)(void);
 // Initialize logging mutex and load persisted config - call once in app_main before any tasks start
 void web_log_init(void);
 
-// Log boot time with actual wall-clock timestamp (call from NTP sync callback)
+// Wall-clock time is known (NTP or BLE CTS): rebase the boot-relative entries
+// recorded so far and log the boot time; call once
 void web_log_boot(void);
 
 // Register callback invoked when the web UI toggles BLE on/off
@@ -42,6 +45,10 @@ void web_set_ble_ctrl_cb(web_ble_ctrl_cb_t cb);
 // Register callback invoked when the web UI requests WiFi reset
 void web_set_wifi_reset_cb(web_wifi_reset_cb_t cb);
 
+// Escape src for use as a JSON string value (" and \ escaped, control
+// characters dropped), truncated to fit dst_len. Returns the length written.
+int web_json_escape(const char *src, char *dst, size_t dst_len);
+
 // Initialize and start HTTP web server
 void web_server_start(void);
 
@@ -57,5 +64,18 @@ void web_log_read(const uint8_t *bd_addr, uint16_t char_uuid, const char *value)
 // Log a BLE write event
 void web_log_write(const uint8_t *bd_addr, uint16_t char_uuid, const char *value);
 
+// Sequence numbers of the oldest retained entry and of the next entry to be
+// logged; entries are numbered from boot and numbers are never reused
+void web_log_seq_range(uint32_t *first, uint32_t *next);
+
+// Serialize entries from *seq (or the oldest retained one, if *seq was
+// overwritten) up to but excluding end into buf, whole records only, and
+// advance *seq past them. Returns the bytes written. Record, little-endian:
+//   [seq:4][timestamp:4][event:1][addr:6][char uuid:2][len:1][data:len]
+// addr is all zero for web UI actions, uuid 0 if none.
+#define LOG_EXPORT_HDR_LEN  18
+#define LOG_EXPORT_MAX_REC  (LOG_EXPORT_HDR_LEN + 63)
+size_t web_log_export(uint32_t *seq, uint32_t end, uint8_t *buf, size_t max);
+
 // Register a characteristic UUID - returns its index
 uint8_t web_log_register_char(uint16_t uuid);
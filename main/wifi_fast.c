@@ -0,0 +1,176 @@
+#include "wifi_fast.h"
+#include <string.h>
+#include "config.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+
+#define TAG "WIFI_FAST"
+
+#define NVS_FAST_NS     "wifi_fast"
+#define NVS_FAST_KEY    "ap"
+
+// Last successful connection; ssid guards against a cache from other credentials
+typedef struct {
+    char     ssid[33];
+    uint8_t  bssid[6];
+    uint8_t  channel;
+    uint32_t ip, netmask, gw, dns;
+} fast_cache_t;
+
+static fast_cache_t      s_cache;
+static bool              s_cache_valid = false;
+static esp_netif_t      *s_netif;
+static bool              s_applied     = false; // hint or lease still in effect
+static bool              s_got_ip      = false;
+static wifi_fast_stats_t s_stats;
+static portMUX_TYPE      s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t uptime_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static void cache_load(void)
+{
+    nvs_handle_t h;
+    if (nvs_open(NVS_FAST_NS, NVS_READONLY, &h) != ESP_OK) return;
+    size_t len = sizeof(s_cache);
+    s_cache_valid = nvs_get_blob(h, NVS_FAST_KEY, &s_cache, &len) == ESP_OK &&
+                    len == sizeof(s_cache);
+    nvs_close(h);
+}
+
+static void cache_save(void)
+{
+    nvs_handle_t h;
+    if (nvs_open(NVS_FAST_NS, NVS_READWRITE, &h) != ESP_OK) return;
+    if (nvs_set_blob(h, NVS_FAST_KEY, &s_cache, sizeof(s_cache)) == ESP_OK)
+        nvs_commit(h);
+    nvs_close(h);
+}
+
+void wifi_fast_apply(wifi_config_t *sta, esp_netif_t *netif)
+{
+    s_netif = netif;
+    // The hint is per boot; the credentials stay in flash as provisioned
+    esp_wifi_set_storage(WIFI_STORAGE_RAM);
+    cache_load();
+
+    if (s_cache_valid && s_cache.channel &&
+        strncmp(s_cache.ssid, (const char *)sta->sta.ssid, sizeof(sta->sta.ssid)) == 0) {
+        memcpy(sta->sta.bssid, s_cache.bssid, sizeof(s_cache.bssid));
+        sta->sta.bssid_set   = true;
+        sta->sta.channel     = s_cache.channel;
+        sta->sta.scan_method = WIFI_FAST_SCAN;
+        s_stats.hint    = true;
+        s_stats.channel = s_cache.channel;
+        s_applied       = true;
+        ESP_LOGI(TAG, "Cached AP " MACSTR " on channel %d",
+                 MAC2STR(s_cache.bssid), s_cache.channel);
+
+#if WIFI_FAST_STATIC_IP
+        if (s_cache.ip) {
+            esp_netif_ip_info_t ip = {
+                .ip.addr = s_cache.ip, .netmask.addr = s_cache.netmask, .gw.addr = s_cache.gw,
+            };
+            esp_netif_dhcpc_stop(netif);
+            if (esp_netif_set_ip_info(netif, &ip) == ESP_OK) {
+                esp_netif_dns_info_t dns = {
+                    .ip.u_addr.ip4.addr = s_cache.dns, .ip.type = ESP_IPADDR_TYPE_V4,
+                };
+                esp_netif_set_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns);
+                s_stats.static_ip = true;
+                ESP_LOGI(TAG, "Reusing lease " IPSTR, IP2STR(&ip.ip));
+            } else {
+                esp_netif_dhcpc_start(netif);
+            }
+        }
+#endif
+    }
+    esp_wifi_set_config(WIFI_IF_STA, sta);
+}
+
+void wifi_fast_on_start(void)
+{
+    s_stats.start_ms = uptime_ms();
+}
+
+void wifi_fast_on_connected(void)
+{
+    if (s_stats.assoc_ms) return;
+    uint32_t now = uptime_ms();
+    portENTER_CRITICAL(&s_lock);
+    s_stats.assoc_ms = now;
+    s_stats.hint_hit = s_applied;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+bool wifi_fast_on_disconnect(void)
+{
+    if (!s_applied) return false;
+    s_applied = false;
+
+    // The caller applies a plain config (any BSSID, any channel); back to DHCP
+    if (s_stats.static_ip)
+        esp_netif_dhcpc_start(s_netif);
+    ESP_LOGW(TAG, "Cached AP %s, falling back to scan%s",
+             s_got_ip ? "lost" : "failed", s_stats.static_ip ? " and DHCP" : "");
+    return !s_got_ip;
+}
+
+void wifi_fast_on_got_ip(const esp_netif_ip_info_t *ip)
+{
+    if (!s_got_ip) {
+        s_got_ip = true;
+        portENTER_CRITICAL(&s_lock);
+        s_stats.ip_ms = uptime_ms();
+        portEXIT_CRITICAL(&s_lock);
+    }
+
+    fast_cache_t now;
+    wifi_ap_record_t ap;
+    if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK) return;
+    memset(&now, 0, sizeof(now));       // compared with memcmp below
+    strncpy(now.ssid, (const char *)ap.ssid, sizeof(now.ssid) - 1);
+    memcpy(now.bssid, ap.bssid, sizeof(now.bssid));
+    now.channel = ap.primary;
+    now.ip      = ip->ip.addr;
+    now.netmask = ip->netmask.addr;
+    now.gw      = ip->gw.addr;
+    esp_netif_dns_info_t dns;
+    if (esp_netif_get_dns_info(s_netif, ESP_NETIF_DNS_MAIN, &dns) == ESP_OK)
+        now.dns = dns.ip.u_addr.ip4.addr;
+
+    // Flash is written only when the AP or lease changed
+    if (s_cache_valid && memcmp(&now, &s_cache, sizeof(now)) == 0) return;
+    s_cache       = now;
+    s_cache_valid = true;
+    cache_save();
+    ESP_LOGI(TAG, "Cached AP " MACSTR " channel %d, lease " IPSTR,
+             MAC2STR(now.bssid), now.channel, IP2STR(&ip->ip));
+}
+
+void wifi_fast_http_ready(void)
+{
+    wifi_fast_stats_t st;
+    portENTER_CRITICAL(&s_lock);
+    s_stats.http_ms = uptime_ms();
+    st = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+    ESP_LOGI(TAG, "Boot timing: WiFi start %lu ms, associated %lu ms, IP %lu ms, "
+             "HTTP ready %lu ms (cached AP %s%s)",
+             (unsigned long)st.start_ms, (unsigned long)st.assoc_ms,
+             (unsigned long)st.ip_ms, (unsigned long)st.http_ms,
+             !st.hint ? "none" : st.hint_hit ? "used" : "missed",
+             st.static_ip ? ", static lease" : "");
+}
+
+void wifi_fast_get_stats(wifi_fast_stats_t *out)
+{
+    portENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_netif.h"
+#include "esp_wifi.h"
+
+// Fast station connect. The BSSID, channel and IP lease of the last
+// successful connection are kept in NVS. At boot the station joins that
+// BSSID on that channel directly instead of scanning. With WIFI_FAST_STATIC_IP
+// it also reuses the lease instead of running DHCP. If the first attempt
+// fails, it falls back to a normal scan and DHCP.
+typedef struct {
+    bool     hint;              // cached BSSID/channel applied at boot
+    bool     hint_hit;          // ... and the first association used it
+    bool     static_ip;         // cached lease applied instead of DHCP
+    uint8_t  channel;           // cached channel, 0 if none
+    uint32_t start_ms;          // since boot: esp_wifi_start
+    uint32_t assoc_ms;          //             first association
+    uint32_t ip_ms;             //             first IP address
+    uint32_t http_ms;           //             web server ready
+} wifi_fast_stats_t;
+
+// Before esp_wifi_start: apply the cached AP to sta (and lease to netif).
+// Switches WiFi config storage to RAM so the hint never reaches flash.
+void wifi_fast_apply(wifi_config_t *sta, esp_netif_t *netif);
+
+// Boot phase marks, from the WiFi event handler / main
+void wifi_fast_on_start(void);
+void wifi_fast_on_connected(void);
+void wifi_fast_on_got_ip(const esp_netif_ip_info_t *ip);
+void wifi_fast_http_ready(void);
+
+// STA disconnected: drop the hint and cached lease if still applied; the
+// caller must apply a plain STA config before the next connect.
+// Returns true if this was the boot attempt; retry at once.
+bool wifi_fast_on_disconnect(void);
+
+void wifi_fast_get_stats(wifi_fast_stats_t *out);
@@ -1,15 +1,23 @@
 #include "wifi_manager.h"
+#include "captive_net.h"
+#include "wifi_fast.h"
+#include "wifi_reconnect.h"
+#include "wifi_scan.h"
+#include "wifi_store.h"
 #include "oled_display.h"
+#include "web_server.h"
+#include "config.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
-#include <sys/socket.h>
 #include "esp_log.h"
+#include "esp_mac.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_netif.h"
 #include "esp_http_server.h"
+#include "esp_timer.h"
 #include "nvs.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
@@ -19,14 +27,228 @@
 
 #define NVS_WIFI_PREV_NS  "wifi_prev"
 #define NVS_WIFI_PREV_KEY "ssid"
+#define NVS_WIFI_PROV_KEY "prov"    // one-shot: open the portal at next boot
+
+// Why the portal was opened although networks are known
+#define PROV_REQ_USER       1       // wifi_manager_reset (web UI button)
+#define PROV_REQ_NO_NETWORK 2       // no known network in range since boot
+#define PROV_REBOOT_DELAY_MS 500    // lets the HTTP/BLE response go out
 
 #define WIFI_CONNECTED_BIT  BIT0
-#define WIFI_FAIL_BIT       BIT1
+#define WIFI_PROV_FAILED_BIT BIT1   // a provisioning attempt failed (ends the BLE-first window)
 
 static EventGroupHandle_t s_wifi_events;
 static bool               s_provisioning = false;
 static httpd_handle_t     s_prov_server  = NULL;
-static uint8_t            s_retry        = 0;   // reconnect backoff counter
+static esp_netif_t       *s_sta_netif    = NULL;
+static bool               s_prov_auto    = false;   // portal opened for PROV_REQ_NO_NETWORK
+static wifi_prov_cb_t     s_prov_scan_cb   = NULL;  // BLE provisioning hooks
+static wifi_prov_cb_t     s_prov_status_cb = NULL;
+
+// GET /scan?fresh=1 requests parked until the scan completes. Only the
+// provisioning httpd task touches them (handler and queued work).
+#define SCAN_MAX_WAITERS    4
+static httpd_req_t       *s_scan_waiters[SCAN_MAX_WAITERS];
+static uint8_t            s_scan_waiter_count = 0;
+
+// Provisioning connect attempt started by POST /connect or the BLE
+// provisioning path. Event handler and timers advance it; GET /connect/status
+// long-polls it.
+typedef struct {
+    uint32_t          job;
+    wifi_prov_state_t state;
+    uint8_t           reason;   // wifi_err_reason_t of the failure, 0 for timeouts
+    uint32_t          ip;       // once connected
+} conn_job_t;
+
+#define STATUS_MAX_WAITERS  4
+static conn_job_t         s_conn = { 0, WIFI_PROV_IDLE, 0, 0 };
+static char               s_conn_ssid[33];      // credentials of the job, stored on success
+static char               s_conn_pass[65];
+static portMUX_TYPE       s_conn_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t s_conn_tmr;           // attempt timeout, then reboot delay
+static httpd_req_t       *s_status_waiters[STATUS_MAX_WAITERS];
+static uint8_t            s_status_waiter_count = 0;
+
+static void conn_set_state(wifi_prov_state_t from, wifi_prov_state_t to, uint8_t reason);
+static void conn_fail(uint8_t reason);
+
+// An attempt is running, or succeeded and the reboot is pending
+static bool conn_busy(void)
+{
+    portENTER_CRITICAL(&s_conn_lock);
+    bool busy = s_conn.state == WIFI_PROV_ASSOCIATING || s_conn.state == WIFI_PROV_GETTING_IP ||
+                s_conn.state == WIFI_PROV_CONNECTED;
+    portEXIT_CRITICAL(&s_conn_lock);
+    return busy;
+}
+
+// --- Station: network selection and roaming ---
+
+// Normal mode only. Selection and roam scans complete in the event task;
+// the roam check runs in the esp_timer task.
+static esp_timer_handle_t s_roam_tmr;
+static uint8_t            s_roam_low     = 0;       // consecutive weak RSSI samples
+static volatile bool      s_roam_scan    = false;   // scan started by the roam check
+static volatile bool      s_roam_pending = false;   // disconnect requested to switch AP
+static volatile bool      s_selecting    = false;   // scan started to pick a network
+static bool               s_sta_ok_once  = false;   // got an IP since boot
+static esp_timer_handle_t s_reboot_tmr;
+
+static void reboot_timer_cb(void *arg)
+{
+    captive_net_stop();             // no-op outside the portal; waits up to 1 s
+    esp_restart();
+}
+
+// Restart from the esp_timer task after PROV_REBOOT_DELAY_MS. Returns at
+// once, so callers on the event loop never block.
+static void reboot_later(void)
+{
+    if (s_reboot_tmr) return;       // already on the way
+    const esp_timer_create_args_t args = {
+        .callback = reboot_timer_cb,
+        .name     = "wifi_reboot",
+    };
+    if (esp_timer_create(&args, &s_reboot_tmr) != ESP_OK ||
+        esp_timer_start_once(s_reboot_tmr, PROV_REBOOT_DELAY_MS * 1000ULL) != ESP_OK)
+        reboot_timer_cb(NULL);
+}
+
+// Reboot into the portal; known networks are kept
+static void provision_reboot(uint8_t why)
+{
+    if (s_reboot_tmr) return;
+    nvs_handle_t h;
+    if (nvs_open(NVS_WIFI_PREV_NS, NVS_READWRITE, &h) == ESP_OK) {
+        nvs_set_u8(h, NVS_WIFI_PROV_KEY, why);
+        nvs_commit(h);
+        nvs_close(h);
+    }
+    reboot_later();
+}
+
+// Nothing has connected for WIFI_STORE_PORTAL_AFTER_MS since boot: reboot
+// into the portal. Checked before every selection or retry.
+static bool sta_portal_due(void)
+{
+    if (s_reboot_tmr) return true;
+    if (s_sta_ok_once || esp_timer_get_time() / 1000 <= WIFI_STORE_PORTAL_AFTER_MS)
+        return false;
+    ESP_LOGW(TAG, "No known network for %d s, opening the portal",
+             WIFI_STORE_PORTAL_AFTER_MS / 1000);
+    provision_reboot(PROV_REQ_NO_NETWORK);
+    return true;
+}
+
+// Point the station at a stored network; ap pins BSSID and channel
+static void sta_apply(const wifi_store_net_t *net, const wifi_scan_ap_t *ap)
+{
+    wifi_config_t cfg = {0};
+    memcpy(cfg.sta.ssid, net->ssid, strnlen(net->ssid, sizeof(cfg.sta.ssid)));
+    memcpy(cfg.sta.password, net->pass, strnlen(net->pass, sizeof(cfg.sta.password)));
+    if (ap) {
+        memcpy(cfg.sta.bssid, ap->bssid, sizeof(cfg.sta.bssid));
+        cfg.sta.bssid_set = true;
+        cfg.sta.channel   = ap->channel;
+    }
+    esp_wifi_set_config(WIFI_IF_STA, &cfg);
+}
+
+// Connect to the best known network: the only one directly, otherwise
+// ranked after a scan (sta_scan_done). Also the reconnect policy's retry.
+static void sta_connect(void)
+{
+    wifi_store_net_t net;
+    if (sta_portal_due()) return;
+    if (wifi_store_count() > 1) {
+        s_selecting = true;
+        if (wifi_scan_request() == ESP_OK) return;
+        s_selecting = false;
+    }
+    if (wifi_store_recent(&net))
+        sta_apply(&net, NULL);
+    esp_wifi_connect();
+}
+
+// Selection scan found nothing known: retry with backoff, or open the
+// portal if nothing has connected for a while since boot
+static void sta_no_network(void)
+{
+    if (!sta_portal_due())
+        wifi_reconnect_schedule(WIFI_REASON_NO_AP_FOUND);
+}
+
+// Credentials rejected repeatedly: forget that network and try the others;
+// with none left, back to the portal
+static void sta_auth_give_up(void)
+{
+    wifi_config_t cur = {0};
+    char ssid[33] = {0};
+    esp_wifi_get_config(WIFI_IF_STA, &cur);
+    memcpy(ssid, cur.sta.ssid, sizeof(cur.sta.ssid));
+    wifi_store_remove(ssid);
+    if (wifi_store_count() == 0)
+        wifi_manager_reset();
+    else
+        sta_connect();
+}
+
+static void sta_scan_done(void)
+{
+    static wifi_scan_ap_t aps[WIFI_SCAN_MAX_APS];   // event task only
+    size_t n = wifi_scan_get(aps, WIFI_SCAN_MAX_APS, NULL, NULL);
+    wifi_store_net_t net;
+    const wifi_scan_ap_t *ap = NULL;
+    bool found = wifi_store_pick(aps, n, &net, &ap);
+
+    if (s_selecting) {
+        s_selecting = false;
+        s_roam_scan = false;
+        if (!found) {
+            ESP_LOGW(TAG, "No known network in range");
+            sta_no_network();
+            return;
+        }
+        ESP_LOGI(TAG, "Selected %s (%d dBm, channel %d)", net.ssid, ap->rssi, ap->channel);
+        sta_apply(&net, ap);
+        esp_wifi_connect();
+        return;
+    }
+
+    if (s_roam_scan) {
+        s_roam_scan = false;
+        wifi_ap_record_t cur;
+        if (!found || esp_wifi_sta_get_ap_info(&cur) != ESP_OK) return;
+        if (memcmp(ap->bssid, cur.bssid, sizeof(cur.bssid)) == 0 ||
+            ap->rssi < cur.rssi + WIFI_ROAM_HYSTERESIS_DB) {
+            ESP_LOGI(TAG, "No better AP than the current one (%d dBm)", cur.rssi);
+            return;
+        }
+        ESP_LOGI(TAG, "Roaming from %s (%d dBm) to %s " MACSTR " (%d dBm)",
+                 (char *)cur.ssid, cur.rssi, net.ssid, MAC2STR(ap->bssid), ap->rssi);
+        wifi_reconnect_on_roam();
+        sta_apply(&net, ap);
+        s_roam_pending = true;
+        esp_wifi_disconnect();
+    }
+}
+
+// Weak signal for WIFI_ROAM_LOW_COUNT samples in a row: look for a better AP
+static void roam_timer_cb(void *arg)
+{
+    wifi_ap_record_t cur;
+    if (esp_wifi_sta_get_ap_info(&cur) != ESP_OK) return;
+    if (cur.rssi >= WIFI_ROAM_RSSI) {
+        s_roam_low = 0;
+        return;
+    }
+    if (++s_roam_low < WIFI_ROAM_LOW_COUNT) return;
+    s_roam_low = 0;
+    ESP_LOGI(TAG, "RSSI %d dBm below %d, scanning for a better AP", cur.rssi, WIFI_ROAM_RSSI);
+    s_roam_scan = true;
+    if (wifi_scan_request() != ESP_OK) s_roam_scan = false;
+}
 
 // --- WiFi event handler ---
 
@@ -36,30 +258,42 @@ static void event_handler(void *arg, esp_event_base_t base,
     if (base == WIFI_EVENT) {
         switch (id) {
         case WIFI_EVENT_STA_START:
-            // Only auto-connect in normal (post-provisioning) mode
-            if (!s_provisioning)
-                esp_wifi_connect();
+            // Only auto-connect in normal (post-provisioning) mode;
+            // the portal keeps its network list fresh instead
+            if (!s_provisioning) {
+                wifi_fast_stats_t fs;
+                wifi_fast_on_start();
+                wifi_fast_get_stats(&fs);
+                if (fs.hint)
+                    esp_wifi_connect();     // cached AP of the most recent network
+                else
+                    sta_connect();
+            } else {
+                wifi_scan_refresh_start();
+            }
+            break;
+        case WIFI_EVENT_STA_CONNECTED:
+            if (s_provisioning)
+                conn_set_state(WIFI_PROV_ASSOCIATING, WIFI_PROV_GETTING_IP, 0);
+            else
+                wifi_fast_on_connected();
             break;
         case WIFI_EVENT_STA_DISCONNECTED: {
+            wifi_event_sta_disconnected_t *disc =
+                (wifi_event_sta_disconnected_t *)data;
             if (s_provisioning) {
-                xEventGroupSetBits(s_wifi_events, WIFI_FAIL_BIT);
+                conn_fail(disc->reason);
             } else {
-                wifi_event_sta_disconnected_t *disc =
-                    (wifi_event_sta_disconnected_t *)data;
-                // Wrong password: give up after 3 attempts, reboot into provisioning
-                if (disc->reason == WIFI_REASON_AUTH_FAIL && s_retry >= 3) {
-                    ESP_LOGE(TAG, "Auth failed %d times (reason %d), "
-                             "resetting to provisioning", s_retry + 1, disc->reason);
-                    wifi_manager_reset();
-                    break;
+                esp_timer_stop(s_roam_tmr);
+                bool boot_miss = wifi_fast_on_disconnect();
+                if (s_roam_pending) {
+                    s_roam_pending = false;
+                    esp_wifi_connect();     // config already points at the new AP
+                } else if (boot_miss) {
+                    sta_connect();          // cached AP missed at boot: no backoff
+                } else if (!wifi_reconnect_on_disconnect(disc->reason)) {
+                    sta_auth_give_up();     // wrong password
                 }
-                // Exponential backoff: 1s, 2s, 4s, 8s, cap at 16s
-                uint32_t delay_ms = (1000u << (s_retry < 4 ? s_retry : 4));
-                ESP_LOGW(TAG, "Disconnected (reason %d), retrying in %lu ms (attempt %d)",
-                         disc->reason, delay_ms, s_retry + 1);
-                vTaskDelay(pdMS_TO_TICKS(delay_ms));
-                s_retry++;
-                esp_wifi_connect();
             }
             break;
         }
@@ -75,113 +309,27 @@ static void event_handler(void *arg, esp_event_base_t base,
         char ip_line[22];
         snprintf(ip_line, sizeof(ip_line), "IP:" IPSTR, IP2STR(&event->ip_info.ip));
         oled_set_line(2, ip_line);
-        s_retry = 0;  // reset backoff counter on successful connection
+        if (!s_provisioning) {
+            wifi_config_t cur = {0};
+            char ssid[33] = {0};
+            esp_wifi_get_config(WIFI_IF_STA, &cur);
+            memcpy(ssid, cur.sta.ssid, sizeof(cur.sta.ssid));
+            s_sta_ok_once = true;
+            wifi_reconnect_on_connected();
+            wifi_fast_on_got_ip(&event->ip_info);
+            wifi_store_mark_ok(ssid);
+            s_roam_low = 0;
+            esp_timer_stop(s_roam_tmr);
+            esp_timer_start_periodic(s_roam_tmr, WIFI_ROAM_CHECK_MS * 1000ULL);
+        }
         xEventGroupSetBits(s_wifi_events, WIFI_CONNECTED_BIT);
-    }
-}
-
-// --- DNS server: hijacks all queries → 192.168.4.1 (captive portal) ---
-
-static void dns_server_task(void *arg)
-{
-    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-    if (sock < 0) {
-        ESP_LOGE(TAG, "DNS socket failed");
-        vTaskDelete(NULL);
-        return;
-    }
-
-    int yes = 1;
-    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
-
-    struct sockaddr_in srv = {
-        .sin_family      = AF_INET,
-        .sin_port        = htons(53),
-        .sin_addr.s_addr = htonl(INADDR_ANY),
-    };
-    if (bind(sock, (struct sockaddr *)&srv, sizeof(srv)) < 0) {
-        ESP_LOGE(TAG, "DNS bind failed");
-        close(sock);
-        vTaskDelete(NULL);
-        return;
-    }
-    ESP_LOGI(TAG, "DNS server ready");
-
-    uint8_t buf[256], resp[300];
-    struct sockaddr_in cli;
-    socklen_t cli_len = sizeof(cli);
-
-    while (1) {
-        int len = recvfrom(sock, buf, sizeof(buf) - 1, 0,
-                           (struct sockaddr *)&cli, &cli_len);
-        if (len < 12) continue;
-
-        // Echo header, mark as response, set ANCOUNT=1
-        memcpy(resp, buf, len);
-        resp[2]  = 0x81; // QR=1, AA=1
-        resp[3]  = 0x80; // RA=1, RCODE=0
-        resp[7]  = 1;    // ANCOUNT = 1
-        resp[8]  = 0; resp[9]  = 0; // NSCOUNT = 0
-        resp[10] = 0; resp[11] = 0; // ARCOUNT = 0
-
-        // Append A-record answer: TTL=0 prevents OS from caching hijacked results
-        int pos = len;
-        resp[pos++] = 0xC0; resp[pos++] = 0x0C; // name: pointer to question
-        resp[pos++] = 0x00; resp[pos++] = 0x01; // Type: A
-        resp[pos++] = 0x00; resp[pos++] = 0x01; // Class: IN
-        resp[pos++] = 0x00; resp[pos++] = 0x00; // TTL (high)
-        resp[pos++] = 0x00; resp[pos++] = 0x00; // TTL = 0 (no caching)
-        resp[pos++] = 0x00; resp[pos++] = 0x04; // RDLENGTH = 4
-        resp[pos++] = 192;  resp[pos++] = 168;
-        resp[pos++] = 4;    resp[pos++] = 1;    // 192.168.4.1
-
-        sendto(sock, resp, pos, 0, (struct sockaddr *)&cli, cli_len);
-    }
-
-    close(sock);
-    vTaskDelete(NULL);
-}
-
-// --- TCP 443 fast-reject: makes Android HTTPS probe fail in milliseconds ---
-// Android runs HTTP and HTTPS probes concurrently. Without a listener on 443,
-// ESP32's lwIP may silently drop SYN packets, causing the HTTPS probe to time
-// out at SOCKET_TIMEOUT_MS (10 s). By accepting and immediately RST-ing the
-// connection (SO_LINGER l_linger=0), we force ECONNRESET in < 5 ms, so the
-// full probe cycle completes in ~1-2 s instead of 10+ s.
-static void tcp443_task(void *arg)
-{
-    int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (sock < 0) { vTaskDelete(NULL); return; }
-
-    int yes = 1;
-    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
-
-    struct sockaddr_in srv = {
-        .sin_family      = AF_INET,
-        .sin_port        = htons(443),
-        .sin_addr.s_addr = htonl(INADDR_ANY),
-    };
-    if (bind(sock, (struct sockaddr *)&srv, sizeof(srv)) < 0 ||
-        listen(sock, 4) < 0) {
-        close(sock);
-        vTaskDelete(NULL);
-        return;
-    }
-    ESP_LOGI(TAG, "TCP 443 reject listener ready");
-
-    while (1) {
-        struct sockaddr_in cli;
-        socklen_t cli_len = sizeof(cli);
-        int client = accept(sock, (struct sockaddr *)&cli, &cli_len);
-        if (client >= 0) {
-            // l_linger=0 causes RST on close instead of graceful FIN
-            struct linger lg = { .l_onoff = 1, .l_linger = 0 };
-            setsockopt(client, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
-            close(client);
+        if (s_provisioning) {
+            portENTER_CRITICAL(&s_conn_lock);
+            s_conn.ip = event->ip_info.ip.addr;
+            portEXIT_CRITICAL(&s_conn_lock);
+            conn_set_state(WIFI_PROV_GETTING_IP, WIFI_PROV_CONNECTED, 0);
         }
     }
-    close(sock);
-    vTaskDelete(NULL);
 }
 
 // --- Provisioning HTTP server ---
@@ -275,12 +423,15 @@ static const char PROV_HTML[] =
     "e.setAttribute('aria-pressed',s);"
     "e.setAttribute('aria-label',s?'Hide password':'Show password');"
     "e.classList.toggle('on',s);i.focus();}"
-    "fetch('/scan').then(r=>r.json()).then(d=>{"
-    "var s=document.getElementById('ssid');"
-    "s.innerHTML=d.ssids.map(n=>'<option>'+n+'</option>').join('');"
+    "function scan(f){fetch('/scan'+(f?'?fresh=1':'')).then(r=>r.json()).then(d=>{"
+    "if(!f&&!d.aps.length)return scan(1);"
+    "var s=document.getElementById('ssid');s.length=0;"
+    "d.aps.forEach(a=>s.add(new Option(a.ssid+' ('+a.rssi+' dBm'+(a.auth?', secured':'')+')',a.ssid)));"
+    "if(!s.length)s.add(new Option('No networks found',''));"
     "if(d.prev){for(var i=0;i<s.options.length;i++)"
     "{if(s.options[i].value===d.prev){s.selectedIndex=i;break;}}}"
-    "});"
+    "});}"
+    "scan(0);"
     "document.getElementById('f').onsubmit=function(e){"
     "e.preventDefault();"
     "var btn=document.getElementById('btn'),st=document.getElementById('st');"
@@ -291,44 +442,29 @@ static const char PROV_HTML[] =
     "fetch('/connect',{method:'POST',body:b.toString(),"
     "headers:{'Content-Type':'application/x-www-form-urlencoded'}})"
     ".then(r=>r.json()).then(r=>{"
-    "st.textContent=r.msg;st.className=r.ok?'ok':'err';"
-    "if(!r.ok)btn.disabled=false;"
-    "if(r.ok)try{window.close();}catch(e){}"
+    "if(r.ok)return poll(r.job,-1);"
+    "st.textContent=r.msg;st.className='err';btn.disabled=false;"
     "});"
     "};"
+    "function poll(j,s){"
+    "var btn=document.getElementById('btn'),st=document.getElementById('st');"
+    "fetch('/connect/status?job='+j+'&seen='+s).then(r=>r.json()).then(d=>{"
+    "st.textContent=d.msg;st.className=d.done?(d.ok?'ok':'err'):'';"
+    "if(!d.done)return poll(j,d.state);"
+    "if(!d.ok)btn.disabled=false;"
+    "else try{window.close();}catch(e){}"
+    "}).catch(()=>setTimeout(()=>poll(j,s),500));"
+    "}"
     "</script></body></html>";
 
-// Escape a string for use as a JSON value (handles " and \; drops control chars)
-static int json_escape(const char *src, char *dst, size_t dst_len)
-{
-    size_t pos = 0;
-    while (*src && pos < dst_len - 1) {
-        if (*src == '"' || *src == '\\') {
-            if (pos + 2 > dst_len - 1) break;
-            dst[pos++] = '\\';
-            dst[pos++] = *src++;
-        } else if ((unsigned char)*src < 0x20) {
-            src++; // drop control characters
-        } else {
-            dst[pos++] = *src++;
-        }
-    }
-    dst[pos] = '\0';
-    return (int)pos;
-}
-
-// GET /scan - return JSON array of visible SSIDs
-static esp_err_t scan_handler(httpd_req_t *req)
+// Write the cached scan as JSON:
+// {"aps":[{"ssid":"net","rssi":-52,"auth":3},...],"prev":"MyNetwork","age":1234,"scanning":false}
+static esp_err_t scan_send(httpd_req_t *req)
 {
-    esp_wifi_scan_start(NULL, true); // Blocking scan (~2s)
-
-    uint16_t ap_count = 0;
-    esp_wifi_scan_get_ap_num(&ap_count);
-    if (ap_count > 20) ap_count = 20;
-
-    wifi_ap_record_t *aps = malloc(ap_count * sizeof(wifi_ap_record_t));
-    if (!aps) { httpd_resp_send_500(req); return ESP_FAIL; }
-    esp_wifi_scan_get_ap_records(&ap_count, aps);
+    static wifi_scan_ap_t aps[WIFI_SCAN_MAX_APS];   // httpd task only
+    int64_t age_ms;
+    bool    scanning;
+    size_t  n = wifi_scan_get(aps, WIFI_SCAN_MAX_APS, &age_ms, &scanning);
 
     // Read previously used SSID (saved before last WiFi reset)
     char prev_ssid[33] = {0};
@@ -339,29 +475,241 @@ static esp_err_t scan_handler(httpd_req_t *req)
         nvs_close(nvs_h);
     }
 
-    // Build JSON: {"ssids":["net1","net2"],"prev":"MyNetwork"}
-    // Worst case: 20 SSIDs * (2 quotes + 64 escaped chars + 1 comma) + prev + wrapper
-    char buf[2048];
-    int pos = snprintf(buf, sizeof(buf), "{\"ssids\":[");
-    bool first = true;
-    for (int i = 0; i < ap_count; i++) {
-        if (aps[i].ssid[0] == '\0') continue; // Skip hidden networks
-        if (!first) buf[pos++] = ',';
-        char esc[65] = {0};
-        json_escape((char *)aps[i].ssid, esc, sizeof(esc));
-        pos += snprintf(buf + pos, sizeof(buf) - pos, "\"%s\"", esc);
-        first = false;
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_sendstr_chunk(req, "{\"aps\":[");
+    char esc[65], item[128];
+    for (size_t i = 0; i < n; i++) {
+        web_json_escape(aps[i].ssid, esc, sizeof(esc));
+        snprintf(item, sizeof(item), "%s{\"ssid\":\"%s\",\"rssi\":%d,\"auth\":%d}",
+                 i ? "," : "", esc, aps[i].rssi, aps[i].authmode);
+        httpd_resp_sendstr_chunk(req, item);
+    }
+    web_json_escape(prev_ssid, esc, sizeof(esc));
+    snprintf(item, sizeof(item), "],\"prev\":\"%s\",\"age\":%lld,\"scanning\":%s}",
+             esc, age_ms, scanning ? "true" : "false");
+    httpd_resp_sendstr_chunk(req, item);
+    return httpd_resp_sendstr_chunk(req, NULL);
+}
+
+// Runs in the httpd task: answer every request parked on the scan
+static void scan_flush_work(void *arg)
+{
+    for (uint8_t i = 0; i < s_scan_waiter_count; i++) {
+        scan_send(s_scan_waiters[i]);
+        httpd_req_async_handler_complete(s_scan_waiters[i]);
+    }
+    s_scan_waiter_count = 0;
+}
+
+// WIFI_EVENT_SCAN_DONE (event task): network selection / roaming in normal
+// mode; in the portal, hand the replies to the httpd task
+static void scan_done_cb(void)
+{
+    if (!s_provisioning) {
+        sta_scan_done();
+        return;
+    }
+    if (s_prov_server)
+        httpd_queue_work(s_prov_server, scan_flush_work, NULL);
+    if (s_prov_scan_cb)
+        s_prov_scan_cb();
+
+    // Opened only because no known network was in range: leave as soon as
+    // one is back, unless the user is already connecting to a new one
+    static wifi_scan_ap_t aps[WIFI_SCAN_MAX_APS];   // event task only
+    wifi_store_net_t net;
+    const wifi_scan_ap_t *ap;
+    size_t n = wifi_scan_get(aps, WIFI_SCAN_MAX_APS, NULL, NULL);
+    if (s_prov_auto && !conn_busy() && wifi_store_pick(aps, n, &net, &ap)) {
+        ESP_LOGI(TAG, "Known network %s is back, leaving the portal", net.ssid);
+        reboot_later();
+    }
+}
+
+// GET /scan - cached network list, returned at once. With ?fresh=1 the
+// request is parked until a new scan completes, without holding the server.
+static esp_err_t scan_handler(httpd_req_t *req)
+{
+    char query[16], val[4];
+    bool fresh = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+                 httpd_query_key_value(query, "fresh", val, sizeof(val)) == ESP_OK &&
+                 val[0] == '1';
+
+    if (fresh && s_scan_waiter_count < SCAN_MAX_WAITERS && wifi_scan_request() == ESP_OK) {
+        httpd_req_t *async;
+        if (httpd_req_async_handler_begin(req, &async) == ESP_OK) {
+            s_scan_waiters[s_scan_waiter_count++] = async;
+            return ESP_OK;
+        }
+    }
+    // Too many waiters or no scan possible: the cache is the best answer
+    return scan_send(req);
+}
+
+// --- Provisioning connect job ---
+
+static const char *conn_phase(wifi_prov_state_t st)
+{
+    switch (st) {
+    case WIFI_PROV_ASSOCIATING: return "associating";
+    case WIFI_PROV_GETTING_IP:  return "getting_ip";
+    case WIFI_PROV_CONNECTED:   return "connected";
+    case WIFI_PROV_FAILED:      return "failed";
+    default:               return "idle";
+    }
+}
+
+static const char *conn_fail_msg(uint8_t reason)
+{
+    switch (reason) {
+    case WIFI_REASON_AUTH_FAIL:
+    case WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT:
+    case WIFI_REASON_HANDSHAKE_TIMEOUT:
+        return "Wrong password.";
+    case WIFI_REASON_NO_AP_FOUND:
+        return "Network not found.";
+    case WIFI_REASON_ASSOC_FAIL:
+    case WIFI_REASON_AUTH_EXPIRE:
+        return "Access point rejected the connection.";
+    case 0:
+        return "Timed out.";
+    default:
+        return "Connection failed.";
     }
-    char prev_esc[65] = {0};
-    json_escape(prev_ssid, prev_esc, sizeof(prev_esc));
-    pos += snprintf(buf + pos, sizeof(buf) - pos, "],\"prev\":\"%s\"}", prev_esc);
-    free(aps);
+}
 
+// Write the job as JSON:
+// {"job":3,"state":4,"phase":"failed","done":true,"ok":false,"reason":202,"msg":"Wrong password."}
+static esp_err_t conn_status_send(httpd_req_t *req)
+{
+    portENTER_CRITICAL(&s_conn_lock);
+    conn_job_t c = s_conn;
+    portEXIT_CRITICAL(&s_conn_lock);
+
+    const char *msg = c.state == WIFI_PROV_ASSOCIATING ? "Connecting..." :
+                      c.state == WIFI_PROV_GETTING_IP  ? "Associated, getting IP address..." :
+                      c.state == WIFI_PROV_CONNECTED   ? "Connected! Rebooting..." :
+                      c.state == WIFI_PROV_FAILED      ? conn_fail_msg(c.reason) : "";
+    bool done = c.state == WIFI_PROV_CONNECTED || c.state == WIFI_PROV_FAILED;
+    char buf[192];
+    snprintf(buf, sizeof(buf),
+             "{\"job\":%lu,\"state\":%d,\"phase\":\"%s\",\"done\":%s,\"ok\":%s,"
+             "\"reason\":%d,\"msg\":\"%s\"}",
+             (unsigned long)c.job, c.state, conn_phase(c.state), done ? "true" : "false",
+             c.state == WIFI_PROV_CONNECTED ? "true" : "false", c.reason, msg);
     httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
     return httpd_resp_send(req, buf, HTTPD_RESP_USE_STRLEN);
 }
 
-// POST /connect - try to connect with submitted credentials
+// Runs in the httpd task: answer every long-poll parked on the job
+static void status_flush_work(void *arg)
+{
+    for (uint8_t i = 0; i < s_status_waiter_count; i++) {
+        conn_status_send(s_status_waiters[i]);
+        httpd_req_async_handler_complete(s_status_waiters[i]);
+    }
+    s_status_waiter_count = 0;
+}
+
+// Advance the job if it is still in state `from`; stale events of a finished
+// attempt (e.g. the disconnect after a timeout) are ignored
+static void conn_set_state(wifi_prov_state_t from, wifi_prov_state_t to, uint8_t reason)
+{
+    portENTER_CRITICAL(&s_conn_lock);
+    bool hit = s_conn.state == from;
+    if (hit) {
+        s_conn.state  = to;
+        s_conn.reason = reason;
+    }
+    uint32_t job = s_conn.job;
+    portEXIT_CRITICAL(&s_conn_lock);
+    if (!hit) return;
+
+    if (to == WIFI_PROV_CONNECTED) {
+        ESP_LOGI(TAG, "Provisioning job %lu: connected, rebooting", (unsigned long)job);
+        wifi_store_add(s_conn_ssid, s_conn_pass);
+        wifi_store_mark_ok(s_conn_ssid);
+        // Leave time for the status reply to reach the browser
+        esp_timer_stop(s_conn_tmr);
+        esp_timer_start_once(s_conn_tmr, WIFI_PROV_REBOOT_DELAY_MS * 1000ULL);
+    } else if (to == WIFI_PROV_FAILED) {
+        ESP_LOGW(TAG, "Provisioning job %lu failed (reason %d)", (unsigned long)job, reason);
+        esp_timer_stop(s_conn_tmr);
+        esp_wifi_disconnect();      // reset STA for the next attempt
+        wifi_scan_refresh_start();
+        xEventGroupSetBits(s_wifi_events, WIFI_PROV_FAILED_BIT);
+    } else {
+        ESP_LOGI(TAG, "Provisioning job %lu: %s", (unsigned long)job, conn_phase(to));
+    }
+    if (s_prov_server)
+        httpd_queue_work(s_prov_server, status_flush_work, NULL);
+    if (s_prov_status_cb)
+        s_prov_status_cb();
+}
+
+// Fail the attempt in whichever phase it is; reason 0 = timeout
+static void conn_fail(uint8_t reason)
+{
+    conn_set_state(WIFI_PROV_ASSOCIATING, WIFI_PROV_FAILED, reason);
+    conn_set_state(WIFI_PROV_GETTING_IP,  WIFI_PROV_FAILED, reason);
+}
+
+// Attempt timeout, or the reboot delay once connected
+static void conn_timer_cb(void *arg)
+{
+    portENTER_CRITICAL(&s_conn_lock);
+    wifi_prov_state_t st = s_conn.state;
+    portEXIT_CRITICAL(&s_conn_lock);
+    if (st == WIFI_PROV_CONNECTED) {
+        captive_net_stop();
+        esp_restart();
+        return;
+    }
+    conn_fail(0);
+}
+
+// Start a connect attempt with the given credentials; one at a time, since
+// a late disconnect of the previous attempt would otherwise fail the new job
+static esp_err_t conn_start(const char *ssid, const char *pass, uint32_t *job_out)
+{
+    portENTER_CRITICAL(&s_conn_lock);
+    bool busy = s_conn.state == WIFI_PROV_ASSOCIATING || s_conn.state == WIFI_PROV_GETTING_IP ||
+                s_conn.state == WIFI_PROV_CONNECTED;
+    uint32_t job = busy ? s_conn.job : ++s_conn.job;
+    if (!busy) {
+        s_conn.state  = WIFI_PROV_ASSOCIATING;
+        s_conn.reason = 0;
+        s_conn.ip     = 0;
+    }
+    portEXIT_CRITICAL(&s_conn_lock);
+    if (busy) return ESP_ERR_INVALID_STATE;
+
+    ESP_LOGI(TAG, "Provisioning job %lu: SSID=%s", (unsigned long)job, ssid);
+    strcpy(s_conn_ssid, ssid);
+    strcpy(s_conn_pass, pass);
+    if (s_prov_status_cb)
+        s_prov_status_cb();
+
+    // The radio can't scan and associate at once
+    wifi_scan_refresh_stop();
+    wifi_scan_abort();
+
+    wifi_config_t cfg = {0};
+    strncpy((char *)cfg.sta.ssid,     ssid, sizeof(cfg.sta.ssid) - 1);
+    strncpy((char *)cfg.sta.password, pass, sizeof(cfg.sta.password) - 1);
+    esp_wifi_set_config(WIFI_IF_STA, &cfg);
+    esp_timer_stop(s_conn_tmr);
+    esp_timer_start_once(s_conn_tmr, WIFI_PROV_CONNECT_TIMEOUT_MS * 1000ULL);
+    if (esp_wifi_connect() != ESP_OK)
+        conn_set_state(WIFI_PROV_ASSOCIATING, WIFI_PROV_FAILED, WIFI_REASON_UNSPECIFIED);
+    *job_out = job;
+    return ESP_OK;
+}
+
+// POST /connect - start a connect attempt with the submitted credentials and
+// return its job id at once; progress is read from /connect/status
 static esp_err_t connect_handler(httpd_req_t *req)
 {
     char body[256] = {0};
@@ -379,43 +727,48 @@ static esp_err_t connect_handler(httpd_req_t *req)
     url_decode(raw_ssid, ssid, sizeof(ssid));
     url_decode(raw_pass, pass, sizeof(pass));
 
-    if (ssid[0] == '\0') {
-        httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_type(req, "application/json");
+    if (ssid[0] == '\0')
         return httpd_resp_send(req, "{\"ok\":false,\"msg\":\"No network selected.\"}",
                                HTTPD_RESP_USE_STRLEN);
-    }
-
-    ESP_LOGI(TAG, "Provisioning: SSID=%s", ssid);
 
-    // Clear stale bits, set credentials, attempt connection
-    xEventGroupClearBits(s_wifi_events, WIFI_CONNECTED_BIT | WIFI_FAIL_BIT);
+    uint32_t job;
+    if (conn_start(ssid, pass, &job) != ESP_OK)
+        return httpd_resp_send(req, "{\"ok\":false,\"msg\":\"Connection attempt in progress.\"}",
+                               HTTPD_RESP_USE_STRLEN);
 
-    wifi_config_t cfg = {0};
-    strncpy((char *)cfg.sta.ssid,     ssid, sizeof(cfg.sta.ssid) - 1);
-    strncpy((char *)cfg.sta.password, pass, sizeof(cfg.sta.password) - 1);
-    esp_wifi_set_config(WIFI_IF_STA, &cfg);
-    esp_wifi_connect();
+    char buf[48];
+    snprintf(buf, sizeof(buf), "{\"ok\":true,\"job\":%lu}", (unsigned long)job);
+    return httpd_resp_send(req, buf, HTTPD_RESP_USE_STRLEN);
+}
 
-    // Wait for connection result (max 12s)
-    EventBits_t bits = xEventGroupWaitBits(s_wifi_events,
-                                           WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
-                                           pdTRUE, pdFALSE,
-                                           pdMS_TO_TICKS(12000));
-
-    if (bits & WIFI_CONNECTED_BIT) {
-        httpd_resp_set_type(req, "application/json");
-        httpd_resp_send(req, "{\"ok\":true,\"msg\":\"Connected! Rebooting...\"}",
-                        HTTPD_RESP_USE_STRLEN);
-        vTaskDelay(pdMS_TO_TICKS(800)); // Let browser receive the response
-        esp_restart();
+// GET /connect/status?job=N&seen=S - long-poll: parked while job N is still
+// in state S, answered as soon as it moves on (the attempt timeout bounds the wait)
+static esp_err_t connect_status_handler(httpd_req_t *req)
+{
+    char query[32], val[12];
+    uint32_t job  = 0;
+    int      seen = -1;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "job", val, sizeof(val)) == ESP_OK)
+            job = strtoul(val, NULL, 10);
+        if (httpd_query_key_value(query, "seen", val, sizeof(val)) == ESP_OK)
+            seen = atoi(val);
     }
 
-    // Connection failed - reset STA for next attempt
-    esp_wifi_disconnect();
-    httpd_resp_set_type(req, "application/json");
-    return httpd_resp_send(req,
-                           "{\"ok\":false,\"msg\":\"Connection failed. Check password.\"}",
-                           HTTPD_RESP_USE_STRLEN);
+    portENTER_CRITICAL(&s_conn_lock);
+    bool park = job == s_conn.job && seen == (int)s_conn.state &&
+                (s_conn.state == WIFI_PROV_ASSOCIATING || s_conn.state == WIFI_PROV_GETTING_IP);
+    portEXIT_CRITICAL(&s_conn_lock);
+
+    if (park && s_status_waiter_count < STATUS_MAX_WAITERS) {
+        httpd_req_t *async;
+        if (httpd_req_async_handler_begin(req, &async) == ESP_OK) {
+            s_status_waiters[s_status_waiter_count++] = async;
+            return ESP_OK;
+        }
+    }
+    return conn_status_send(req);
 }
 
 // GET / and OS probe URLs (iOS /hotspot-detect.html, Android /generate_204, etc.)
@@ -448,7 +801,9 @@ static esp_err_t captive_handler(httpd_req_t *req)
     return httpd_resp_send(req, NULL, 0);
 }
 
-static void start_provisioning(void)
+// SoftAP portal: captive DNS / mDNS / TCP 443 (captive_net) and the HTTP server. With the
+// BLE-first window the station is already running and is restarted in APSTA.
+static void start_softap(bool sta_running)
 {
     // Build AP name from last 3 bytes of MAC
     uint8_t mac[6];
@@ -472,6 +827,11 @@ static void start_provisioning(void)
     strncpy((char *)ap_cfg.ap.ssid, ap_name, sizeof(ap_cfg.ap.ssid));
     ap_cfg.ap.ssid_len = strlen(ap_name);
 
+    if (sta_running) {
+        wifi_scan_refresh_stop();   // restarts on STA_START
+        wifi_scan_abort();
+        esp_wifi_stop();
+    }
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_APSTA));
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &ap_cfg));
 
@@ -479,8 +839,8 @@ static void start_provisioning(void)
     // so sockets are ready the instant the AP accepts the first client connection.
     // Android fires captive portal probes immediately on association; if servers
     // start after esp_wifi_start() there is a race that causes the probe to fail.
-    xTaskCreate(dns_server_task, "dns_srv", 3072, NULL, 5, NULL);
-    xTaskCreate(tcp443_task,    "tcp443",  2048, NULL, 5, NULL);
+    if (captive_net_start(ESP_IP4TOADDR(192, 168, 4, 1)) != ESP_OK)
+        ESP_LOGE(TAG, "Captive DNS failed, clients must open 192.168.4.1 by hand");
 
     // Provisioning HTTP server with wildcard matching for captive portal
     httpd_config_t config  = HTTPD_DEFAULT_CONFIG();
@@ -493,6 +853,7 @@ static void start_provisioning(void)
         httpd_uri_t u_root     = { "/",                    HTTP_GET,  root_handler,    NULL };
         httpd_uri_t u_scan     = { "/scan",                HTTP_GET,  scan_handler,    NULL };
         httpd_uri_t u_connect  = { "/connect",             HTTP_POST, connect_handler, NULL };
+        httpd_uri_t u_cstatus  = { "/connect/status",      HTTP_GET,  connect_status_handler, NULL };
         // iOS CNA probe: must return 200 + portal HTML (body must NOT contain "Success")
         httpd_uri_t u_apple    = { "/hotspot-detect.html", HTTP_GET,  root_handler,    NULL };
         // Android probe: returning non-204 triggers captive portal notification
@@ -506,6 +867,7 @@ static void start_provisioning(void)
         httpd_register_uri_handler(s_prov_server, &u_root);
         httpd_register_uri_handler(s_prov_server, &u_scan);
         httpd_register_uri_handler(s_prov_server, &u_connect);
+        httpd_register_uri_handler(s_prov_server, &u_cstatus);
         httpd_register_uri_handler(s_prov_server, &u_apple);
         httpd_register_uri_handler(s_prov_server, &u_gen204);
         httpd_register_uri_handler(s_prov_server, &u_ncsi);
@@ -531,7 +893,7 @@ void wifi_manager_start(void)
     if (loop_err != ESP_OK && loop_err != ESP_ERR_INVALID_STATE)
         ESP_ERROR_CHECK(loop_err);
 
-    esp_netif_create_default_wifi_sta();
+    s_sta_netif = esp_netif_create_default_wifi_sta();
     esp_netif_create_default_wifi_ap();
 
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
@@ -542,23 +904,76 @@ void wifi_manager_start(void)
     ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP,
                                                &event_handler, NULL));
 
-    // Check for saved credentials
+    wifi_scan_init(scan_done_cb);
+
+    // Known networks; a config saved by the driver before the store is imported
     wifi_config_t sta_cfg = {0};
     esp_wifi_get_config(WIFI_IF_STA, &sta_cfg);
-    bool provisioned = (strlen((char *)sta_cfg.sta.ssid) > 0);
+    wifi_store_init(&sta_cfg);
+
+    // One-shot portal request from wifi_manager_reset / sta_no_network
+    uint8_t prov_req = 0;
+    nvs_handle_t h;
+    if (nvs_open(NVS_WIFI_PREV_NS, NVS_READWRITE, &h) == ESP_OK) {
+        if (nvs_get_u8(h, NVS_WIFI_PROV_KEY, &prov_req) == ESP_OK) {
+            nvs_erase_key(h, NVS_WIFI_PROV_KEY);
+            nvs_commit(h);
+        }
+        nvs_close(h);
+    }
 
-    if (!provisioned) {
+    if (wifi_store_count() == 0 || prov_req) {
         s_provisioning = true;
-        start_provisioning();
-        // connect_handler calls esp_restart() on success;
+        s_prov_auto    = prov_req == PROV_REQ_NO_NETWORK;
+        const esp_timer_create_args_t tmr_args = {
+            .callback = conn_timer_cb,
+            .name     = "wifi_prov",
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&tmr_args, &s_conn_tmr));
+
+        // BLE-first window: a phone app can provision over GATT before the
+        // SoftAP, DNS and HTTP tasks are started. A failed attempt ends the
+        // window at once; one still in progress postpones the portal until
+        // it has failed
+        bool ble_first = s_prov_status_cb && WIFI_PROV_BLE_FIRST_MS > 0;
+        if (ble_first) {
+            oled_set_line(0, "WiFi Setup");
+            oled_set_line(2, "Setup via BLE...");
+            ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+            ESP_ERROR_CHECK(esp_wifi_start());
+            ESP_LOGI(TAG, "BLE provisioning window, SoftAP portal in %d ms",
+                     WIFI_PROV_BLE_FIRST_MS);
+            xEventGroupWaitBits(s_wifi_events, WIFI_PROV_FAILED_BIT,
+                                pdTRUE, pdTRUE, pdMS_TO_TICKS(WIFI_PROV_BLE_FIRST_MS));
+            while (conn_busy())
+                xEventGroupWaitBits(s_wifi_events, WIFI_PROV_FAILED_BIT,
+                                    pdTRUE, pdTRUE, pdMS_TO_TICKS(500));
+        }
+        start_softap(ble_first);
+        // A successful connect job reboots (conn_timer_cb);
         // this task waits indefinitely while the HTTP server handles provisioning
         vTaskDelay(portMAX_DELAY);
     }
 
-    // Normal STA connection path
-    ESP_LOGI(TAG, "Saved credentials: SSID=%s, connecting...", sta_cfg.sta.ssid);
+    // Normal STA connection path: boot config is the most recent network,
+    // so the fast-boot hint applies; without a hint STA_START ranks by scan
+    wifi_store_net_t net;
+    wifi_store_recent(&net);
+    memset(&sta_cfg, 0, sizeof(sta_cfg));
+    memcpy(sta_cfg.sta.ssid, net.ssid, strnlen(net.ssid, sizeof(sta_cfg.sta.ssid)));
+    memcpy(sta_cfg.sta.password, net.pass, strnlen(net.pass, sizeof(sta_cfg.sta.password)));
+
+    wifi_reconnect_init(sta_connect);
+    const esp_timer_create_args_t roam_args = {
+        .callback = roam_timer_cb,
+        .name     = "wifi_roam",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&roam_args, &s_roam_tmr));
+    ESP_LOGI(TAG, "%d known network(s), most recent %s, connecting...",
+             (int)wifi_store_count(), net.ssid);
     oled_set_line(2, "Connecting...");
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    wifi_fast_apply(&sta_cfg, s_sta_netif);
     ESP_ERROR_CHECK(esp_wifi_start());
     // WIFI_EVENT_STA_START → event_handler → esp_wifi_connect()
 
@@ -569,7 +984,7 @@ void wifi_manager_start(void)
 
 void wifi_manager_reset(void)
 {
-    ESP_LOGI(TAG, "Erasing WiFi credentials, rebooting into provisioning mode...");
+    ESP_LOGI(TAG, "Rebooting into provisioning mode, known networks kept...");
 
     // Save current SSID for pre-selection in next provisioning session (Variant B)
     wifi_config_t cfg = {0};
@@ -583,7 +998,41 @@ void wifi_manager_reset(void)
         }
     }
 
+    // Drop the driver's own copy; the store is the source of truth
     esp_wifi_restore();
-    vTaskDelay(pdMS_TO_TICKS(500)); // Allow HTTP/BLE response to be sent
-    esp_restart();
+    provision_reboot(PROV_REQ_USER);
+}
+
+bool wifi_manager_is_provisioning(void)
+{
+    return s_provisioning;
+}
+
+esp_err_t wifi_manager_prov_scan(void)
+{
+    if (!s_provisioning || conn_busy()) return ESP_ERR_INVALID_STATE;
+    return wifi_scan_request();
+}
+
+esp_err_t wifi_manager_prov_connect(const char *ssid, const char *pass)
+{
+    uint32_t job;
+    if (!s_provisioning) return ESP_ERR_INVALID_STATE;
+    if (!ssid[0] || strlen(ssid) > 32 || strlen(pass) > 64) return ESP_ERR_INVALID_ARG;
+    return conn_start(ssid, pass, &job);
+}
+
+void wifi_manager_prov_status(wifi_prov_state_t *state, uint8_t *reason, uint32_t *ip)
+{
+    portENTER_CRITICAL(&s_conn_lock);
+    *state  = s_conn.state;
+    *reason = s_conn.reason;
+    *ip     = s_conn.ip;
+    portEXIT_CRITICAL(&s_conn_lock);
+}
+
+void wifi_manager_set_prov_cb(wifi_prov_cb_t scan_done_cb, wifi_prov_cb_t status_cb)
+{
+    s_prov_scan_cb   = scan_done_cb;
+    s_prov_status_cb = status_cb;
 }
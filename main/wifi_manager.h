@@ -1,7 +1,45 @@
 #pragma once
 
-// Initialize WiFi - provisioning if needed, STA mode if already provisioned
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Provisioning connect attempt, as reported to the BLE provisioning path
+typedef enum {
+    WIFI_PROV_IDLE,
+    WIFI_PROV_ASSOCIATING,
+    WIFI_PROV_GETTING_IP,   // associated, waiting for DHCP
+    WIFI_PROV_CONNECTED,    // got IP, rebooting
+    WIFI_PROV_FAILED,
+} wifi_prov_state_t;
+
+typedef void (*wifi_prov_cb_t)(void);
+
+// Initialize WiFi - provisioning if no network is known, otherwise STA mode
+// on the best known network in range (roaming when the signal gets weak)
 void wifi_manager_start(void);
 
-// Erase WiFi credentials and reboot into provisioning mode
-void wifi_manager_reset(void);
\ No newline at end of file
+// Reboot into provisioning mode; known networks are kept, and one that fails
+// authentication repeatedly is forgotten. Returns at once, the device
+// restarts 500 ms later.
+void wifi_manager_reset(void);
+// --- Provisioning from other transports (BLE) ---
+
+// True while the device runs provisioning instead of STA mode
+bool wifi_manager_is_provisioning(void);
+
+// Start a scan; scan_done_cb follows. ESP_ERR_INVALID_STATE outside
+// provisioning or during a connect attempt.
+esp_err_t wifi_manager_prov_scan(void);
+
+// Start a connect attempt, shared with the portal's POST /connect;
+// ESP_ERR_INVALID_STATE if one is already running
+esp_err_t wifi_manager_prov_connect(const char *ssid, const char *pass);
+
+// State of the current attempt; ip (network order) once connected, failure
+// reason (wifi_err_reason_t, 0 = timeout) once failed
+void wifi_manager_prov_status(wifi_prov_state_t *state, uint8_t *reason, uint32_t *ip);
+
+// Called after every scan while provisioning, and on every attempt state
+// change; from the WiFi event task or a timer
+void wifi_manager_set_prov_cb(wifi_prov_cb_t scan_done_cb, wifi_prov_cb_t status_cb);
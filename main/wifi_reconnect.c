@@ -0,0 +1,157 @@
+#include "wifi_reconnect.h"
+#include "config.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+
+#define TAG "WIFI_RECONNECT"
+
+#define LINK_LOSS_JITTER_MS 250     // spread of the immediate retry after a beacon timeout
+
+static wifi_reconnect_stats_t s_stats;
+static int64_t                s_outage_start_us;    // 0 = no outage
+static uint8_t                s_auth_fails;         // consecutive AUTH_FAIL
+static esp_timer_handle_t     s_retry_tmr;
+static void                 (*s_connect_fn)(void);
+static portMUX_TYPE           s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Exponential backoff with equal jitter: a random delay in [d/2, d], so
+// devices that lost the same AP do not retry in lockstep
+static uint32_t backoff_ms(uint8_t attempt, uint32_t cap_ms)
+{
+    uint32_t d = cap_ms;
+    if (attempt < 16 && (WIFI_RECONNECT_BASE_MS << attempt) < cap_ms)
+        d = WIFI_RECONNECT_BASE_MS << attempt;
+    return d / 2 + esp_random() % (d / 2 + 1);
+}
+
+static void retry_timer_cb(void *arg)
+{
+    portENTER_CRITICAL(&s_lock);
+    s_stats.next_retry_ms = 0;
+    s_stats.attempts++;
+    uint8_t attempt = s_stats.attempt;
+    portEXIT_CRITICAL(&s_lock);
+
+    ESP_LOGI(TAG, "Reconnect attempt %d", attempt);
+    s_connect_fn();
+}
+
+// Pick the delay for reason and arm the retry timer
+static void retry_schedule(uint8_t reason, bool was_connected, const char *why)
+{
+    portENTER_CRITICAL(&s_lock);
+    uint8_t attempt = s_stats.attempt;
+    portEXIT_CRITICAL(&s_lock);
+
+    uint32_t delay_ms;
+    const char *policy;
+    if (reason == WIFI_REASON_BEACON_TIMEOUT && was_connected) {
+        delay_ms = esp_random() % LINK_LOSS_JITTER_MS;
+        policy   = "link lost";
+    } else if (reason == WIFI_REASON_NO_AP_FOUND) {
+        delay_ms = backoff_ms(attempt, WIFI_RECONNECT_NO_AP_MAX_MS);
+        policy   = "AP not found";
+    } else {
+        delay_ms = backoff_ms(attempt, WIFI_RECONNECT_MAX_MS);
+        policy   = "backoff";
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    if (s_stats.attempt < UINT8_MAX) s_stats.attempt++;
+    s_stats.next_retry_ms = delay_ms;
+    portEXIT_CRITICAL(&s_lock);
+
+    ESP_LOGW(TAG, "%s (reason %d), %s: retry %d in %lu ms",
+             why, reason, policy, attempt + 1, (unsigned long)delay_ms);
+    esp_timer_stop(s_retry_tmr);
+    esp_timer_start_once(s_retry_tmr, delay_ms * 1000ULL);
+}
+
+void wifi_reconnect_init(void (*connect_fn)(void))
+{
+    s_connect_fn = connect_fn;
+    const esp_timer_create_args_t args = {
+        .callback = retry_timer_cb,
+        .name     = "wifi_retry",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&args, &s_retry_tmr));
+}
+
+bool wifi_reconnect_on_disconnect(uint8_t reason)
+{
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_lock);
+    bool was_connected = s_stats.connected;
+    s_stats.connected   = false;
+    s_stats.last_reason = reason;
+    s_stats.disconnects++;
+    if (!s_outage_start_us) s_outage_start_us = now;
+    s_auth_fails = reason == WIFI_REASON_AUTH_FAIL ? s_auth_fails + 1 : 0;
+    uint8_t auth_fails = s_auth_fails;
+    portEXIT_CRITICAL(&s_lock);
+
+    // Wrong password: stop after a few tries so the caller can drop the network
+    if (auth_fails > WIFI_RECONNECT_AUTH_MAX) {
+        ESP_LOGE(TAG, "Auth failed %d times in a row (reason %d), giving up",
+                 auth_fails, reason);
+        portENTER_CRITICAL(&s_lock);
+        s_auth_fails = 0;
+        portEXIT_CRITICAL(&s_lock);
+        return false;
+    }
+
+    retry_schedule(reason, was_connected, "Disconnected");
+    return true;
+}
+
+void wifi_reconnect_schedule(uint8_t reason)
+{
+    portENTER_CRITICAL(&s_lock);
+    if (!s_outage_start_us) s_outage_start_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&s_lock);
+    retry_schedule(reason, false, "No connection attempt");
+}
+
+void wifi_reconnect_on_roam(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    s_stats.roams++;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void wifi_reconnect_on_connected(void)
+{
+    int64_t now = esp_timer_get_time();
+    esp_timer_stop(s_retry_tmr);
+
+    portENTER_CRITICAL(&s_lock);
+    uint32_t outage_ms = s_outage_start_us ? (now - s_outage_start_us) / 1000 : 0;
+    uint8_t  attempts  = s_stats.attempt;
+    if (s_outage_start_us) {
+        s_stats.recoveries++;
+        s_stats.last_outage_ms   = outage_ms;
+        s_stats.total_outage_ms += outage_ms;
+        if (outage_ms > s_stats.max_outage_ms) s_stats.max_outage_ms = outage_ms;
+    }
+    s_outage_start_us     = 0;
+    s_auth_fails          = 0;
+    s_stats.connected     = true;
+    s_stats.attempt       = 0;
+    s_stats.next_retry_ms = 0;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (outage_ms)
+        ESP_LOGI(TAG, "Reconnected after %lu ms, %d attempt(s)",
+                 (unsigned long)outage_ms, attempts);
+}
+
+void wifi_reconnect_get_stats(wifi_reconnect_stats_t *out)
+{
+    portENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Station reconnect policy. Retries are scheduled on an esp_timer, so the
+// event loop never waits out a backoff. Delays grow exponentially from
+// WIFI_RECONNECT_BASE_MS with jitter; per disconnect reason:
+//   beacon timeout  - first retry at once (the AP is most likely still there)
+//   no AP found     - capped at WIFI_RECONNECT_NO_AP_MAX_MS instead of _MAX_MS
+//   auth fail       - gives up after WIFI_RECONNECT_AUTH_MAX consecutive retries
+// A retry calls connect_fn, which picks the network and connects.
+typedef struct {
+    bool     connected;
+    uint8_t  last_reason;       // wifi_err_reason_t of the last disconnect
+    uint8_t  attempt;           // retries in the current outage
+    uint32_t disconnects;
+    uint32_t attempts;          // esp_wifi_connect calls by the policy
+    uint32_t recoveries;        // outages that ended with an IP address
+    uint32_t roams;             // switches to a stronger AP while connected
+    uint32_t next_retry_ms;     // delay of the pending retry, 0 if none
+    uint32_t last_outage_ms;    // first disconnect -> got IP
+    uint32_t max_outage_ms;
+    uint64_t total_outage_ms;
+} wifi_reconnect_stats_t;
+
+void wifi_reconnect_init(void (*connect_fn)(void));
+
+// WIFI_EVENT_STA_DISCONNECTED: schedule the next attempt. Returns false when
+// the credentials were rejected too often; the caller should re-provision.
+bool wifi_reconnect_on_disconnect(uint8_t reason);
+
+// Retry later without a disconnect, e.g. no known network in a selection
+// scan: same backoff as reason, but not counted in disconnects
+void wifi_reconnect_schedule(uint8_t reason);
+
+// Deliberate disconnect to switch AP; the caller reconnects itself
+void wifi_reconnect_on_roam(void);
+
+// IP_EVENT_STA_GOT_IP: end the outage, reset the backoff
+void wifi_reconnect_on_connected(void);
+
+void wifi_reconnect_get_stats(wifi_reconnect_stats_t *out);
@@ -0,0 +1,164 @@
+#include "wifi_scan.h"
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#define TAG "WIFI_SCAN"
+
+// Raw records fetched per scan before de-duplication by SSID
+#define SCAN_MAX_RECORDS    (WIFI_SCAN_MAX_APS * 2)
+
+static wifi_scan_ap_t      s_aps[WIFI_SCAN_MAX_APS];
+static size_t              s_ap_count;
+static int64_t             s_done_us   = -1;    // last completed scan
+static int64_t             s_start_us;
+static volatile bool       s_scanning  = false;
+static SemaphoreHandle_t   s_mutex;
+static esp_timer_handle_t  s_refresh_tmr;
+static wifi_scan_done_cb_t s_done_cb;
+
+// Merge raw records into a de-duplicated, RSSI-sorted list
+static size_t scan_collect(const wifi_ap_record_t *rec, uint16_t n, wifi_scan_ap_t *out)
+{
+    size_t count = 0;
+    for (uint16_t i = 0; i < n; i++) {
+        if (rec[i].ssid[0] == '\0') continue;   // hidden network
+        size_t j;
+        for (j = 0; j < count; j++)
+            if (strcmp(out[j].ssid, (const char *)rec[i].ssid) == 0) break;
+        if (j < count) {
+            if (rec[i].rssi <= out[j].rssi) continue;
+            // Stronger AP for a known SSID: drop the old entry, re-insert below
+            memmove(&out[j], &out[j + 1], (count - j - 1) * sizeof(out[0]));
+            count--;
+        }
+        // Insertion point by RSSI, strongest first
+        size_t pos = count;
+        while (pos > 0 && out[pos - 1].rssi < rec[i].rssi) pos--;
+        if (pos >= WIFI_SCAN_MAX_APS) continue;
+        if (count == WIFI_SCAN_MAX_APS) count--;  // weakest falls off
+        memmove(&out[pos + 1], &out[pos], (count - pos) * sizeof(out[0]));
+        wifi_scan_ap_t *ap = &out[pos];
+        strncpy(ap->ssid, (const char *)rec[i].ssid, sizeof(ap->ssid) - 1);
+        ap->ssid[sizeof(ap->ssid) - 1] = '\0';
+        memcpy(ap->bssid, rec[i].bssid, sizeof(ap->bssid));
+        ap->rssi     = rec[i].rssi;
+        ap->authmode = rec[i].authmode;
+        ap->channel  = rec[i].primary;
+        count++;
+    }
+    return count;
+}
+
+static void scan_done_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    wifi_event_sta_scan_done_t *done = (wifi_event_sta_scan_done_t *)data;
+    uint16_t n = 0;
+    esp_wifi_scan_get_ap_num(&n);
+    if (n > SCAN_MAX_RECORDS) n = SCAN_MAX_RECORDS;
+
+    // Records are fetched even when empty or failed: this frees the driver's list
+    wifi_ap_record_t *rec = n ? malloc(n * sizeof(*rec)) : NULL;
+    if (!rec) n = 0;
+    esp_wifi_scan_get_ap_records(&n, rec);
+
+    static wifi_scan_ap_t fresh[WIFI_SCAN_MAX_APS];
+    size_t count = scan_collect(rec, n, fresh);
+    free(rec);
+
+    int64_t now = esp_timer_get_time();
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    // A failed or aborted scan (e.g. a connect attempt took the radio) keeps
+    // the previous list
+    if (done->status == 0) {
+        memcpy(s_aps, fresh, count * sizeof(fresh[0]));
+        s_ap_count = count;
+        s_done_us  = now;
+    }
+    s_scanning = false;
+    xSemaphoreGive(s_mutex);
+
+    if (done->status == 0)
+        ESP_LOGI(TAG, "Scan done in %lld ms: %d records, %d networks",
+                 (now - s_start_us) / 1000, n, (int)count);
+    else
+        ESP_LOGW(TAG, "Scan failed (status %lu), keeping cached list",
+                 (unsigned long)done->status);
+    if (s_done_cb) s_done_cb();
+}
+
+static void refresh_timer_cb(void *arg)
+{
+    wifi_scan_request();
+}
+
+void wifi_scan_init(wifi_scan_done_cb_t done_cb)
+{
+    s_done_cb = done_cb;
+    s_mutex   = xSemaphoreCreateMutex();
+    const esp_timer_create_args_t args = {
+        .callback = refresh_timer_cb,
+        .name     = "wifi_scan",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&args, &s_refresh_tmr));
+    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_SCAN_DONE,
+                                               &scan_done_handler, NULL));
+}
+
+esp_err_t wifi_scan_request(void)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    esp_err_t err = ESP_OK;
+    if (!s_scanning) {
+        err = esp_wifi_scan_start(NULL, false);
+        if (err == ESP_OK) {
+            s_scanning = true;
+            s_start_us = esp_timer_get_time();
+        }
+    }
+    xSemaphoreGive(s_mutex);
+    if (err != ESP_OK)
+        ESP_LOGW(TAG, "Scan not started: %s", esp_err_to_name(err));
+    return err;
+}
+
+void wifi_scan_refresh_start(void)
+{
+    wifi_scan_request();
+    esp_timer_stop(s_refresh_tmr);
+    esp_timer_start_periodic(s_refresh_tmr, WIFI_SCAN_REFRESH_MS * 1000ULL);
+}
+
+void wifi_scan_refresh_stop(void)
+{
+    esp_timer_stop(s_refresh_tmr);
+}
+
+void wifi_scan_abort(void)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    bool was = s_scanning;
+    if (was) esp_wifi_scan_stop();
+    s_scanning = false;
+    xSemaphoreGive(s_mutex);
+    if (was && s_done_cb) s_done_cb();
+}
+
+size_t wifi_scan_get(wifi_scan_ap_t *out, size_t max, int64_t *age_ms, bool *scanning)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    size_t n = s_ap_count < max ? s_ap_count : max;
+    if (n) memcpy(out, s_aps, n * sizeof(out[0]));
+    if (age_ms)
+        *age_ms = s_done_us < 0 ? -1 : (esp_timer_get_time() - s_done_us) / 1000;
+    if (scanning)
+        *scanning = s_scanning;
+    xSemaphoreGive(s_mutex);
+    return n;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// One visible network; duplicates (several APs, same SSID) keep the strongest
+typedef struct {
+    char    ssid[33];
+    uint8_t bssid[6];           // of the strongest AP
+    int8_t  rssi;
+    uint8_t authmode;           // wifi_auth_mode_t
+    uint8_t channel;
+} wifi_scan_ap_t;
+
+// Called from the WiFi event task after every scan, successful or not
+typedef void (*wifi_scan_done_cb_t)(void);
+
+// Create the cache and refresh timer, hook WIFI_EVENT_SCAN_DONE.
+// Needs the default event loop.
+void wifi_scan_init(wifi_scan_done_cb_t done_cb);
+
+// Start a non-blocking scan; ESP_OK if one started or is already running
+esp_err_t wifi_scan_request(void);
+
+// Scan now and then every WIFI_SCAN_REFRESH_MS (STA must be started)
+void wifi_scan_refresh_start(void);
+void wifi_scan_refresh_stop(void);
+
+// Stop a running scan (a connect attempt needs the radio); parked
+// readers are answered from the cache
+void wifi_scan_abort(void);
+
+// Copy up to max cached networks, strongest first. age_ms is the time since
+// the last completed scan, -1 if none has completed yet.
+size_t wifi_scan_get(wifi_scan_ap_t *out, size_t max, int64_t *age_ms, bool *scanning);
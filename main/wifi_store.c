@@ -0,0 +1,176 @@
+#include "wifi_store.h"
+#include <string.h>
+#include <time.h>
+#include "config.h"
+#include "ntp_sync.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#define TAG "WIFI_STORE"
+
+#define NVS_STORE_NS    "wifi_store"
+#define NVS_STORE_KEY   "nets"
+
+// A success older than this is re-stamped even if the network is already
+// the most recent, so last_ok_time stays meaningful without a write per connect
+#define RESTAMP_S       3600
+
+static wifi_store_net_t  s_nets[WIFI_STORE_MAX];
+static size_t            s_count;
+static uint32_t          s_seq;         // highest last_ok_seq
+static SemaphoreHandle_t s_mutex;
+
+static void store_save(void)
+{
+    nvs_handle_t h;
+    if (nvs_open(NVS_STORE_NS, NVS_READWRITE, &h) != ESP_OK) return;
+    esp_err_t err = s_count ? nvs_set_blob(h, NVS_STORE_KEY, s_nets, s_count * sizeof(s_nets[0]))
+                            : nvs_erase_key(h, NVS_STORE_KEY);
+    if (err == ESP_OK || err == ESP_ERR_NVS_NOT_FOUND)
+        nvs_commit(h);
+    nvs_close(h);
+}
+
+static int store_index(const char *ssid)
+{
+    for (size_t i = 0; i < s_count; i++)
+        if (strcmp(s_nets[i].ssid, ssid) == 0) return (int)i;
+    return -1;
+}
+
+void wifi_store_init(const wifi_config_t *legacy)
+{
+    s_mutex = xSemaphoreCreateMutex();
+
+    nvs_handle_t h;
+    if (nvs_open(NVS_STORE_NS, NVS_READONLY, &h) == ESP_OK) {
+        size_t len = sizeof(s_nets);
+        if (nvs_get_blob(h, NVS_STORE_KEY, s_nets, &len) == ESP_OK)
+            s_count = len / sizeof(s_nets[0]);
+        nvs_close(h);
+    }
+    for (size_t i = 0; i < s_count; i++)
+        if (s_nets[i].last_ok_seq > s_seq) s_seq = s_nets[i].last_ok_seq;
+
+    if (s_count == 0 && legacy && legacy->sta.ssid[0]) {
+        char ssid[33] = {0}, pass[65] = {0};
+        memcpy(ssid, legacy->sta.ssid, sizeof(legacy->sta.ssid));
+        memcpy(pass, legacy->sta.password, sizeof(legacy->sta.password));
+        wifi_store_add(ssid, pass);
+        ESP_LOGI(TAG, "Imported saved network %s", ssid);
+    }
+    ESP_LOGI(TAG, "%d known network(s)", (int)s_count);
+}
+
+size_t wifi_store_count(void)
+{
+    return s_count;
+}
+
+bool wifi_store_get(size_t i, wifi_store_net_t *out)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    bool ok = i < s_count;
+    if (ok) *out = s_nets[i];
+    xSemaphoreGive(s_mutex);
+    return ok;
+}
+
+esp_err_t wifi_store_add(const char *ssid, const char *pass)
+{
+    if (!ssid[0] || strlen(ssid) >= sizeof(s_nets[0].ssid) ||
+        strlen(pass) >= sizeof(s_nets[0].pass))
+        return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    int i = store_index(ssid);
+    if (i < 0) {
+        if (s_count < WIFI_STORE_MAX) {
+            i = s_count++;
+        } else {
+            // Evict the least recently connected network
+            i = 0;
+            for (size_t j = 1; j < s_count; j++)
+                if (s_nets[j].last_ok_seq < s_nets[i].last_ok_seq) i = j;
+            ESP_LOGW(TAG, "Store full, forgetting %s", s_nets[i].ssid);
+        }
+        memset(&s_nets[i], 0, sizeof(s_nets[i]));
+        strcpy(s_nets[i].ssid, ssid);
+    }
+    strcpy(s_nets[i].pass, pass);
+    store_save();
+    xSemaphoreGive(s_mutex);
+    return ESP_OK;
+}
+
+void wifi_store_remove(const char *ssid)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    int i = store_index(ssid);
+    if (i >= 0) {
+        memmove(&s_nets[i], &s_nets[i + 1], (s_count - i - 1) * sizeof(s_nets[0]));
+        s_count--;
+        store_save();
+        ESP_LOGW(TAG, "Forgot %s", ssid);
+    }
+    xSemaphoreGive(s_mutex);
+}
+
+void wifi_store_mark_ok(const char *ssid)
+{
+    uint32_t now = ntp_sync_is_synced() ? (uint32_t)time(NULL) : 0;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    int i = store_index(ssid);
+    if (i >= 0) {
+        wifi_store_net_t *n = &s_nets[i];
+        bool newest = n->last_ok_seq && n->last_ok_seq == s_seq;
+        // Flash is written when the most recent network changes, or to
+        // refresh an old or missing timestamp
+        if (!newest || (now && now - n->last_ok_time > RESTAMP_S)) {
+            if (!newest) n->last_ok_seq = ++s_seq;
+            if (now) n->last_ok_time = now;
+            store_save();
+        }
+    }
+    xSemaphoreGive(s_mutex);
+}
+
+bool wifi_store_recent(wifi_store_net_t *out)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    int best = -1;
+    for (size_t i = 0; i < s_count; i++)
+        if (best < 0 || s_nets[i].last_ok_seq > s_nets[best].last_ok_seq) best = i;
+    if (best >= 0) *out = s_nets[best];
+    xSemaphoreGive(s_mutex);
+    return best >= 0;
+}
+
+bool wifi_store_pick(const wifi_scan_ap_t *aps, size_t n,
+                     wifi_store_net_t *net, const wifi_scan_ap_t **ap)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    int best = -1, best_ap = -1, best_score = INT32_MIN;
+    for (size_t a = 0; a < n; a++) {
+        int i = store_index(aps[a].ssid);
+        if (i < 0) continue;
+        int bonus = s_nets[i].last_ok_seq == 0     ? 0 :
+                    s_nets[i].last_ok_seq == s_seq ? WIFI_STORE_RECENT_BONUS_DB :
+                                                     WIFI_STORE_RECENT_BONUS_DB / 2;
+        int score = aps[a].rssi + bonus;
+        if (score > best_score) {
+            best_score = score;
+            best       = i;
+            best_ap    = a;
+        }
+    }
+    if (best >= 0) {
+        *net = s_nets[best];
+        *ap  = &aps[best_ap];
+    }
+    xSemaphoreGive(s_mutex);
+    return best >= 0;
+}
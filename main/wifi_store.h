@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_wifi.h"
+#include "wifi_scan.h"
+
+// Known networks, NVS-backed, up to WIFI_STORE_MAX. Adding to a full list
+// evicts the network that connected least recently.
+typedef struct {
+    char     ssid[33];
+    char     pass[65];
+    uint32_t last_ok_seq;       // 0 = never connected; higher = more recent
+    uint32_t last_ok_time;      // Unix time of the last success, 0 if unknown
+} wifi_store_net_t;
+
+// Load the list; a single STA config from before the store is imported
+void wifi_store_init(const wifi_config_t *legacy);
+
+size_t wifi_store_count(void);
+bool   wifi_store_get(size_t i, wifi_store_net_t *out);
+
+// Add or update (password) a network
+esp_err_t wifi_store_add(const char *ssid, const char *pass);
+void      wifi_store_remove(const char *ssid);
+
+// Record a successful connection
+void wifi_store_mark_ok(const char *ssid);
+
+// Network that connected most recently, or the first one if none has
+bool wifi_store_recent(wifi_store_net_t *out);
+
+// Best visible known network among scan results: RSSI plus
+// WIFI_STORE_RECENT_BONUS_DB for the most recent success (half of it for
+// older successes). *ap points into aps.
+bool wifi_store_pick(const wifi_scan_ap_t *aps, size_t n,
+                     wifi_store_net_t *net, const wifi_scan_ap_t **ap);